@@ -0,0 +1,79 @@
+/**
+ * Tests the sketch-based $approxCountDistinct and $approxPercentile accumulators.
+ */
+(function() {
+    "use strict";
+
+    const coll = db.approximate_accumulators;
+    coll.drop();
+
+    const numDocs = 10000;
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < numDocs; ++i) {
+        bulk.insert({_id: i, group: i % 2, value: i, dup: i % 100, str: "str" + (i % 50)});
+    }
+    assert.writeOK(bulk.execute());
+
+    // Small cardinalities are estimated exactly.
+    let results = coll.aggregate([
+                          {$group: {_id: "$group", dups: {$approxCountDistinct: "$dup"}}},
+                          {$sort: {_id: 1}}
+                      ])
+                      .toArray();
+    assert.eq(results, [{_id: 0, dups: 50}, {_id: 1, dups: 50}]);
+
+    results = coll.aggregate([{$group: {_id: null, strs: {$approxCountDistinct: "$str"}}}])
+                  .toArray();
+    assert.eq(results, [{_id: null, strs: 50}]);
+
+    // Larger cardinalities are estimated to within a few percent.
+    results = coll.aggregate([{$group: {_id: null, values: {$approxCountDistinct: "$value"}}}])
+                  .toArray();
+    assert.eq(results.length, 1);
+    assert.lte(Math.abs(results[0].values - numDocs), numDocs * 0.05, tojson(results));
+
+    // A single percentile produces a single number.
+    results =
+        coll.aggregate([{
+                $group:
+                    {_id: null, median: {$approxPercentile: {input: "$value", p: 0.5}}}
+            }])
+            .toArray();
+    assert.eq(results.length, 1);
+    assert.lte(Math.abs(results[0].median - numDocs / 2), numDocs * 0.01, tojson(results));
+
+    // An array of percentiles produces an array of the same length, and the extremes are exact.
+    results = coll.aggregate([{
+                          $group: {
+                              _id: null,
+                              percentiles: {$approxPercentile: {input: "$value", p: [0, 0.9, 1]}}
+                          }
+                      }])
+                  .toArray();
+    assert.eq(results.length, 1);
+    const percentiles = results[0].percentiles;
+    assert.eq(percentiles.length, 3, tojson(results));
+    assert.eq(percentiles[0], 0, tojson(results));
+    assert.lte(Math.abs(percentiles[1] - numDocs * 0.9), numDocs * 0.01, tojson(results));
+    assert.eq(percentiles[2], numDocs - 1, tojson(results));
+
+    // Non-numeric input is ignored.
+    results =
+        coll.aggregate([{
+                $group: {_id: null, p: {$approxPercentile: {input: "$str", p: 0.5}}}
+            }])
+            .toArray();
+    assert.eq(results, [{_id: null, p: null}]);
+
+    // Percentiles must be between 0 and 1.
+    assert.commandFailedWithCode(db.runCommand({
+        aggregate: coll.getName(),
+        pipeline: [{$group: {_id: null, p: {$approxPercentile: {input: "$value", p: 2}}}}]
+    }),
+                                 40310);
+    assert.commandFailedWithCode(db.runCommand({
+        aggregate: coll.getName(),
+        pipeline: [{$group: {_id: null, p: {$approxPercentile: "$value"}}}]
+    }),
+                                 40312);
+}());
@@ -0,0 +1,102 @@
+/**
+ * Tests that $merge writes into an existing collection in place, according to its 'on',
+ * 'whenMatched' and 'whenNotMatched' options.
+ */
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // For assertErrorCode.
+
+    const source = db.merge_basic_source;
+    const target = db.merge_basic_target;
+    source.drop();
+    target.drop();
+
+    for (let i = 0; i < 10; ++i) {
+        assert.writeOK(source.insert({_id: i, hour: Math.floor(i / 5), x: i}));
+    }
+
+    function mergeHour(hour, options) {
+        const spec = Object.extend({into: target.getName()}, options);
+        source.aggregate([
+            {$match: {hour: hour}},
+            {$group: {_id: "$hour", total: {$sum: "$x"}, count: {$sum: 1}}},
+            {$merge: spec}
+        ]);
+    }
+
+    // By default, new documents are inserted and matching documents have their fields updated.
+    mergeHour(0);
+    assert.eq(target.find().toArray(), [{_id: 0, total: 10, count: 5}]);
+    assert.writeOK(target.update({_id: 0}, {$set: {note: "kept"}}));
+
+    assert.writeOK(source.insert({_id: 10, hour: 0, x: 10}));
+    mergeHour(0);
+    mergeHour(1);
+    assert.eq(target.find().sort({_id: 1}).toArray(), [
+        {_id: 0, total: 20, count: 6, note: "kept"},
+        {_id: 1, total: 35, count: 5}
+    ]);
+
+    // Replacing drops fields which are not in the new document.
+    mergeHour(0, {whenMatched: "replace"});
+    assert.eq(target.findOne({_id: 0}), {_id: 0, total: 20, count: 6});
+
+    // Existing documents can be left alone, and unmatched documents can be discarded.
+    assert.writeOK(source.insert({_id: 11, hour: 0, x: 11}));
+    mergeHour(0, {whenMatched: "keepExisting"});
+    assert.eq(target.findOne({_id: 0}), {_id: 0, total: 20, count: 6});
+    assert.writeOK(target.remove({_id: 1}));
+    mergeHour(1, {whenNotMatched: "discard"});
+    assert.eq(target.find().toArray(), [{_id: 0, total: 20, count: 6}]);
+
+    // With whenMatched: "fail", a matching document is a duplicate key error.
+    assertErrorCode(source,
+                    [
+                      {$match: {hour: 0}},
+                      {$group: {_id: "$hour"}},
+                      {$merge: {into: target.getName(), whenMatched: "fail"}}
+                    ],
+                    40347);
+
+    // Matching on fields other than _id requires a unique index on exactly those fields.
+    const byHourPipeline = [
+        {$group: {_id: null, hour: {$max: "$hour"}, total: {$sum: "$x"}}},
+        {$project: {_id: 0}},
+        {$merge: {into: target.getName(), on: "hour"}}
+    ];
+    assertErrorCode(source, byHourPipeline, 40345);
+
+    target.drop();
+    assert.commandWorked(target.createIndex({hour: 1}, {unique: true}));
+    source.aggregate(byHourPipeline);
+    source.aggregate(byHourPipeline);
+    assert.eq(target.find({}, {_id: 0}).toArray(), [{hour: 1, total: 66}]);
+
+    // Documents matched on other fields keep their own _id, and new documents get the _id of the
+    // merged document when merging.
+    const existingId = target.findOne({hour: 1})._id;
+    function mergeByHour(whenMatched) {
+        source.aggregate([
+            {$group: {_id: "$hour", hour: {$first: "$hour"}, total: {$sum: "$x"}}},
+            {$merge: {into: target.getName(), on: "hour", whenMatched: whenMatched}}
+        ]);
+    }
+    mergeByHour("merge");
+    assert.eq(target.find().sort({hour: 1}).toArray(),
+              [{_id: 0, hour: 0, total: 31}, {_id: existingId, hour: 1, total: 35}]);
+    assert.writeOK(target.update({hour: 1}, {$set: {note: "replaced"}}));
+    mergeByHour("replace");
+    assert.eq(target.find().sort({hour: 1}).toArray(),
+              [{_id: 0, hour: 0, total: 31}, {_id: existingId, hour: 1, total: 35}]);
+
+    // Every document needs a non-array value for the 'on' fields.
+    assertErrorCode(source,
+                    [{$project: {_id: 0, x: 1}}, {$merge: {into: target.getName(), on: "hour"}}],
+                    40346);
+
+    // $merge must be the last stage, and cannot write into the collection being aggregated.
+    assertErrorCode(source, [{$merge: {into: target.getName()}}, {$match: {}}],
+                    ErrorCodes.BadValue);
+    assertErrorCode(source, [{$merge: {into: source.getName()}}], 40348);
+}());
@@ -0,0 +1,84 @@
+/**
+ * Tests the behavior of $setWindowFields with whole-partition, document-based and range-based
+ * windows.
+ */
+(function() {
+    "use strict";
+
+    const coll = db.set_window_fields_basic;
+    coll.drop();
+
+    for (let i = 0; i < 10; ++i) {
+        assert.writeOK(coll.insert({_id: i, part: i % 2, t: i * 10, x: i}));
+    }
+
+    // Without a window, every document sees its whole partition.
+    let results = coll.aggregate([
+                          {$setWindowFields: {partitionBy: "$part", output: {total: {$sum: "$x"}}}},
+                          {$project: {_id: 1, total: 1}},
+                          {$sort: {_id: 1}}
+                      ])
+                      .toArray();
+    assert.eq(results.length, 10);
+    results.forEach(doc => assert.eq(doc.total, doc._id % 2 === 0 ? 20 : 25, tojson(doc)));
+
+    // A running total, which resets at each partition.
+    results = coll.aggregate([
+                      {
+                        $setWindowFields: {
+                            partitionBy: "$part",
+                            sortBy: {t: 1},
+                            output: {
+                                running: {$sum: "$x", window: {documents: ["unbounded", "current"]}}
+                            }
+                        }
+                      },
+                      {$sort: {_id: 1}}
+                  ])
+                  .toArray();
+    let expectedRunning = [0, 1, 2, 4, 6, 9, 12, 16, 20, 25];
+    results.forEach(doc => assert.eq(doc.running, expectedRunning[doc._id], tojson(doc)));
+
+    // A sliding average and maximum over the previous, current and next documents.
+    results = coll.aggregate([
+                      {
+                        $setWindowFields: {
+                            sortBy: {t: 1},
+                            output: {
+                                avg: {$avg: "$x", window: {documents: [-1, 1]}},
+                                max: {$max: "$x", window: {documents: [-1, 1]}}
+                            }
+                        }
+                      },
+                      {$sort: {_id: 1}}
+                  ])
+                  .toArray();
+    results.forEach(function(doc) {
+        const lo = Math.max(0, doc._id - 1);
+        const hi = Math.min(9, doc._id + 1);
+        assert.eq(doc.avg, (lo + hi) / 2, tojson(doc));
+        assert.eq(doc.max, hi, tojson(doc));
+    });
+
+    // A range window of sort key values within 15 below the current document.
+    results = coll.aggregate([
+                      {
+                        $setWindowFields:
+                            {sortBy: {t: 1}, output: {count: {$sum: 1, window: {range: [-15, 0]}}}}
+                      },
+                      {$sort: {_id: 1}}
+                  ])
+                  .toArray();
+    results.forEach(doc => assert.eq(doc.count, doc._id === 0 ? 1 : 2, tojson(doc)));
+
+    // Accumulators which cannot remove values are rejected in windows with a lower bound.
+    assert.commandFailedWithCode(
+        db.runCommand({
+            aggregate: coll.getName(),
+            pipeline: [{
+                $setWindowFields:
+                    {sortBy: {t: 1}, output: {all: {$push: "$x", window: {documents: [-1, 0]}}}}
+            }]
+        }),
+        40325);
+}());
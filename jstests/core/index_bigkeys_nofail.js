@@ -45,6 +45,22 @@
     assert.writeOK(t.update({_id: 3}, {$set: {name: 'short'}}));
     assert.writeError(t.update({_id: 3}, {$set: {name: x}}));
 
+    // Index builds keep the other keys in order around an oversized one.
+    t.drop();
+    db.getSiblingDB('admin').runCommand({setParameter: 1, failIndexKeyTooLong: false});
+    for (var i = 0; i < 100; i++) {
+        assert.writeOK(t.insert({_id: i, name: "k" + ((i * 37) % 100 + 100)}));
+        if (i == 50) {
+            assert.writeOK(t.insert({_id: "big", name: x}));
+        }
+    }
+    assert.commandWorked(t.ensureIndex({name: 1}));
+    var names = t.find({name: {$lt: "l"}}, {_id: 0, name: 1}).hint({name: 1}).toArray();
+    assert.eq(100, names.length);
+    for (var i = 0; i < 100; i++) {
+        assert.eq("k" + (i + 100), names[i].name);
+    }
+
     db.getSiblingDB('admin').runCommand({setParameter: 1, failIndexKeyTooLong: was});
 
     // Explicitly drop the collection to avoid failures in post-test hooks that run dbHash and
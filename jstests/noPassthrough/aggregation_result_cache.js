@@ -0,0 +1,112 @@
+// Tests that the aggregation result cache serves repeated aggregations on views and on pipelines run
+// with the 'cacheResults' option, and that writes to the underlying collections invalidate it.
+(function() {
+    'use strict';
+
+    const conn = MongoRunner.runMongod({setParameter: "aggregationResultCacheMaxBytes=1048576"});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+    const coll = testDB.aggregation_result_cache;
+    const foreign = testDB.aggregation_result_cache_foreign;
+
+    function cacheMetrics() {
+        return testDB.serverStatus().metrics.aggregate.resultCache;
+    }
+
+    function runAndCountHits(cmdObj) {
+        const before = cacheMetrics();
+        const res = assert.commandWorked(testDB.runCommand(cmdObj));
+        const after = cacheMetrics();
+        return {
+            batch: res.cursor.firstBatch,
+            ns: res.cursor.ns,
+            hits: after.hits - before.hits,
+            misses: after.misses - before.misses
+        };
+    }
+
+    assert.writeOK(coll.insert([{_id: 1, x: 1}, {_id: 2, x: 2}, {_id: 3, x: 3}]));
+    assert.commandWorked(testDB.createView("aggregation_result_cache_view",
+                                           coll.getName(),
+                                           [{$match: {x: {$gte: 2}}}]));
+
+    const viewCmd = {
+        aggregate: "aggregation_result_cache_view",
+        pipeline: [{$sort: {_id: 1}}],
+        cursor: {}
+    };
+
+    // The first aggregation on the view misses and populates the cache; the second is a hit.
+    let result = runAndCountHits(viewCmd);
+    assert.eq([{_id: 2, x: 2}, {_id: 3, x: 3}], result.batch);
+    assert.eq(0, result.hits);
+    assert.eq(1, result.misses);
+
+    result = runAndCountHits(viewCmd);
+    assert.eq([{_id: 2, x: 2}, {_id: 3, x: 3}], result.batch);
+    assert.eq("test.aggregation_result_cache_view", result.ns);
+    assert.eq(1, result.hits);
+
+    // A write to the underlying collection invalidates the cached results.
+    assert.writeOK(coll.insert({_id: 4, x: 4}));
+    result = runAndCountHits(viewCmd);
+    assert.eq(4, result.batch.length);
+    assert.eq(0, result.hits);
+
+    // Aggregations on collections are only cached when they ask for it.
+    const collCmd = {aggregate: coll.getName(), pipeline: [{$match: {x: 1}}], cursor: {}};
+    runAndCountHits(collCmd);
+    result = runAndCountHits(collCmd);
+    assert.eq(0, result.hits);
+    assert.eq(0, result.misses);
+
+    collCmd.cacheResults = true;
+    runAndCountHits(collCmd);
+    result = runAndCountHits(collCmd);
+    assert.eq([{_id: 1, x: 1}], result.batch);
+    assert.eq(1, result.hits);
+
+    // Writes to a collection read by $lookup also invalidate the cached results.
+    assert.writeOK(foreign.insert({_id: 1, y: 1}));
+    const lookupCmd = {
+        aggregate: coll.getName(),
+        pipeline: [
+            {$match: {_id: 1}},
+            {$lookup: {from: foreign.getName(), localField: "x", foreignField: "y", as: "joined"}}
+        ],
+        cursor: {},
+        cacheResults: true
+    };
+    runAndCountHits(lookupCmd);
+    result = runAndCountHits(lookupCmd);
+    assert.eq(1, result.hits);
+    assert.eq(1, result.batch[0].joined.length);
+
+    assert.writeOK(foreign.insert({_id: 2, y: 1}));
+    result = runAndCountHits(lookupCmd);
+    assert.eq(0, result.hits);
+    assert.eq(2, result.batch[0].joined.length);
+
+    // Results which do not fit in the first batch are never cached.
+    const batchCmd = {
+        aggregate: coll.getName(),
+        pipeline: [{$sort: {_id: 1}}],
+        cursor: {batchSize: 2},
+        cacheResults: true
+    };
+    runAndCountHits(batchCmd);
+    result = runAndCountHits(batchCmd);
+    assert.eq(0, result.hits);
+
+    // Pipelines which write are never cached.
+    const outCmd = {
+        aggregate: coll.getName(),
+        pipeline: [{$out: "aggregation_result_cache_out"}],
+        cursor: {},
+        cacheResults: true
+    };
+    result = runAndCountHits(outCmd);
+    assert.eq(0, result.misses);
+
+    MongoRunner.stopMongod(conn);
+})();
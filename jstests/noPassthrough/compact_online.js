@@ -0,0 +1,40 @@
+// Tests that online compaction reclaims space from a WiredTiger collection while other operations
+// on it continue.
+(function() {
+    'use strict';
+
+    const conn = MongoRunner.runMongod({storageEngine: "wiredTiger"});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+    const coll = testDB.compact_online;
+
+    const padding = 'x'.repeat(1024);
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < 20000; ++i) {
+        bulk.insert({_id: i, padding: padding});
+    }
+    assert.writeOK(bulk.execute());
+    assert.commandWorked(coll.createIndex({padding: 1}));
+    assert.writeOK(coll.remove({_id: {$gte: 1000}}));
+    assert.commandWorked(testDB.adminCommand({fsync: 1}));
+    const sizeBefore = coll.stats().storageSize;
+
+    // Writes keep going while the collection is compacted.
+    const awaitCompact = startParallelShell(function() {
+        assert.commandWorked(db.getSiblingDB("test").runCommand(
+            {compact: "compact_online", online: true}));
+    }, conn.port);
+    for (let i = 0; i < 100; ++i) {
+        assert.writeOK(coll.insert({_id: "new" + i}));
+    }
+    // Only intent locks are held while a table is compacted, so reads don't wait either.
+    assert.eq(1, coll.find({_id: 0}).itcount());
+    awaitCompact();
+
+    assert.eq(1100, coll.count());
+    assert.commandWorked(testDB.adminCommand({fsync: 1}));
+    assert.lt(coll.stats().storageSize, sizeBefore);
+    assert.commandWorked(coll.validate(true));
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,141 @@
+// Tests that hybrid index builds, which load their indexes in bulk and then apply the writes made
+// to the collection during the build, build the same indexes as if there had been no such writes.
+(function() {
+    'use strict';
+
+    load("jstests/libs/analyze_plan.js");
+
+    const conn = MongoRunner.runMongod(
+        {storageEngine: "wiredTiger", setParameter: {hybridIndexBuilds: true}});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+    const coll = testDB.index_build_hybrid;
+
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < 1000; ++i) {
+        bulk.insert({_id: i, a: i, b: [i, -i]});
+    }
+    assert.writeOK(bulk.execute());
+
+    function waitForScannedIndexBuild() {
+        assert.soon(function() {
+            return testDB.currentOp().inprog.some(function(op) {
+                return op.msg && op.msg.includes("Index Build (background)") && op.progress &&
+                    op.progress.done === op.progress.total;
+            });
+        }, "index build did not finish scanning the collection");
+    }
+
+    // Builds 'indexes' while running 'writes' once the build has scanned the collection, so the
+    // writes change documents it already read.
+    function buildIndexesWhileWriting(indexes, writes) {
+        assert.commandWorked(testDB.adminCommand(
+            {configureFailPoint: 'hangAfterStartingIndexBuild', mode: 'alwaysOn'}));
+        const awaitBuild = startParallelShell(
+            "assert.commandWorked(db.getSiblingDB('test').runCommand(" +
+                tojson({createIndexes: coll.getName(), indexes: indexes}) + "));",
+            conn.port);
+        try {
+            waitForScannedIndexBuild();
+            writes();
+        } finally {
+            assert.commandWorked(testDB.adminCommand(
+                {configureFailPoint: 'hangAfterStartingIndexBuild', mode: 'off'}));
+        }
+        awaitBuild();
+    }
+
+    buildIndexesWhileWriting(
+        [
+          {key: {a: 1}, name: "a_1", background: true},
+          {key: {b: 1}, name: "b_1", background: true},
+          {key: {a: -1, b: 1}, name: "a_-1_b_1", background: true},
+          {key: {c: 1}, name: "c_1", background: true}
+        ],
+        function() {
+            assert.writeOK(coll.insert({_id: "new", a: 5, b: [1, 2, 3], c: [1, 2]}));
+            assert.writeOK(coll.update({_id: {$lt: 100}}, {$inc: {a: 1000}}, {multi: true}));
+            assert.writeOK(coll.update({_id: -1}, {$set: {a: 0}}, {upsert: true}));
+            assert.writeOK(coll.remove({_id: {$gte: 900}}));
+            assert.writeOK(coll.update({_id: 500}, {$set: {b: 7}}));
+            assert.writeOK(coll.update({_id: 500}, {$set: {b: [8, 9]}}));
+        });
+
+    // These writes change documents the indexes built above already hold.
+    buildIndexesWhileWriting([{
+                                 key: {a: 1, _id: 1},
+                                 name: "partial",
+                                 background: true,
+                                 partialFilterExpression: {a: {$lt: 10}}
+                             }],
+                             function() {
+                                 assert.writeOK(coll.update({_id: 150}, {$set: {a: 3}}));
+                                 assert.writeOK(coll.remove({_id: 5}));
+                             });
+
+    // Updates which only change an included field rewrite the entries loaded in bulk.
+    const includeIndex =
+        {key: {a: 1, _id: 1}, name: "a_include_e", background: true, include: ["e"]};
+    buildIndexesWhileWriting([includeIndex], function() {
+        assert.writeOK(coll.update({_id: 200}, {$set: {e: "new"}}));
+        assert.writeOK(coll.update({_id: 201}, {$set: {e: 1}}));
+        assert.writeOK(coll.update({_id: 201}, {$set: {e: 2}}));
+    });
+
+    // Builds whose writes outgrow their memory budget before the bulk load restart as classic
+    // background builds, which the writes made meanwhile went to directly.
+    function setMaxSideWritesBytes(bytes) {
+        assert.commandWorked(
+            testDB.adminCommand({setParameter: 1, hybridIndexBuildMaxSideWritesBytes: bytes}));
+    }
+    setMaxSideWritesBytes(1);
+    buildIndexesWhileWriting([{key: {d: 1}, name: "d_1", background: true}], function() {
+        assert.writeOK(coll.update({_id: {$lt: 10}}, {$set: {d: 1}}, {multi: true}));
+        assert.writeOK(coll.insert([{_id: "d1", d: 1}, {_id: "d2", d: 2}]));
+        assert.writeOK(coll.remove({_id: "d2"}));
+    });
+    setMaxSideWritesBytes(100 * 1024 * 1024);
+    const log = assert.commandWorked(testDB.adminCommand({getLog: "global"})).log;
+    assert(log.some(line => line.includes("building indexes without bulk method")), tojson(log));
+    assert.eq(10, coll.find({d: 1}).hint({d: 1}).itcount());
+    assert.eq(0, coll.find({d: 2}).hint({d: 1}).itcount());
+    assert.eq(902, coll.find().hint({d: 1}).itcount());
+
+    assert.eq(8, coll.getIndexes().length);
+    assert.commandWorked(coll.validate(true));
+
+    function keysExamined(query, hint) {
+        const explain = coll.find(query).hint(hint).explain("executionStats");
+        return explain.executionStats.totalKeysExamined;
+    }
+
+    // 899 of the original documents remain, plus the three inserted or upserted during builds.
+    assert.eq(902, coll.find().hint({a: 1}).itcount());
+    assert.eq(902, coll.find().hint({a: -1, b: 1}).itcount());
+    assert.eq(99, coll.find({a: {$gte: 1000}}).hint({a: 1}).itcount());
+    assert.eq(0, coll.find({a: {$gte: 900, $lt: 1000}}).hint({a: 1}).itcount());
+    assert.eq(1, coll.find({a: 5}).hint({a: 1}).itcount());
+    assert.eq(1, coll.find({b: 8}).hint({b: 1}).itcount());
+    assert.eq(0, coll.find({b: {$in: [7, 500, -500]}}).hint({b: 1}).itcount());
+
+    // The partial index holds the documents with a < 10: "new", the upserted one, and the one
+    // moved into it, but not those moved out of it or removed.
+    assert.eq([0, 3, 5],
+              coll.find({a: {$lt: 10}}).hint("partial").toArray().map(doc => doc.a).sort());
+    assert.eq(3, keysExamined({a: {$lt: 10}}, "partial"));
+
+    // The entries of the documents updated during the build hold their current included values.
+    const includeQuery = {_id: {$in: [200, 201]}};
+    const includeProj = {_id: 1, a: 1, e: 1};
+    const explain = coll.find(includeQuery, includeProj).hint("a_include_e").explain();
+    assert(isIndexOnly(explain.queryPlanner.winningPlan), tojson(explain));
+    assert.eq([{_id: 200, a: 200, e: "new"}, {_id: 201, a: 201, e: 2}],
+              coll.find(includeQuery, includeProj).hint("a_include_e").sort({_id: 1}).toArray());
+
+    // Only a document inserted during the build has an array for 'c', which still makes the index
+    // multikey.
+    assert.eq(2, keysExamined({c: {$gte: 0}}, {c: 1}));
+    assert(coll.find({c: 1}).hint({c: 1}).explain().queryPlanner.winningPlan.inputStage.isMultiKey);
+
+    MongoRunner.stopMongod(conn);
+})();
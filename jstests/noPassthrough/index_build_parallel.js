@@ -0,0 +1,56 @@
+// Tests that foreground index builds which generate their keys on several threads build the same
+// indexes as single threaded builds, and still report errors.
+(function() {
+    'use strict';
+
+    const conn = MongoRunner.runMongod({setParameter: {indexBuildThreads: 4}});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+    const coll = testDB.index_build_parallel;
+
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < 50000; ++i) {
+        bulk.insert({_id: i, a: i % 1000, b: [i, -i], c: "str" + (i % 7), u: i});
+    }
+    assert.writeOK(bulk.execute());
+
+    assert.commandWorked(coll.createIndexes([{a: 1, c: -1}, {b: 1}, {c: 1}, {u: 1}]));
+    assert.commandWorked(
+        coll.createIndex({a: 1}, {name: "partial", partialFilterExpression: {a: {$lt: 10}}}));
+    assert.commandWorked(coll.validate(true));
+
+    function keysExamined(query, hint) {
+        const explain = coll.find(query).hint(hint).explain("executionStats");
+        return explain.executionStats.totalKeysExamined;
+    }
+
+    assert.eq(50000, coll.find().hint({a: 1, c: -1}).itcount());
+    assert.eq(100000, keysExamined({b: {$exists: true}}, {b: 1}));
+    assert.eq(50, coll.find({a: 7}).hint({a: 1, c: -1}).itcount());
+    assert.eq(500, coll.find({a: {$lt: 10}}).hint("partial").itcount());
+    assert.eq([{u: 49999}],
+              coll.find({}, {_id: 0, u: 1}).sort({u: -1}).hint({u: 1}).limit(1).toArray());
+
+    // Multikey indexes are still marked as such.
+    assert(coll.find({b: 5}).hint({b: 1}).explain().queryPlanner.winningPlan.inputStage.isMultiKey);
+
+    // Duplicates found by the workers fail unique index builds.
+    assert.commandFailedWithCode(coll.createIndex({a: 1}, {unique: true}), ErrorCodes.DuplicateKey);
+    assert.commandWorked(coll.createIndex({u: 1, a: 1}, {unique: true}));
+
+    // Errors generating keys on a worker fail the build.
+    assert.writeOK(coll.insert({_id: "badGeo", loc: {type: "Point", coordinates: [1000, 1000]}}));
+    assert.commandFailed(coll.createIndex({loc: "2dsphere"}));
+    assert.eq(7, coll.getIndexes().length);
+
+    // Thread counts out of range are rejected.
+    for (let param of ["indexBuildThreads", "indexBuildSortThreads"]) {
+        assert.commandFailedWithCode(testDB.adminCommand({setParameter: 1, [param]: 0}),
+                                     ErrorCodes.BadValue);
+        assert.commandFailedWithCode(testDB.adminCommand({setParameter: 1, [param]: 100000}),
+                                     ErrorCodes.BadValue);
+        assert.commandWorked(testDB.adminCommand({setParameter: 1, [param]: 2}));
+    }
+
+    MongoRunner.stopMongod(conn);
+})();
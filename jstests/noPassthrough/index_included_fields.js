@@ -0,0 +1,62 @@
+// Tests that indexes with non-key included fields validate their options, keep the included values
+// up to date, and cover queries which project the included fields.
+(function() {
+    'use strict';
+
+    load("jstests/libs/analyze_plan.js");
+
+    const conn = MongoRunner.runMongod({storageEngine: "wiredTiger"});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+    const coll = testDB.index_included_fields;
+
+    assert.commandFailed(coll.createIndex({a: 1}, {include: []}));
+    assert.commandFailed(coll.createIndex({a: 1}, {include: "b"}));
+    assert.commandFailed(coll.createIndex({a: 1}, {include: ["a"]}));
+    assert.commandFailed(coll.createIndex({a: 1}, {include: ["b.c"]}));
+    assert.commandFailed(coll.createIndex({a: 1}, {include: ["b", "b"]}));
+    assert.commandFailed(coll.createIndex({a: 1}, {include: ["b"], unique: true}));
+    assert.commandFailed(coll.createIndex({a: "hashed"}, {include: ["b"]}));
+
+    // Documents which exist before the index is built are indexed with their included values.
+    assert.writeOK(coll.insert({_id: 1, a: 1, b: "one", c: 1}));
+    assert.commandWorked(coll.createIndex({a: 1}, {include: ["b"]}));
+    assert.writeOK(coll.insert({_id: 2, a: 2, b: "two", c: 2}));
+    assert.writeOK(coll.insert({_id: 3, a: 3, c: 3}));
+
+    function coveredFind(query) {
+        const proj = {_id: 0, a: 1, b: 1};
+        const explain = coll.find(query, proj).explain("executionStats");
+        assert(isIndexOnly(explain.queryPlanner.winningPlan), tojson(explain));
+        assert.eq(0, explain.executionStats.totalDocsExamined, tojson(explain));
+        return coll.find(query, proj).sort({a: 1}).toArray();
+    }
+
+    assert.eq([{a: 1, b: "one"}, {a: 2, b: "two"}, {a: 3, b: null}], coveredFind({a: {$gte: 1}}));
+
+    // Updates to an included field alone rewrite the index entry.
+    assert.writeOK(coll.update({_id: 2}, {$set: {b: "deux"}}));
+    assert.writeOK(coll.update({_id: 3}, {$set: {b: ["x", "y"]}}));
+    assert.eq([{a: 2, b: "deux"}, {a: 3, b: ["x", "y"]}], coveredFind({a: {$gte: 2}}));
+
+    // Fields which are neither keys nor included still require fetching the document.
+    let explain = coll.find({a: 1}, {_id: 0, a: 1, c: 1}).explain();
+    assert(!isIndexOnly(explain.queryPlanner.winningPlan), tojson(explain));
+
+    // Indexes built in bulk over existing documents are ordered by their keys alone.
+    assert.commandWorked(coll.createIndex({c: -1}, {include: ["b"]}));
+    const query = {c: {$gte: 1}};
+    const proj = {_id: 0, b: 1, c: 1};
+    explain = coll.find(query, proj).sort({c: -1}).explain("executionStats");
+    assert(isIndexOnly(explain.queryPlanner.winningPlan), tojson(explain));
+    assert.eq(0, explain.executionStats.totalDocsExamined, tojson(explain));
+    const results = coll.find(query, proj).sort({c: -1}).toArray();
+    assert.eq([3, 2, 1], results.map(doc => doc.c), tojson(results));
+    assert.eq([["x", "y"], "deux", "one"], results.map(doc => doc.b), tojson(results));
+
+    // Updating a field the new index includes rewrites its entry as well.
+    assert.writeOK(coll.update({_id: 1}, {$set: {b: "uno"}}));
+    assert.eq("uno", coll.findOne({c: 1}, proj).b);
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,38 @@
+// Tests that collStats reports how well collections compress with the block compressor they were
+// created with.
+(function() {
+    'use strict';
+
+    const conn = MongoRunner.runMongod({storageEngine: "wiredTiger"});
+    assert.neq(null, conn, "mongod was unable to start up");
+    const testDB = conn.getDB("test");
+
+    function createAndFill(compressor) {
+        assert.commandWorked(testDB.createCollection(
+            compressor,
+            {storageEngine: {wiredTiger: {configString: "block_compressor=" + compressor}}}));
+        const coll = testDB[compressor];
+        const bulk = coll.initializeUnorderedBulkOp();
+        for (let i = 0; i < 10000; ++i) {
+            bulk.insert(
+                {_id: i, status: "active", kind: "reading", tags: ["a", "b", "c"], value: i});
+        }
+        assert.writeOK(bulk.execute());
+        return coll;
+    }
+
+    const zlib = createAndFill("zlib");
+    const none = createAndFill("none");
+
+    // The file sizes the ratio is computed from are only updated by checkpoints.
+    assert.commandWorked(testDB.adminCommand({fsync: 1}));
+
+    const zlibStats = assert.commandWorked(zlib.stats()).wiredTiger;
+    const noneStats = assert.commandWorked(none.stats()).wiredTiger;
+    assert(zlibStats.creationString.includes("block_compressor=zlib"),
+           tojson(zlibStats.creationString));
+    assert.gt(zlibStats.compressionRatio, 1, tojson(zlibStats));
+    assert.gt(zlibStats.compressionRatio, noneStats.compressionRatio, tojson(noneStats));
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,60 @@
+// Tests that merging sharded aggregation results which span several batches per shard, with the
+// merger prefetching the next batch from every shard, returns complete and correctly sorted
+// results, and that abandoning the merge early leaves no cursors open on the shards.
+(function() {
+    'use strict';
+
+    const st = new ShardingTest({shards: 2});
+    const testDB = st.s.getDB("test");
+    const coll = testDB.agg_merge_cursors_prefetch;
+
+    assert.commandWorked(st.s.adminCommand({enableSharding: testDB.getName()}));
+    st.ensurePrimaryShard(testDB.getName(), 'shard0000');
+    assert.commandWorked(st.s.adminCommand({shardCollection: coll.getFullName(), key: {_id: 1}}));
+    assert.commandWorked(st.s.adminCommand({split: coll.getFullName(), middle: {_id: 0}}));
+    assert.commandWorked(
+        st.s.adminCommand({moveChunk: coll.getFullName(), find: {_id: 0}, to: 'shard0001'}));
+
+    // Insert enough data that each shard returns its results over several getMore batches. The
+    // 'x' values interleave across the shards, so that sorting on them merges from both shards.
+    const N = 4000;
+    const padding = 'x'.repeat(8 * 1024);
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < N; ++i) {
+        bulk.insert({_id: i % 2 === 0 ? i : -i, x: i, padding: padding});
+    }
+    assert.writeOK(bulk.execute());
+
+    function openShardCursors() {
+        return st.shard0.getDB("admin").serverStatus().metrics.cursor.open.total +
+            st.shard1.getDB("admin").serverStatus().metrics.cursor.open.total;
+    }
+
+    // A sorted merge returns every document, in order.
+    let expected = 0;
+    coll.aggregate([{$sort: {x: 1}}, {$project: {x: 1}}], {allowDiskUse: true})
+        .forEach(function(doc) {
+            assert.eq(expected++, doc.x);
+        });
+    assert.eq(N, expected);
+
+    // So does an unsorted merge, though in no particular order.
+    const seen = {};
+    coll.aggregate([{$project: {x: 1}}]).forEach(function(doc) {
+        assert(!seen.hasOwnProperty(doc.x), tojson(doc));
+        seen[doc.x] = true;
+    });
+    assert.eq(N, Object.keySet(seen).length);
+
+    // Stopping the merge before the shards are exhausted kills the shard cursors, including ones
+    // with a prefetched batch outstanding.
+    const result = coll.aggregate([{$sort: {x: -1}}, {$limit: 150}, {$project: {x: 1}}]).toArray();
+    assert.eq(150, result.length);
+    assert.eq(N - 1, result[0].x);
+    assert.eq(N - 150, result[149].x);
+    assert.soon(function() {
+        return openShardCursors() === 0;
+    });
+
+    st.stop();
+})();
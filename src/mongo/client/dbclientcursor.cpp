@@ -184,27 +184,66 @@ bool DBClientCursor::initLazyFinish(bool& retry) {
     return !retry;
 }
 
+void DBClientCursor::_assembleGetMore(Message& toSend) {
+    BufBuilder b;
+    b.appendNum(opts);
+    b.appendStr(ns);
+    b.appendNum(nextBatchSize());
+    b.appendNum(cursorId);
+
+    toSend.setData(dbGetMore, b.buf(), b.len());
+}
+
+void DBClientCursor::enablePrefetch() {
+    verify(_client);
+    verify(!haveLimit);
+    massert(40357,
+            "DBClientCursor::enablePrefetch called on a client that doesn't support lazy",
+            _client->lazySupported());
+    _prefetch = true;
+    _requestMoreLazy();
+}
+
+void DBClientCursor::_requestMoreLazy() {
+    if (!_prefetch || _moreRequested || !cursorId)
+        return;
+
+    Message toSend;
+    _assembleGetMore(toSend);
+    _client->say(toSend);
+    _moreRequested = true;
+}
+
 void DBClientCursor::requestMore() {
     verify(cursorId && batch.pos == batch.nReturned);
 
+    if (_moreRequested) {
+        _moreRequested = false;
+        Message response;
+        if (!_client->recv(response)) {
+            uasserted(40358, str::stream() << "recv failed while reading getMore response from "
+                                           << _originalHost);
+        }
+        this->batch.m = std::move(response);
+        dataReceived();
+        _requestMoreLazy();
+        return;
+    }
+
     if (haveLimit) {
         nToReturn -= batch.nReturned;
         verify(nToReturn > 0);
     }
-    BufBuilder b;
-    b.appendNum(opts);
-    b.appendStr(ns);
-    b.appendNum(nextBatchSize());
-    b.appendNum(cursorId);
 
     Message toSend;
-    toSend.setData(dbGetMore, b.buf(), b.len());
+    _assembleGetMore(toSend);
     Message response;
 
     if (_client) {
         _client->call(toSend, response);
         this->batch.m = std::move(response);
         dataReceived();
+        _requestMoreLazy();
     } else {
         verify(_scopedHost.size());
         ScopedDbConnection conn(_scopedHost);
@@ -433,6 +472,7 @@ bool DBClientCursor::peekError(BSONObj* error) {
 
 void DBClientCursor::attach(AScopedConnection* conn) {
     verify(_scopedHost.size() == 0);
+    verify(!_moreRequested);
     verify(conn);
     verify(conn->get());
 
@@ -520,7 +560,15 @@ void DBClientCursor::kill() {
     DESTRUCTOR_GUARD(
 
         if (cursorId && _ownCursor && !inShutdown()) {
-            if (_client) {
+            if (_moreRequested) {
+                // The server may still be producing the reply to a prefetched getMore, which this
+                // connection has to receive before it can send anything else. The server can't
+                // kill the cursor while that getMore is running, so in that case it is left to
+                // time out.
+                ScopedDbConnection conn(_originalHost);
+                conn->killCursor(cursorId);
+                conn.done();
+            } else if (_client) {
                 _client->killCursor(cursorId);
             } else {
                 verify(_scopedHost.size());
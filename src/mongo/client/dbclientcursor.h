@@ -205,6 +205,15 @@ public:
     void initLazy(bool isRetry = false);
     bool initLazyFinish(bool& retry);
 
+    /**
+     * Makes this cursor request its next batch as soon as the current one has been received,
+     * rather than once the current one has been consumed, so that the server produces each batch
+     * while the client iterates the previous one. Like initLazy(), this requires a client which
+     * supports lazy requests, and the connection must not be used for anything else while this
+     * cursor is alive. Cursors with a limit are not supported.
+     */
+    void enablePrefetch();
+
     class Batch {
         MONGO_DISALLOW_COPYING(Batch);
         friend class DBClientCursor;
@@ -232,9 +241,21 @@ public:
      *
      * Killing an already killed or exhausted cursor does nothing, so it is safe to always call this
      * if you want to ensure that a cursor is killed.
+     *
+     * If the reply to a prefetched getMore is still outstanding, this does not wait for it. The
+     * cursor is killed over a new connection instead, and hasPendingReply() stays true.
      */
     void kill();
 
+    /**
+     * Returns true if the reply to a prefetched getMore has not been received, even after kill().
+     * The connection can then not be used for anything else, and must be discarded rather than
+     * returned to a pool.
+     */
+    bool hasPendingReply() const {
+        return _moreRequested;
+    }
+
 private:
     DBClientCursor(DBClientBase* client,
                    const std::string& ns,
@@ -267,6 +288,8 @@ private:
     std::string _scopedHost;
     std::string _lazyHost;
     bool wasError;
+    bool _prefetch = false;
+    bool _moreRequested = false;  // a getMore has been sent and its reply not yet received
 
     void dataReceived() {
         bool retry;
@@ -284,8 +307,15 @@ private:
 
     void requestMore();
 
+    /**
+     * Sends a getMore without waiting for its reply if prefetching is enabled and no request is
+     * already outstanding. The reply is received by the next call to requestMore().
+     */
+    void _requestMoreLazy();
+
     // init pieces
     void _assembleInit(Message& toSend);
+    void _assembleGetMore(Message& toSend);
 };
 
 /** iterate over objects in current batch only - will not cause a network call
@@ -202,6 +202,21 @@ void AuthorizationSession::_addPrivilegesForStage(const std::string& db,
         }
         Privilege::addPrivilegeToPrivilegeVector(
             requiredPrivileges, Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
+    } else if (stageName == "$merge" && stageSpec.firstElementType() == BSONType::Object &&
+               stageSpec.firstElement()["into"].type() == BSONType::String) {
+        NamespaceString outputNs(db, stageSpec.firstElement()["into"].str());
+        uassert(40350,
+                mongoutils::str::stream() << "Invalid $merge target namespace, " << outputNs.ns(),
+                outputNs.isValid());
+
+        ActionSet actions;
+        actions.addAction(ActionType::insert);
+        actions.addAction(ActionType::update);
+        if (shouldBypassDocumentValidationForCommand(cmdObj)) {
+            actions.addAction(ActionType::bypassDocumentValidation);
+        }
+        Privilege::addPrivilegeToPrivilegeVector(
+            requiredPrivileges, Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
     } else if (stageName == "$lookup" && stageSpec.firstElementType() == BSONType::Object) {
         NamespaceString fromNs(db, stageSpec.firstElement()["from"].str());
         Privilege::addPrivilegeToPrivilegeVector(
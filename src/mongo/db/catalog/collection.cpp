@@ -146,6 +146,7 @@ std::string CompactOptions::toString() const {
     }
 
     ss << " validateDocuments: " << validateDocuments;
+    ss << " online: " << online;
 
     return ss.str();
 }
@@ -416,7 +417,8 @@ Status Collection::insertDocument(OperationContext* txn,
 Status Collection::insertDocument(OperationContext* txn,
                                   const BSONObj& doc,
                                   const std::vector<MultiIndexBlock*>& indexBlocks,
-                                  bool enforceQuota) {
+                                  bool enforceQuota,
+                                  RecordStoreBulkLoader* bulkLoader) {
     {
         auto status = checkValidation(txn, doc);
         if (!status.isOK())
@@ -428,8 +430,10 @@ Status Collection::insertDocument(OperationContext* txn,
     if (_mustTakeCappedLockOnInsert)
         synchronizeOnCappedInFlightResource(txn->lockState(), _ns);
 
-    StatusWith<RecordId> loc =
-        _recordStore->insertRecord(txn, doc.objdata(), doc.objsize(), _enforceQuota(enforceQuota));
+    StatusWith<RecordId> loc = bulkLoader
+        ? bulkLoader->insertRecord(doc.objdata(), doc.objsize())
+        : _recordStore->insertRecord(
+              txn, doc.objdata(), doc.objsize(), _enforceQuota(enforceQuota));
 
     if (!loc.isOK())
         return loc.getStatus();
@@ -441,6 +445,8 @@ Status Collection::insertDocument(OperationContext* txn,
         }
     }
 
+    _infoCache.notifyOfWrite(txn);
+
     vector<BSONObj> docs;
     docs.push_back(doc);
 
@@ -487,6 +493,8 @@ Status Collection::_insertDocuments(OperationContext* txn,
     if (!status.isOK())
         return status;
 
+    _infoCache.notifyOfWrite(txn);
+
     std::vector<BsonRecord> bsonRecords;
     bsonRecords.reserve(count);
     int recordIndex = 0;
@@ -560,6 +568,7 @@ void Collection::deleteDocument(
     }
 
     _recordStore->deleteRecord(txn, loc);
+    _infoCache.notifyOfWrite(txn);
 
     if (opObserver)
         opObserver->onDelete(txn, ns(), std::move(deleteState), fromMigrate);
@@ -656,6 +665,8 @@ StatusWith<RecordId> Collection::updateDocument(OperationContext* txn,
         }
     }
 
+    _infoCache.notifyOfWrite(txn);
+
     Status updateStatus = _recordStore->updateRecord(
         txn, oldLocation, newDoc.objdata(), newDoc.objsize(), _enforceQuota(enforceQuota), this);
 
@@ -783,6 +794,7 @@ StatusWith<RecordData> Collection::updateDocumentWithDamages(
         _recordStore->updateWithDamages(txn, loc, oldRec.value(), damageSource, damages);
 
     if (newRecStatus.isOK()) {
+        _infoCache.notifyOfWrite(txn);
         args->updatedDoc = newRecStatus.getValue().toBson();
 
         auto opObserver = getGlobalServiceContext()->getOpObserver();
@@ -879,6 +891,7 @@ Status Collection::truncate(OperationContext* txn) {
     status = _recordStore->truncate(txn);
     if (!status.isOK())
         return status;
+    _infoCache.notifyOfWrite(txn);
 
     // 4) re-create indexes
     for (size_t i = 0; i < indexSpecs.size(); i++) {
@@ -898,6 +911,7 @@ void Collection::temp_cappedTruncateAfter(OperationContext* txn, RecordId end, b
 
     _cursorManager.invalidateAll(false, "capped collection truncated");
     _recordStore->temp_cappedTruncateAfter(txn, end, inclusive);
+    _infoCache.notifyOfWrite(txn);
 }
 
 Status Collection::setValidator(OperationContext* txn, BSONObj validatorDoc) {
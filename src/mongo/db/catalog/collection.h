@@ -73,6 +73,7 @@ struct CompactOptions {
         validateDocuments = true;
         paddingFactor = 1;
         paddingBytes = 0;
+        online = false;
     }
 
     // padding
@@ -90,6 +91,11 @@ struct CompactOptions {
     // other
     bool validateDocuments;
 
+    // Compact without holding locks while the storage engine works, so that other operations on
+    // the collection continue meanwhile. Only possible for record stores which compact in place,
+    // and handled by the compact command rather than Collection::compact().
+    bool online;
+
     std::string toString() const;
 };
 
@@ -299,13 +305,16 @@ public:
 
     /**
      * Inserts a document into the record store and adds it to the MultiIndexBlocks passed in.
+     * If 'bulkLoader' is not null, the record is appended through it rather than inserted into
+     * the record store directly; see RecordStore::makeBulkLoader().
      *
      * NOTE: It is up to caller to commit the indexes.
      */
     Status insertDocument(OperationContext* txn,
                           const BSONObj& doc,
                           const std::vector<MultiIndexBlock*>& indexBlocks,
-                          bool enforceQuota);
+                          bool enforceQuota,
+                          RecordStoreBulkLoader* bulkLoader = nullptr);
 
     /**
      * Updates the document @ oldLocation with newDoc.
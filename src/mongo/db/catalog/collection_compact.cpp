@@ -111,14 +111,24 @@ StatusWith<CompactStats> Collection::compact(OperationContext* txn,
                                             << _recordStore->name());
 
     if (_recordStore->compactsInPlace()) {
+        // The collection and each of its ready indexes are compacted in turn, with the progress
+        // reported through currentOp and a chance to be killed in between.
+        stdx::unique_lock<Client> lk(*txn->getClient());
+        ProgressMeterHolder progress(*txn->setMessage_inlock(
+            "Compact", "Compact Progress", 1 + _indexCatalog.numIndexesReady(txn)));
+        lk.unlock();
+
         CompactStats stats;
         Status status = _recordStore->compact(txn, NULL, compactOptions, &stats);
         if (!status.isOK())
             return StatusWith<CompactStats>(status);
+        progress.hit();
 
         // Compact all indexes (not including unfinished indexes)
         IndexCatalog::IndexIterator ii(_indexCatalog.getIndexIterator(txn, false));
         while (ii.more()) {
+            txn->checkForInterrupt();
+
             IndexDescriptor* descriptor = ii.next();
             IndexAccessMethod* index = _indexCatalog.getIndex(descriptor);
 
@@ -128,8 +138,10 @@ StatusWith<CompactStats> Collection::compact(OperationContext* txn,
                 error() << "failed to compact index: " << descriptor->toString();
                 return status;
             }
+            progress.hit();
         }
 
+        progress.finished();
         return StatusWith<CompactStats>(stats);
     }
 
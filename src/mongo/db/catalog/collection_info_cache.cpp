@@ -49,12 +49,18 @@
 
 namespace mongo {
 
+namespace {
+// Source of the write sequence values handed out to every CollectionInfoCache.
+AtomicUInt64 nextWriteSequence;
+}  // namespace
+
 CollectionInfoCache::CollectionInfoCache(Collection* collection)
     : _collection(collection),
       _keysComputed(false),
       _planCache(new PlanCache(collection->ns().ns())),
       _querySettings(new QuerySettings()),
-      _indexUsageTracker(getGlobalServiceContext()->getPreciseClockSource()) {}
+      _indexUsageTracker(getGlobalServiceContext()->getPreciseClockSource()),
+      _writeSequence(nextWriteSequence.addAndFetch(1)) {}
 
 CollectionInfoCache::~CollectionInfoCache() {
     // Necessary because the collection cache will not explicitly get updated upon database drop.
@@ -92,6 +98,12 @@ void CollectionInfoCache::computeIndexKeys(OperationContext* txn) {
                 BSONElement e = j.next();
                 _indexedPaths.addPath(e.fieldName());
             }
+
+            // Included field values are stored in the index entries, so updating them also
+            // requires updating the index.
+            for (auto&& field : descriptor->includedFields()) {
+                _indexedPaths.addPath(field.fieldName());
+            }
         } else {
             fts::FTSSpec ftsSpec(descriptor->infoObj());
 
@@ -152,6 +164,11 @@ void CollectionInfoCache::notifyOfQuery(OperationContext* txn,
     }
 }
 
+void CollectionInfoCache::notifyOfWrite(OperationContext* txn) {
+    txn->recoveryUnit()->onCommit(
+        [this] { _writeSequence.store(nextWriteSequence.addAndFetch(1)); });
+}
+
 void CollectionInfoCache::clearQueryCache() {
     LOG(1) << _collection->ns().ns() << ": clearing plan cache - collection info cache reset";
     if (NULL != _planCache.get()) {
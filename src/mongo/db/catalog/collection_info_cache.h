@@ -34,6 +34,7 @@
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/query_settings.h"
 #include "mongo/db/update_index_data.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
@@ -107,6 +108,22 @@ public:
      */
     void notifyOfQuery(OperationContext* txn, const std::set<std::string>& indexesUsed);
 
+    /**
+     * Signal to the cache that 'txn' has modified documents in this collection. The write sequence
+     * advances when the write commits, so results computed from an earlier snapshot of the
+     * collection can be recognized as stale.
+     */
+    void notifyOfWrite(OperationContext* txn);
+
+    /**
+     * Returns a value which changes whenever a write to this collection commits. Values are unique
+     * across all collections in the process, so a dropped and recreated collection never repeats
+     * the sequence of the collection it replaced.
+     */
+    unsigned long long getWriteSequence() const {
+        return _writeSequence.load();
+    }
+
 private:
     Collection* _collection;  // not owned
 
@@ -134,6 +151,8 @@ private:
     void rebuildIndexData(OperationContext* txn);
 
     bool _hasTTLIndex = false;
+
+    AtomicUInt64 _writeSequence;
 };
 
 }  // namespace mongo
@@ -34,6 +34,7 @@
 
 #include "mongo/db/catalog/index_catalog.h"
 
+#include <set>
 #include <vector>
 
 #include "mongo/bson/simple_bsonobj_comparator.h"
@@ -595,6 +596,55 @@ Status IndexCatalog::_isSpecOk(OperationContext* txn, const BSONObj& spec) const
         }
     }
 
+    // Ensure that the included fields, if any, can be stored alongside the index keys.
+    BSONElement includeElement = spec.getField("include");
+    if (includeElement) {
+        if (includeElement.type() != Array || includeElement.Obj().isEmpty()) {
+            return Status(ErrorCodes::CannotCreateIndex,
+                          "\"include\" for an index must be a non-empty array of field names");
+        }
+
+        if (IndexNames::findPluginName(key) != IndexNames::BTREE) {
+            return Status(ErrorCodes::CannotCreateIndex,
+                          "\"include\" is only supported by btree indexes");
+        }
+
+        if (spec["unique"].trueValue() || IndexDescriptor::isIdIndexPattern(key)) {
+            return Status(ErrorCodes::CannotCreateIndex,
+                          "cannot mix \"include\" and \"unique\" options");
+        }
+
+        std::set<StringData> includedFields;
+        for (auto&& includedField : includeElement.Obj()) {
+            if (includedField.type() != String) {
+                return Status(ErrorCodes::CannotCreateIndex,
+                              str::stream() << "included fields must be strings: "
+                                            << includedField);
+            }
+
+            const StringData fieldName = includedField.valueStringData();
+            if (fieldName.empty() || fieldName[0] == '$' ||
+                fieldName.find('.') != std::string::npos) {
+                return Status(ErrorCodes::CannotCreateIndex,
+                              str::stream() << "included fields must be top-level field names: '"
+                                            << fieldName
+                                            << "'");
+            }
+
+            if (key.hasField(fieldName)) {
+                return Status(ErrorCodes::CannotCreateIndex,
+                              str::stream() << "included field '" << fieldName
+                                            << "' is already part of the index key");
+            }
+
+            if (!includedFields.insert(fieldName).second) {
+                return Status(ErrorCodes::CannotCreateIndex,
+                              str::stream() << "included field '" << fieldName
+                                            << "' is listed more than once");
+            }
+        }
+    }
+
     if (IndexDescriptor::isIdIndexPattern(key)) {
         BSONElement uniqueElt = spec["unique"];
         if (uniqueElt && !uniqueElt.trueValue()) {
@@ -34,6 +34,9 @@
 
 #include "mongo/db/catalog/index_create.h"
 
+#include <algorithm>
+#include <deque>
+
 #include "mongo/base/error_codes.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/audit.h"
@@ -47,7 +50,12 @@
 #include "mongo/db/operation_context.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/service_context.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/fail_point.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -64,6 +72,39 @@ using std::endl;
 MONGO_FP_DECLARE(crashAfterStartingIndexBuild);
 MONGO_FP_DECLARE(hangAfterStartingIndexBuild);
 
+namespace {
+
+// Number of threads a foreground index build uses to generate and sort keys, at most one per core.
+// The collection is always scanned by the thread running the build.
+std::atomic<int> indexBuildThreads(1);  // NOLINT
+
+class ExportedIndexBuildThreadsParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedIndexBuildThreadsParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(), "indexBuildThreads", &indexBuildThreads) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 1 || potentialNewValue > 256) {
+            return Status(ErrorCodes::BadValue, "indexBuildThreads must be between 1 and 256");
+        }
+
+        return Status::OK();
+    }
+
+} exportedIndexBuildThreadsParam;
+
+}  // namespace
+
+// Whether background index builds which allow it load their indexes in bulk and apply the writes
+// made to the collection meanwhile afterwards, instead of inserting each document's keys.
+MONGO_EXPORT_SERVER_PARAMETER(hybridIndexBuilds, bool, false);
+
+// How much memory, in bytes, the writes recorded by a hybrid index build may take before it is
+// loaded in bulk. Builds which exceed it restart as classic background builds.
+MONGO_EXPORT_SERVER_PARAMETER(hybridIndexBuildMaxSideWritesBytes, long long, 100 * 1024 * 1024);
+
 /**
  * On rollback sets MultiIndexBlock::_needToCleanup to true.
  */
@@ -103,6 +144,8 @@ MultiIndexBlock::MultiIndexBlock(OperationContext* txn, Collection* collection)
       _txn(txn),
       _buildInBackground(false),
       _allowInterruption(false),
+      _allowHybrid(false),
+      _buildHybrid(false),
       _ignoreUnique(false),
       _needToCleanup(true) {}
 
@@ -182,6 +225,14 @@ Status MultiIndexBlock::init(const std::vector<BSONObj>& indexSpecs) {
         _buildInBackground = (_buildInBackground && info["background"].trueValue());
     }
 
+    // The side writes only record which documents changed, so a drain can't tell which of two
+    // documents that were both indexed with the same key may keep it.
+    const bool tryHybrid = _buildInBackground && _allowHybrid && hybridIndexBuilds.load() &&
+        supportsDocLocking() &&
+        std::none_of(indexSpecs.begin(), indexSpecs.end(), [](const BSONObj& spec) {
+            return spec["unique"].trueValue();
+        });
+
     for (size_t i = 0; i < indexSpecs.size(); i++) {
         BSONObj info = indexSpecs[i];
         StatusWith<BSONObj> statusWithInfo =
@@ -202,9 +253,9 @@ Status MultiIndexBlock::init(const std::vector<BSONObj>& indexSpecs) {
         if (!status.isOK())
             return status;
 
-        if (!_buildInBackground) {
+        if (!_buildInBackground || tryHybrid) {
             // Bulk build process requires foreground building as it assumes nothing is changing
-            // under it.
+            // under it, unless the changes are recorded on the side for a hybrid build.
             index.bulk = index.real->initiateBulk();
         }
 
@@ -215,7 +266,7 @@ Status MultiIndexBlock::init(const std::vector<BSONObj>& indexSpecs) {
             repl::getGlobalReplicationCoordinator()->shouldIgnoreUniqueIndex(descriptor);
 
         log() << "build index on: " << ns << " properties: " << descriptor->toString();
-        if (index.bulk)
+        if (index.bulk && !tryHybrid)
             log() << "\t building index using bulk method";
 
         index.filterExpression = index.block->getEntry()->getFilterExpression();
@@ -226,6 +277,14 @@ Status MultiIndexBlock::init(const std::vector<BSONObj>& indexSpecs) {
         _indexes.push_back(std::move(index));
     }
 
+    if (tryHybrid) {
+        _buildHybrid = true;
+        for (auto&& index : _indexes) {
+            index.real->startRecordingSideWrites();
+        }
+        log() << "\t building indexes using bulk method and recording concurrent writes";
+    }
+
     if (_buildInBackground)
         _backgroundOperation.reset(new BackgroundOperation(ns));
 
@@ -244,6 +303,212 @@ Status MultiIndexBlock::init(const std::vector<BSONObj>& indexSpecs) {
     return Status::OK();
 }
 
+/**
+ * Generates and sorts the keys of a foreground index build on worker threads. The thread running
+ * the build still scans the collection, and hands the documents to the workers in batches. Each
+ * worker inserts the keys of its documents into BulkBuilders of its own, which it absorbs into the
+ * MultiIndexBlock's BulkBuilders once there are no more documents.
+ *
+ * The sort memory of an index is split evenly between the workers.
+ */
+class MultiIndexBlock::ParallelBulkInserter {
+    MONGO_DISALLOW_COPYING(ParallelBulkInserter);
+
+public:
+    ParallelBulkInserter(std::vector<IndexToBuild>* indexes, size_t numWorkers)
+        : _indexes(indexes) {
+        for (size_t worker = 0; worker < numWorkers; worker++) {
+            std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>> bulks;
+            for (auto&& index : *_indexes) {
+                bulks.push_back(index.real->initiateBulk(
+                    IndexAccessMethod::kDefaultBulkMaxMemoryUsageBytes / numWorkers));
+                invariant(bulks.back());
+            }
+            _workerBulks.push_back(std::move(bulks));
+        }
+
+        for (size_t worker = 0; worker < numWorkers; worker++) {
+            _threads.emplace_back([this, worker] { _runWorker(worker); });
+        }
+    }
+
+    ~ParallelBulkInserter() {
+        // Only reached with threads still running if the build failed or was interrupted.
+        if (!_threads.empty()) {
+            {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _aborted = true;
+                _queue.clear();
+            }
+            _join();
+        }
+    }
+
+    /**
+     * Queues 'doc' to be indexed. Returns the error of any worker which failed so far.
+     */
+    Status insert(const BSONObj& doc, const RecordId& loc) {
+        _batch.emplace_back(doc.getOwned(), loc);
+        _batchBytes += doc.objsize();
+        if (_batch.size() < kMaxBatchDocs && _batchBytes < kMaxBatchBytes) {
+            return Status::OK();
+        }
+        return _dispatchBatch();
+    }
+
+    /**
+     * Waits for the workers to index all queued documents and to hand their keys over to the
+     * MultiIndexBlock's BulkBuilders.
+     */
+    Status finish() {
+        if (!_batch.empty()) {
+            Status status = _dispatchBatch();
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _noMoreBatches = true;
+        }
+        _join();
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        return _status;
+    }
+
+private:
+    using Batch = std::vector<std::pair<BSONObj, RecordId>>;
+
+    // A batch is handed to the workers once it reaches either limit.
+    static const size_t kMaxBatchDocs = 1000;
+    static const size_t kMaxBatchBytes = 1024 * 1024;
+
+    Status _dispatchBatch() {
+        {
+            // Bound the documents waiting for a worker, so that a slow worker can't make the
+            // build buffer the collection in memory.
+            stdx::unique_lock<stdx::mutex> lk(_mutex);
+            _spaceAvailable.wait(
+                lk, [&] { return _queue.size() < _threads.size() || !_status.isOK(); });
+            if (!_status.isOK()) {
+                return _status;
+            }
+            _queue.push_back(std::move(_batch));
+        }
+        _workAvailable.notify_one();
+
+        _batch = Batch();
+        _batchBytes = 0;
+        return Status::OK();
+    }
+
+    void _runWorker(size_t worker) {
+        auto& bulks = _workerBulks[worker];
+        Status status = Status::OK();
+        try {
+            while (true) {
+                Batch batch;
+                {
+                    stdx::unique_lock<stdx::mutex> lk(_mutex);
+                    _workAvailable.wait(lk, [&] {
+                        return !_queue.empty() || _noMoreBatches || _aborted || !_status.isOK();
+                    });
+                    if (_queue.empty() || _aborted || !_status.isOK()) {
+                        break;
+                    }
+                    batch = std::move(_queue.front());
+                    _queue.pop_front();
+                }
+                _spaceAvailable.notify_one();
+
+                for (auto&& doc : batch) {
+                    status = _insert(bulks, doc.first, doc.second);
+                    if (!status.isOK()) {
+                        break;
+                    }
+                }
+                if (!status.isOK()) {
+                    break;
+                }
+            }
+
+            if (status.isOK() && !_isAborted()) {
+                for (size_t i = 0; i < bulks.size(); i++) {
+                    (*_indexes)[i].bulk->absorb(std::move(bulks[i]));
+                }
+            }
+        } catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+
+        if (!status.isOK()) {
+            {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                if (_status.isOK()) {
+                    _status = status;
+                }
+                _queue.clear();
+            }
+            _workAvailable.notify_all();
+            _spaceAvailable.notify_all();
+        }
+    }
+
+    Status _insert(const std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>>& bulks,
+                   const BSONObj& doc,
+                   const RecordId& loc) {
+        for (size_t i = 0; i < bulks.size(); i++) {
+            const IndexToBuild& index = (*_indexes)[i];
+            if (index.filterExpression && !index.filterExpression->matchesBSON(doc)) {
+                continue;
+            }
+
+            // The BulkBuilder doesn't use the OperationContext, which belongs to another thread.
+            int64_t unused;
+            Status status = bulks[i]->insert(nullptr, doc, loc, index.options, &unused);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+        return Status::OK();
+    }
+
+    bool _isAborted() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        return _aborted;
+    }
+
+    void _join() {
+        _workAvailable.notify_all();
+        for (auto&& thread : _threads) {
+            thread.join();
+        }
+        _threads.clear();
+    }
+
+    std::vector<IndexToBuild>* const _indexes;
+
+    // One BulkBuilder per index for each worker. Only touched by that worker once it is running.
+    std::vector<std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>>> _workerBulks;
+
+    // The batch being filled by the thread running the build.
+    Batch _batch;
+    size_t _batchBytes = 0;
+
+    // Guards the members below.
+    stdx::mutex _mutex;
+    stdx::condition_variable _workAvailable;
+    stdx::condition_variable _spaceAvailable;
+    std::deque<Batch> _queue;
+    bool _noMoreBatches = false;
+    bool _aborted = false;
+    Status _status = Status::OK();  // The first error of any worker.
+
+    std::vector<stdx::thread> _threads;
+};
+
 Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsOut) {
     const char* curopMessage = _buildInBackground ? "Index Build (background)" : "Index Build";
     const auto numRecords = _collection->numRecords(_txn);
@@ -264,6 +529,16 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
         exec->setYieldPolicy(PlanExecutor::WRITE_CONFLICT_RETRY_ONLY, _collection);
     }
 
+    // When every index is built in bulk, nothing reads the indexes until doneInserting(), so their
+    // keys can be generated and sorted on other threads.
+    std::unique_ptr<ParallelBulkInserter> parallelInserter;
+    const int numThreads =
+        std::min(indexBuildThreads.load(), static_cast<int>(ProcessInfo().getNumCores()));
+    if (numThreads > 1 && !_buildInBackground) {
+        log() << "\t generating index keys on " << numThreads << " threads";
+        parallelInserter = stdx::make_unique<ParallelBulkInserter>(&_indexes, numThreads);
+    }
+
     Snapshotted<BSONObj> objToIndex;
     RecordId loc;
     PlanExecutor::ExecState state;
@@ -286,7 +561,8 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
             progress->setTotalWhileRunning(_collection->numRecords(_txn));
 
             WriteUnitOfWork wunit(_txn);
-            Status ret = insert(objToIndex.value(), loc);
+            Status ret = parallelInserter ? parallelInserter->insert(objToIndex.value(), loc)
+                                          : insert(objToIndex.value(), loc);
             if (_buildInBackground)
                 exec->saveState();
             if (ret.isOK()) {
@@ -317,6 +593,12 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
             _txn->recoveryUnit()->abandonSnapshot();
             exec->restoreState();  // Handles any WCEs internally.
         }
+
+        if (_sideWritesExceedBudget()) {
+            exec.reset();
+            _abandonBulkLoad();
+            return insertAllDocumentsInCollection(dupsOut);
+        }
     }
 
     uassert(28550,
@@ -324,6 +606,12 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
                 WorkingSetCommon::toStatusString(objToIndex.value()),
             state == PlanExecutor::IS_EOF);
 
+    if (parallelInserter) {
+        Status ret = parallelInserter->finish();
+        if (!ret.isOK())
+            return ret;
+    }
+
     // Need the index build to hang before the progress meter is marked as finished so we can
     // reliably check that the index build has actually started in js tests.
     while (MONGO_FAIL_POINT(hangAfterStartingIndexBuild)) {
@@ -331,12 +619,26 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
         sleepmillis(1000);
     }
 
+    if (_sideWritesExceedBudget()) {
+        exec.reset();
+        _abandonBulkLoad();
+        return insertAllDocumentsInCollection(dupsOut);
+    }
+
     progress->finished();
 
     Status ret = doneInserting(dupsOut);
     if (!ret.isOK())
         return ret;
 
+    // Most writes made during the scan can be applied without blocking other writers. The rest
+    // are applied by drainSideWrites().
+    if (_buildHybrid) {
+        ret = _applySideWrites();
+        if (!ret.isOK())
+            return ret;
+    }
+
     log() << "build index done.  scanned " << n << " total records. " << t.seconds() << " secs"
           << endl;
 
@@ -382,12 +684,92 @@ Status MultiIndexBlock::doneInserting(std::set<RecordId>* dupsOut) {
     return Status::OK();
 }
 
+Status MultiIndexBlock::drainSideWrites() {
+    if (!_buildHybrid)
+        return Status::OK();
+
+    Status status = _applySideWrites();
+    if (!status.isOK())
+        return status;
+
+    for (auto&& index : _indexes) {
+        index.real->stopRecordingSideWrites();
+    }
+    _buildHybrid = false;
+    return Status::OK();
+}
+
+Status MultiIndexBlock::_applySideWrites() {
+    invariant(_buildHybrid);
+    size_t numApplied = 0;
+    for (auto&& index : _indexes) {
+        const IndexAccessMethod::SideWrites sideWrites = index.real->takeSideWrites();
+
+        // Each document is read from a snapshot at least as new as the writes recorded for it, and
+        // reindexed from that version. This makes the order the writes were made in irrelevant.
+        _txn->recoveryUnit()->abandonSnapshot();
+        for (auto&& sideWrite : sideWrites) {
+            if (_allowInterruption)
+                _txn->checkForInterrupt();
+
+            MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                WriteUnitOfWork wunit(_txn);
+                Snapshotted<BSONObj> doc;
+                const BSONObj* currentDoc = nullptr;
+                if (_collection->findDoc(_txn, sideWrite.first, &doc) &&
+                    (!index.filterExpression || index.filterExpression->matchesBSON(doc.value()))) {
+                    currentDoc = &doc.value();
+                }
+                Status status = index.real->applySideWrite(
+                    _txn, sideWrite.first, sideWrite.second, currentDoc, index.options);
+                if (!status.isOK())
+                    return status;
+                wunit.commit();
+            }
+            MONGO_WRITE_CONFLICT_RETRY_LOOP_END(_txn, "index build", _collection->ns().ns());
+        }
+        numApplied += sideWrites.size();
+    }
+
+    LOG(1) << "\t applied writes to " << numApplied << " documents to indexes being built on "
+           << _collection->ns();
+    return Status::OK();
+}
+
+bool MultiIndexBlock::_sideWritesExceedBudget() const {
+    if (!_buildHybrid)
+        return false;
+
+    long long bytes = 0;
+    for (auto&& index : _indexes) {
+        if (!index.bulk)
+            return false;
+        bytes += index.real->getSideWritesBytes();
+    }
+    return bytes > hybridIndexBuildMaxSideWritesBytes.load();
+}
+
+void MultiIndexBlock::_abandonBulkLoad() {
+    log() << "\t writes to " << _collection->ns() << " during the index build exceeded "
+          << hybridIndexBuildMaxSideWritesBytes.load()
+          << " bytes, building indexes without bulk method";
+
+    // The indexes are still empty, so the documents these writes changed are simply indexed as
+    // they are now. Writes already in progress are still recorded and applied afterwards.
+    for (auto&& index : _indexes) {
+        index.real->abandonSideWrites();
+        index.bulk.reset();
+    }
+    _txn->recoveryUnit()->abandonSnapshot();
+}
+
 void MultiIndexBlock::abortWithoutCleanup() {
     _indexes.clear();
     _needToCleanup = false;
 }
 
 void MultiIndexBlock::commit() {
+    invariant(!_buildHybrid);
     for (size_t i = 0; i < _indexes.size(); i++) {
         _indexes[i].block->success();
     }
@@ -88,6 +88,21 @@ public:
         _allowInterruption = true;
     }
 
+    /**
+     * Call this before init() to allow a background build to load its indexes in bulk while
+     * concurrent writes to the collection are recorded on the side, if the 'hybridIndexBuilds'
+     * server parameter is set. The caller must then call drainSideWrites() before commit().
+     *
+     * Builds of unique indexes, of indexes that cannot be built in bulk, and builds on storage
+     * engines without document-level locking are still done as classic background builds. So are
+     * builds whose recorded writes outgrow the 'hybridIndexBuildMaxSideWritesBytes' server
+     * parameter before the indexes are loaded; insertAllDocumentsInCollection() then scans the
+     * collection again.
+     */
+    void allowHybridBuilding() {
+        _allowHybrid = true;
+    }
+
     /**
      * By default we enforce the 'unique' flag in specs when building an index by failing.
      * If this is called before init(), we will ignore unique violations. This has no effect if
@@ -154,6 +169,17 @@ public:
      */
     Status doneInserting(std::set<RecordId>* dupsOut = NULL);
 
+    /**
+     * Applies the writes made to the collection since they were last drained to the indexes of a
+     * hybrid build, and stops recording them. Does nothing if the build is not hybrid.
+     *
+     * Should be called after insertAllDocumentsInCollection() and before commit(), while holding
+     * a lock that blocks writes to the collection.
+     *
+     * Should not be called inside of a WriteUnitOfWork.
+     */
+    Status drainSideWrites();
+
     /**
      * Marks the index ready for use. Should only be called as the last method after
      * doneInserting() or insertAllDocumentsInCollection() return success.
@@ -185,9 +211,14 @@ public:
         return _buildInBackground;
     }
 
+    bool getBuildHybrid() const {
+        return _buildHybrid;
+    }
+
 private:
     class SetNeedToCleanupOnRollback;
     class CleanupIndexesVectorOnRollback;
+    class ParallelBulkInserter;
 
     struct IndexToBuild {
         std::unique_ptr<IndexCatalog::IndexBuildBlock> block;
@@ -199,6 +230,24 @@ private:
         InsertDeleteOptions options;
     };
 
+    /**
+     * Reindexes each document written since the side writes were last drained from its current
+     * version. Leaves the recording of side writes on.
+     */
+    Status _applySideWrites();
+
+    /**
+     * Returns true if the indexes are yet to be loaded in bulk, but the writes recorded meanwhile
+     * take more memory than allowed.
+     */
+    bool _sideWritesExceedBudget() const;
+
+    /**
+     * Discards the bulk loads and the side writes recorded so far, so the indexes are built by
+     * inserting each document's keys, as in a classic background build.
+     */
+    void _abandonBulkLoad();
+
     std::vector<IndexToBuild> _indexes;
 
     std::unique_ptr<BackgroundOperation> _backgroundOperation;
@@ -209,6 +258,8 @@ private:
 
     bool _buildInBackground;
     bool _allowInterruption;
+    bool _allowHybrid;
+    bool _buildHybrid;
     bool _ignoreUnique;
 
     bool _needToCleanup;
@@ -43,9 +43,11 @@
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index_builder.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -53,6 +55,104 @@ namespace mongo {
 using std::string;
 using std::stringstream;
 
+namespace {
+
+/**
+ * Compacts the collection 'nss' and its ready indexes in place. Each table is compacted under
+ * intent locks taken afresh for it, so the collection and its indexes are looked up again every
+ * time and shutdown can't close the storage engine in the middle of a table. No locks are held
+ * between tables. Meanwhile the collection is registered as a background operation, which keeps it
+ * and its indexes from being dropped or renamed.
+ */
+Status compactOnline(OperationContext* txn,
+                     const NamespaceString& nss,
+                     const CompactOptions& compactOptions) {
+    std::unique_ptr<BackgroundOperation> backgroundOperation;
+    std::vector<std::string> indexNames;
+    {
+        ScopedTransaction transaction(txn, MODE_IX);
+        AutoGetDb autoDb(txn, nss.db(), MODE_IX);
+        Lock::CollectionLock collLock(txn->lockState(), nss.ns(), MODE_IX);
+        Database* const collDB = autoDb.getDb();
+
+        Collection* collection = collDB ? collDB->getCollection(nss) : nullptr;
+        if (!collection) {
+            if (collDB && collDB->getViewCatalog()->lookup(txn, nss.ns()))
+                return {ErrorCodes::CommandNotSupportedOnView, "can't compact a view"};
+            return {ErrorCodes::NamespaceNotFound, "collection does not exist"};
+        }
+
+        RecordStore* recordStore = collection->getRecordStore();
+        if (!recordStore->compactsInPlace()) {
+            return {ErrorCodes::CommandNotSupported,
+                    str::stream() << "cannot compact online with record store: "
+                                  << recordStore->name()};
+        }
+
+        OldClientContext ctx(txn, nss.ns());
+        BackgroundOperation::assertNoBgOpInProgForNs(nss.ns());
+        backgroundOperation = stdx::make_unique<BackgroundOperation>(nss.ns());
+
+        IndexCatalog::IndexIterator ii(collection->getIndexCatalog()->getIndexIterator(txn, false));
+        while (ii.more()) {
+            indexNames.push_back(ii.next()->indexName());
+        }
+    }
+
+    log() << "compact " << nss.ns() << " begin, options: " << compactOptions.toString();
+
+    // The collection and each of its indexes are compacted in turn, with the progress reported
+    // through currentOp and a chance to be killed in between.
+    stdx::unique_lock<Client> lk(*txn->getClient());
+    ProgressMeterHolder progress(
+        *txn->setMessage_inlock("Compact", "Compact Progress", 1 + indexNames.size()));
+    lk.unlock();
+
+    {
+        ScopedTransaction transaction(txn, MODE_IS);
+        AutoGetCollection autoColl(txn, nss, MODE_IS);
+        Collection* collection = autoColl.getCollection();
+        if (!collection)
+            return {ErrorCodes::NamespaceNotFound, "collection was dropped during compaction"};
+
+        CompactStats stats;
+        Status status = collection->getRecordStore()->compact(txn, NULL, &compactOptions, &stats);
+        if (!status.isOK())
+            return status;
+    }
+    progress.hit();
+
+    for (auto&& indexName : indexNames) {
+        txn->checkForInterrupt();
+
+        ScopedTransaction transaction(txn, MODE_IS);
+        AutoGetCollection autoColl(txn, nss, MODE_IS);
+        Collection* collection = autoColl.getCollection();
+        if (!collection)
+            return {ErrorCodes::NamespaceNotFound, "collection was dropped during compaction"};
+
+        IndexCatalog* indexCatalog = collection->getIndexCatalog();
+        IndexDescriptor* descriptor = indexCatalog->findIndexByName(txn, indexName);
+        if (!descriptor)
+            return {ErrorCodes::IndexNotFound,
+                    str::stream() << "index was dropped during compaction: " << indexName};
+
+        LOG(1) << "compacting index: " << indexName;
+        Status status = indexCatalog->getIndex(descriptor)->compact(txn);
+        if (!status.isOK()) {
+            error() << "failed to compact index: " << indexName;
+            return status;
+        }
+        progress.hit();
+    }
+
+    progress.finished();
+    log() << "compact " << nss.ns() << " end";
+    return Status::OK();
+}
+
+}  // namespace
+
 class CompactCmd : public Command {
 public:
     virtual bool supportsWriteConcern(const BSONObj& cmd) const override {
@@ -79,8 +179,10 @@ public:
                 "warning: this operation locks the database and is slow. you can cancel with "
                 "killOp()\n"
                 "{ compact : <collection_name>, [force:<bool>], [validate:<bool>],\n"
-                "  [paddingFactor:<num>], [paddingBytes:<num>] }\n"
+                "  [paddingFactor:<num>], [paddingBytes:<num>], [online:<bool>] }\n"
                 "  force - allows to run on a replica set primary\n"
+                "  online - compact without blocking reads and writes, for storage engines "
+                "which compact in place\n"
                 "  validate - check records are noncorrupt before adding to newly compacting "
                 "extents. slower but safer (defaults to true in this version)\n";
     }
@@ -144,6 +246,11 @@ public:
         if (cmdObj.hasElement("validate"))
             compactOptions.validateDocuments = cmdObj["validate"].trueValue();
 
+        compactOptions.online = cmdObj["online"].trueValue();
+        if (compactOptions.online) {
+            return appendCommandStatus(result, compactOnline(txn, nss, compactOptions));
+        }
+
         ScopedTransaction transaction(txn, MODE_IX);
         AutoGetDb autoDb(txn, db, MODE_X);
         Database* const collDB = autoDb.getDb();
@@ -222,6 +222,7 @@ public:
         MultiIndexBlock indexer(txn, collection);
         indexer.allowBackgroundBuilding();
         indexer.allowInterruption();
+        indexer.allowHybridBuilding();
 
         const size_t origSpecsSize = specs.size();
         indexer.removeExistingIndexes(&specs);
@@ -313,6 +314,8 @@ public:
             Database* db = dbHolder().get(txn, ns.db());
             uassert(28551, "database dropped during index build", db);
             uassert(28552, "collection dropped during index build", db->getCollection(ns.ns()));
+
+            uassertStatusOK(indexer.drainSideWrites());
         }
 
         MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
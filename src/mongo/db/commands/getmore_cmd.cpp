@@ -44,6 +44,7 @@
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/global_timestamp.h"
+#include "mongo/db/pipeline/document_arena.h"
 #include "mongo/db/query/cursor_response.h"
 #include "mongo/db/query/find.h"
 #include "mongo/db/query/find_common.h"
@@ -512,6 +513,13 @@ public:
         PlanExecutor* exec = cursor->getExecutor();
         const bool isAwaitData = isCursorAwaitData(cursor);
 
+        // Aggregation pipelines create and discard documents as they produce the batch, so let
+        // those documents recycle each other's memory.
+        boost::optional<DocumentArena> arena;
+        if (cursor->isAggCursor()) {
+            arena.emplace();
+        }
+
         // If an awaitData getMore is killed during this process due to our max time expiring at
         // an interrupt point, we just continue as normal and return rather than reporting a
         // timeout to the user.
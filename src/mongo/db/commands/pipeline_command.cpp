@@ -30,23 +30,28 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <deque>
 #include <vector>
 
+#include "mongo/base/counter.h"
 #include "mongo/base/init.h"
 #include "mongo/db/auth/action_set.h"
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/client.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/pipeline_proxy.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/aggregation_request.h"
+#include "mongo/db/pipeline/aggregation_result_cache.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
@@ -57,12 +62,14 @@
 #include "mongo/db/query/find_common.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/plan_summary_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/db/views/view.h"
 #include "mongo/db/views/view_catalog.h"
 #include "mongo/db/views/view_sharding_check.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/clock_source.h"
 #include "mongo/util/log.h"
 #include "mongo/util/string_map.h"
 
@@ -78,18 +85,149 @@ using stdx::make_unique;
 
 namespace {
 
+// The aggregation result cache is disabled unless given a memory budget. When enabled, it holds the
+// results of aggregations on views and of aggregations run with the 'cacheResults' option.
+MONGO_EXPORT_SERVER_PARAMETER(aggregationResultCacheMaxBytes, int, 0);
+MONGO_EXPORT_SERVER_PARAMETER(aggregationResultCacheExpireAfterSecs, int, 60);
+
+Counter64 resultCacheHits;
+Counter64 resultCacheMisses;
+Counter64 resultCacheEvictions;
+
+ServerStatusMetricField<Counter64> displayResultCacheHits("aggregate.resultCache.hits",
+                                                          &resultCacheHits);
+ServerStatusMetricField<Counter64> displayResultCacheMisses("aggregate.resultCache.misses",
+                                                            &resultCacheMisses);
+ServerStatusMetricField<Counter64> displayResultCacheEvictions("aggregate.resultCache.evictions",
+                                                               &resultCacheEvictions);
+
+/**
+ * Returns false if 'spec' names, at any depth, a stage which writes or whose output depends on
+ * something other than the contents of the collections the pipeline reads.
+ */
+bool isCacheableStageSpec(const BSONObj& spec) {
+    static const std::initializer_list<StringData> uncacheableStages = {
+        "$out"_sd, "$merge"_sd, "$sample"_sd, "$collStats"_sd, "$indexStats"_sd};
+
+    for (auto&& elem : spec) {
+        if (std::find(uncacheableStages.begin(),
+                      uncacheableStages.end(),
+                      elem.fieldNameStringData()) != uncacheableStages.end()) {
+            return false;
+        }
+        if (elem.isABSONObj() && !isCacheableStageSpec(elem.embeddedObject())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isCacheablePipeline(const std::vector<BSONObj>& pipeline) {
+    return std::all_of(pipeline.begin(), pipeline.end(), isCacheableStageSpec);
+}
+
+/**
+ * Returns true if the results of 'request' may be served from, and stored in, the aggregation
+ * result cache. Aggregations on views are cached whenever the cache is enabled; aggregations on
+ * collections only when they ask for it.
+ */
+bool canUseResultCache(OperationContext* txn,
+                       const NamespaceString& origNss,
+                       const AggregationRequest& request,
+                       const ExpressionContext& expCtx) {
+    const NamespaceString& nss = request.getNamespaceString();
+    if (aggregationResultCacheMaxBytes.load() <= 0 ||
+        !(request.shouldCacheResults() || origNss != nss)) {
+        return false;
+    }
+
+    // Only a complete first batch of a local read can be cached and served again.
+    if (!request.isCursorCommand() || request.isExplain() || request.isFromRouter() ||
+        nss.isOplog() || txn->recoveryUnit()->isReadingFromMajorityCommittedSnapshot()) {
+        return false;
+    }
+
+    if (!isCacheablePipeline(request.getPipeline())) {
+        return false;
+    }
+    for (auto&& resolved : expCtx.resolvedNamespaces) {
+        if (!isCacheablePipeline(resolved.second.pipeline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the names of the namespaces resolved for 'expCtx' in a deterministic order.
+ */
+std::vector<std::string> sortedResolvedNamespaceNames(const ExpressionContext& expCtx) {
+    std::vector<std::string> names;
+    for (auto&& resolved : expCtx.resolvedNamespaces) {
+        names.push_back(resolved.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+/**
+ * Builds the result cache key for 'request', which must already have any view on its namespace
+ * resolved. The key covers the pipeline, its collation and the definitions of the namespaces the
+ * pipeline reads through stages such as $lookup.
+ */
+std::string makeResultCacheKey(const AggregationRequest& request,
+                               const ExpressionContext& expCtx) {
+    BSONObjBuilder keyBuilder;
+    keyBuilder.append("ns", request.getNamespaceString().ns());
+    keyBuilder.append("pipeline", request.getPipeline());
+    keyBuilder.append("collation", request.getCollation());
+
+    BSONArrayBuilder involvedBuilder(keyBuilder.subarrayStart("involved"));
+    for (auto&& name : sortedResolvedNamespaceNames(expCtx)) {
+        const auto& resolved = expCtx.resolvedNamespaces.find(name)->second;
+        involvedBuilder.append(BSON("ns" << resolved.ns.ns() << "pipeline" << resolved.pipeline));
+    }
+    involvedBuilder.doneFast();
+
+    BSONObj key = keyBuilder.obj();
+    return std::string(key.objdata(), key.objsize());
+}
+
+/**
+ * Returns the write sequence of 'nss' and of every collection resolved for 'expCtx'. Must be
+ * called while holding a lock on 'db', which may be null if the database does not exist.
+ */
+AggregationResultCache::CollectionVersions getCollectionVersions(Database* db,
+                                                                 const NamespaceString& nss,
+                                                                 const ExpressionContext& expCtx) {
+    auto versionOf = [db](const NamespaceString& ns) -> AggregationResultCache::CollectionVersion {
+        Collection* collection = db ? db->getCollection(ns.ns()) : nullptr;
+        return {ns.ns(), collection ? collection->infoCache()->getWriteSequence() : 0ULL};
+    };
+
+    AggregationResultCache::CollectionVersions versions{versionOf(nss)};
+    for (auto&& name : sortedResolvedNamespaceNames(expCtx)) {
+        versions.push_back(versionOf(expCtx.resolvedNamespaces.find(name)->second.ns));
+    }
+    return versions;
+}
+
 /**
  * Returns true if we need to keep a ClientCursor saved for this pipeline (for future getMore
  * requests). Otherwise, returns false. The passed 'nsForCursor' is only used to determine the
  * namespace used in the returned cursor. In the case of views, this can be different from that
  * in 'request'.
+ *
+ * If 'exhaustedBatch' is non-null and the first batch holds every result of the pipeline, it is set
+ * to that batch.
  */
 bool handleCursorCommand(OperationContext* txn,
                          const string& nsForCursor,
                          ClientCursorPin* pin,
                          PlanExecutor* exec,
                          const AggregationRequest& request,
-                         BSONObjBuilder& result) {
+                         BSONObjBuilder& result,
+                         boost::optional<BSONArray>* exhaustedBatch) {
     ClientCursor* cursor = pin ? pin->c() : NULL;
     if (pin) {
         invariant(cursor);
@@ -100,6 +238,10 @@ bool handleCursorCommand(OperationContext* txn,
     invariant(request.getBatchSize());
     long long batchSize = request.getBatchSize().get();
 
+    // Documents built while producing the batch are mostly discarded before it is returned, so
+    // let them recycle each other's memory.
+    DocumentArena arena;
+
     // can't use result BSONObjBuilder directly since it won't handle exceptions correctly.
     BSONArrayBuilder resultsArray;
     BSONObj next;
@@ -162,7 +304,11 @@ bool handleCursorCommand(OperationContext* txn,
     }
 
     const long long cursorId = cursor ? cursor->cursorid() : 0LL;
-    appendCursorResponseObject(cursorId, nsForCursor, resultsArray.arr(), &result);
+    BSONArray firstBatch = resultsArray.arr();
+    if (!cursor && exhaustedBatch) {
+        *exhaustedBatch = firstBatch;
+    }
+    appendCursorResponseObject(cursorId, nsForCursor, firstBatch, &result);
 
     return static_cast<bool>(cursor);
 }
@@ -340,6 +486,10 @@ public:
         unique_ptr<ClientCursorPin> pin;  // either this OR the exec will be non-null
         unique_ptr<PlanExecutor> exec;
         auto curOp = CurOp::get(txn);
+        auto clock = txn->getServiceContext()->getFastClockSource();
+        const bool useResultCache = canUseResultCache(txn, origNss, request, *expCtx);
+        std::string resultCacheKey;
+        AggregationResultCache::CollectionVersions resultCacheVersions;
         {
             // This will throw if the sharding version for this connection is out of date. If the
             // namespace is a view, the lock will be released before re-running the aggregation.
@@ -407,6 +557,24 @@ public:
                 return status;
             }
 
+            // Serve the results from the result cache if an earlier run of this pipeline saw the
+            // same state of every collection it reads. The versions must be taken under the lock
+            // and before execution, so that a write racing with this run can only invalidate it.
+            if (useResultCache) {
+                resultCacheKey = makeResultCacheKey(request, *expCtx);
+                resultCacheVersions = getCollectionVersions(ctx.getDb(), nss, *expCtx);
+                auto cached = AggregationResultCache::get(txn->getServiceContext())
+                                  .lookup(resultCacheKey, resultCacheVersions, clock->now());
+                if (cached && cached->nFields() <= request.getBatchSize().get()) {
+                    resultCacheHits.increment();
+                    curOp->debug().cursorExhausted = true;
+                    curOp->debug().nreturned = cached->nFields();
+                    appendCursorResponseObject(0LL, origNss.ns(), *cached, &result);
+                    return appendCommandStatus(result, Status::OK());
+                }
+                resultCacheMisses.increment();
+            }
+
             // If the pipeline does not have a user-specified collation, set it from the collection
             // default.
             if (request.getCollation().isEmpty() && collection &&
@@ -508,12 +676,24 @@ public:
             if (expCtx->isExplain) {
                 result << "stages" << Value(pipeline->writeExplainOps());
             } else if (request.isCursorCommand()) {
+                boost::optional<BSONArray> exhaustedBatch;
                 keepCursor = handleCursorCommand(txn,
                                                  origNss.ns(),
                                                  pin.get(),
                                                  pin ? pin->c()->getExecutor() : exec.get(),
                                                  request,
-                                                 result);
+                                                 result,
+                                                 useResultCache ? &exhaustedBatch : nullptr);
+                if (exhaustedBatch) {
+                    const Seconds expireAfter(aggregationResultCacheExpireAfterSecs.load());
+                    resultCacheEvictions.increment(
+                        AggregationResultCache::get(txn->getServiceContext())
+                            .insert(std::move(resultCacheKey),
+                                    std::move(resultCacheVersions),
+                                    std::move(*exhaustedBatch),
+                                    clock->now() + expireAfter,
+                                    aggregationResultCacheMaxBytes.load()));
+                }
             } else {
                 pipeline->run(result);
             }
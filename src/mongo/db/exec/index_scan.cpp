@@ -32,6 +32,8 @@
 
 #include "mongo/db/exec/index_scan.h"
 
+#include <algorithm>
+
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
@@ -58,6 +60,9 @@ namespace mongo {
 // static
 const char* IndexScan::kStageType = "IXSCAN";
 
+// static
+const size_t IndexScan::kMaxBatchSize = 128;
+
 IndexScan::IndexScan(OperationContext* txn,
                      const IndexScanParams& params,
                      WorkingSet* workingSet,
@@ -69,6 +74,9 @@ IndexScan::IndexScan(OperationContext* txn,
       _scanState(INITIALIZING),
       _filter(filter),
       _shouldDedup(true),
+      _batchPos(0),
+      _nextBatchSize(1),
+      _batchCrossedYield(false),
       _forward(params.direction == 1),
       _params(params),
       _endKeyInclusive(false) {
@@ -129,6 +137,25 @@ boost::optional<IndexKeyEntry> IndexScan::initIndexScan() {
     }
 }
 
+boost::optional<IndexKeyEntry> IndexScan::nextFromBatch() {
+    if (_batchPos == _batch.size()) {
+        discardBatch();
+        // If this throws, whatever was read before the WriteConflictException stays in _batch
+        // and the cursor stays positioned on the last of those entries.
+        if (_indexCursor->nextBatch(_nextBatchSize, &_batch) == 0)
+            return boost::none;
+        _nextBatchSize = std::min(_nextBatchSize * 2, kMaxBatchSize);
+    }
+
+    return std::move(_batch[_batchPos++]);
+}
+
+void IndexScan::discardBatch() {
+    _batch.clear();
+    _batchPos = 0;
+    _batchCrossedYield = false;
+}
+
 PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
     // Get the next kv pair from the index, if any.
     boost::optional<IndexKeyEntry> kv;
@@ -138,10 +165,13 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
                 kv = initIndexScan();
                 break;
             case GETTING_NEXT:
-                kv = _indexCursor->next();
+                kv = nextFromBatch();
                 break;
             case NEED_SEEK:
                 ++_specificStats.seeks;
+                // Entries after a seek are usually far from the ones before it, so don't assume
+                // the scan will continue for long.
+                _nextBatchSize = 1;
                 kv = _indexCursor->seek(_seekPoint);
                 break;
             case HIT_END:
@@ -179,6 +209,7 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
                 break;
 
             case IndexBoundsChecker::MUST_ADVANCE:
+                discardBatch();
                 _scanState = NEED_SEEK;
                 return PlanStage::NEED_TIME;
         }
@@ -188,6 +219,7 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
         _scanState = HIT_END;
         _commonStats.isEOF = true;
         _indexCursor.reset();
+        discardBatch();
         return PlanStage::IS_EOF;
     }
 
@@ -215,9 +247,14 @@ PlanStage::StageState IndexScan::doWork(WorkingSetID* out) {
     WorkingSetID id = _workingSet->allocate();
     WorkingSetMember* member = _workingSet->get(id);
     member->recordId = kv->loc;
-    member->keyData.push_back(IndexKeyDatum(_keyPattern, kv->key, _iam));
+    member->keyData.push_back(IndexKeyDatum(
+        _keyPattern, kv->key, _iam, _iam->getIncludedFields(), kv->included.getOwned()));
     _workingSet->transitionToRecordIdAndIdx(id);
 
+    // The key was read before a yield, so make sure it still matches the document if we fetch it.
+    if (_batchCrossedYield)
+        member->isSuspicious = true;
+
     if (_params.addKeyMetadata) {
         BSONObjBuilder bob;
         bob.appendKeys(_keyPattern, kv->key);
@@ -241,6 +278,11 @@ void IndexScan::doSaveState() {
         return;
     }
 
+    // The cursor saves its position at the end of the batch, so the entries before it are kept
+    // rather than re-read after restoring.
+    if (_batchPos < _batch.size())
+        _batchCrossedYield = true;
+
     _indexCursor->save();
 }
 
@@ -260,12 +302,19 @@ void IndexScan::doReattachToOperationContext() {
 }
 
 void IndexScan::doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) {
-    // The only state we're responsible for holding is what RecordIds to drop.  If a document
-    // mutates the underlying index cursor will deal with it.
+    // The only state we're responsible for holding is what RecordIds to drop, and the entries we
+    // have read ahead. If a document mutates the underlying index cursor will deal with it, and
+    // any read-ahead entries for it are checked against the document when they are fetched.
     if (INVALIDATION_MUTATION == type) {
         return;
     }
 
+    // A deleted document's entries must not be returned.
+    _batch.erase(std::remove_if(_batch.begin() + _batchPos,
+                                _batch.end(),
+                                [&dl](const IndexKeyEntry& entry) { return entry.loc == dl; }),
+                 _batch.end());
+
     // If we see this RecordId again, it may not be the same document it was before, so we want
     // to return it if we see it again.
     unordered_set<RecordId, RecordId::Hasher>::iterator it = _returned.find(dl);
@@ -119,6 +119,20 @@ private:
      */
     boost::optional<IndexKeyEntry> initIndexScan();
 
+    /**
+     * Returns the next entry from _batch, refilling it from the index cursor when it has been
+     * used up. Returns boost::none once the cursor is exhausted.
+     */
+    boost::optional<IndexKeyEntry> nextFromBatch();
+
+    /**
+     * Drops any entries read ahead into _batch, e.g. because the cursor is about to be moved.
+     */
+    void discardBatch();
+
+    // The most entries read from the index cursor at a time.
+    static const size_t kMaxBatchSize;
+
     // The WorkingSet we fill with results.  Not owned by us.
     WorkingSet* const _workingSet;
 
@@ -139,6 +153,17 @@ private:
     bool _shouldDedup;
     unordered_set<RecordId, RecordId::Hasher> _returned;
 
+    // Entries read ahead from _indexCursor which have not been examined yet, starting at
+    // _batchPos. Batches start with a single entry and double up to kMaxBatchSize, so that scans
+    // which stop early (e.g. because of a limit) don't read far past the entries they use.
+    std::vector<IndexKeyEntry> _batch;
+    size_t _batchPos;
+    size_t _nextBatchSize;
+
+    // Set if the unexamined entries in _batch were read before a yield, in which case the
+    // documents they point to may have changed since.
+    bool _batchCrossedYield;
+
     const bool _forward;
     const IndexScanParams _params;
 
@@ -179,6 +179,17 @@ Status ProjectionStage::transform(WorkingSetMember* member) {
             }
             ++keyIndex;
         }
+
+        // ...followed by the values of any fields the index includes, which the covered key
+        // pattern lists after the key fields.
+        BSONObjIterator includedIterator(member->keyData[0].includedData);
+        while (includedIterator.more()) {
+            BSONElement elt = includedIterator.next();
+            if (_includeKey[keyIndex]) {
+                bob.appendAs(elt, _keyFieldNames[keyIndex]);
+            }
+            ++keyIndex;
+        }
     }
 
     member->keyData.clear();
@@ -227,6 +227,23 @@ bool WorkingSetMember::getFieldDotted(const string& field, BSONElement* out) con
                 return true;
             }
         }
+
+        if (keyData[i].includedData.isEmpty()) {
+            continue;
+        }
+
+        BSONObjIterator includedPatternIt(keyData[i].includedPattern);
+        BSONObjIterator includedDataIt(keyData[i].includedData);
+        while (includedPatternIt.more()) {
+            BSONElement includedPatternElt = includedPatternIt.next();
+            verify(includedDataIt.more());
+            BSONElement includedDataElt = includedDataIt.next();
+
+            if (field == includedPatternElt.fieldName()) {
+                *out = includedDataElt;
+                return true;
+            }
+        }
     }
 
     return false;
@@ -248,6 +265,9 @@ size_t WorkingSetMember::getMemUsage() const {
     for (size_t i = 0; i < keyData.size(); ++i) {
         const IndexKeyDatum& keyDatum = keyData[i];
         memUsage += keyDatum.keyData.objsize();
+        if (!keyDatum.includedData.isEmpty()) {
+            memUsage += keyDatum.includedData.objsize();
+        }
     }
 
     return memUsage;
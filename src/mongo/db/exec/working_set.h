@@ -173,8 +173,16 @@ private:
  * the key.
  */
 struct IndexKeyDatum {
-    IndexKeyDatum(const BSONObj& keyPattern, const BSONObj& key, const IndexAccessMethod* index)
-        : indexKeyPattern(keyPattern), keyData(key), index(index) {}
+    IndexKeyDatum(const BSONObj& keyPattern,
+                  const BSONObj& key,
+                  const IndexAccessMethod* index,
+                  const BSONObj& includedPattern = BSONObj(),
+                  const BSONObj& included = BSONObj())
+        : indexKeyPattern(keyPattern),
+          keyData(key),
+          includedPattern(includedPattern),
+          includedData(included),
+          index(index) {}
 
     // This is not owned and points into the IndexDescriptor's data.
     BSONObj indexKeyPattern;
@@ -182,6 +190,12 @@ struct IndexKeyDatum {
     // This is the BSONObj for the key that we put into the index.  Owned by us.
     BSONObj keyData;
 
+    // The non-key fields the index stores with each key, and their values for this entry. Both
+    // are empty unless the index has included fields. Like the key pattern, the pattern points
+    // into the index's data; the values are owned by us.
+    BSONObj includedPattern;
+    BSONObj includedData;
+
     const IndexAccessMethod* index;
 };
 
@@ -46,7 +46,9 @@
 #include "mongo/db/repl/replication_coordinator.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/progress_meter.h"
 
 namespace mongo {
@@ -72,6 +74,45 @@ bool isMultikeyFromPaths(const MultikeyPaths& multikeyPaths) {
 
 MONGO_EXPORT_SERVER_PARAMETER(failIndexKeyTooLong, bool, true);
 
+namespace {
+
+// Number of threads an index build uses to sort its keys, at most one per core. Above one, each
+// batch of keys is also spilled to disk in the background while the next batch is collected.
+std::atomic<int> indexBuildSortThreads(1);  // NOLINT
+
+class ExportedIndexBuildSortThreadsParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedIndexBuildSortThreadsParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(), "indexBuildSortThreads", &indexBuildSortThreads) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 1 || potentialNewValue > 256) {
+            return Status(ErrorCodes::BadValue, "indexBuildSortThreads must be between 1 and 256");
+        }
+
+        return Status::OK();
+    }
+
+} exportedIndexBuildSortThreadsParam;
+
+SortOptions makeBulkBuilderSortOptions(size_t maxMemoryUsageBytes) {
+    SortOptions opts = SortOptions()
+                           .TempDir(storageGlobalParams.dbpath + "/_tmp")
+                           .ExtSortAllowed()
+                           .MaxMemoryUsageBytes(maxMemoryUsageBytes);
+
+    const int sortThreads =
+        std::min(indexBuildSortThreads.load(), static_cast<int>(ProcessInfo().getNumCores()));
+    if (sortThreads > 1) {
+        opts.SortThreads(sortThreads).SpillInBackground();
+    }
+    return opts;
+}
+
+}  // namespace
+
 //
 // Comparison for external sorter interface
 //
@@ -82,16 +123,28 @@ int oldCompare(const BSONObj& l, const BSONObj& r, const Ordering& o);
 
 class BtreeExternalSortComparison {
 public:
-    BtreeExternalSortComparison(const BSONObj& ordering, int version)
-        : _ordering(Ordering::make(ordering)), _version(version) {
+    /**
+     * If 'hasIncludedFields' is true, the sorted objects hold the values of the index's included
+     * fields after the key, and only the key fields are compared.
+     */
+    BtreeExternalSortComparison(const BSONObj& ordering, int version, bool hasIncludedFields)
+        : _ordering(Ordering::make(ordering)),
+          _version(version),
+          _numKeyFields(hasIncludedFields ? ordering.nFields() : 0) {
         invariant(version == 1 || version == 0);
+        invariant(version == 1 || !hasIncludedFields);
     }
 
     typedef std::pair<BSONObj, RecordId> Data;
 
     int operator()(const Data& l, const Data& r) const {
-        int x = (_version == 1 ? l.first.woCompare(r.first, _ordering, /*considerfieldname*/ false)
+        int x;
+        if (_numKeyFields) {
+            x = compareKeyFields(l.first, r.first);
+        } else {
+            x = (_version == 1 ? l.first.woCompare(r.first, _ordering, /*considerfieldname*/ false)
                                : oldCompare(l.first, r.first, _ordering));
+        }
         if (x) {
             return x;
         }
@@ -99,13 +152,72 @@ public:
     }
 
 private:
+    int compareKeyFields(const BSONObj& l, const BSONObj& r) const {
+        BSONObjIterator lIt(l);
+        BSONObjIterator rIt(r);
+        for (int i = 0; i < _numKeyFields; ++i) {
+            int x = lIt.next().woCompare(rIt.next(), /*considerfieldname*/ false);
+            if (x) {
+                return x * _ordering.get(i);
+            }
+        }
+        return 0;
+    }
+
     const Ordering _ordering;
     const int _version;
+    const int _numKeyFields;
+};
+
+class KeyStringExternalSortComparison {
+public:
+    typedef std::pair<SortableKeyString, RecordId> Data;
+
+    int operator()(const Data& l, const Data& r) const {
+        int x = l.first.compare(r.first);
+        if (x) {
+            return x;
+        }
+        return l.second.compare(r.second);
+    }
 };
 
+namespace {
+
+/**
+ * Decodes the output of a KeyString sorter back into the BSON keys the bulk builders expect.
+ */
+class KeyStringToBsonIterator final : public SortIteratorInterface<BSONObj, RecordId> {
+public:
+    using Input = SortIteratorInterface<SortableKeyString, RecordId>;
+
+    KeyStringToBsonIterator(std::shared_ptr<Input> input, Ordering ordering)
+        : _input(std::move(input)), _ordering(ordering) {}
+
+    bool more() final {
+        return _input->more();
+    }
+
+    Data next() final {
+        auto data = _input->next();
+        return Data(data.first.toBson(_ordering), data.second);
+    }
+
+private:
+    std::shared_ptr<Input> _input;
+    const Ordering _ordering;
+};
+
+}  // namespace
+
 IndexAccessMethod::IndexAccessMethod(IndexCatalogEntry* btreeState, SortedDataInterface* btree)
     : _btreeState(btreeState), _descriptor(btreeState->descriptor()), _newInterface(btree) {
     verify(0 == _descriptor->version() || 1 == _descriptor->version());
+
+    // Indexes on storage engines which cannot store included fields behave like regular indexes.
+    if (_newInterface->supportsIncludedFields()) {
+        _includedFields = _descriptor->includedFields();
+    }
 }
 
 bool IndexAccessMethod::ignoreKeyTooLong(OperationContext* txn) {
@@ -121,6 +233,21 @@ Status IndexAccessMethod::insert(OperationContext* txn,
                                  const RecordId& loc,
                                  const InsertDeleteOptions& options,
                                  int64_t* numInserted) {
+    if (isRecordingSideWrites()) {
+        invariant(numInserted);
+        *numInserted = 0;
+        recordSideWrite(txn, loc, {});
+        return Status::OK();
+    }
+
+    return insertKeys(txn, obj, loc, options, numInserted);
+}
+
+Status IndexAccessMethod::insertKeys(OperationContext* txn,
+                                     const BSONObj& obj,
+                                     const RecordId& loc,
+                                     const InsertDeleteOptions& options,
+                                     int64_t* numInserted) {
     invariant(numInserted);
     *numInserted = 0;
     BSONObjSet keys = SimpleBSONObjComparator::kInstance.makeBSONObjSet();
@@ -128,9 +255,13 @@ Status IndexAccessMethod::insert(OperationContext* txn,
     // Delegate to the subclass.
     getKeys(obj, &keys, &multikeyPaths);
 
+    const BSONObj included = getIncludedValues(obj);
+
     Status ret = Status::OK();
     for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-        Status status = _newInterface->insert(txn, *i, loc, options.dupsAllowed);
+        Status status = _includedFields.isEmpty()
+            ? _newInterface->insert(txn, *i, loc, options.dupsAllowed)
+            : _newInterface->insertWithIncludedFields(txn, *i, loc, options.dupsAllowed, included);
 
         // Everything's OK, carry on.
         if (status.isOK()) {
@@ -169,6 +300,25 @@ Status IndexAccessMethod::insert(OperationContext* txn,
     return ret;
 }
 
+BSONObj IndexAccessMethod::getIncludedValues(const BSONObj& obj) const {
+    if (_includedFields.isEmpty()) {
+        return BSONObj();
+    }
+
+    // Included fields are top-level, so a missing field is stored as null just like a missing
+    // key field.
+    BSONObjBuilder included;
+    for (auto&& field : _includedFields) {
+        BSONElement value = obj[field.fieldNameStringData()];
+        if (value.eoo()) {
+            included.appendNull("");
+        } else {
+            included.appendAs(value, "");
+        }
+    }
+    return included.obj();
+}
+
 void IndexAccessMethod::removeOneKey(OperationContext* txn,
                                      const BSONObj& key,
                                      const RecordId& loc,
@@ -208,6 +358,11 @@ Status IndexAccessMethod::remove(OperationContext* txn,
     MultikeyPaths* multikeyPaths = nullptr;
     getKeys(obj, &keys, multikeyPaths);
 
+    if (isRecordingSideWrites()) {
+        recordSideWrite(txn, loc, std::vector<BSONObj>(keys.begin(), keys.end()));
+        return Status::OK();
+    }
+
     for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
         removeOneKey(txn, *i, loc, options.dupsAllowed);
         ++*numDeleted;
@@ -341,6 +496,16 @@ Status IndexAccessMethod::validateUpdate(OperationContext* txn,
 
     std::tie(ticket->removed, ticket->added) = setDifference(ticket->oldKeys, ticket->newKeys);
 
+    if (!_includedFields.isEmpty()) {
+        // The included values are stored with every key, so if any of them changed then all of
+        // the keys have to be rewritten, not just the ones which differ.
+        ticket->newIncluded = getIncludedValues(to);
+        if (!getIncludedValues(from).binaryEqual(ticket->newIncluded)) {
+            ticket->removed.assign(ticket->oldKeys.begin(), ticket->oldKeys.end());
+            ticket->added.assign(ticket->newKeys.begin(), ticket->newKeys.end());
+        }
+    }
+
     ticket->_isValid = true;
 
     return Status::OK();
@@ -360,6 +525,12 @@ Status IndexAccessMethod::update(OperationContext* txn,
         return Status(ErrorCodes::InternalError, "Invalid UpdateTicket in update");
     }
 
+    if (isRecordingSideWrites()) {
+        recordSideWrite(
+            txn, ticket.loc, std::vector<BSONObj>(ticket.oldKeys.begin(), ticket.oldKeys.end()));
+        return Status::OK();
+    }
+
     if (ticket.oldKeys.size() + ticket.added.size() - ticket.removed.size() > 1 ||
         isMultikeyFromPaths(ticket.newMultikeyPaths)) {
         _btreeState->setMultikey(txn, ticket.newMultikeyPaths);
@@ -370,7 +541,10 @@ Status IndexAccessMethod::update(OperationContext* txn,
     }
 
     for (size_t i = 0; i < ticket.added.size(); ++i) {
-        Status status = _newInterface->insert(txn, ticket.added[i], ticket.loc, ticket.dupsAllowed);
+        Status status = _includedFields.isEmpty()
+            ? _newInterface->insert(txn, ticket.added[i], ticket.loc, ticket.dupsAllowed)
+            : _newInterface->insertWithIncludedFields(
+                  txn, ticket.added[i], ticket.loc, ticket.dupsAllowed, ticket.newIncluded);
         if (!status.isOK()) {
             if (status.code() == ErrorCodes::KeyTooLong && ignoreKeyTooLong(txn)) {
                 // Ignore.
@@ -387,23 +561,157 @@ Status IndexAccessMethod::update(OperationContext* txn,
     return Status::OK();
 }
 
+/**
+ * Records a side write once the WriteUnitOfWork which made it commits. Recording at commit rather
+ * than when the write happens means a drain never sees a write whose document it can't read yet.
+ */
+class IndexAccessMethod::RecordSideWriteChange : public RecoveryUnit::Change {
+public:
+    RecordSideWriteChange(std::shared_ptr<SideWritesTable> sideWrites,
+                          const RecordId& loc,
+                          std::vector<BSONObj> staleKeys)
+        : _sideWrites(std::move(sideWrites)), _loc(loc), _staleKeys(std::move(staleKeys)) {}
+
+    void commit() final {
+        stdx::lock_guard<stdx::mutex> lk(_sideWrites->mutex);
+        auto entry = _sideWrites->writes.emplace(_loc, std::vector<BSONObj>());
+
+        // Counts the map node and the keys, but not the allocator's overhead.
+        long long bytes = entry.second ? sizeof(SideWrites::value_type) + 4 * sizeof(void*) : 0;
+        for (auto&& key : _staleKeys) {
+            bytes += sizeof(BSONObj) + key.objsize();
+        }
+        _sideWrites->bytes.addAndFetch(bytes);
+
+        auto& keys = entry.first->second;
+        keys.insert(keys.end(),
+                    std::make_move_iterator(_staleKeys.begin()),
+                    std::make_move_iterator(_staleKeys.end()));
+    }
+
+    void rollback() final {}
+
+private:
+    const std::shared_ptr<SideWritesTable> _sideWrites;
+    const RecordId _loc;
+    std::vector<BSONObj> _staleKeys;
+};
+
+void IndexAccessMethod::recordSideWrite(OperationContext* txn,
+                                        const RecordId& loc,
+                                        std::vector<BSONObj> staleKeys) {
+    for (auto&& key : staleKeys) {
+        key = key.getOwned();
+    }
+    txn->recoveryUnit()->registerChange(
+        new RecordSideWriteChange(_sideWrites, loc, std::move(staleKeys)));
+}
+
+void IndexAccessMethod::startRecordingSideWrites() {
+    invariant(!_sideWrites);
+    _sideWrites = std::make_shared<SideWritesTable>();
+}
+
+void IndexAccessMethod::stopRecordingSideWrites() {
+    _sideWrites.reset();
+}
+
+void IndexAccessMethod::abandonSideWrites() {
+    invariant(_sideWrites);
+    _sideWrites->recording.store(false);
+
+    // The writes recorded so far only touched documents, which are read again once the index is
+    // built without them.
+    takeSideWrites();
+}
+
+IndexAccessMethod::SideWrites IndexAccessMethod::takeSideWrites() {
+    invariant(_sideWrites);
+    SideWrites writes;
+    stdx::lock_guard<stdx::mutex> lk(_sideWrites->mutex);
+    writes.swap(_sideWrites->writes);
+    _sideWrites->bytes.store(0);
+    return writes;
+}
+
+long long IndexAccessMethod::getSideWritesBytes() const {
+    return _sideWrites ? _sideWrites->bytes.load() : 0;
+}
+
+Status IndexAccessMethod::applySideWrite(OperationContext* txn,
+                                         const RecordId& loc,
+                                         const std::vector<BSONObj>& staleKeys,
+                                         const BSONObj* currentDoc,
+                                         const InsertDeleteOptions& options) {
+    BSONObjSet currentKeys = SimpleBSONObjComparator::kInstance.makeBSONObjSet();
+    if (currentDoc) {
+        MultikeyPaths* multikeyPaths = nullptr;
+        getKeys(*currentDoc, &currentKeys, multikeyPaths);
+    }
+
+    // Inserting a key which is already in the index leaves its entry as it is, so when the index
+    // has included fields every stale key is removed, in case the included values have changed.
+    for (auto&& key : staleKeys) {
+        if (!_includedFields.isEmpty() || !currentKeys.count(key)) {
+            removeOneKey(txn, key, loc, options.dupsAllowed);
+        }
+    }
+
+    // The bulk load or an earlier drain may already have inserted some of these keys, which the
+    // index accepts since it isn't ready yet.
+    if (currentDoc) {
+        int64_t unused;
+        return insertKeys(txn, *currentDoc, loc, options, &unused);
+    }
+    return Status::OK();
+}
+
 Status IndexAccessMethod::compact(OperationContext* txn) {
     return this->_newInterface->compact(txn);
 }
 
-std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk() {
-    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor));
+// static
+const size_t IndexAccessMethod::kDefaultBulkMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
+std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk(
+    size_t maxMemoryUsageBytes) {
+    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor, maxMemoryUsageBytes));
 }
 
 IndexAccessMethod::BulkBuilder::BulkBuilder(const IndexAccessMethod* index,
-                                            const IndexDescriptor* descriptor)
-    : _sorter(Sorter::make(
-          SortOptions()
-              .TempDir(storageGlobalParams.dbpath + "/_tmp")
-              .ExtSortAllowed()
-              .MaxMemoryUsageBytes(100 * 1024 * 1024),
-          BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version()))),
-      _real(index) {}
+                                            const IndexDescriptor* descriptor,
+                                            size_t maxMemoryUsageBytes)
+    : _ordering(Ordering::make(descriptor->keyPattern())),
+      _real(index),
+      _maxMemoryUsageBytes(maxMemoryUsageBytes) {
+    // v0 indexes order their keys with oldCompare(), which KeyStrings do not model. Keys with
+    // included field values are sorted as BSON, since KeyStrings would order by them too.
+    if (descriptor->version() != 0 && index->_includedFields.isEmpty()) {
+        _keyStringSorter.reset(KeyStringSorter::make(
+            makeBulkBuilderSortOptions(maxMemoryUsageBytes), KeyStringExternalSortComparison()));
+    } else {
+        _sorter.reset(Sorter::make(makeBulkBuilderSortOptions(maxMemoryUsageBytes),
+                                   _bsonComparison()));
+    }
+}
+
+BtreeExternalSortComparison IndexAccessMethod::BulkBuilder::_bsonComparison() const {
+    return BtreeExternalSortComparison(_real->_descriptor->keyPattern(),
+                                       _real->_descriptor->version(),
+                                       !_real->_includedFields.isEmpty());
+}
+
+void IndexAccessMethod::BulkBuilder::_switchToBsonSorter() {
+    // The keys already in '_keyStringSorter' keep their memory only if none were spilled, since
+    // done() spills the rest of them otherwise.
+    const size_t held = _keyStringSorter->numFiles() ? 0 : _keyStringSorter->memUsed();
+    _keyStringsSorted.reset(_keyStringSorter->done());
+    _keyStringSorter.reset();
+
+    _sorter.reset(Sorter::make(
+        makeBulkBuilderSortOptions(_maxMemoryUsageBytes - std::min(held, _maxMemoryUsageBytes)),
+        _bsonComparison()));
+}
 
 Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
                                               const BSONObj& obj,
@@ -415,20 +723,29 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
     _real->getKeys(obj, &keys, &multikeyPaths);
 
     _everGeneratedMultipleKeys = _everGeneratedMultipleKeys || (keys.size() > 1);
+    _addMultikeyPaths(multikeyPaths);
+
+    const BSONObj included = _real->getIncludedValues(obj);
 
-    if (!multikeyPaths.empty()) {
-        if (_indexMultikeyPaths.empty()) {
-            _indexMultikeyPaths = multikeyPaths;
+    for (BSONObjSet::iterator it = keys.begin(); it != keys.end(); ++it) {
+        if (!included.isEmpty()) {
+            // The included values follow the key fields, and commitBulk() splits them off again.
+            BSONObjBuilder keyAndIncluded(it->objsize() + included.objsize());
+            keyAndIncluded.appendElements(*it);
+            keyAndIncluded.appendElements(included);
+            _sorter->add(keyAndIncluded.obj(), loc);
+        } else if (_keyStringSorter && it->objsize() < int(KeyString::TypeBits::kMaxKeyBytes)) {
+            _keyStringSorter->add(
+                SortableKeyString(KeyString(SortableKeyString::kVersion, *it, _ordering)), loc);
         } else {
-            invariant(_indexMultikeyPaths.size() == multikeyPaths.size());
-            for (size_t i = 0; i < multikeyPaths.size(); ++i) {
-                _indexMultikeyPaths[i].insert(multikeyPaths[i].begin(), multikeyPaths[i].end());
+            // The TypeBits of a KeyString only have room for keys that fit in an index entry.
+            // Larger keys are kept as BSON so that the storage engine can still decide how to
+            // reject them, and so are all keys after them.
+            if (_keyStringSorter) {
+                _switchToBsonSorter();
             }
+            _sorter->add(*it, loc);
         }
-    }
-
-    for (BSONObjSet::iterator it = keys.begin(); it != keys.end(); ++it) {
-        _sorter->add(*it, loc);
         _keysInserted++;
     }
 
@@ -439,6 +756,93 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
     return Status::OK();
 }
 
+void IndexAccessMethod::BulkBuilder::_addMultikeyPaths(const MultikeyPaths& multikeyPaths) {
+    if (multikeyPaths.empty()) {
+        return;
+    }
+
+    if (_indexMultikeyPaths.empty()) {
+        _indexMultikeyPaths = multikeyPaths;
+        return;
+    }
+
+    invariant(_indexMultikeyPaths.size() == multikeyPaths.size());
+    for (size_t i = 0; i < multikeyPaths.size(); ++i) {
+        _indexMultikeyPaths[i].insert(multikeyPaths[i].begin(), multikeyPaths[i].end());
+    }
+}
+
+void IndexAccessMethod::BulkBuilder::absorb(std::unique_ptr<BulkBuilder> other) {
+    invariant(other->_real == _real);
+
+    // Finishing the sorts is the expensive part, so it happens before taking the lock.
+    std::shared_ptr<Sorter::Iterator> bsonKeys;
+    if (other->_sorter) {
+        bsonKeys.reset(other->_sorter->done());
+    }
+    std::shared_ptr<KeyStringSorter::Iterator> keyStrings;
+    if (other->_keyStringSorter) {
+        keyStrings.reset(other->_keyStringSorter->done());
+    } else {
+        keyStrings = std::move(other->_keyStringsSorted);
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_absorbMutex);
+    if (bsonKeys) {
+        _absorbedBsonKeys.push_back(std::move(bsonKeys));
+    }
+    if (keyStrings) {
+        _absorbedKeyStrings.push_back(std::move(keyStrings));
+    }
+    _absorbedBsonKeys.insert(_absorbedBsonKeys.end(),
+                             other->_absorbedBsonKeys.begin(),
+                             other->_absorbedBsonKeys.end());
+    _absorbedKeyStrings.insert(_absorbedKeyStrings.end(),
+                               other->_absorbedKeyStrings.begin(),
+                               other->_absorbedKeyStrings.end());
+
+    _keysInserted += other->_keysInserted;
+    _everGeneratedMultipleKeys = _everGeneratedMultipleKeys || other->_everGeneratedMultipleKeys;
+    _addMultikeyPaths(other->_indexMultikeyPaths);
+}
+
+std::shared_ptr<IndexAccessMethod::BulkBuilder::Sorter::Iterator>
+IndexAccessMethod::BulkBuilder::done() {
+    // Keys of absorbed BulkBuilders are merged in the same representation they were sorted in,
+    // so that KeyStrings are still compared with memcmp.
+    std::vector<std::shared_ptr<KeyStringSorter::Iterator>> keyStrings;
+    keyStrings.swap(_absorbedKeyStrings);
+    if (_keyStringSorter) {
+        keyStrings.emplace_back(_keyStringSorter->done());
+    } else if (_keyStringsSorted) {
+        keyStrings.push_back(std::move(_keyStringsSorted));
+    }
+
+    std::vector<std::shared_ptr<Sorter::Iterator>> iters;
+    iters.swap(_absorbedBsonKeys);
+    if (_sorter) {
+        iters.emplace_back(_sorter->done());
+    }
+
+    if (!keyStrings.empty()) {
+        std::shared_ptr<KeyStringSorter::Iterator> sortedKeyStrings(
+            keyStrings.size() == 1 ? keyStrings.front()
+                                   : std::shared_ptr<KeyStringSorter::Iterator>(
+                                         KeyStringSorter::Iterator::merge(
+                                             keyStrings,
+                                             SortOptions(),
+                                             KeyStringExternalSortComparison())));
+        iters.push_back(std::make_shared<KeyStringToBsonIterator>(sortedKeyStrings, _ordering));
+    }
+
+    if (iters.size() == 1) {
+        return iters.front();
+    }
+
+    // For indexes which use KeyStrings, this only happens once a key was too large to encode.
+    return std::shared_ptr<Sorter::Iterator>(
+        Sorter::Iterator::merge(iters, SortOptions(), _bsonComparison()));
+}
 
 Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      std::unique_ptr<BulkBuilder> bulk,
@@ -447,7 +851,7 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      set<RecordId>* dupsToDrop) {
     Timer timer;
 
-    std::unique_ptr<BulkBuilder::Sorter::Iterator> i(bulk->_sorter->done());
+    std::shared_ptr<BulkBuilder::Sorter::Iterator> i = bulk->done();
 
     stdx::unique_lock<Client> lk(*txn->getClient());
     ProgressMeterHolder pm(*txn->setMessage_inlock("Index Bulk Build: (2/3) btree bottom up",
@@ -484,7 +888,19 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
 
         // Get the next datum and add it to the builder.
         BulkBuilder::Sorter::Data d = i->next();
-        Status status = builder->addKey(d.first, d.second);
+        Status status = Status::OK();
+        if (_includedFields.isEmpty()) {
+            status = builder->addKey(d.first, d.second);
+        } else {
+            // Split off the included values which BulkBuilder::insert() appended to the key.
+            BSONObjBuilder key;
+            BSONObjBuilder included;
+            int numFields = 0;
+            for (auto&& elem : d.first) {
+                (numFields++ < _descriptor->getNumFields() ? key : included).append(elem);
+            }
+            status = builder->addKeyWithIncludedFields(key.obj(), d.second, included.obj());
+        }
 
         if (!status.isOK()) {
             // Overlong key that's OK to skip?
@@ -529,3 +945,6 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
 
 #include "mongo/db/sorter/sorter.cpp"
 MONGO_CREATE_SORTER(mongo::BSONObj, mongo::RecordId, mongo::BtreeExternalSortComparison);
+MONGO_CREATE_SORTER(mongo::SortableKeyString,
+                    mongo::RecordId,
+                    mongo::KeyStringExternalSortComparison);
@@ -29,7 +29,9 @@
 #pragma once
 
 #include <atomic>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/bson/simple_bsonobj_comparator.h"
@@ -37,14 +39,18 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/sorter/sortable_key_string.h"
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
 
 namespace mongo {
 
 extern std::atomic<bool> failIndexKeyTooLong;  // NOLINT
 
 class BSONObjBuilder;
+class BtreeExternalSortComparison;
 class MatchExpression;
 class UpdateTicket;
 struct InsertDeleteOptions;
@@ -186,6 +192,15 @@ public:
 
     RecordId findSingle(OperationContext* txn, const BSONObj& key) const;
 
+    /**
+     * Returns the fields whose values are stored alongside each key in this index, in the form
+     * {b: 1, c: 1}. Empty if the index has no included fields, or if its storage engine cannot
+     * store them.
+     */
+    const BSONObj& getIncludedFields() const {
+        return _includedFields;
+    }
+
     /**
      * Attempt compaction to regain disk space if the indexed record store supports
      * compaction-in-place.
@@ -207,15 +222,48 @@ public:
                       const InsertDeleteOptions& options,
                       int64_t* numInserted);
 
+        /**
+         * Takes over the keys inserted into 'other', which must have been started on the same
+         * index. The keys 'other' still holds in memory are sorted on the calling thread, so
+         * several threads may absorb into the same BulkBuilder at once. No keys may be inserted
+         * once absorption has started.
+         */
+        void absorb(std::unique_ptr<BulkBuilder> other);
+
     private:
         friend class IndexAccessMethod;
 
         using Sorter = mongo::Sorter<BSONObj, RecordId>;
+        using KeyStringSorter = mongo::Sorter<SortableKeyString, RecordId>;
+
+        BulkBuilder(const IndexAccessMethod* index,
+                    const IndexDescriptor* descriptor,
+                    size_t maxMemoryUsageBytes);
+
+        void _addMultikeyPaths(const MultikeyPaths& multikeyPaths);
 
-        BulkBuilder(const IndexAccessMethod* index, const IndexDescriptor* descriptor);
+        // Returns the keys added so far in index order, merging both sorters if needed.
+        std::shared_ptr<Sorter::Iterator> done();
 
+        BtreeExternalSortComparison _bsonComparison() const;
+
+        /**
+         * Finishes '_keyStringSorter' into '_keyStringsSorted' and creates '_sorter' with whatever
+         * memory budget the finished keys leave, so the two never use more than one budget.
+         */
+        void _switchToBsonSorter();
+
+        // Keys are encoded as KeyStrings and sorted with memcmp whenever the index version allows
+        // it, until one is too large to encode. '_sorter' compares the BSON keys directly. It
+        // holds every key of a v0 index or of an index with included fields, and the keys of
+        // other v1 indexes from the first one too large to encode on. Only one of the two sorters
+        // exists at a time, and '_keyStringsSorted' then holds the output of '_keyStringSorter'.
         std::unique_ptr<Sorter> _sorter;
+        std::unique_ptr<KeyStringSorter> _keyStringSorter;
+        std::unique_ptr<KeyStringSorter::Iterator> _keyStringsSorted;
+        const Ordering _ordering;
         const IndexAccessMethod* _real;
+        const size_t _maxMemoryUsageBytes;
         int64_t _keysInserted = 0;
 
         // Set to true if at least one document causes IndexAccessMethod::getKeys() to return a
@@ -225,8 +273,20 @@ public:
         // Holds the path components that cause this index to be multikey. The '_indexMultikeyPaths'
         // vector remains empty if this index doesn't support path-level multikey tracking.
         MultikeyPaths _indexMultikeyPaths;
+
+        // The sorted keys of the BulkBuilders absorbed into this one, merged with our own keys by
+        // done(). Guarded by '_absorbMutex', as are the members above while absorbing.
+        std::vector<std::shared_ptr<KeyStringSorter::Iterator>> _absorbedKeyStrings;
+        std::vector<std::shared_ptr<Sorter::Iterator>> _absorbedBsonKeys;
+        stdx::mutex _absorbMutex;
     };
 
+    /**
+     * The memory a BulkBuilder may use to sort keys before spilling them to disk, unless it is
+     * given a different budget.
+     */
+    static const size_t kDefaultBulkMaxMemoryUsageBytes;
+
     /**
      * Starts a bulk operation.
      * You work on the returned BulkBuilder and then call commitBulk.
@@ -234,7 +294,8 @@ public:
      *
      * It is only legal to initiate bulk when the index is new and empty.
      */
-    std::unique_ptr<BulkBuilder> initiateBulk();
+    std::unique_ptr<BulkBuilder> initiateBulk(
+        size_t maxMemoryUsageBytes = kDefaultBulkMaxMemoryUsageBytes);
 
     /**
      * Call this when you are ready to finish your bulk work.
@@ -275,6 +336,57 @@ public:
     static std::pair<std::vector<BSONObj>, std::vector<BSONObj>> setDifference(
         const BSONObjSet& left, const BSONObjSet& right);
 
+    //
+    // Hybrid index builds
+    //
+
+    /**
+     * The keys each document touched by side writes may have left in the index, by RecordId.
+     */
+    using SideWrites = std::map<RecordId, std::vector<BSONObj>>;
+
+    /**
+     * Makes writes to this index record the documents they touch instead of changing the index,
+     * while a hybrid index build loads it in bulk. A write is recorded when its WriteUnitOfWork
+     * commits, together with the keys of the document version it replaced.
+     */
+    void startRecordingSideWrites();
+
+    /**
+     * Makes writes go straight to the index again. No writes to the collection may be in progress.
+     */
+    void stopRecordingSideWrites();
+
+    /**
+     * Makes new writes go straight to the index again and forgets the side writes recorded so far,
+     * for a hybrid build which gives up on loading the index in bulk while it is still empty.
+     * Writes which were already in progress are still recorded, and must be applied once they
+     * finished.
+     */
+    void abandonSideWrites();
+
+    /**
+     * Returns the side writes recorded since the last call, and forgets them.
+     */
+    SideWrites takeSideWrites();
+
+    /**
+     * Returns roughly how much memory the side writes recorded since the last takeSideWrites()
+     * hold, in bytes.
+     */
+    long long getSideWritesBytes() const;
+
+    /**
+     * Brings the entries for 'loc' up to date after side writes touched it. The keys of
+     * 'currentDoc' are inserted, and any of 'staleKeys' it no longer generates are removed.
+     * 'currentDoc' is null if the document is gone or no longer matches the index's filter.
+     */
+    Status applySideWrite(OperationContext* txn,
+                          const RecordId& loc,
+                          const std::vector<BSONObj>& staleKeys,
+                          const BSONObj* currentDoc,
+                          const InsertDeleteOptions& options);
+
 protected:
     // Determines whether it's OK to ignore ErrorCodes::KeyTooLong for this OperationContext
     bool ignoreKeyTooLong(OperationContext* txn);
@@ -283,12 +395,55 @@ protected:
     const IndexDescriptor* _descriptor;
 
 private:
+    class RecordSideWriteChange;
+
+    struct SideWritesTable {
+        // Cleared by abandonSideWrites(). Writes which checked it before are still recorded.
+        AtomicWord<bool> recording{true};
+        AtomicInt64 bytes;  // The approximate size of 'writes'.
+
+        stdx::mutex mutex;
+        SideWrites writes;
+    };
+
+    /**
+     * Returns true if writes to this index should be recorded as side writes instead.
+     */
+    bool isRecordingSideWrites() const {
+        return _sideWrites && _sideWrites->recording.load();
+    }
+
+    /**
+     * Implements insert(), but always writes to the index, even while side writes are recorded.
+     */
+    Status insertKeys(OperationContext* txn,
+                      const BSONObj& obj,
+                      const RecordId& loc,
+                      const InsertDeleteOptions& options,
+                      int64_t* numInserted);
+
+    void recordSideWrite(OperationContext* txn,
+                         const RecordId& loc,
+                         std::vector<BSONObj> staleKeys);
+
     void removeOneKey(OperationContext* txn,
                       const BSONObj& key,
                       const RecordId& loc,
                       bool dupsAllowed);
 
+    /**
+     * Returns the values of the included fields of 'obj', in the same format as the index keys.
+     */
+    BSONObj getIncludedValues(const BSONObj& obj) const;
+
     const std::unique_ptr<SortedDataInterface> _newInterface;
+
+    BSONObj _includedFields;
+
+    // Set while a hybrid index build records the writes to this index, or may still have writes
+    // to apply. Only changed while no writes to the collection are in progress, and shared with
+    // the changes that record them.
+    std::shared_ptr<SideWritesTable> _sideWrites;
 };
 
 /**
@@ -311,6 +466,9 @@ private:
     std::vector<BSONObj> removed;
     std::vector<BSONObj> added;
 
+    // The included field values to store with each of the 'added' keys.
+    BSONObj newIncluded;
+
     RecordId loc;
     bool dupsAllowed;
 
@@ -78,6 +78,15 @@ public:
         if (e.isNumber()) {
             _version = e.numberInt();
         }
+
+        BSONElement include = _infoObj["include"];
+        if (include.type() == Array) {
+            BSONObjBuilder includedFields;
+            for (auto&& field : include.Obj()) {
+                includedFields.append(field.valueStringData(), 1);
+            }
+            _includedFields = includedFields.obj();
+        }
     }
 
     ~IndexDescriptor() {
@@ -106,6 +115,15 @@ public:
         _keyPattern = newKeyPattern;
     }
 
+    /**
+     * Returns the non-key fields whose values are stored with each index entry, as a pattern such
+     * as {b: 1, c: 1}, or an empty object if there are none. Set by the "include" index option.
+     */
+    const BSONObj& includedFields() const {
+        _checkOk();
+        return _includedFields;
+    }
+
     // How many fields do we index / are in the key pattern?
     int getNumFields() const {
         _checkOk();
@@ -246,6 +264,7 @@ private:
 
     int64_t _numFields;  // How many fields are indexed?
     BSONObj _keyPattern;
+    BSONObj _includedFields;
     std::string _indexName;
     std::string _parentNS;
     std::string _indexNamespace;
@@ -32,6 +32,7 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <boost/optional.hpp>
+#include <deque>
 #include <unordered_set>
 #include <vector>
 
@@ -39,6 +40,8 @@
 #include "mongo/bson/bsontypes.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/hyper_log_log.h"
+#include "mongo/db/pipeline/t_digest.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/pipeline/value_comparator.h"
 #include "mongo/stdx/functional.h"
@@ -88,6 +91,24 @@ public:
     /// Reset this accumulator to a fresh state ready to receive input.
     virtual void reset() = 0;
 
+    /**
+     * Prepares this accumulator to have values retracted with remove(), as needed when it is
+     * evaluated over a sliding window. Must be called before any input is processed. Returns false
+     * if this accumulator cannot retract values, in which case remove() must not be called.
+     */
+    virtual bool enableRemoval() {
+        return false;
+    }
+
+    /**
+     * Retracts 'input' from the accumulated state. Values must be removed in the same order in
+     * which they were passed to process() with 'merging' false, and only after enableRemoval()
+     * returned true.
+     */
+    void remove(const Value& input) {
+        removeInternal(input);
+    }
+
     /**
      * Registers an Accumulator with a parsing function, so that when an accumulator with the given
      * name is encountered during parsing of the $group stage, it will call 'factory' to construct
@@ -133,6 +154,11 @@ protected:
     /// Update subclass's internal state based on input
     virtual void processInternal(const Value& input, bool merging) = 0;
 
+    /// Retract 'input' from subclass's internal state. Only called if enableRemoval() succeeded.
+    virtual void removeInternal(const Value& input) {
+        MONGO_UNREACHABLE;
+    }
+
     /**
      * Accumulators which need to update their internal state when attaching to a new
      * ExpressionContext should override this method.
@@ -180,6 +206,74 @@ private:
 };
 
 
+/**
+ * Estimates the number of distinct values using a HyperLogLog sketch. Unlike $addToSet followed by
+ * $size, memory usage is bounded by the size of the sketch rather than the number of distinct
+ * values. Values are considered equal according to the collation of the ExpressionContext.
+ */
+class AccumulatorApproxCountDistinct final : public Accumulator {
+public:
+    AccumulatorApproxCountDistinct();
+
+    void processInternal(const Value& input, bool merging) final;
+    Value getValue(bool toBeMerged) const final;
+    const char* getOpName() const final;
+    void reset() final;
+
+    static boost::intrusive_ptr<Accumulator> create();
+
+    bool isAssociative() const final {
+        return true;
+    }
+
+    bool isCommutative() const final {
+        return true;
+    }
+
+private:
+    HyperLogLog _sketch;
+};
+
+
+/**
+ * Estimates one or more percentiles of the numeric input using a t-digest. The argument is an
+ * object of the form {input: <expression>, p: <number or array of numbers between 0 and 1>}. The
+ * result is a single number if 'p' is a number, or an array of numbers in the same order as 'p'.
+ * Non-numeric input is ignored.
+ */
+class AccumulatorApproxPercentile final : public Accumulator {
+public:
+    AccumulatorApproxPercentile();
+
+    void processInternal(const Value& input, bool merging) final;
+    Value getValue(bool toBeMerged) const final;
+    const char* getOpName() const final;
+    void reset() final;
+
+    static boost::intrusive_ptr<Accumulator> create();
+
+    bool isAssociative() const final {
+        return true;
+    }
+
+    bool isCommutative() const final {
+        return true;
+    }
+
+private:
+    /**
+     * Validates and records the requested percentiles, unless they have already been recorded.
+     */
+    void _setPercentiles(const Value& percentiles);
+
+    TDigest _digest;
+
+    // The requested percentiles, as given by the first input. Empty until the first input is seen.
+    std::vector<double> _percentiles;
+    bool _returnArray = false;
+};
+
+
 class AccumulatorFirst final : public Accumulator {
 public:
     AccumulatorFirst();
@@ -222,6 +316,15 @@ public:
     const char* getOpName() const final;
     void reset() final;
 
+    /**
+     * Removing a value never narrows the type of the result, so a window which once contained a
+     * double continues to produce doubles.
+     */
+    bool enableRemoval() final {
+        return true;
+    }
+    void removeInternal(const Value& input) final;
+
     static boost::intrusive_ptr<Accumulator> create();
 
     bool isAssociative() const final {
@@ -253,6 +356,9 @@ public:
     const char* getOpName() const final;
     void reset() final;
 
+    bool enableRemoval() final;
+    void removeInternal(const Value& input) final;
+
     bool isAssociative() const final {
         return true;
     }
@@ -264,6 +370,12 @@ public:
 private:
     Value _val;
     const Sense _sense;
+
+    // Only used once enableRemoval() has been called. Holds the values which could still become
+    // the result as older values are removed, in insertion order. Each value is strictly better
+    // than all of the values before it, so the front of the deque is always the current result.
+    bool _removable = false;
+    std::deque<Value> _candidates;
 };
 
 class AccumulatorMax final : public AccumulatorMinMax {
@@ -304,6 +416,11 @@ public:
     const char* getOpName() const final;
     void reset() final;
 
+    bool enableRemoval() final {
+        return true;
+    }
+    void removeInternal(const Value& input) final;
+
     static boost::intrusive_ptr<Accumulator> create();
 
 private:
@@ -0,0 +1,99 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+
+REGISTER_ACCUMULATOR(approxCountDistinct, AccumulatorApproxCountDistinct::create);
+
+namespace {
+/**
+ * Value hashes are only intended for use in hash tables and are not well distributed over all 64
+ * bits, which HyperLogLog relies on. This is the 64-bit finalizer from MurmurHash3.
+ */
+uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+}  // namespace
+
+const char* AccumulatorApproxCountDistinct::getOpName() const {
+    return "$approxCountDistinct";
+}
+
+void AccumulatorApproxCountDistinct::processInternal(const Value& input, bool merging) {
+    if (!merging) {
+        if (input.missing()) {
+            return;
+        }
+        _sketch.add(mixHash(getExpressionContext()->getValueComparator().hash(input)));
+    } else {
+        // 'input' is what getValue(true) produced below.
+        const BSONBinData binData = input.getBinData();
+        auto swSketch = HyperLogLog::deserialize(
+            StringData(static_cast<const char*>(binData.data), binData.length));
+        uassertStatusOK(swSketch.getStatus());
+        _sketch.merge(swSketch.getValue());
+    }
+    _memUsageBytes = sizeof(*this) - sizeof(_sketch) + _sketch.memUsageBytes();
+}
+
+Value AccumulatorApproxCountDistinct::getValue(bool toBeMerged) const {
+    if (toBeMerged) {
+        const std::string serialized = _sketch.serialize();
+        return Value(BSONBinData(serialized.data(), serialized.size(), BinDataGeneral));
+    }
+    return Value(_sketch.estimate());
+}
+
+AccumulatorApproxCountDistinct::AccumulatorApproxCountDistinct() {
+    _memUsageBytes = sizeof(*this);
+}
+
+void AccumulatorApproxCountDistinct::reset() {
+    _sketch.reset();
+    _memUsageBytes = sizeof(*this);
+}
+
+intrusive_ptr<Accumulator> AccumulatorApproxCountDistinct::create() {
+    return new AccumulatorApproxCountDistinct();
+}
+
+}  // namespace mongo
@@ -0,0 +1,164 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+REGISTER_ACCUMULATOR(approxPercentile, AccumulatorApproxPercentile::create);
+
+namespace {
+const char inputName[] = "input";
+const char percentilesName[] = "p";
+const char digestName[] = "digest";
+const char returnArrayName[] = "returnArray";
+}  // namespace
+
+const char* AccumulatorApproxPercentile::getOpName() const {
+    return "$approxPercentile";
+}
+
+void AccumulatorApproxPercentile::_setPercentiles(const Value& percentiles) {
+    if (!_percentiles.empty()) {
+        return;
+    }
+
+    auto validatePercentile = [](const Value& p) {
+        uassert(40310,
+                str::stream() << "$approxPercentile requires 'p' to contain numbers between 0 and "
+                                 "1, but found "
+                              << p.toString(),
+                p.numeric() && p.getDouble() >= 0 && p.getDouble() <= 1);
+        return p.getDouble();
+    };
+
+    if (percentiles.getType() == Array) {
+        uassert(40311,
+                "$approxPercentile requires 'p' to be a non-empty array",
+                !percentiles.getArray().empty());
+        for (auto&& p : percentiles.getArray()) {
+            _percentiles.push_back(validatePercentile(p));
+        }
+        _returnArray = true;
+    } else {
+        _percentiles.push_back(validatePercentile(percentiles));
+        _returnArray = false;
+    }
+}
+
+void AccumulatorApproxPercentile::processInternal(const Value& input, bool merging) {
+    if (!merging) {
+        uassert(40312,
+                str::stream() << "$approxPercentile requires an object of the form {" << inputName
+                              << ": <expression>, "
+                              << percentilesName
+                              << ": <number or array>}, but found "
+                              << input.toString(),
+                input.getType() == Object);
+
+        _setPercentiles(input[percentilesName]);
+
+        // Non-numeric input has no impact on the percentiles.
+        const Value value = input[inputName];
+        if (!value.numeric()) {
+            return;
+        }
+        _digest.add(value.getDouble());
+    } else {
+        // 'input' is what getValue(true) produced below.
+        verify(input.getType() == Object);
+        const Value percentiles = input[percentilesName];
+        if (!percentiles.getArray().empty()) {
+            _setPercentiles(input[returnArrayName].getBool() ? percentiles
+                                                             : percentiles.getArray().front());
+        }
+
+        const BSONBinData binData = input[digestName].getBinData();
+        auto swDigest = TDigest::deserialize(
+            StringData(static_cast<const char*>(binData.data), binData.length));
+        uassertStatusOK(swDigest.getStatus());
+        _digest.merge(swDigest.getValue());
+    }
+    _memUsageBytes = sizeof(*this) - sizeof(_digest) + _digest.memUsageBytes() +
+        _percentiles.capacity() * sizeof(double);
+}
+
+Value AccumulatorApproxPercentile::getValue(bool toBeMerged) const {
+    if (toBeMerged) {
+        const std::string serialized = _digest.serialize();
+        vector<Value> percentiles;
+        for (double p : _percentiles) {
+            percentiles.push_back(Value(p));
+        }
+        return Value(Document{
+            {digestName, BSONBinData(serialized.data(), serialized.size(), BinDataGeneral)},
+            {percentilesName, std::move(percentiles)},
+            {returnArrayName, _returnArray}});
+    }
+
+    if (_percentiles.empty() || _digest.empty()) {
+        return Value(BSONNULL);
+    }
+
+    if (!_returnArray) {
+        return Value(_digest.quantile(_percentiles.front()));
+    }
+
+    vector<Value> results;
+    for (double p : _percentiles) {
+        results.push_back(Value(_digest.quantile(p)));
+    }
+    return Value(std::move(results));
+}
+
+AccumulatorApproxPercentile::AccumulatorApproxPercentile() {
+    _memUsageBytes = sizeof(*this);
+}
+
+void AccumulatorApproxPercentile::reset() {
+    _digest.reset();
+    _percentiles.clear();
+    _returnArray = false;
+    _memUsageBytes = sizeof(*this);
+}
+
+intrusive_ptr<Accumulator> AccumulatorApproxPercentile::create() {
+    return new AccumulatorApproxPercentile();
+}
+
+}  // namespace mongo
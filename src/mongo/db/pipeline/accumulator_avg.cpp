@@ -28,6 +28,8 @@
 
 #include "mongo/platform/basic.h"
 
+#include <limits>
+
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
@@ -90,6 +92,31 @@ void AccumulatorAvg::processInternal(const Value& input, bool merging) {
     _count++;
 }
 
+void AccumulatorAvg::removeInternal(const Value& input) {
+    switch (input.getType()) {
+        case NumberDecimal:
+            _decimalTotal = _decimalTotal.subtract(input.getDecimal());
+            break;
+        case NumberLong:
+            if (input.getLong() == std::numeric_limits<long long>::min()) {
+                // The negation of the smallest long does not fit in a long.
+                _nonDecimalTotal.addLong(std::numeric_limits<long long>::max());
+                _nonDecimalTotal.addLong(1);
+            } else {
+                _nonDecimalTotal.addLong(-input.getLong());
+            }
+            break;
+        case NumberInt:
+        case NumberDouble:
+            _nonDecimalTotal.addDouble(-input.getDouble());
+            break;
+        default:
+            dassert(!input.numeric());
+            return;
+    }
+    _count--;
+}
+
 intrusive_ptr<Accumulator> AccumulatorAvg::create() {
     return new AccumulatorAvg();
 }
@@ -48,6 +48,25 @@ const char* AccumulatorMinMax::getOpName() const {
 }
 
 void AccumulatorMinMax::processInternal(const Value& input, bool merging) {
+    if (_removable) {
+        dassert(!merging);
+        if (input.nullish()) {
+            return;
+        }
+
+        // Any candidate which is worse than 'input' can never become the result again, since it
+        // will be removed before 'input' is.
+        const auto& valueCmp = getExpressionContext()->getValueComparator();
+        while (!_candidates.empty() && valueCmp.compare(_candidates.back(), input) * _sense > 0) {
+            _memUsageBytes -= _candidates.back().getApproximateSize();
+            _candidates.pop_back();
+        }
+        _candidates.push_back(input);
+        _memUsageBytes += input.getApproximateSize();
+        _val = _candidates.front();
+        return;
+    }
+
     // nullish values should have no impact on result
     if (!input.nullish()) {
         /* compare with the current value; swap if appropriate */
@@ -66,12 +85,33 @@ Value AccumulatorMinMax::getValue(bool toBeMerged) const {
     return _val;
 }
 
+bool AccumulatorMinMax::enableRemoval() {
+    _removable = true;
+    return true;
+}
+
+void AccumulatorMinMax::removeInternal(const Value& input) {
+    invariant(_removable);
+    if (input.nullish()) {
+        return;
+    }
+
+    // If 'input' is not the oldest candidate then it was already discarded by a better value.
+    if (!_candidates.empty() &&
+        getExpressionContext()->getValueComparator().evaluate(_candidates.front() == input)) {
+        _memUsageBytes -= _candidates.front().getApproximateSize();
+        _candidates.pop_front();
+    }
+    _val = _candidates.empty() ? Value() : _candidates.front();
+}
+
 AccumulatorMinMax::AccumulatorMinMax(Sense sense) : _sense(sense) {
     _memUsageBytes = sizeof(*this);
 }
 
 void AccumulatorMinMax::reset() {
     _val = Value();
+    _candidates.clear();
     _memUsageBytes = sizeof(*this);
 }
 
@@ -82,6 +82,35 @@ void AccumulatorSum::processInternal(const Value& input, bool merging) {
     }
 }
 
+void AccumulatorSum::removeInternal(const Value& input) {
+    if (!input.numeric()) {
+        return;
+    }
+
+    switch (input.getType()) {
+        case NumberInt:
+        case NumberLong: {
+            const long long value = input.coerceToLong();
+            if (value == std::numeric_limits<long long>::min()) {
+                // The negation of the smallest long does not fit in a long.
+                nonDecimalTotal.addLong(std::numeric_limits<long long>::max());
+                nonDecimalTotal.addLong(1);
+            } else {
+                nonDecimalTotal.addLong(-value);
+            }
+            break;
+        }
+        case NumberDouble:
+            nonDecimalTotal.addDouble(-input.getDouble());
+            break;
+        case NumberDecimal:
+            decimalTotal = decimalTotal.subtract(input.coerceToDecimal());
+            break;
+        default:
+            MONGO_UNREACHABLE;
+    }
+}
+
 intrusive_ptr<Accumulator> AccumulatorSum::create() {
     return new AccumulatorSum();
 }
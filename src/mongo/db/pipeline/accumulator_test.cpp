@@ -338,4 +338,131 @@ TEST(Accumulators, AddToSetRespectsCollation) {
         {{{Value("a"), Value("b"), Value("c")}, Value(std::vector<Value>{Value("a")})}});
 }
 
+TEST(Accumulators, ApproxCountDistinct) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    assertExpectedResults(
+        "$approxCountDistinct",
+        expCtx,
+        {
+            // No documents evaluated.
+            {{}, Value(0LL)},
+            // Missing values are ignored.
+            {{Value()}, Value(0LL)},
+            // Null is counted as a value.
+            {{Value(BSONNULL)}, Value(1LL)},
+            // Duplicates are only counted once.
+            {{Value("a"), Value("b"), Value("a"), Value("c"), Value("b")}, Value(3LL)},
+            // Numerically equal values of different types are the same value.
+            {{Value(1), Value(1LL), Value(1.0), Value(Decimal128(1))}, Value(1LL)},
+        });
+}
+
+TEST(Accumulators, ApproxCountDistinctRespectsCollation) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    expCtx->setCollator(
+        stdx::make_unique<CollatorInterfaceMock>(CollatorInterfaceMock::MockType::kAlwaysEqual));
+    assertExpectedResults("$approxCountDistinct",
+                          expCtx,
+                          {{{Value("a"), Value("b"), Value("c")}, Value(1LL)}});
+}
+
+TEST(Accumulators, ApproxCountDistinctLargeInputIsWithinErrorBounds) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    auto factory = Accumulator::getFactory("$approxCountDistinct");
+
+    const int numShards = 4;
+    const int n = 100000;
+    intrusive_ptr<Accumulator> merger = factory();
+    merger->injectExpressionContext(expCtx);
+    for (int shard = 0; shard < numShards; ++shard) {
+        intrusive_ptr<Accumulator> accum = factory();
+        accum->injectExpressionContext(expCtx);
+        // Every shard sees half of the values seen by the previous shard.
+        for (int i = shard * n / 2; i < shard * n / 2 + n; ++i) {
+            accum->process(Value(i), false);
+        }
+        merger->process(accum->getValue(true), true);
+    }
+
+    const long long expected = (numShards + 1) * n / 2;
+    ASSERT_APPROX_EQUAL(merger->getValue(false).getLong(), expected, expected * 0.05);
+
+    // The sketch uses bounded memory, unlike $addToSet.
+    ASSERT_LT(merger->memUsageForSorter(), 16 * 1024);
+}
+
+TEST(Accumulators, ApproxPercentile) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    auto input = [](Value value, Value p) { return Value(Document{{"input", value}, {"p", p}}); };
+    const Value median(0.5);
+    const Value extremes(std::vector<Value>{Value(0.0), Value(0.5), Value(1.0)});
+    assertExpectedResults(
+        "$approxPercentile",
+        expCtx,
+        {
+            // No documents evaluated.
+            {{}, Value(BSONNULL)},
+            // Non-numeric values are ignored.
+            {{input(Value("a"), median), input(Value(), median)}, Value(BSONNULL)},
+            // A single value.
+            {{input(Value(7), median)}, Value(7.0)},
+            // Small inputs are exact.
+            {{input(Value(5), median),
+              input(Value(1), median),
+              input(Value(4LL), median),
+              input(Value(2.0), median),
+              input(Value(3), median)},
+             Value(3.0)},
+            // An array of percentiles produces an array of results.
+            {{input(Value(5), extremes),
+              input(Value(1), extremes),
+              input(Value(3), extremes),
+              input(Value(2), extremes),
+              input(Value(4), extremes)},
+             Value(std::vector<Value>{Value(1.0), Value(3.0), Value(5.0)})},
+        });
+}
+
+TEST(Accumulators, ApproxPercentileLargeInputIsWithinErrorBounds) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    auto factory = Accumulator::getFactory("$approxPercentile");
+    const Value percentiles(std::vector<Value>{Value(0.01), Value(0.5), Value(0.99)});
+
+    const int numShards = 4;
+    const int n = 100000;
+    intrusive_ptr<Accumulator> merger = factory();
+    merger->injectExpressionContext(expCtx);
+    for (int shard = 0; shard < numShards; ++shard) {
+        intrusive_ptr<Accumulator> accum = factory();
+        accum->injectExpressionContext(expCtx);
+        for (int i = shard; i < n; i += numShards) {
+            accum->process(Value(Document{{"input", i}, {"p", percentiles}}), false);
+        }
+        merger->process(accum->getValue(true), true);
+    }
+
+    auto results = merger->getValue(false).getArray();
+    ASSERT_EQ(results.size(), 3U);
+    ASSERT_APPROX_EQUAL(results[0].getDouble(), 0.01 * n, n * 0.005);
+    ASSERT_APPROX_EQUAL(results[1].getDouble(), 0.5 * n, n * 0.005);
+    ASSERT_APPROX_EQUAL(results[2].getDouble(), 0.99 * n, n * 0.005);
+    ASSERT_LT(merger->memUsageForSorter(), 64 * 1024);
+}
+
+TEST(Accumulators, ApproxPercentileRejectsInvalidPercentiles) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    auto accum = Accumulator::getFactory("$approxPercentile")();
+    accum->injectExpressionContext(expCtx);
+    ASSERT_THROWS_CODE(accum->process(Value(1), false), UserException, 40312);
+    ASSERT_THROWS_CODE(
+        accum->process(Value(Document{{"input", 1}, {"p", 1.5}}), false), UserException, 40310);
+    ASSERT_THROWS_CODE(accum->process(Value(Document{{"input", 1}, {"p", "a"}}), false),
+                       UserException,
+                       40310);
+    ASSERT_THROWS_CODE(
+        accum->process(Value(Document{{"input", 1}, {"p", std::vector<Value>{}}}), false),
+        UserException,
+        40311);
+}
+
 }  // namespace AccumulatorTests
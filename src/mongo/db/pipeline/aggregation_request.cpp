@@ -54,6 +54,7 @@ const StringData AggregationRequest::kPipelineName = "pipeline"_sd;
 const StringData AggregationRequest::kCollationName = "collation"_sd;
 const StringData AggregationRequest::kExplainName = "explain"_sd;
 const StringData AggregationRequest::kAllowDiskUseName = "allowDiskUse"_sd;
+const StringData AggregationRequest::kCacheResultsName = "cacheResults"_sd;
 
 const long long AggregationRequest::kDefaultBatchSize = 101;
 
@@ -142,6 +143,13 @@ StatusWith<AggregationRequest> AggregationRequest::parseFromBSON(NamespaceString
                                       << typeName(elem.type())};
             }
             request.setAllowDiskUse(elem.Bool());
+        } else if (kCacheResultsName == fieldName) {
+            if (elem.type() != BSONType::Bool) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream() << kCacheResultsName << " must be a boolean, not a "
+                                      << typeName(elem.type())};
+            }
+            request.setCacheResults(elem.Bool());
         } else if (bypassDocumentValidationCommandOption() == fieldName) {
             request.setBypassDocumentValidation(elem.trueValue());
         } else {
@@ -161,6 +169,7 @@ Document AggregationRequest::serializeToCommandObj() const {
         {kExplainName, _explain ? Value(true) : Value()},
         {kAllowDiskUseName, _allowDiskUse ? Value(true) : Value()},
         {kFromRouterName, _fromRouter ? Value(true) : Value()},
+        {kCacheResultsName, _cacheResults ? Value(true) : Value()},
         {bypassDocumentValidationCommandOption(),
          _bypassDocumentValidation ? Value(true) : Value()},
         // Only serialize a collation if one was specified.
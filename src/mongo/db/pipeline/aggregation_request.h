@@ -54,6 +54,7 @@ public:
     static const StringData kCollationName;
     static const StringData kExplainName;
     static const StringData kAllowDiskUseName;
+    static const StringData kCacheResultsName;
 
     static const long long kDefaultBatchSize;
 
@@ -116,6 +117,14 @@ public:
         return _bypassDocumentValidation;
     }
 
+    /**
+     * True if the caller asked for the results of this pipeline to be served from, and stored in,
+     * the server's aggregation result cache.
+     */
+    bool shouldCacheResults() const {
+        return _cacheResults;
+    }
+
     /**
      * Returns an empty object if no collation was specified.
      */
@@ -160,6 +169,10 @@ public:
         _bypassDocumentValidation = shouldBypassDocumentValidation;
     }
 
+    void setCacheResults(bool cacheResults) {
+        _cacheResults = cacheResults;
+    }
+
 private:
     // Required fields.
 
@@ -180,6 +193,7 @@ private:
     bool _allowDiskUse = false;
     bool _fromRouter = false;
     bool _bypassDocumentValidation = false;
+    bool _cacheResults = false;
     bool _cursorCommand = false;
 };
 }  // namespace mongo
@@ -0,0 +1,129 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/aggregation_result_cache.h"
+
+#include "mongo/db/service_context.h"
+
+namespace mongo {
+
+namespace {
+const auto getAggregationResultCache =
+    ServiceContext::declareDecoration<AggregationResultCache>();
+}  // namespace
+
+AggregationResultCache& AggregationResultCache::get(ServiceContext* serviceContext) {
+    return getAggregationResultCache(serviceContext);
+}
+
+size_t AggregationResultCache::Entry::memUsage() const {
+    size_t size = sizeof(Entry) + key.size() + static_cast<size_t>(results.objsize());
+    for (auto&& version : versions) {
+        size += sizeof(CollectionVersion) + version.ns.size();
+    }
+    return size;
+}
+
+boost::optional<BSONArray> AggregationResultCache::lookup(const std::string& key,
+                                                          const CollectionVersions& versions,
+                                                          Date_t now) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto& byKey = boost::multi_index::get<1>(_container);
+    auto it = byKey.find(key);
+    if (it == byKey.end()) {
+        return boost::none;
+    }
+
+    auto seqIt = boost::multi_index::project<0>(_container, it);
+    if (it->versions != versions || it->expireAt <= now) {
+        _erase(seqIt);
+        return boost::none;
+    }
+
+    _container.relocate(_container.begin(), seqIt);
+    return it->results;
+}
+
+size_t AggregationResultCache::insert(std::string key,
+                                      CollectionVersions versions,
+                                      BSONArray results,
+                                      Date_t expireAt,
+                                      size_t maxBytes) {
+    Entry entry{std::move(key), std::move(versions), std::move(results), expireAt};
+    const size_t entrySize = entry.memUsage();
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto& byKey = boost::multi_index::get<1>(_container);
+    auto existing = byKey.find(entry.key);
+    if (existing != byKey.end()) {
+        _erase(boost::multi_index::project<0>(_container, existing));
+    }
+
+    if (entrySize > maxBytes) {
+        return 0;
+    }
+
+    size_t numEvicted = 0;
+    while (_memoryUsage + entrySize > maxBytes) {
+        invariant(!_container.empty());
+        _erase(std::prev(_container.end()));
+        ++numEvicted;
+    }
+
+    _container.push_front(std::move(entry));
+    _memoryUsage += entrySize;
+    return numEvicted;
+}
+
+void AggregationResultCache::clear() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _container.clear();
+    _memoryUsage = 0;
+}
+
+size_t AggregationResultCache::size() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _container.size();
+}
+
+size_t AggregationResultCache::getMemoryUsage() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _memoryUsage;
+}
+
+void AggregationResultCache::_erase(IndexedContainer::iterator it) {
+    const size_t entrySize = it->memUsage();
+    invariant(entrySize <= _memoryUsage);
+    _memoryUsage -= entrySize;
+    _container.erase(it);
+}
+
+}  // namespace mongo
@@ -0,0 +1,139 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/optional.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class ServiceContext;
+
+/**
+ * A least-recently-used cache of complete aggregation results, bounded by memory. Each entry
+ * records the write sequence (see CollectionInfoCache::getWriteSequence()) of every collection the
+ * pipeline read from when its results were computed; a lookup made with different sequences treats
+ * the entry as stale and discards it. Entries also expire at a fixed time after their insertion.
+ *
+ * Keys are opaque to the cache. Callers must build them from everything which determines a
+ * pipeline's results other than the contents of the collections it reads.
+ *
+ * This class is thread safe.
+ */
+class AggregationResultCache {
+public:
+    /**
+     * The write sequence of one collection read by a cached pipeline. Collections which did not
+     * exist when the pipeline ran are recorded with a sequence of zero.
+     */
+    struct CollectionVersion {
+        bool operator==(const CollectionVersion& other) const {
+            return ns == other.ns && writeSequence == other.writeSequence;
+        }
+
+        std::string ns;
+        unsigned long long writeSequence;
+    };
+
+    using CollectionVersions = std::vector<CollectionVersion>;
+
+    static AggregationResultCache& get(ServiceContext* serviceContext);
+
+    /**
+     * Returns the results cached under 'key' if they were computed from exactly the collection
+     * states described by 'versions' and have not expired by 'now'. Stale and expired entries are
+     * removed. A hit makes the entry the most recently used.
+     */
+    boost::optional<BSONArray> lookup(const std::string& key,
+                                      const CollectionVersions& versions,
+                                      Date_t now);
+
+    /**
+     * Caches 'results' under 'key', replacing any existing entry, then evicts least recently used
+     * entries until the cache holds at most 'maxBytes'. Results which alone exceed 'maxBytes' are
+     * not cached. Returns the number of entries evicted to make room.
+     */
+    size_t insert(std::string key,
+                  CollectionVersions versions,
+                  BSONArray results,
+                  Date_t expireAt,
+                  size_t maxBytes);
+
+    /**
+     * Removes every entry from the cache.
+     */
+    void clear();
+
+    /**
+     * Returns the number of cached entries.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the approximate number of bytes held by cached entries.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+    struct Entry {
+        size_t memUsage() const;
+
+        std::string key;
+        CollectionVersions versions;
+        BSONArray results;
+        Date_t expireAt;
+    };
+
+    // Ordered from most to least recently used, with a unique hashed index on the key.
+    using IndexedContainer = boost::multi_index::multi_index_container<
+        Entry,
+        boost::multi_index::indexed_by<
+            boost::multi_index::sequenced<>,
+            boost::multi_index::hashed_unique<
+                boost::multi_index::member<Entry, std::string, &Entry::key>>>>;
+
+    void _erase(IndexedContainer::iterator it);
+
+    mutable stdx::mutex _mutex;
+    IndexedContainer _container;
+    size_t _memoryUsage = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,154 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/aggregation_result_cache.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using CollectionVersions = AggregationResultCache::CollectionVersions;
+
+const size_t kLargeBudget = 1024 * 1024;
+
+BSONArray makeResults(int numResults) {
+    BSONArrayBuilder builder;
+    for (int i = 0; i < numResults; ++i) {
+        builder.append(BSON("_id" << i));
+    }
+    return builder.arr();
+}
+
+CollectionVersions makeVersions(unsigned long long writeSequence) {
+    return {{"test.coll", writeSequence}, {"test.other", 0}};
+}
+
+TEST(AggregationResultCacheTest, LookupOnEmptyCacheMisses) {
+    AggregationResultCache cache;
+    ASSERT_FALSE(cache.lookup("key", makeVersions(1), Date_t::fromMillisSinceEpoch(0)));
+}
+
+TEST(AggregationResultCacheTest, LookupReturnsInsertedResults) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    ASSERT_EQ(0U,
+              cache.insert("key", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget));
+
+    auto results = cache.lookup("key", makeVersions(1), now);
+    ASSERT_TRUE(results);
+    ASSERT_BSONOBJ_EQ(*results, makeResults(3));
+    ASSERT_FALSE(cache.lookup("otherKey", makeVersions(1), now));
+}
+
+TEST(AggregationResultCacheTest, WriteToAnyCollectionInvalidatesEntry) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    cache.insert("key", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget);
+
+    CollectionVersions versions = makeVersions(1);
+    versions[1].writeSequence = 7;
+    ASSERT_FALSE(cache.lookup("key", versions, now));
+
+    // A stale entry is dropped rather than kept around for the old versions.
+    ASSERT_FALSE(cache.lookup("key", makeVersions(1), now));
+    ASSERT_EQ(0U, cache.size());
+    ASSERT_EQ(0U, cache.getMemoryUsage());
+}
+
+TEST(AggregationResultCacheTest, EntryExpires) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    cache.insert("key", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget);
+
+    ASSERT_TRUE(cache.lookup("key", makeVersions(1), now + Milliseconds(999)));
+    ASSERT_FALSE(cache.lookup("key", makeVersions(1), now + Seconds(1)));
+    ASSERT_EQ(0U, cache.size());
+}
+
+TEST(AggregationResultCacheTest, InsertReplacesExistingEntry) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    cache.insert("key", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget);
+    cache.insert("key", makeVersions(2), makeResults(5), now + Seconds(1), kLargeBudget);
+
+    ASSERT_EQ(1U, cache.size());
+    auto results = cache.lookup("key", makeVersions(2), now);
+    ASSERT_TRUE(results);
+    ASSERT_BSONOBJ_EQ(*results, makeResults(5));
+}
+
+TEST(AggregationResultCacheTest, EvictsLeastRecentlyUsedEntryToStayWithinBudget) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    const auto expireAt = now + Seconds(1);
+    cache.insert("a", makeVersions(1), makeResults(10), expireAt, kLargeBudget);
+    const size_t entrySize = cache.getMemoryUsage();
+    const size_t budget = 2 * entrySize;
+
+    ASSERT_EQ(0U, cache.insert("b", makeVersions(1), makeResults(10), expireAt, budget));
+
+    // Using "a" makes "b" the least recently used entry.
+    ASSERT_TRUE(cache.lookup("a", makeVersions(1), now));
+    ASSERT_EQ(1U, cache.insert("c", makeVersions(1), makeResults(10), expireAt, budget));
+
+    ASSERT_EQ(2U, cache.size());
+    ASSERT_LTE(cache.getMemoryUsage(), budget);
+    ASSERT_TRUE(cache.lookup("a", makeVersions(1), now));
+    ASSERT_FALSE(cache.lookup("b", makeVersions(1), now));
+    ASSERT_TRUE(cache.lookup("c", makeVersions(1), now));
+}
+
+TEST(AggregationResultCacheTest, DoesNotCacheResultsLargerThanBudget) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    cache.insert("key", makeVersions(1), makeResults(1), now + Seconds(1), kLargeBudget);
+
+    ASSERT_EQ(0U, cache.insert("key", makeVersions(2), makeResults(1000), now + Seconds(1), 1024));
+    ASSERT_EQ(0U, cache.size());
+    ASSERT_EQ(0U, cache.getMemoryUsage());
+}
+
+TEST(AggregationResultCacheTest, ClearRemovesAllEntries) {
+    AggregationResultCache cache;
+    const auto now = Date_t::fromMillisSinceEpoch(1000);
+    cache.insert("a", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget);
+    cache.insert("b", makeVersions(1), makeResults(3), now + Seconds(1), kLargeBudget);
+
+    cache.clear();
+    ASSERT_EQ(0U, cache.size());
+    ASSERT_EQ(0U, cache.getMemoryUsage());
+    ASSERT_FALSE(cache.lookup("a", makeVersions(1), now));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -35,6 +35,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/field_path.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 using namespace mongoutils;
@@ -44,11 +45,62 @@ using std::vector;
 
 const DocumentStorage DocumentStorage::kEmptyDoc;
 
+namespace {
+bool isMetaFieldName(StringData fieldName) {
+    return fieldName[0] == '$' &&
+        (fieldName == Document::metaFieldTextScore || fieldName == Document::metaFieldRandVal);
+}
+}  // namespace
+
+DocumentStorage::DocumentStorage(const BSONObj& bson, bool parseMetaData) : DocumentStorage() {
+    _bson = bson.getOwned();
+    _bsonOffset = 4;  // Skip the length prefix to the first element.
+    _backedByBson = true;
+
+    if (parseMetaData) {
+        // Metadata has to be extracted up front, but this only needs to look at field names.
+        for (auto&& elem : _bson) {
+            auto fieldName = elem.fieldNameStringData();
+            if (fieldName == Document::metaFieldTextScore) {
+                setTextScore(elem.Double());
+                _bsonHasMetaFields = true;
+            } else if (fieldName == Document::metaFieldRandVal) {
+                setRandMetaField(elem.Double());
+                _bsonHasMetaFields = true;
+            }
+        }
+    }
+}
+
+Position DocumentStorage::loadNextBsonElement() {
+    BSONElement elem(_bson.objdata() + _bsonOffset);
+    if (elem.eoo()) {
+        _bsonOffset = 0;
+        return Position();
+    }
+    _bsonOffset += elem.size();
+
+    auto fieldName = elem.fieldNameStringData();
+    if (_bsonHasMetaFields && isMetaFieldName(fieldName)) {
+        return Position();
+    }
+
+    // Note: this will not parse out metadata in embedded documents.
+    Position pos = getNextPosition();
+    appendField(fieldName) = Value(elem);
+    return pos;
+}
+
 Position DocumentStorage::findField(StringData requested) const {
+    // Small documents are scanned linearly, so only hash the name if it will be used.
+    return findField(requested, _numFields >= HASH_TAB_MIN ? hashKey(requested) : 0);
+}
+
+Position DocumentStorage::findField(StringData requested, unsigned requestedHash) const {
     int reqSize = requested.size();  // get size calculation out of the way if needed
 
     if (_numFields >= HASH_TAB_MIN) {  // hash lookup
-        const unsigned bucket = bucketForKey(requested);
+        const unsigned bucket = requestedHash & _hashTabMask;
 
         Position pos = _hashTab[bucket];
         while (pos.found()) {
@@ -61,13 +113,21 @@ Position DocumentStorage::findField(StringData requested) const {
             pos = elem.nextCollision;
         }
     } else {  // linear scan
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        for (DocumentStorageIterator it = iteratorCacheOnly(); !it.atEnd(); it.advance()) {
             if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
                 return it.position();
             }
         }
     }
 
+    // The field hasn't been decoded yet, so read further into the backing BSON until we find it.
+    while (_bsonOffset) {
+        Position pos = const_cast<DocumentStorage*>(this)->loadNextBsonElement();
+        if (pos.found() && getField(pos).nameSD() == requested) {
+            return pos;
+        }
+    }
+
     // if we got here, there's no such field
     return Position();
 }
@@ -132,6 +192,7 @@ void DocumentStorage::alloc(unsigned newSize) {
     const bool firstAlloc = !_buffer;
     const bool doingRehash = needRehash();
     const size_t oldCapacity = _bufferEnd - _buffer;
+    const size_t oldBufferBytes = bufferBytes();
 
     // make new bucket count big enough
     while (needRehash() || hashTabBuckets() < HASH_TAB_INIT_SIZE)
@@ -144,13 +205,14 @@ void DocumentStorage::alloc(unsigned newSize) {
 
     uassert(16490, "Tried to make oversized document", capacity <= size_t(BufferMaxSize));
 
-    std::unique_ptr<char[]> oldBuf(_buffer);
-    _buffer = new char[capacity];
+    char* const oldBuf = _buffer;
+    ON_BLOCK_EXIT([oldBuf, oldBufferBytes] { DocumentArena::deallocate(oldBuf, oldBufferBytes); });
+    _buffer = static_cast<char*>(DocumentArena::allocate(capacity));
     _bufferEnd = _buffer + capacity - hashTabBytes();
 
     if (!firstAlloc) {
         // This just copies the elements
-        memcpy(_buffer, oldBuf.get(), _usedBytes);
+        memcpy(_buffer, oldBuf, _usedBytes);
 
         if (_numFields >= HASH_TAB_MIN) {
             // if we were hashing, deal with the hash table
@@ -158,7 +220,7 @@ void DocumentStorage::alloc(unsigned newSize) {
                 rehash();
             } else {
                 // no rehash needed so just slide table down to new position
-                memcpy(_hashTab, oldBuf.get() + oldCapacity, hashTabBytes());
+                memcpy(_hashTab, oldBuf + oldCapacity, hashTabBytes());
             }
         }
     }
@@ -177,19 +239,28 @@ void DocumentStorage::reserveFields(size_t expectedFields) {
 
     uassert(16491, "Tried to make oversized document", newSize <= size_t(BufferMaxSize));
 
-    _buffer = new char[newSize + hashTabBytes()];
-    _bufferEnd = _buffer + newSize;
+    // Round up to a power of two like alloc() does, so that the buffer can be recycled.
+    size_t capacity = 128;
+    while (capacity < newSize + hashTabBytes())
+        capacity *= 2;
+
+    _buffer = static_cast<char*>(DocumentArena::allocate(capacity));
+    _bufferEnd = _buffer + capacity - hashTabBytes();
 }
 
 intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
+    // The clone is about to be modified, so it is never backed by BSON.
+    fillCache();
     intrusive_ptr<DocumentStorage> out(new DocumentStorage());
 
     // Make a copy of the buffer.
     // It is very important that the positions of each field are the same after cloning.
-    const size_t bufferBytes = (_bufferEnd + hashTabBytes()) - _buffer;
-    out->_buffer = new char[bufferBytes];
-    out->_bufferEnd = out->_buffer + (_bufferEnd - _buffer);
-    memcpy(out->_buffer, _buffer, bufferBytes);
+    if (_buffer) {
+        const size_t bytes = bufferBytes();
+        out->_buffer = static_cast<char*>(DocumentArena::allocate(bytes));
+        out->_bufferEnd = out->_buffer + (_bufferEnd - _buffer);
+        memcpy(out->_buffer, _buffer, bytes);
+    }
 
     // Copy remaining fields
     out->_usedBytes = _usedBytes;
@@ -208,11 +279,11 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
 }
 
 DocumentStorage::~DocumentStorage() {
-    std::unique_ptr<char[]> deleteBufferAtScopeEnd(_buffer);
-
-    for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+    for (DocumentStorageIterator it = iteratorCacheOnly(); !it.atEnd(); it.advance()) {
         it->val.~Value();  // explicit destructor call
     }
+
+    DocumentArena::deallocate(_buffer, bufferBytes());
 }
 
 Document::Document(const BSONObj& bson) {
@@ -245,12 +316,21 @@ BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d
 }
 
 void Document::toBson(BSONObjBuilder* pBuilder) const {
+    if (auto bson = storage().getBson()) {
+        pBuilder->appendElements(*bson);
+        return;
+    }
+
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
         *pBuilder << it->nameSD() << it->val;
     }
 }
 
 BSONObj Document::toBson() const {
+    if (auto bson = storage().getBson()) {
+        return *bson;
+    }
+
     BSONObjBuilder bb;
     toBson(&bb);
     return bb.obj();
@@ -260,6 +340,10 @@ const StringData Document::metaFieldTextScore("$textScore"_sd);
 const StringData Document::metaFieldRandVal("$randVal"_sd);
 
 BSONObj Document::toBsonWithMetaData() const {
+    if (auto bson = storage().getBson()) {
+        return *bson;  // Backing BSON only has no metadata fields if the Document has no metadata.
+    }
+
     BSONObjBuilder bb;
     toBson(&bb);
     if (hasTextScore())
@@ -293,6 +377,10 @@ Document Document::fromBsonWithMetaData(const BSONObj& bson) {
     return md.freeze();
 }
 
+Document Document::lazyFromBsonWithMetaData(const BSONObj& bson) {
+    return Document(new DocumentStorage(bson, /*parseMetaData=*/true));
+}
+
 MutableDocument::MutableDocument(size_t expectedFields)
     : _storageHolder(NULL), _storage(_storageHolder) {
     if (expectedFields) {
@@ -365,7 +453,8 @@ size_t Document::getApproximateSize() const {
     size_t size = sizeof(DocumentStorage);
     size += storage().allocatedBytes();
 
-    for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
+    // Fields which have not been decoded yet are accounted for by allocatedBytes().
+    for (DocumentStorageIterator it = storage().iteratorCacheOnly(); !it.atEnd(); it.advance()) {
         size += it->val.getApproximateSize();
         size -= sizeof(Value);  // already accounted for above
     }
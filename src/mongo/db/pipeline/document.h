@@ -64,6 +64,12 @@ class Position;
  *  pass and return by Value. Note that the data in a Document is
  *  immutable, but you can replace a Document instance with assignment.
  *
+ *  Thread-safety: as for Value, any number of threads may read a Document
+ *  concurrently, except for Documents created by lazyFromBsonWithMetaData()
+ *  and their copies, which share storage that is filled in as it is read.
+ *  Such Documents, and Values holding them, may only be read by one thread
+ *  at a time, including when they are sorted or spilled on another thread.
+ *
  *  See Also: Value class in Value.h
  */
 class Document {
@@ -115,6 +121,17 @@ public:
         return storage().getField(key);
     }
 
+    /**
+     * Like getField(key), but with 'keyHash' already computed by hashFieldName(key). Callers which
+     * look up the same field in many Documents can use this to hash the name only once.
+     */
+    const Value getField(StringData key, unsigned keyHash) const {
+        return storage().getField(key, keyHash);
+    }
+    static unsigned hashFieldName(StringData key) {
+        return DocumentStorage::hashKey(key);
+    }
+
     /// Look up a field by Position. See positionOf and getNestedField.
     const Value operator[](Position pos) const {
         return getField(pos);
@@ -211,6 +228,15 @@ public:
      */
     static Document fromBsonWithMetaData(const BSONObj& bson);
 
+    /**
+     * Like fromBsonWithMetaData(), but keeps an owned copy of 'bson' and decodes each top-level
+     * field the first time it is looked up rather than all of them up front. Until the Document is
+     * modified, toBson() returns the original BSON without rebuilding it. Unlike other Documents,
+     * these must not be read concurrently from multiple threads, since reading them modifies
+     * their storage; see DocumentStorage.
+     */
+    static Document lazyFromBsonWithMetaData(const BSONObj& bson);
+
     // Support BSONObjBuilder and BSONArrayBuilder "stream" API
     friend BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d);
 
@@ -543,7 +569,10 @@ private:
             return clonedStorage();
 
         // This function exists to ensure this is safe
-        return const_cast<DocumentStorage&>(*storagePtr());
+        DocumentStorage& storage = const_cast<DocumentStorage&>(*storagePtr());
+        if (MONGO_unlikely(storage.isBackedByBson()))
+            storage.releaseBson();  // Modifications can't be reflected in the original BSON.
+        return storage;
     }
     DocumentStorage& newStorage() {
         reset(new DocumentStorage);
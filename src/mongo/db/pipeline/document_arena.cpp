@@ -0,0 +1,124 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_arena.h"
+
+#include <new>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+namespace {
+
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL DocumentArena* currentArena = nullptr;
+
+/**
+ * Returns the index of the smallest size class which fits 'bytes', or -1 if none does.
+ */
+int sizeClassFor(size_t bytes) {
+    if (bytes > (size_t(1) << DocumentArena::kMaxSizeClassLog2))
+        return -1;
+
+    int sizeClass = 0;
+    while ((size_t(1) << (DocumentArena::kMinSizeClassLog2 + sizeClass)) < bytes)
+        sizeClass++;
+    return sizeClass;
+}
+
+size_t sizeClassBytes(int sizeClass) {
+    return size_t(1) << (DocumentArena::kMinSizeClassLog2 + sizeClass);
+}
+
+}  // namespace
+
+const int DocumentArena::kMinSizeClassLog2;
+const int DocumentArena::kMaxSizeClassLog2;
+const size_t DocumentArena::kMaxCachedBytes;
+
+DocumentArena::DocumentArena() : _previous(currentArena) {
+    currentArena = this;
+}
+
+DocumentArena::~DocumentArena() {
+    invariant(currentArena == this);
+    currentArena = _previous;
+
+    for (FreeBlock* head : _freeLists) {
+        while (head) {
+            FreeBlock* next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+}
+
+void* DocumentArena::allocate(size_t bytes) {
+    const int sizeClass = sizeClassFor(bytes);
+    if (sizeClass < 0)
+        return ::operator new(bytes);
+
+    // Blocks which could be cached are always allocated at the full size of their class, since
+    // they may be freed into an arena which hands them out for any request of that class.
+    DocumentArena* arena = currentArena;
+    if (!arena)
+        return ::operator new(sizeClassBytes(sizeClass));
+
+    if (FreeBlock* block = arena->_freeLists[sizeClass]) {
+        arena->_freeLists[sizeClass] = block->next;
+        arena->_cachedBytes -= sizeClassBytes(sizeClass);
+        arena->_reusedAllocations++;
+        return block;
+    }
+
+    arena->_heapAllocations++;
+    return ::operator new(sizeClassBytes(sizeClass));
+}
+
+void DocumentArena::deallocate(void* block, size_t bytes) {
+    if (!block)
+        return;
+
+    const int sizeClass = sizeClassFor(bytes);
+    DocumentArena* arena = currentArena;
+    if (sizeClass < 0 || !arena ||
+        arena->_cachedBytes + sizeClassBytes(sizeClass) > kMaxCachedBytes) {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeBlock* freed = new (block) FreeBlock{arena->_freeLists[sizeClass]};
+    arena->_freeLists[sizeClass] = freed;
+    arena->_cachedBytes += sizeClassBytes(sizeClass);
+}
+
+}  // namespace mongo
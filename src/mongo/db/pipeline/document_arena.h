@@ -0,0 +1,98 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+/**
+ * While in scope, recycles the memory of DocumentStorage objects, their field buffers and array
+ * storage freed on the current thread, so that a pipeline which creates and discards many
+ * transient documents reuses a handful of blocks instead of going through malloc and free for
+ * each of them. Arenas are meant to be scoped to the processing of one batch of results.
+ *
+ * The arena only changes where memory comes from; reference counting is unaffected. Documents and
+ * values which outlive the arena, for example by being stashed in a cursor or handed to another
+ * thread, stay valid: their memory is returned to the heap, or to whichever arena is in scope on
+ * the thread that frees them. Arenas may be nested, in which case the innermost one is used.
+ */
+class DocumentArena {
+    MONGO_DISALLOW_COPYING(DocumentArena);
+
+public:
+    DocumentArena();
+    ~DocumentArena();
+
+    /**
+     * Returns a block of at least 'bytes' bytes, reusing memory cached by the arena in scope on
+     * this thread if there is any. Must be released with deallocate() and the same 'bytes'.
+     */
+    static void* allocate(size_t bytes);
+    static void deallocate(void* block, size_t bytes);
+
+    /**
+     * Number of blocks requested from this arena which had to be allocated from the heap.
+     */
+    long long heapAllocations() const {
+        return _heapAllocations;
+    }
+
+    /**
+     * Number of blocks requested from this arena which were served from memory freed earlier.
+     */
+    long long reusedAllocations() const {
+        return _reusedAllocations;
+    }
+
+    // Blocks are cached in power-of-two size classes from 2^kMinSizeClassLog2 to
+    // 2^kMaxSizeClassLog2 bytes. Larger blocks always go to and from the heap.
+    static const int kMinSizeClassLog2 = 5;
+    static const int kMaxSizeClassLog2 = 13;
+
+    // Freed blocks are returned to the heap rather than cached beyond this many bytes.
+    static const size_t kMaxCachedBytes = 4 * 1024 * 1024;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    DocumentArena* const _previous;
+    std::array<FreeBlock*, kMaxSizeClassLog2 - kMinSizeClassLog2 + 1> _freeLists{};
+    size_t _cachedBytes = 0;
+    long long _heapAllocations = 0;
+    long long _reusedAllocations = 0;
+};
+
+}  // namespace mongo
@@ -32,7 +32,10 @@
 
 #include <bitset>
 #include <boost/intrusive_ptr.hpp>
+#include <boost/optional.hpp>
 
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/pipeline/document_arena.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/util/intrusive_counter.h"
 
@@ -178,7 +181,13 @@ private:
     bool _includeMissing;
 };
 
-/// Storage class used by both Document and MutableDocument
+/** Storage class used by both Document and MutableDocument
+ *
+ *  Storage created from BSON keeps an owned copy of it and only decodes each field into the buffer
+ *  the first time it is looked up, so that the buffer acts as a cache of the fields read so far.
+ *  Lookups on such storage may therefore modify it even through a const reference, so Documents
+ *  backed by BSON must not be read concurrently from multiple threads.
+ */
 class DocumentStorage : public RefCountable {
 public:
     DocumentStorage()
@@ -189,10 +198,27 @@ public:
           _hashTabMask(0),
           _metaFields(),
           _textScore(0),
-          _randVal(0) {}
+          _randVal(0),
+          _bsonOffset(0),
+          _backedByBson(false),
+          _bsonHasMetaFields(false) {}
+
+    /**
+     * Creates storage backed by an owned copy of 'bson', whose fields are decoded lazily. If
+     * 'parseMetaData' is true, top-level fields with metadata names are treated as metadata.
+     */
+    DocumentStorage(const BSONObj& bson, bool parseMetaData);
 
     ~DocumentStorage();
 
+    // Storage objects and their buffers come from the DocumentArena in scope, if there is one.
+    static void* operator new(size_t bytes) {
+        return DocumentArena::allocate(bytes);
+    }
+    static void operator delete(void* ptr, size_t bytes) {
+        DocumentArena::deallocate(ptr, bytes);
+    }
+
     enum MetaType : char {
         TEXT_SCORE,
         RAND_VAL,
@@ -217,9 +243,42 @@ public:
         return Position(_usedBytes);
     }
 
+    /**
+     * Returns true if this storage was created from BSON and has not been modified since, in which
+     * case getBson() returns that BSON, excluding any metadata.
+     */
+    bool isBackedByBson() const {
+        return _backedByBson;
+    }
+    boost::optional<BSONObj> getBson() const {
+        if (!_backedByBson || _bsonHasMetaFields)
+            return boost::none;
+        return _bson;
+    }
+
+    /**
+     * Decodes any remaining fields from the backing BSON and releases it. This must be called
+     * before modifying storage which is backed by BSON.
+     */
+    void releaseBson() {
+        fillCache();
+        _bson = BSONObj();
+        _backedByBson = false;
+    }
+
     /// Returns the position of the named field (may be missing) or Position()
     Position findField(StringData name) const;
 
+    /// Like findField(name), but with 'nameHash' already computed by hashKey(name).
+    Position findField(StringData name, unsigned nameHash) const;
+
+    static unsigned hashKey(StringData name) {
+        // TODO consider FNV-1a once we have a better benchmark corpus
+        unsigned out;
+        MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
+        return out;
+    }
+
     // Document uses these
     const ValueElement& getField(Position pos) const {
         verify(pos.found());
@@ -231,6 +290,12 @@ public:
             return Value();
         return getField(pos).val;
     }
+    Value getField(StringData name, unsigned nameHash) const {
+        Position pos = findField(name, nameHash);
+        if (!pos.found())
+            return Value();
+        return getField(pos).val;
+    }
 
     // MutableDocument uses these
     ValueElement& getField(Position pos) {
@@ -254,11 +319,18 @@ public:
 
     /// This skips missing values
     DocumentStorageIterator iterator() const {
+        fillCache();
         return DocumentStorageIterator(_firstElement, end(), false);
     }
 
     /// This includes missing values
     DocumentStorageIterator iteratorAll() const {
+        fillCache();
+        return DocumentStorageIterator(_firstElement, end(), true);
+    }
+
+    /// Like iteratorAll(), but only includes fields which have already been decoded from BSON.
+    DocumentStorageIterator iteratorCacheOnly() const {
         return DocumentStorageIterator(_firstElement, end(), true);
     }
 
@@ -266,7 +338,8 @@ public:
     boost::intrusive_ptr<DocumentStorage> clone() const;
 
     size_t allocatedBytes() const {
-        return !_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes());
+        const size_t bsonBytes = _backedByBson ? _bson.objsize() : 0;
+        return bsonBytes + (!_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes()));
     }
 
     /**
@@ -305,6 +378,18 @@ public:
     }
 
 private:
+    /// Decodes every field which has not yet been read from the backing BSON.
+    void fillCache() const {
+        while (_bsonOffset)
+            const_cast<DocumentStorage*>(this)->loadNextBsonElement();
+    }
+
+    /**
+     * Decodes the element at '_bsonOffset' into the buffer and advances past it. Returns the
+     * position of the new field, or Position() if the element was metadata or the end of the BSON.
+     */
+    Position loadNextBsonElement();
+
     /// Same as lastElement->next() or firstElement() if empty.
     const ValueElement* end() const {
         return _firstElement ? _firstElement->plusBytes(_usedBytes) : nullptr;
@@ -313,6 +398,11 @@ private:
     /// Allocates space in _buffer. Copies existing data if there is any.
     void alloc(unsigned newSize);
 
+    /// Size of the block holding _buffer and the hash table.
+    size_t bufferBytes() const {
+        return !_buffer ? 0 : (_bufferEnd - _buffer) + hashTabBytes();
+    }
+
     /// Call after adding field to _buffer and increasing _numFields
     void addFieldToHashTable(Position pos);
 
@@ -334,13 +424,6 @@ private:
         memset(_hashTab, -1, hashTabBytes());
     }
 
-    static unsigned hashKey(StringData name) {
-        // TODO consider FNV-1a once we have a better benchmark corpus
-        unsigned out;
-        MurmurHash3_x86_32(name.rawData(), name.size(), 0, &out);
-        return out;
-    }
-
     unsigned bucketForKey(StringData name) const {
         return hashKey(name) & _hashTabMask;
     }
@@ -348,7 +431,7 @@ private:
     /// Adds all fields to the hash table
     void rehash() {
         hashTabInit();
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance())
+        for (DocumentStorageIterator it = iteratorCacheOnly(); !it.atEnd(); it.advance())
             addFieldToHashTable(it.position());
     }
 
@@ -385,6 +468,13 @@ private:
     std::bitset<MetaType::NUM_FIELDS> _metaFields;
     double _textScore;
     double _randVal;
+
+    // Only set while '_backedByBson' is true. '_bsonOffset' is the offset in '_bson' of the next
+    // element to decode, or 0 once every element has been decoded.
+    BSONObj _bson;
+    unsigned _bsonOffset;
+    bool _backedByBson;
+    bool _bsonHasMetaFields;
     // When adding a field, make sure to update clone() method
 
     // Defined in document.cpp
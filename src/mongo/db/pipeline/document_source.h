@@ -56,7 +56,9 @@
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/pipeline/value_comparator.h"
 #include "mongo/db/query/plan_summary_stats.h"
+#include "mongo/db/sorter/sortable_key_string.h"
 #include "mongo/db/sorter/sorter.h"
+#include "mongo/platform/random.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/intrusive_counter.h"
 
@@ -220,6 +222,16 @@ public:
         return false;
     }
 
+    /**
+     * Returns true if this stage produces the output for each input document as soon as that
+     * document has been read, and keeps no state that depends on having reached the end of its
+     * input. Such a stage may be asked for more results after it has returned boost::none, once
+     * its source has more input available, and will carry on as if it had never seen EOF.
+     */
+    virtual bool canResumeAfterEOF() const {
+        return false;
+    }
+
     /**
      * Returns true if the DocumentSource needs to be run on the primary shard.
      */
@@ -335,6 +347,31 @@ protected:
     virtual ~SplittableDocumentSource() {}
 };
 
+/**
+ * This class marks blocking DocumentSources which can also be fed their input one document at a
+ * time, rather than pulling it from their source. This allows a caller which already has each
+ * input document in hand, such as $facet, to drive several blocking stages from a single pass over
+ * the input without buffering it.
+ */
+class PushableDocumentSource {
+public:
+    /**
+     * Adds 'doc' to the input of this stage. It is illegal to call this after loadingDone(), or
+     * after getNext() has started pulling from the source.
+     */
+    virtual void loadDocument(const Document& doc) = 0;
+
+    /**
+     * Signals that there is no more input. Subsequent calls to getNext() will return the results
+     * computed from the documents passed to loadDocument(), without reading from the source.
+     */
+    virtual void loadingDone() = 0;
+
+protected:
+    // It is invalid to delete through a PushableDocumentSource-typed pointer.
+    virtual ~PushableDocumentSource() {}
+};
+
 
 /** This class marks DocumentSources which need mongod-specific functionality.
  *  It causes a MongodInterface to be injected when in a mongod and prevents mongos from
@@ -370,6 +407,12 @@ public:
          */
         virtual BSONObj insert(const NamespaceString& ns, const std::vector<BSONObj>& objs) = 0;
 
+        /**
+         * Applies 'updates', each in the format of an element of the "updates" array of an update
+         * command, to 'ns' in order, stopping at the first error.
+         */
+        virtual Status update(const NamespaceString& ns, const std::vector<BSONObj>& updates) = 0;
+
         virtual CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
                                                       const NamespaceString& ns) = 0;
 
@@ -585,7 +628,9 @@ private:
 };
 
 
-class DocumentSourceGroup final : public DocumentSource, public SplittableDocumentSource {
+class DocumentSourceGroup final : public DocumentSource,
+                                  public SplittableDocumentSource,
+                                  public PushableDocumentSource {
 public:
     using Accumulators = std::vector<boost::intrusive_ptr<Accumulator>>;
     using GroupsMap = ValueUnorderedMap<Accumulators>;
@@ -637,6 +682,13 @@ public:
     boost::intrusive_ptr<DocumentSource> getShardSource() final;
     boost::intrusive_ptr<DocumentSource> getMergeSource() final;
 
+    /**
+     * Virtuals for PushableDocumentSource. A $group which is fed its input this way never uses the
+     * streaming strategy, since it cannot inspect the sort order of its input.
+     */
+    void loadDocument(const Document& input) final;
+    void loadingDone() final;
+
 protected:
     void doInjectExpressionContext() final;
 
@@ -728,6 +780,11 @@ private:
     std::unique_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
     const bool _extSortAllowed;
 
+    // The files written by spill() while loading input, and an estimate of the memory used by the
+    // groups which have not yet been spilled.
+    std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> _sortedFiles;
+    int _memoryUsageBytes = 0;
+
     std::pair<Value, Value> _firstPartOfNextGroup;
     // Only used when '_sorted' is true.
     boost::optional<Document> _firstDocOfNextGroup;
@@ -764,6 +821,9 @@ public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
     const char* getSourceName() const final;
+    bool canResumeAfterEOF() const final {
+        return true;
+    }
     Value serialize(bool explain = false) const final;
     boost::intrusive_ptr<DocumentSource> optimize() final;
     BSONObjSet getOutputSorts() final {
@@ -1039,6 +1099,9 @@ public:
     // virtuals from DocumentSource
     const char* getSourceName() const;
     boost::optional<Document> getNext();
+    bool canResumeAfterEOF() const {
+        return true;
+    }
     boost::intrusive_ptr<DocumentSource> optimize();
     void dispose();
     Value serialize(bool explain) const;
@@ -1113,10 +1176,106 @@ private:
     const NamespaceString _outputNs;  // output will go here after all data is processed.
 };
 
+/**
+ * The $merge stage writes its input into an existing collection, matching each document against
+ * the target collection by its 'on' fields. For example:
+ *
+ * {$merge: {into: "rollup", on: "_id", whenMatched: "merge", whenNotMatched: "insert"}}
+ *
+ * Unlike $out, which builds a new collection and renames it over the target, $merge modifies the
+ * target in place with batched writes. This makes it possible to refresh part of a large
+ * collection, for example from a time-bounded $match, without rewriting the rest of it. The
+ * 'on' fields must be "_id" or the fields of a unique index on the target collection.
+ */
+class DocumentSourceMerge final : public DocumentSourceNeedsMongod,
+                                  public SplittableDocumentSource {
+public:
+    // What to do with a document whose 'on' fields match a document in the target collection.
+    // Unless the 'on' fields include "_id", matched documents keep their own _id, and documents
+    // inserted for kReplace get a new one.
+    enum class WhenMatched {
+        kReplace,       // Replace the existing document.
+        kMerge,         // Set the fields of the new document in the existing document.
+        kKeepExisting,  // Leave the existing document unchanged.
+        kFail,          // Fail with a duplicate key error.
+    };
+
+    // What to do with a document which does not match any document in the target collection.
+    enum class WhenNotMatched {
+        kInsert,   // Insert the document.
+        kDiscard,  // Ignore the document.
+    };
+
+    // The maximum number of write operations sent in one batch.
+    static const size_t kMaxBatchSize = 1000;
+
+    // virtuals from DocumentSource
+    boost::optional<Document> getNext() final;
+    const char* getSourceName() const final;
+    Value serialize(bool explain = false) const final;
+    GetDepsReturn getDependencies(DepsTracker* deps) const final;
+    bool needsPrimaryShard() const final {
+        return true;
+    }
+
+    // Virtuals for SplittableDocumentSource
+    boost::intrusive_ptr<DocumentSource> getShardSource() final {
+        return NULL;
+    }
+    boost::intrusive_ptr<DocumentSource> getMergeSource() final {
+        return this;
+    }
+
+    const NamespaceString& getOutputNs() const {
+        return _outputNs;
+    }
+
+    static boost::intrusive_ptr<DocumentSource> createFromBson(
+        BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+private:
+    DocumentSourceMerge(const NamespaceString& outputNs,
+                        std::vector<FieldPath> onFields,
+                        WhenMatched whenMatched,
+                        WhenNotMatched whenNotMatched,
+                        const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    /**
+     * Checks that the target collection can be merged into: it must not be sharded, and if the
+     * 'on' fields are not just "_id", it must have a unique index on exactly those fields.
+     */
+    void validateTargetCollection();
+
+    /**
+     * Returns the statement that writes 'doc' into the target collection. This is an element of
+     * the "documents" array of an insert command if '_whenMatched' is kFail, and an element of
+     * the "updates" array of an update command otherwise.
+     */
+    BSONObj makeWriteStatement(const Document& doc) const;
+
+    /**
+     * Writes all of 'statements' to the target collection.
+     */
+    void flush(const std::vector<BSONObj>& statements);
+
+    bool _done = false;
+
+    const NamespaceString _outputNs;
+    const std::vector<FieldPath> _onFields;
+    const WhenMatched _whenMatched;
+    const WhenNotMatched _whenNotMatched;
+
+    // Unless the 'on' fields include _id, matched documents keep their own _id.
+    const bool _onFieldsIncludeId;
+};
+
 class DocumentSourceRedact final : public DocumentSource {
 public:
     boost::optional<Document> getNext() final;
     const char* getSourceName() const final;
+    bool canResumeAfterEOF() const final {
+        return true;
+    }
     boost::intrusive_ptr<DocumentSource> optimize() final;
 
     /**
@@ -1252,6 +1411,9 @@ public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
     const char* getSourceName() const final;
+    bool canResumeAfterEOF() const final {
+        return true;
+    }
     BSONObjSet getOutputSorts() final {
         return pSource ? pSource->getOutputSorts()
                        : SimpleBSONObjComparator::kInstance.makeBSONObjSet();
@@ -1314,7 +1476,9 @@ private:
     long long count;
 };
 
-class DocumentSourceSort final : public DocumentSource, public SplittableDocumentSource {
+class DocumentSourceSort final : public DocumentSource,
+                                 public SplittableDocumentSource,
+                                 public PushableDocumentSource {
 public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
@@ -1382,13 +1546,13 @@ public:
      * coming from another DocumentSource. Once all documents have been added, the caller must call
      * loadingDone() before using getNext() to receive the documents in sorted order.
      */
-    void loadDocument(const Document& doc);
+    void loadDocument(const Document& doc) final;
 
     /**
      * Signals to the sort stage that there will be no more input documents. It is an error to call
      * loadDocument() once this method returns.
      */
-    void loadingDone();
+    void loadingDone() final;
 
     /**
      * Instructs the sort stage to use the given set of cursors as inputs, to merge documents that
@@ -1427,6 +1591,9 @@ private:
     // This is used to merge pre-sorted results from a DocumentSourceMergeCursors.
     class IteratorFromCursor;
 
+    // This is used to read the output of '_keyStringSorter' as if it came from a MySorter.
+    class IteratorFromKeyStringSorter;
+
     /* these two parallel each other */
     typedef std::vector<boost::intrusive_ptr<Expression>> SortKey;
     SortKey vSortKey;
@@ -1438,7 +1605,23 @@ private:
     /// Compare two Values according to the specified sort key.
     int compare(const Value& lhs, const Value& rhs) const;
 
+    /**
+     * Encodes a key returned by extractKey() as a KeyString that orders the same way as compare(),
+     * or returns boost::none if the key is too large to encode.
+     */
+    boost::optional<SortableKeyString> encodeKey(const Value& key) const;
+
+    /// Builds the Orderings used by encodeKey() from vAscending.
+    void makeKeyOrderings();
+
+    /**
+     * Finishes '_keyStringSorter' into '_keyStringSorted' and creates '_sorter' with whatever
+     * memory budget the finished documents leave, so the two never use more than one budget.
+     */
+    void switchToValueSorter();
+
     typedef Sorter<Value, Document> MySorter;
+    typedef Sorter<SortableKeyString, Document> KeyStringSorter;
 
     /**
      * Absorbs 'limit', enabling a top-k sort. It is safe to call this multiple times, it will keep
@@ -1462,12 +1645,30 @@ private:
         const DocumentSourceSort& _source;
     };
 
+    // For KeyStringSorter
+    class KeyStringComparator {
+    public:
+        int operator()(const KeyStringSorter::Data& lhs, const KeyStringSorter::Data& rhs) const {
+            return lhs.first.compare(rhs.first);
+        }
+    };
+
     boost::intrusive_ptr<DocumentSourceLimit> limitSrc;
 
     bool _done;
     bool _mergingPresorted;
+
+    // Documents are sorted by the KeyString encoding of their sort key until one is too large to
+    // encode. From then on they all go to '_sorter', and '_keyStringSorted' holds the output of
+    // '_keyStringSorter' for the final merge.
+    std::unique_ptr<KeyStringSorter> _keyStringSorter;
+    std::unique_ptr<KeyStringSorter::Iterator> _keyStringSorted;
     std::unique_ptr<MySorter> _sorter;
     std::unique_ptr<MySorter::Iterator> _output;
+
+    // One Ordering per KeyString in an encoded key. An Ordering describes at most 32 fields, so
+    // longer sort patterns are encoded as a concatenation of KeyStrings.
+    std::vector<Ordering> _keyOrderings;
 };
 
 class DocumentSourceSkip final : public DocumentSource, public SplittableDocumentSource {
@@ -1475,6 +1676,9 @@ public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
     const char* getSourceName() const final;
+    bool canResumeAfterEOF() const final {
+        return true;
+    }
     /**
      * Attempts to move a subsequent $limit before the skip, potentially allowing for forther
      * optimizations earlier in the pipeline.
@@ -1535,7 +1739,7 @@ private:
     explicit DocumentSourceSkip(const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
 
     long long _skip;
-    bool _needToSkip;
+    long long _nSkipped = 0;
 };
 
 
@@ -1544,6 +1748,9 @@ public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
     const char* getSourceName() const final;
+    bool canResumeAfterEOF() const final {
+        return true;
+    }
     Value serialize(bool explain = false) const final;
     BSONObjSet getOutputSorts() final;
 
@@ -2017,7 +2224,9 @@ private:
  * The $bucketAuto stage takes a user-specified number of buckets and automatically determines
  * boundaries such that the values are approximately equally distributed between those buckets.
  */
-class DocumentSourceBucketAuto final : public DocumentSource, public SplittableDocumentSource {
+class DocumentSourceBucketAuto final : public DocumentSource,
+                                       public SplittableDocumentSource,
+                                       public PushableDocumentSource {
 public:
     Value serialize(bool explain = false) const final;
     GetDepsReturn getDependencies(DepsTracker* deps) const final;
@@ -2025,6 +2234,10 @@ public:
     void dispose() final;
     const char* getSourceName() const final;
 
+    // Virtuals for PushableDocumentSource.
+    void loadDocument(const Document& doc) final;
+    void loadingDone() final;
+
     /**
      * The $bucketAuto stage must be run on the merging shard.
      */
@@ -2037,6 +2250,11 @@ public:
 
     static const uint64_t kMaxMemoryUsageBytes = 100 * 1024 * 1024;
 
+    // In approximate mode, the number of 'groupBy' values sampled per requested bucket, and the
+    // largest sample kept regardless of the number of buckets.
+    static const long long kApproximateSamplesPerBucket = 100;
+    static const long long kMaxApproximateSampleSize = 100 * 1000;
+
     static boost::intrusive_ptr<DocumentSourceBucketAuto> create(
         const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
         int numBuckets = 0,
@@ -2045,6 +2263,15 @@ public:
     static boost::intrusive_ptr<DocumentSource> createFromBson(
         BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
 
+    /**
+     * Like createFromBson(), but limits the memory used to sort or buffer the input to
+     * 'maxMemoryUsageBytes'.
+     */
+    static boost::intrusive_ptr<DocumentSourceBucketAuto> createFromBsonWithMaxMemoryUsage(
+        BSONElement elem,
+        const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+        uint64_t maxMemoryUsageBytes);
+
 private:
     explicit DocumentSourceBucketAuto(const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
                                       int numBuckets,
@@ -2058,12 +2285,36 @@ private:
         std::vector<boost::intrusive_ptr<Accumulator>> _accums;
     };
 
+    /**
+     * Creates '_sorter', which orders the input documents by their 'groupBy' value.
+     */
+    void initializeSorter();
+
     /**
      * Consumes all of the documents from the source in the pipeline and sorts them by their
-     * 'groupBy' value.
+     * 'groupBy' value, or, in approximate mode, buffers them unsorted.
      */
     void populateSorter();
 
+    /**
+     * Approximate mode counterpart of loadDocument(). Adds the 'groupBy' value of 'doc' to the
+     * reservoir sample and buffers 'doc', spilling the buffer to disk once it outgrows the memory
+     * limit.
+     */
+    void bufferDocument(Value key, const Document& doc);
+
+    /**
+     * Appends the buffered documents to '_spillWriter', creating it if necessary.
+     */
+    void spillBufferedDocuments();
+
+    /**
+     * Approximate mode counterpart of populateBuckets(). Picks the bucket boundaries from the
+     * quantiles of the sampled 'groupBy' values, then makes one pass over the buffered documents
+     * to place each into its bucket by binary search, without sorting the input.
+     */
+    void populateApproximateBuckets();
+
     /**
      * Computes the 'groupBy' expression value for 'doc'.
      */
@@ -2086,6 +2337,11 @@ private:
      */
     void addDocumentToBucket(const std::pair<Value, Document>& entry, Bucket& bucket);
 
+    /**
+     * Updates the accumulators in 'bucket' with 'doc', without changing the bucket's boundaries.
+     */
+    void accumulate(const Document& doc, Bucket& bucket);
+
     /**
      * Adds 'newBucket' to _buckets and updates any boundaries if necessary.
      */
@@ -2121,5 +2377,181 @@ private:
     boost::intrusive_ptr<Expression> _groupByExpression;
     boost::intrusive_ptr<GranularityRounder> _granularityRounder;
     long long _nDocuments = 0;
+
+    // State for approximate mode, where bucket boundaries are estimated from a uniform sample of
+    // the 'groupBy' values instead of from the fully sorted input.
+    bool _approximate = false;
+    std::vector<Value> _keySample;
+    PseudoRandom _random{int64_t{0}};  // Fixed seed, so that the boundaries are repeatable.
+    boost::optional<Value> _minKey;
+    boost::optional<Value> _maxKey;
+    std::vector<std::pair<Value, Document>> _bufferedInput;
+    uint64_t _bufferedInputBytes = 0;
+    std::unique_ptr<SortedFileWriter<Value, Document>> _spillWriter;
+};
+
+/**
+ * The $setWindowFields stage evaluates accumulators over a window of neighboring documents within
+ * each partition of its input, and adds the results to each document. For example:
+ *
+ * {$setWindowFields: {
+ *     partitionBy: "$account",
+ *     sortBy: {time: 1},
+ *     output: {
+ *         runningTotal: {$sum: "$amount", window: {documents: ["unbounded", "current"]}},
+ *         movingAvg: {$avg: "$amount", window: {documents: [-4, 0]}},
+ *         hourlyMax: {$max: "$amount", window: {range: [-3600, 0]}}
+ *     }
+ * }}
+ *
+ * The user-facing stage is an alias which expands into a $sort on the partition and sort keys
+ * followed by this stage, which serializes itself as $_internalSetWindowFields and relies on its
+ * input already being grouped by partition and sorted within each partition.
+ *
+ * Windows are evaluated incrementally. Accumulators are advanced as the window slides forward, and
+ * values leaving the window are retracted, so only the documents inside the widest window are
+ * buffered rather than the whole partition. Windows without an upper bound still need to see the
+ * whole partition before producing the first result, and windows with a lower bound can only use
+ * accumulators which support removal ($sum, $avg, $min and $max).
+ */
+class DocumentSourceSetWindowFields final : public DocumentSource {
+public:
+    static const uint64_t kMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
+    // virtuals from DocumentSource
+    boost::optional<Document> getNext() final;
+    const char* getSourceName() const final;
+    Value serialize(bool explain = false) const final;
+    GetDepsReturn getDependencies(DepsTracker* deps) const final;
+    boost::intrusive_ptr<DocumentSource> optimize() final;
+    void dispose() final;
+    BSONObjSet getOutputSorts() final;
+
+    /**
+     * Parses the user-facing $setWindowFields stage into a $sort on the partition and sort keys,
+     * followed by a DocumentSourceSetWindowFields.
+     */
+    static std::vector<boost::intrusive_ptr<DocumentSource>> createFromBson(
+        BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    /**
+     * Parses $_internalSetWindowFields, which assumes that its input is already sorted.
+     */
+    static boost::intrusive_ptr<DocumentSourceSetWindowFields> createFromBsonInternal(
+        BSONElement elem,
+        const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+        uint64_t maxMemoryUsageBytes = kMaxMemoryUsageBytes);
+
+protected:
+    void doInjectExpressionContext() final;
+
+private:
+    // A window function to compute for every document, and the state of its current window.
+    struct OutputField {
+        explicit OutputField(const std::string& fieldName) : path(fieldName) {}
+
+        FieldPath path;
+        Accumulator::Factory factory;
+        boost::intrusive_ptr<Expression> expression;
+
+        // Whether the bounds are offsets in the partition, or offsets from the sort key value.
+        bool isRange = false;
+
+        // A missing bound is unbounded.
+        boost::optional<double> lower;
+        boost::optional<double> upper;
+
+        boost::intrusive_ptr<Accumulator> accumulator;
+
+        // Positions within the partition of the next document to add to and to remove from
+        // 'accumulator'. The documents in between are those currently in the window.
+        long long nextToAdd = 0;
+        long long nextToRemove = 0;
+    };
+
+    struct BufferedDocument {
+        Document doc;
+
+        // The value of the sort key, only populated if there are range-based windows.
+        double sortKey = 0;
+
+        // The evaluated argument of each accumulator, in the same order as '_outputFields'.
+        std::vector<Value> inputs;
+
+        size_t memUsageBytes = 0;
+    };
+
+    DocumentSourceSetWindowFields(const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+                                  uint64_t maxMemoryUsageBytes);
+
+    void parseOutputField(const BSONElement& elem, const VariablesParseState& vps);
+
+    /**
+     * Reads the next input document into the buffer, unless it belongs to the next partition, in
+     * which case it is set aside and the current partition is marked as fully loaded.
+     */
+    void loadNextDocument();
+
+    void appendToBuffer(Document doc);
+
+    Value computePartitionKey(const Document& doc);
+
+    /**
+     * Discards the buffer and window state of the current partition and moves the first document
+     * of the next partition into the buffer.
+     */
+    void startNextPartition();
+
+    /**
+     * Returns true if enough of the partition has been read to compute every window of the
+     * document at 'index'.
+     */
+    bool windowsAreComplete(long long index) const;
+
+    /**
+     * Slides every window forward to the next document to output, and returns that document with
+     * the window results added.
+     */
+    Document outputNextDocument();
+
+    /**
+     * Drops documents from the front of the buffer which are no longer needed by any window.
+     */
+    void releaseBuffer();
+
+    const BufferedDocument& bufferedDocument(long long index) const {
+        return _buffer[index - _bufferStart];
+    }
+
+    double position(const OutputField& field, long long index) const {
+        return field.isRange ? bufferedDocument(index).sortKey : static_cast<double>(index);
+    }
+
+    boost::intrusive_ptr<Expression> _partitionBy;
+    BSONObj _sortBy;
+    std::vector<OutputField> _outputFields;
+
+    // The single sort key of range-based windows, if there are any. Positions are multiplied by
+    // the sort direction, so that they always increase through the partition.
+    boost::optional<FieldPath> _rangeSortPath;
+    int _rangeSortDirection = 1;
+
+    std::unique_ptr<Variables> _variables;
+    const uint64_t _maxMemoryUsageBytes;
+
+    // Documents of the current partition which are either waiting to be output, or are still
+    // inside some window. '_bufferStart' is the position in the partition of the front document.
+    std::deque<BufferedDocument> _buffer;
+    long long _bufferStart = 0;
+    uint64_t _memUsageBytes = 0;
+
+    // The number of documents of the current partition which have been read so far.
+    long long _partitionSize = 0;
+    // The position in the partition of the next document to return.
+    long long _nextToOutput = 0;
+    // Whether every document in the current partition has been read.
+    bool _partitionLoaded = false;
+    Value _partitionKey;
+    boost::optional<Document> _firstDocOfNextPartition;
 };
 }  // namespace mongo
@@ -30,6 +30,11 @@
 
 #include "mongo/db/pipeline/document_source.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/stdx/memory.h"
+
 namespace mongo {
 
 using boost::intrusive_ptr;
@@ -39,6 +44,9 @@ using std::vector;
 
 REGISTER_DOCUMENT_SOURCE(bucketAuto, DocumentSourceBucketAuto::createFromBson);
 
+const long long DocumentSourceBucketAuto::kApproximateSamplesPerBucket;
+const long long DocumentSourceBucketAuto::kMaxApproximateSampleSize;
+
 const char* DocumentSourceBucketAuto::getSourceName() const {
     return "$bucketAuto";
 }
@@ -48,10 +56,7 @@ boost::optional<Document> DocumentSourceBucketAuto::getNext() {
 
     if (!_populated) {
         populateSorter();
-        populateBuckets();
-
-        _populated = true;
-        _bucketsIterator = _buckets.begin();
+        loadingDone();
     }
 
     if (_bucketsIterator == _buckets.end()) {
@@ -77,25 +82,53 @@ DocumentSource::GetDepsReturn DocumentSourceBucketAuto::getDependencies(DepsTrac
     return EXHAUSTIVE_ALL;
 }
 
-void DocumentSourceBucketAuto::populateSorter() {
-    if (!_sorter) {
-        SortOptions opts;
-        opts.maxMemoryUsageBytes = _maxMemoryUsageBytes;
-        const auto& valueCmp = pExpCtx->getValueComparator();
-        auto comparator = [valueCmp](const Sorter<Value, Document>::Data& lhs,
-                                     const Sorter<Value, Document>::Data& rhs) {
-            return valueCmp.compare(lhs.first, rhs.first);
-        };
+void DocumentSourceBucketAuto::initializeSorter() {
+    SortOptions opts;
+    opts.maxMemoryUsageBytes = _maxMemoryUsageBytes;
+    const auto& valueCmp = pExpCtx->getValueComparator();
+    auto comparator = [valueCmp](const Sorter<Value, Document>::Data& lhs,
+                                 const Sorter<Value, Document>::Data& rhs) {
+        return valueCmp.compare(lhs.first, rhs.first);
+    };
 
-        _sorter.reset(Sorter<Value, Document>::make(opts, comparator));
-    }
+    _sorter.reset(Sorter<Value, Document>::make(opts, comparator));
+}
 
-    _nDocuments = 0;
+void DocumentSourceBucketAuto::populateSorter() {
     while (boost::optional<Document> next = pSource->getNext()) {
-        Document doc = *next;
-        _sorter->add(extractKey(doc), doc);
+        loadDocument(*next);
+    }
+}
+
+void DocumentSourceBucketAuto::loadDocument(const Document& doc) {
+    invariant(!_populated);
+    if (_approximate) {
+        bufferDocument(extractKey(doc), doc);
         _nDocuments++;
+        return;
+    }
+
+    if (!_sorter) {
+        initializeSorter();
     }
+
+    _sorter->add(extractKey(doc), doc);
+    _nDocuments++;
+}
+
+void DocumentSourceBucketAuto::loadingDone() {
+    if (_approximate) {
+        populateApproximateBuckets();
+    } else {
+        if (!_sorter) {
+            initializeSorter();
+        }
+
+        populateBuckets();
+    }
+
+    _populated = true;
+    _bucketsIterator = _buckets.begin();
 }
 
 Value DocumentSourceBucketAuto::extractKey(const Document& doc) {
@@ -134,14 +167,160 @@ void DocumentSourceBucketAuto::addDocumentToBucket(const pair<Value, Document>&
                                                    Bucket& bucket) {
     invariant(pExpCtx->getValueComparator().evaluate(entry.first >= bucket._max));
     bucket._max = entry.first;
+    accumulate(entry.second, bucket);
+}
 
+void DocumentSourceBucketAuto::accumulate(const Document& doc, Bucket& bucket) {
     const size_t numAccumulators = _accumulatorFactories.size();
-    _variables->setRoot(entry.second);
+    _variables->setRoot(doc);
     for (size_t k = 0; k < numAccumulators; k++) {
         bucket._accums[k]->process(_expressions[k]->evaluate(_variables.get()), false);
     }
 }
 
+void DocumentSourceBucketAuto::bufferDocument(Value key, const Document& doc) {
+    const auto& valueCmp = pExpCtx->getValueComparator();
+    if (!_minKey || valueCmp.evaluate(key < *_minKey)) {
+        _minKey = key;
+    }
+    if (!_maxKey || valueCmp.evaluate(key > *_maxKey)) {
+        _maxKey = key;
+    }
+
+    // Reservoir sampling keeps every value seen so far in the sample with equal probability.
+    const long long sampleSize =
+        std::min(kApproximateSamplesPerBucket * _nBuckets, kMaxApproximateSampleSize);
+    if (static_cast<long long>(_keySample.size()) < sampleSize) {
+        _keySample.push_back(key);
+    } else {
+        const long long slot = _random.nextInt64(_nDocuments + 1);
+        if (slot < sampleSize) {
+            _keySample[slot] = key;
+        }
+    }
+
+    _bufferedInputBytes += key.getApproximateSize() + doc.getApproximateSize();
+    _bufferedInput.emplace_back(std::move(key), doc);
+    if (_bufferedInputBytes > _maxMemoryUsageBytes) {
+        uassert(40355,
+                str::stream() << "$bucketAuto exceeded memory limit of " << _maxMemoryUsageBytes
+                              << " bytes, but did not opt in to external sorting. Pass "
+                                 "allowDiskUse:true to opt in.",
+                pExpCtx->extSortAllowed && !pExpCtx->inRouter);
+        spillBufferedDocuments();
+    }
+}
+
+void DocumentSourceBucketAuto::spillBufferedDocuments() {
+    if (!_spillWriter) {
+        _spillWriter = stdx::make_unique<SortedFileWriter<Value, Document>>(
+            SortOptions().TempDir(pExpCtx->tempDir));
+    }
+
+    // The file is only ever read back sequentially, so the documents are written as they came.
+    for (auto&& entry : _bufferedInput) {
+        _spillWriter->addAlreadySorted(entry.first, entry.second);
+    }
+    _bufferedInput.clear();
+    _bufferedInputBytes = 0;
+}
+
+void DocumentSourceBucketAuto::populateApproximateBuckets() {
+    if (_nBuckets == 0 || _nDocuments == 0) {
+        return;
+    }
+
+    const auto& valueCmp = pExpCtx->getValueComparator();
+    std::sort(_keySample.begin(), _keySample.end(), valueCmp.getLessThan());
+
+    // The inclusive lower boundary of each bucket after the first. The sample is walked the way
+    // populateBuckets() walks the sorted input, with each bucket's size scaled down to the
+    // sample, so a sample holding every value gives the exact algorithm's boundaries.
+    long long approxBucketSize = std::round(double(_nDocuments) / double(_nBuckets));
+    if (approxBucketSize < 1) {
+        approxBucketSize = 1;
+    }
+    const size_t sampleSize = _keySample.size();
+    const size_t bucketSizeInSample = std::max(
+        1LL, std::llround(double(approxBucketSize) * double(sampleSize) / double(_nDocuments)));
+
+    std::vector<Value> lowerBounds;
+    size_t next = 0;  // The index of the first sampled value in the current bucket.
+    for (int i = 0; i < _nBuckets - 1 && next < sampleSize; i++) {
+        // The largest sampled value the bucket holds before absorbing any equal or rounded values.
+        const size_t last = std::min(next + bucketSizeInSample, sampleSize) - 1;
+        next = last + 1;
+
+        if (_granularityRounder) {
+            Value boundary = _granularityRounder->roundUp(_keySample[last]);
+            while (next < sampleSize && valueCmp.evaluate(boundary > _keySample[next])) {
+                next++;
+            }
+            if (next < sampleSize) {
+                lowerBounds.push_back(std::move(boundary));
+            }
+        } else {
+            while (next < sampleSize && valueCmp.evaluate(_keySample[last] == _keySample[next])) {
+                next++;
+            }
+            if (next < sampleSize) {
+                lowerBounds.push_back(_keySample[next]);
+            }
+        }
+    }
+    _keySample.clear();
+
+    std::vector<Bucket> buckets;
+    std::vector<bool> bucketIsEmpty(lowerBounds.size() + 1, true);
+    for (size_t i = 0; i <= lowerBounds.size(); i++) {
+        Value min = i == 0 ? *_minKey : lowerBounds[i - 1];
+        buckets.emplace_back(min, min, _accumulatorFactories);
+    }
+
+    auto addToBucket = [&](const pair<Value, Document>& entry) {
+        const size_t index =
+            std::upper_bound(
+                lowerBounds.begin(), lowerBounds.end(), entry.first, valueCmp.getLessThan()) -
+            lowerBounds.begin();
+        accumulate(entry.second, buckets[index]);
+        bucketIsEmpty[index] = false;
+    };
+
+    if (_spillWriter) {
+        spillBufferedDocuments();
+        std::unique_ptr<SortedFileWriter<Value, Document>::Iterator> spilled(_spillWriter->done());
+        _spillWriter.reset();
+        while (spilled->more()) {
+            addToBucket(spilled->next());
+        }
+    }
+    for (auto&& entry : _bufferedInput) {
+        addToBucket(entry);
+    }
+    _bufferedInput.clear();
+    _bufferedInputBytes = 0;
+
+    // Each bucket's maximum is the next non-empty bucket's minimum, except for the last bucket,
+    // whose maximum is the largest value seen.
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (bucketIsEmpty[i]) {
+            continue;
+        }
+        if (!_buckets.empty()) {
+            _buckets.back()._max = buckets[i]._min;
+        }
+        _buckets.push_back(std::move(buckets[i]));
+    }
+    _buckets.back()._max = *_maxKey;
+
+    if (_granularityRounder) {
+        Bucket& firstBucket = _buckets.front();
+        Bucket& lastBucket = _buckets.back();
+        firstBucket._min = _granularityRounder->roundDown(firstBucket._min);
+        lastBucket._max = _granularityRounder->roundUp(lastBucket._max);
+    }
+}
+
 void DocumentSourceBucketAuto::populateBuckets() {
     invariant(_sorter);
     _sortedInput.reset(_sorter->done());
@@ -312,6 +491,8 @@ Document DocumentSourceBucketAuto::makeDocument(const Bucket& bucket) {
 
 void DocumentSourceBucketAuto::dispose() {
     _sortedInput.reset();
+    _spillWriter.reset();
+    _bufferedInput.clear();
     _bucketsIterator = _buckets.end();
     pSource->dispose();
 }
@@ -326,6 +507,10 @@ Value DocumentSourceBucketAuto::serialize(bool explain) const {
         insides["granularity"] = Value(_granularityRounder->getName());
     }
 
+    if (_approximate) {
+        insides["approximate"] = Value(true);
+    }
+
     const size_t nOutputFields = _fieldNames.size();
     MutableDocument outputSpec(nOutputFields);
     for (size_t i = 0; i < nOutputFields; i++) {
@@ -380,12 +565,20 @@ void DocumentSourceBucketAuto::setGranularity(string granularity) {
 
 intrusive_ptr<DocumentSource> DocumentSourceBucketAuto::createFromBson(
     BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    return createFromBsonWithMaxMemoryUsage(elem, pExpCtx, kMaxMemoryUsageBytes);
+}
+
+intrusive_ptr<DocumentSourceBucketAuto> DocumentSourceBucketAuto::createFromBsonWithMaxMemoryUsage(
+    BSONElement elem,
+    const intrusive_ptr<ExpressionContext>& pExpCtx,
+    uint64_t maxMemoryUsageBytes) {
     uassert(40240,
             str::stream() << "The argument to $bucketAuto must be an object, but found type: "
                           << typeName(elem.type()),
             elem.type() == BSONType::Object);
 
-    intrusive_ptr<DocumentSourceBucketAuto> bucketAuto(DocumentSourceBucketAuto::create(pExpCtx));
+    intrusive_ptr<DocumentSourceBucketAuto> bucketAuto(
+        DocumentSourceBucketAuto::create(pExpCtx, 0, maxMemoryUsageBytes));
 
     const BSONObj bucketAutoObj = elem.embeddedObject();
     VariablesIdGenerator idGenerator;
@@ -444,6 +637,13 @@ intrusive_ptr<DocumentSource> DocumentSourceBucketAuto::createFromBson(
                         << typeName(argument.type()),
                     argument.type() == BSONType::String);
             bucketAuto->setGranularity(argument.str());
+        } else if ("approximate" == argName) {
+            uassert(40356,
+                    str::stream()
+                        << "The $bucketAuto 'approximate' field must be a boolean, but found type: "
+                        << typeName(argument.type()),
+                    argument.type() == BSONType::Bool);
+            bucketAuto->_approximate = argument.Bool();
         } else {
             uasserted(40245, str::stream() << "Unrecognized option to $bucketAuto: " << argName);
         }
@@ -104,7 +104,9 @@ void DocumentSourceCursor::loadBatch() {
             } else if (_dependencies) {
                 _currentBatch.push_back(_dependencies->extractFields(obj));
             } else {
-                _currentBatch.push_back(Document::fromBsonWithMetaData(obj));
+                // Most pipelines only read a few fields of each document, so only decode fields
+                // as they are accessed.
+                _currentBatch.push_back(Document::lazyFromBsonWithMetaData(obj));
             }
 
             if (_limit) {
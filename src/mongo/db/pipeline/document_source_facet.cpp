@@ -49,12 +49,80 @@ namespace mongo {
 using boost::intrusive_ptr;
 using std::vector;
 
+namespace {
+
+/**
+ * Describes how to push input documents into a sub-pipeline, rather than having it read them back
+ * out of the TeeBuffer. Each document is passed through the leading stages of the sub-pipeline
+ * which can resume after EOF, and their output is loaded into 'blockingStage', or is collected
+ * into 'results' if there is no blocking stage.
+ */
+struct PushedFacet {
+    /**
+     * Pushes 'input' into the sub-pipeline, returning the approximate size of any results this
+     * added to 'results'.
+     */
+    size_t push(const Document& input) {
+        size_t resultsSizeBytes = 0;
+        consumer->push(input);
+        while (auto next = lastResumableStage->getNext()) {
+            if (blockingStage) {
+                blockingStage->loadDocument(*next);
+            } else {
+                resultsSizeBytes += next->getApproximateSize();
+                results.emplace_back(std::move(*next));
+            }
+        }
+        return resultsSizeBytes;
+    }
+
+    DocumentSourceTeeConsumer* consumer = nullptr;
+    DocumentSource* lastResumableStage = nullptr;
+    PushableDocumentSource* blockingStage = nullptr;
+    vector<Value> results;
+};
+
+/**
+ * Returns a PushedFacet for 'pipeline' if every stage up to its first blocking stage can resume
+ * after EOF, and that blocking stage (if any) can be pushed its input. Otherwise, returns
+ * boost::none, and the pipeline must read its input from the TeeBuffer.
+ */
+boost::optional<PushedFacet> makePushedFacet(Pipeline* pipeline) {
+    const auto& sources = pipeline->getSources();
+    auto consumer = dynamic_cast<DocumentSourceTeeConsumer*>(sources.front().get());
+    if (!consumer) {
+        return boost::none;
+    }
+
+    PushedFacet pushedFacet;
+    pushedFacet.consumer = consumer;
+    pushedFacet.lastResumableStage = consumer;
+    for (auto it = std::next(sources.begin()); it != sources.end(); ++it) {
+        if ((*it)->canResumeAfterEOF()) {
+            pushedFacet.lastResumableStage = it->get();
+            continue;
+        }
+
+        pushedFacet.blockingStage = dynamic_cast<PushableDocumentSource*>(it->get());
+        if (!pushedFacet.blockingStage) {
+            return boost::none;
+        }
+        break;
+    }
+    return pushedFacet;
+}
+
+}  // namespace
+
 DocumentSourceFacet::DocumentSourceFacet(StringMap<intrusive_ptr<Pipeline>> facetPipelines,
-                                         const intrusive_ptr<ExpressionContext>& expCtx)
-    : DocumentSourceNeedsMongod(expCtx), _facetPipelines(std::move(facetPipelines)) {
+                                         const intrusive_ptr<ExpressionContext>& expCtx,
+                                         uint64_t maxMemoryUsageBytes)
+    : DocumentSourceNeedsMongod(expCtx),
+      _facetPipelines(std::move(facetPipelines)),
+      _maxMemoryUsageBytes(maxMemoryUsageBytes) {
 
     // Build the tee stage, and the consumers of the tee.
-    _teeBuffer = TeeBuffer::create();
+    _teeBuffer = TeeBuffer::create(_maxMemoryUsageBytes);
     for (auto&& facet : _facetPipelines) {
         auto pipeline = facet.second;
         pipeline->addInitialSource(DocumentSourceTeeConsumer::create(pExpCtx, _teeBuffer));
@@ -65,8 +133,9 @@ REGISTER_DOCUMENT_SOURCE(facet, DocumentSourceFacet::createFromBson);
 
 intrusive_ptr<DocumentSourceFacet> DocumentSourceFacet::create(
     StringMap<intrusive_ptr<Pipeline>> facetPipelines,
-    const intrusive_ptr<ExpressionContext>& expCtx) {
-    return new DocumentSourceFacet(std::move(facetPipelines), expCtx);
+    const intrusive_ptr<ExpressionContext>& expCtx,
+    uint64_t maxMemoryUsageBytes) {
+    return new DocumentSourceFacet(std::move(facetPipelines), expCtx, maxMemoryUsageBytes);
 }
 
 void DocumentSourceFacet::setSource(DocumentSource* source) {
@@ -81,12 +150,48 @@ boost::optional<Document> DocumentSourceFacet::getNext() {
     }
     _done = true;  // We will only ever produce one result.
 
-    // Build the results by executing each pipeline serially, one at a time.
+    // Push each input document into every pipeline which can process it incrementally as soon as
+    // it is read. The input only needs to be buffered if some pipeline cannot be driven this way.
+    StringMap<PushedFacet> pushedFacets;
+    bool retainInput = false;
+    for (auto&& facet : _facetPipelines) {
+        if (auto pushedFacet = makePushedFacet(facet.second.get())) {
+            pushedFacets[facet.first] = std::move(*pushedFacet);
+        } else {
+            retainInput = true;
+        }
+    }
+
+    size_t resultsMemoryUsageBytes = 0;
+    vector<TeeBuffer::PushConsumer> pushConsumers;
+    for (auto&& pushedFacet : pushedFacets) {
+        auto facetPtr = &pushedFacet.second;
+        pushConsumers.push_back([this, facetPtr, &resultsMemoryUsageBytes](const Document& input) {
+            resultsMemoryUsageBytes += facetPtr->push(input);
+            uassert(40335,
+                    "Exceeded memory limit for $facet",
+                    resultsMemoryUsageBytes <= _maxMemoryUsageBytes);
+        });
+    }
+    _teeBuffer->populate(pushConsumers, retainInput);
+
+    // Build the results by finishing each pipeline serially, one at a time.
     MutableDocument results;
     for (auto&& facet : _facetPipelines) {
         auto facetName = facet.first;
         auto facetPipeline = facet.second;
 
+        auto pushedFacet = pushedFacets.find(facetName);
+        if (pushedFacet != pushedFacets.end() && !pushedFacet->second.blockingStage) {
+            // Every stage of this pipeline has already produced all of its output.
+            results[facetName] = Value(std::move(pushedFacet->second.results));
+            continue;
+        }
+
+        if (pushedFacet != pushedFacets.end()) {
+            pushedFacet->second.blockingStage->loadingDone();
+        }
+
         std::vector<Value> facetResults;
         while (auto next = facetPipeline->getSources().back()->getNext()) {
             facetResults.emplace_back(std::move(*next));
@@ -204,10 +309,11 @@ intrusive_ptr<DocumentSource> DocumentSourceFacet::createFromBson(
                               << facetElem.toString(),
                 !pipeline->getSources().empty());
 
-        // Disallow $out stages, $facet stages, and any stages that need to be the first stage in
-        // the pipeline.
+        // Disallow $out and $merge stages, $facet stages, and any stages that need to be the first
+        // stage in the pipeline.
         for (auto&& stage : pipeline->getSources()) {
             if ((dynamic_cast<DocumentSourceOut*>(stage.get())) ||
+                (dynamic_cast<DocumentSourceMerge*>(stage.get())) ||
                 (dynamic_cast<DocumentSourceFacet*>(stage.get())) ||
                 (stage->isValidInitialSource())) {
                 uasserted(40173,
@@ -220,6 +326,6 @@ intrusive_ptr<DocumentSource> DocumentSourceFacet::createFromBson(
         facetPipelines[facetName] = pipeline;
     }
 
-    return new DocumentSourceFacet(std::move(facetPipelines), expCtx);
+    return new DocumentSourceFacet(std::move(facetPipelines), expCtx, kMaxMemoryUsageBytes);
 }
 }  // namespace mongo
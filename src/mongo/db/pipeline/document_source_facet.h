@@ -50,6 +50,11 @@ class Pipeline;
  * each of the sub-pipelines. The $facet stage is blocking, and outputs only one document,
  * containing an array of results for each sub-pipeline.
  *
+ * Sub-pipelines made up of stages which can resume after EOF, optionally followed by a stage which
+ * can be pushed its input (such as $group or $sort) and anything after it, have each input
+ * document pushed through them as it is read, so only their blocking stages hold any state. The
+ * input is only buffered in full if some sub-pipeline cannot be driven this way.
+ *
  * For example, {$facet: {facetA: [{$skip: 1}], facetB: [{$limit: 1}]}} would describe a $facet
  * stage which will produce a document like the following:
  * {facetA: [<all input documents except the first one>], facetB: [<the first document>]}.
@@ -60,12 +65,15 @@ class Pipeline;
 class DocumentSourceFacet final : public DocumentSourceNeedsMongod,
                                   public SplittableDocumentSource {
 public:
+    static const uint64_t kMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
     static boost::intrusive_ptr<DocumentSource> createFromBson(
         BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
 
     static boost::intrusive_ptr<DocumentSourceFacet> create(
         StringMap<boost::intrusive_ptr<Pipeline>> facetPipelines,
-        const boost::intrusive_ptr<ExpressionContext>& expCtx);
+        const boost::intrusive_ptr<ExpressionContext>& expCtx,
+        uint64_t maxMemoryUsageBytes = kMaxMemoryUsageBytes);
 
     /**
      * Blocking call. Will consume all input and produces one output document.
@@ -114,13 +122,18 @@ public:
 
 private:
     DocumentSourceFacet(StringMap<boost::intrusive_ptr<Pipeline>> facetPipelines,
-                        const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+                        const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
+                        uint64_t maxMemoryUsageBytes);
 
     Value serialize(bool explain = false) const final;
 
     boost::intrusive_ptr<TeeBuffer> _teeBuffer;
     StringMap<boost::intrusive_ptr<Pipeline>> _facetPipelines;
 
+    // Bounds both the buffered input and the results collected from sub-pipelines which have no
+    // blocking stage.
+    const uint64_t _maxMemoryUsageBytes;
+
     bool _done = false;
 };
 }  // namespace mongo
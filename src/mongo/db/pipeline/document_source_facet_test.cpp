@@ -133,6 +133,13 @@ TEST_F(DocumentSourceFacetTest, ShouldRejectFacetsContainingAnOutStage) {
     ASSERT_THROWS(DocumentSourceFacet::createFromBson(spec.firstElement(), ctx), UserException);
 }
 
+TEST_F(DocumentSourceFacetTest, ShouldRejectFacetsContainingAMergeStage) {
+    auto ctx = getExpCtx();
+    auto spec = BSON("$facet" << BSON("a" << BSON_ARRAY(BSON("$merge" << BSON("into"
+                                                                              << "out")))));
+    ASSERT_THROWS(DocumentSourceFacet::createFromBson(spec.firstElement(), ctx), UserException);
+}
+
 TEST_F(DocumentSourceFacetTest, ShouldRejectFacetsContainingAFacetStage) {
     auto ctx = getExpCtx();
     auto spec = fromjson("{$facet: {a: [{$facet: {a: [{$skip: 2}]}}]}}");
@@ -252,6 +259,101 @@ TEST_F(DocumentSourceFacetTest, ShouldBeAbleToEvaluateMultipleStagesWithinOneSub
     ASSERT_DOCUMENT_EQ(*output, Document(fromjson("{subPipe: [{_id: 0}, {_id: 1}]}")));
 }
 
+TEST_F(DocumentSourceFacetTest, ShouldPushInputThroughResumableAndBlockingStages) {
+    auto ctx = getExpCtx();
+
+    auto parseFacet = [&ctx](const char* json) {
+        std::vector<BSONObj> rawPipeline;
+        for (auto&& stage : fromjson(json)["pipeline"].Obj()) {
+            rawPipeline.push_back(stage.Obj());
+        }
+        return uassertStatusOK(Pipeline::parse(rawPipeline, ctx));
+    };
+
+    auto facetStage = DocumentSourceFacet::create(
+        {{"unwound", parseFacet("{pipeline: [{$unwind: '$arr'}, {$skip: 1}, {$limit: 2}]}")},
+         {"sorted", parseFacet("{pipeline: [{$sort: {x: -1}}, {$limit: 2}, {$project: {x: 1}}]}")},
+         {"counted",
+          parseFacet(
+              "{pipeline: [{$match: {x: {$gte: 1}}}, {$group: {_id: null, n: {$sum: 1}}}]}")},
+         {"buckets", parseFacet("{pipeline: [{$bucketAuto: {groupBy: '$x', buckets: 2}}]}")}},
+        ctx);
+    facetStage->optimize();
+
+    std::deque<Document> inputs = {Document(fromjson("{_id: 0, x: 0, arr: [1, 2]}")),
+                                   Document(fromjson("{_id: 1, x: 1, arr: [3]}")),
+                                   Document(fromjson("{_id: 2, x: 2, arr: []}")),
+                                   Document(fromjson("{_id: 3, x: 3, arr: [4, 5]}"))};
+    auto mock = DocumentSourceMock::create(inputs);
+    facetStage->setSource(mock.get());
+
+    auto output = facetStage->getNext();
+    ASSERT_TRUE(output);
+    ASSERT_EQ((*output).size(), 4UL);
+    ASSERT_VALUE_EQ((*output)["unwound"],
+                    Value(fromjson("{x: [{_id: 0, x: 0, arr: 2}, {_id: 1, x: 1, arr: 3}]}")["x"]));
+    ASSERT_VALUE_EQ((*output)["sorted"],
+                    Value(fromjson("{x: [{_id: 3, x: 3}, {_id: 2, x: 2}]}")["x"]));
+    ASSERT_VALUE_EQ((*output)["counted"], Value(fromjson("{x: [{_id: null, n: 3}]}")["x"]));
+    ASSERT_VALUE_EQ((*output)["buckets"],
+                    Value(fromjson("{x: [{_id: {min: 0, max: 2}, count: 2},"
+                                   "     {_id: {min: 2, max: 3}, count: 2}]}")["x"]));
+
+    ASSERT_FALSE(facetStage->getNext());
+}
+
+TEST_F(DocumentSourceFacetTest, ShouldNotBufferInputIfEveryPipelineCanBePushedItsInput) {
+    auto ctx = getExpCtx();
+
+    auto group = DocumentSourceGroup::createFromBson(
+        BSON("$group" << BSON("_id" << BSONNULL << "n" << BSON("$sum" << 1))).firstElement(), ctx);
+    auto groupPipeline = uassertStatusOK(Pipeline::create({group}, ctx));
+
+    auto project = DocumentSourceProject::createFromBson(
+        BSON("$project" << BSON("_id" << true)).firstElement(), ctx);
+    auto projectPipeline = uassertStatusOK(Pipeline::create({project}, ctx));
+
+    // Each input document is larger than the memory limit, but should never be buffered.
+    const uint64_t maxMemoryUsageBytes = 1000;
+    auto facetStage = DocumentSourceFacet::create(
+        {{"grouped", groupPipeline}, {"projected", projectPipeline}}, ctx, maxMemoryUsageBytes);
+
+    auto largeStr = std::string(1000, 'y');
+    std::deque<Document> inputs = {Document{{"_id", 0}, {"x", largeStr}},
+                                   Document{{"_id", 1}, {"x", largeStr}}};
+    auto mock = DocumentSourceMock::create(inputs);
+    facetStage->setSource(mock.get());
+
+    auto output = facetStage->getNext();
+    ASSERT_TRUE(output);
+    ASSERT_VALUE_EQ((*output)["grouped"], Value(fromjson("{x: [{_id: null, n: 2}]}")["x"]));
+    ASSERT_VALUE_EQ((*output)["projected"], Value(fromjson("{x: [{_id: 0}, {_id: 1}]}")["x"]));
+}
+
+TEST_F(DocumentSourceFacetTest, ShouldBufferInputIfAnyPipelineCannotBePushedItsInput) {
+    auto ctx = getExpCtx();
+
+    auto group = DocumentSourceGroup::createFromBson(
+        BSON("$group" << BSON("_id" << BSONNULL << "n" << BSON("$sum" << 1))).firstElement(), ctx);
+    auto groupPipeline = uassertStatusOK(Pipeline::create({group}, ctx));
+
+    auto dummy = DocumentSourcePassthrough::create();
+    auto dummyPipeline = uassertStatusOK(Pipeline::create({dummy}, ctx));
+
+    const uint64_t maxMemoryUsageBytes = 1000;
+    auto facetStage = DocumentSourceFacet::create(
+        {{"grouped", groupPipeline}, {"passthrough", dummyPipeline}}, ctx, maxMemoryUsageBytes);
+
+    auto largeStr = std::string(1000, 'y');
+    std::deque<Document> inputs = {Document{{"_id", 0}, {"x", largeStr}},
+                                   Document{{"_id", 1}, {"x", largeStr}}};
+    auto mock = DocumentSourceMock::create(inputs);
+    facetStage->setSource(mock.get());
+
+    // The passthrough stage must read its input back from the buffer, which exceeds the limit.
+    ASSERT_THROWS_CODE(facetStage->getNext(), UserException, 40174);
+}
+
 //
 // Miscellaneous.
 //
@@ -80,6 +80,10 @@ public:
         MONGO_UNREACHABLE;
     }
 
+    Status update(const NamespaceString& ns, const std::vector<BSONObj>& updates) final {
+        MONGO_UNREACHABLE;
+    }
+
     CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
                                           const NamespaceString& ns) final {
         MONGO_UNREACHABLE;
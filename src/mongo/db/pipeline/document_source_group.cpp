@@ -447,89 +447,97 @@ void DocumentSourceGroup::initialize() {
         return;
     }
 
+    // This loop consumes all input from pSource and buckets it based on pIdExpression.
+    while (boost::optional<Document> input = pSource->getNext()) {
+        loadDocument(*input);
+    }
+    loadingDone();
+}
+
+void DocumentSourceGroup::loadDocument(const Document& input) {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
     dassert(numAccumulators == vpExpression.size());
 
-    // pushed to on spill()
-    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
-    int memoryUsageBytes = 0;
+    if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+        uassert(16945,
+                "Exceeded memory limit for $group, but didn't allow external sort."
+                " Pass allowDiskUse:true to opt in.",
+                _extSortAllowed);
+        _sortedFiles.push_back(spill());
+        _memoryUsageBytes = 0;
+    }
 
-    // This loop consumes all input from pSource and buckets it based on pIdExpression.
-    while (boost::optional<Document> input = pSource->getNext()) {
-        if (memoryUsageBytes > _maxMemoryUsageBytes) {
-            uassert(16945,
-                    "Exceeded memory limit for $group, but didn't allow external sort."
-                    " Pass allowDiskUse:true to opt in.",
-                    _extSortAllowed);
-            sortedFiles.push_back(spill());
-            memoryUsageBytes = 0;
-        }
+    _variables->setRoot(input);
 
-        _variables->setRoot(*input);
+    /* get the _id value */
+    Value id = computeId(_variables.get());
 
-        /* get the _id value */
-        Value id = computeId(_variables.get());
+    /*
+      Look for the _id value in the map; if it's not there, add a
+      new entry with a blank accumulator.
+    */
+    const size_t oldSize = _groups->size();
+    vector<intrusive_ptr<Accumulator>>& group = (*_groups)[id];
+    const bool inserted = _groups->size() != oldSize;
 
-        /*
-          Look for the _id value in the map; if it's not there, add a
-          new entry with a blank accumulator.
-        */
-        const size_t oldSize = _groups->size();
-        vector<intrusive_ptr<Accumulator>>& group = (*_groups)[id];
-        const bool inserted = _groups->size() != oldSize;
-
-        if (inserted) {
-            memoryUsageBytes += id.getApproximateSize();
-
-            // Add the accumulators
-            group.reserve(numAccumulators);
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group.push_back(vpAccumulatorFactory[i]());
-                group.back()->injectExpressionContext(pExpCtx);
-            }
-        } else {
-            for (size_t i = 0; i < numAccumulators; i++) {
-                // subtract old mem usage. New usage added back after processing.
-                memoryUsageBytes -= group[i]->memUsageForSorter();
-            }
-        }
+    if (inserted) {
+        _memoryUsageBytes += id.getApproximateSize();
 
-        /* tickle all the accumulators for the group we found */
-        dassert(numAccumulators == group.size());
+        // Add the accumulators
+        group.reserve(numAccumulators);
         for (size_t i = 0; i < numAccumulators; i++) {
-            group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-            memoryUsageBytes += group[i]->memUsageForSorter();
+            group.push_back(vpAccumulatorFactory[i]());
+            group.back()->injectExpressionContext(pExpCtx);
         }
+    } else {
+        for (size_t i = 0; i < numAccumulators; i++) {
+            // subtract old mem usage. New usage added back after processing.
+            _memoryUsageBytes -= group[i]->memUsageForSorter();
+        }
+    }
 
-        // We are done with the ROOT document so release it.
-        _variables->clearRoot();
+    /* tickle all the accumulators for the group we found */
+    dassert(numAccumulators == group.size());
+    for (size_t i = 0; i < numAccumulators; i++) {
+        group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
+        _memoryUsageBytes += group[i]->memUsageForSorter();
+    }
 
-        if (kDebugBuild && !storageGlobalParams.readOnly) {
-            // In debug mode, spill every time we have a duplicate id to stress merge logic.
-            if (!inserted  // is a dup
-                &&
-                !pExpCtx->inRouter  // can't spill to disk in router
-                &&
-                !_extSortAllowed  // don't change behavior when testing external sort
-                &&
-                sortedFiles.size() < 20  // don't open too many FDs
-                ) {
-                sortedFiles.push_back(spill());
-            }
+    // We are done with the ROOT document so release it.
+    _variables->clearRoot();
+
+    if (kDebugBuild && !storageGlobalParams.readOnly) {
+        // In debug mode, spill every time we have a duplicate id to stress merge logic.
+        if (!inserted  // is a dup
+            &&
+            !pExpCtx->inRouter  // can't spill to disk in router
+            &&
+            !_extSortAllowed  // don't change behavior when testing external sort
+            &&
+            _sortedFiles.size() < 20  // don't open too many FDs
+            ) {
+            _sortedFiles.push_back(spill());
         }
     }
+}
+
+void DocumentSourceGroup::loadingDone() {
+    _initialized = true;
+    const size_t numAccumulators = vpAccumulatorFactory.size();
 
     // These blocks do any final steps necessary to prepare to output results.
-    if (!sortedFiles.empty()) {
+    if (!_sortedFiles.empty()) {
         _spilled = true;
         if (!_groups->empty()) {
-            sortedFiles.push_back(spill());
+            _sortedFiles.push_back(spill());
         }
 
         // We won't be using groups again so free its memory.
         _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
 
         _sorterIterator.reset(Sorter<Value, Value>::Iterator::merge(
-            sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
+            _sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
+        _sortedFiles.clear();
 
         // prepare current to accumulate data
         _currentAccumulators.reserve(numAccumulators);
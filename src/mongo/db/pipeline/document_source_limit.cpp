@@ -66,12 +66,18 @@ Pipeline::SourceContainer::iterator DocumentSourceLimit::optimizeAt(
 boost::optional<Document> DocumentSourceLimit::getNext() {
     pExpCtx->checkForInterrupt();
 
-    if (++count > limit) {
+    if (count >= limit) {
         pSource->dispose();
         return boost::none;
     }
 
-    return pSource->getNext();
+    // Only count documents actually returned, so that reaching EOF does not use up the limit if
+    // this stage is asked for more results once its source has more input.
+    auto next = pSource->getNext();
+    if (next) {
+        ++count;
+    }
+    return next;
 }
 
 Value DocumentSourceLimit::serialize(bool explain) const {
@@ -0,0 +1,372 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+
+#include "mongo/db/pipeline/document_source.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+REGISTER_DOCUMENT_SOURCE(merge, DocumentSourceMerge::createFromBson);
+
+const size_t DocumentSourceMerge::kMaxBatchSize;
+
+namespace {
+
+DocumentSourceMerge::WhenMatched parseWhenMatched(const BSONElement& elem) {
+    StringData mode = elem.type() == BSONType::String ? elem.valueStringData() : StringData();
+    if (mode == "replace") {
+        return DocumentSourceMerge::WhenMatched::kReplace;
+    } else if (mode == "merge") {
+        return DocumentSourceMerge::WhenMatched::kMerge;
+    } else if (mode == "keepExisting") {
+        return DocumentSourceMerge::WhenMatched::kKeepExisting;
+    } else if (mode == "fail") {
+        return DocumentSourceMerge::WhenMatched::kFail;
+    }
+    uasserted(40339,
+              str::stream() << "'whenMatched' option to $merge must be one of 'replace', 'merge', "
+                               "'keepExisting' or 'fail', but found: "
+                            << elem.toString(false));
+}
+
+DocumentSourceMerge::WhenNotMatched parseWhenNotMatched(const BSONElement& elem) {
+    StringData mode = elem.type() == BSONType::String ? elem.valueStringData() : StringData();
+    if (mode == "insert") {
+        return DocumentSourceMerge::WhenNotMatched::kInsert;
+    } else if (mode == "discard") {
+        return DocumentSourceMerge::WhenNotMatched::kDiscard;
+    }
+    uasserted(40340,
+              str::stream()
+                  << "'whenNotMatched' option to $merge must be one of 'insert' or 'discard', "
+                     "but found: "
+                  << elem.toString(false));
+}
+
+StringData serializeWhenMatched(DocumentSourceMerge::WhenMatched whenMatched) {
+    switch (whenMatched) {
+        case DocumentSourceMerge::WhenMatched::kReplace:
+            return "replace"_sd;
+        case DocumentSourceMerge::WhenMatched::kMerge:
+            return "merge"_sd;
+        case DocumentSourceMerge::WhenMatched::kKeepExisting:
+            return "keepExisting"_sd;
+        case DocumentSourceMerge::WhenMatched::kFail:
+            return "fail"_sd;
+    }
+    MONGO_UNREACHABLE;
+}
+
+StringData serializeWhenNotMatched(DocumentSourceMerge::WhenNotMatched whenNotMatched) {
+    switch (whenNotMatched) {
+        case DocumentSourceMerge::WhenNotMatched::kInsert:
+            return "insert"_sd;
+        case DocumentSourceMerge::WhenNotMatched::kDiscard:
+            return "discard"_sd;
+    }
+    MONGO_UNREACHABLE;
+}
+
+vector<FieldPath> parseOnFields(const BSONElement& elem) {
+    const std::string badOnFields = str::stream()
+        << "'on' option to $merge must be a field name or a non-empty array of distinct field "
+           "names, but found: "
+        << elem.toString(false);
+
+    vector<FieldPath> onFields;
+    if (elem.type() == BSONType::String) {
+        onFields.emplace_back(elem.str());
+        return onFields;
+    }
+
+    uassert(40338, badOnFields, elem.type() == BSONType::Array && !elem.Obj().isEmpty());
+    for (auto&& fieldElem : elem.Obj()) {
+        uassert(40351, badOnFields, fieldElem.type() == BSONType::String);
+        FieldPath field(fieldElem.str());
+        uassert(40352,
+                badOnFields,
+                std::none_of(onFields.begin(), onFields.end(), [&field](const FieldPath& other) {
+                    return other.fullPath() == field.fullPath();
+                }));
+        onFields.push_back(std::move(field));
+    }
+    return onFields;
+}
+
+}  // namespace
+
+const char* DocumentSourceMerge::getSourceName() const {
+    return "$merge";
+}
+
+void DocumentSourceMerge::validateTargetCollection() {
+    invariant(_mongod);
+
+    uassert(40344,
+            str::stream() << "namespace '" << _outputNs.ns()
+                          << "' is sharded so it can't be used for $merge",
+            !_mongod->isSharded(_outputNs));
+
+    // The _id index always exists and is unique, so it can always be used to find the document
+    // to update.
+    const auto isIdField = [](const FieldPath& field) { return field.fullPath() == "_id"; };
+    if (std::any_of(_onFields.begin(), _onFields.end(), isIdField)) {
+        return;
+    }
+
+    // Otherwise there must be a unique index whose key is exactly the 'on' fields, or the updates
+    // could match more than one document. Partial indexes do not enforce uniqueness for documents
+    // outside of their filter, so they don't qualify.
+    const auto isUniqueIndexOnFields = [this](const BSONObj& spec) {
+        if (!spec["unique"].trueValue() || spec.hasField("partialFilterExpression")) {
+            return false;
+        }
+        BSONObj keyPattern = spec["key"].Obj();
+        if (static_cast<size_t>(keyPattern.nFields()) != _onFields.size()) {
+            return false;
+        }
+        for (auto&& keyElem : keyPattern) {
+            if (std::none_of(_onFields.begin(), _onFields.end(), [&keyElem](const FieldPath& f) {
+                    return f.fullPath() == keyElem.fieldNameStringData();
+                })) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const std::list<BSONObj> indexes = _mongod->directClient()->getIndexSpecs(_outputNs.ns());
+    uassert(40345,
+            str::stream() << "$merge into namespace '" << _outputNs.ns()
+                          << "' requires a unique index on the 'on' fields: "
+                          << serialize()[getSourceName()]["on"].toString(),
+            std::any_of(indexes.begin(), indexes.end(), isUniqueIndexOnFields));
+}
+
+BSONObj DocumentSourceMerge::makeWriteStatement(const Document& doc) const {
+    BSONObj obj = doc.toBson();
+    if (_whenMatched == WhenMatched::kFail) {
+        // The unique index on the 'on' fields turns a match into a duplicate key error.
+        return obj;
+    }
+
+    BSONObjBuilder query;
+    for (auto&& field : _onFields) {
+        Value value = doc.getNestedField(field);
+        uassert(40346,
+                str::stream() << "$merge requires each document to have a non-array value for the "
+                                 "'on' field '"
+                              << field.fullPath()
+                              << "', but found: "
+                              << obj,
+                !value.missing() && value.getType() != BSONType::Array);
+        value.addToBsonObj(&query, field.fullPath());
+    }
+
+    // A matched document may have a different _id unless it is one of the 'on' fields, and _id
+    // can't be changed, so it is only written to new documents.
+    BSONObj fields = obj;
+    BSONElement id;
+    if (!_onFieldsIncludeId) {
+        id = obj["_id"];
+        fields = obj.removeField("_id");
+    }
+
+    BSONObjBuilder statement;
+    statement.append("q", query.obj());
+    switch (_whenMatched) {
+        case WhenMatched::kReplace:
+            // A replacement can't be combined with $setOnInsert, so new documents get a new _id.
+            statement.append("u", fields);
+            break;
+        case WhenMatched::kMerge: {
+            BSONObjBuilder update(statement.subobjStart("u"));
+            update.append("$set", fields);
+            if (!id.eoo()) {
+                update.append("$setOnInsert", id.wrap());
+            }
+            break;
+        }
+        case WhenMatched::kKeepExisting:
+            statement.append("u", BSON("$setOnInsert" << obj));
+            break;
+        case WhenMatched::kFail:
+            MONGO_UNREACHABLE;
+    }
+    statement.append("upsert", _whenNotMatched == WhenNotMatched::kInsert);
+    statement.append("multi", false);
+    return statement.obj();
+}
+
+void DocumentSourceMerge::flush(const vector<BSONObj>& statements) {
+    if (_whenMatched == WhenMatched::kFail) {
+        BSONObj err = _mongod->insert(_outputNs, statements);
+        uassert(40347,
+                str::stream() << "insert for $merge failed: " << err,
+                DBClientWithCommands::getLastErrorString(err).empty());
+        return;
+    }
+
+    Status status = _mongod->update(_outputNs, statements);
+    uassert(40354,
+            str::stream() << "update for $merge failed: " << status.toString(),
+            status.isOK());
+}
+
+boost::optional<Document> DocumentSourceMerge::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    // Make sure we only write out once.
+    if (_done)
+        return boost::none;
+    _done = true;
+
+    validateTargetCollection();
+
+    // Write the documents in batches that fit in a single write command. Documents are written as
+    // they arrive, so if a write fails, the writes before it will already have been applied.
+    vector<BSONObj> batch;
+    int batchBytes = 0;
+    while (boost::optional<Document> next = pSource->getNext()) {
+        BSONObj statement = makeWriteStatement(*next);
+        batchBytes += statement.objsize();
+        if (!batch.empty() && (batchBytes > BSONObjMaxUserSize || batch.size() >= kMaxBatchSize)) {
+            flush(batch);
+            batch.clear();
+            batchBytes = statement.objsize();
+        }
+        batch.push_back(statement);
+    }
+
+    if (!batch.empty())
+        flush(batch);
+
+    // Like $out, this stage doesn't produce output documents.
+    return boost::none;
+}
+
+DocumentSourceMerge::DocumentSourceMerge(const NamespaceString& outputNs,
+                                         vector<FieldPath> onFields,
+                                         WhenMatched whenMatched,
+                                         WhenNotMatched whenNotMatched,
+                                         const intrusive_ptr<ExpressionContext>& pExpCtx)
+    : DocumentSourceNeedsMongod(pExpCtx),
+      _outputNs(outputNs),
+      _onFields(std::move(onFields)),
+      _whenMatched(whenMatched),
+      _whenNotMatched(whenNotMatched),
+      _onFieldsIncludeId(std::any_of(_onFields.begin(), _onFields.end(), [](const FieldPath& f) {
+          return f.fullPath() == "_id";
+      })) {}
+
+intrusive_ptr<DocumentSource> DocumentSourceMerge::createFromBson(
+    BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    uassert(40336,
+            str::stream() << "$merge only supports an object argument, not "
+                          << typeName(elem.type()),
+            elem.type() == BSONType::Object);
+
+    uassert(ErrorCodes::InvalidOptions,
+            "$merge can only be used with the 'local' read concern level",
+            !pExpCtx->opCtx->recoveryUnit()->isReadingFromMajorityCommittedSnapshot());
+
+    std::string into;
+    vector<FieldPath> onFields{FieldPath("_id")};
+    WhenMatched whenMatched = WhenMatched::kMerge;
+    WhenNotMatched whenNotMatched = WhenNotMatched::kInsert;
+    for (auto&& option : elem.Obj()) {
+        StringData optionName = option.fieldNameStringData();
+        if (optionName == "into") {
+            uassert(40337,
+                    str::stream() << "'into' option to $merge must be a non-empty string, but "
+                                     "found: "
+                                  << option.toString(false),
+                    option.type() == BSONType::String && !option.valueStringData().empty());
+            into = option.str();
+        } else if (optionName == "on") {
+            onFields = parseOnFields(option);
+        } else if (optionName == "whenMatched") {
+            whenMatched = parseWhenMatched(option);
+        } else if (optionName == "whenNotMatched") {
+            whenNotMatched = parseWhenNotMatched(option);
+        } else {
+            uasserted(40341,
+                      str::stream() << "unrecognized option to $merge: " << optionName);
+        }
+    }
+
+    uassert(40353, "$merge requires an 'into' option", !into.empty());
+    uassert(40342,
+            str::stream() << "$merge with whenMatched: '" << serializeWhenMatched(whenMatched)
+                          << "' and whenNotMatched: 'discard' would never write anything",
+            whenNotMatched == WhenNotMatched::kInsert ||
+                whenMatched == WhenMatched::kReplace || whenMatched == WhenMatched::kMerge);
+
+    NamespaceString outputNs(pExpCtx->ns.db().toString() + '.' + into);
+    uassert(40343, "Can't $merge into special collection: " + into, !outputNs.isSpecial());
+
+    // Documents updated in the collection being read could be read again, so this would not be
+    // well defined. $out avoids the problem by writing into a temporary collection.
+    uassert(40348,
+            str::stream() << "$merge cannot write into the collection being aggregated: "
+                          << outputNs.ns(),
+            outputNs != pExpCtx->ns);
+
+    return new DocumentSourceMerge(
+        outputNs, std::move(onFields), whenMatched, whenNotMatched, pExpCtx);
+}
+
+Value DocumentSourceMerge::serialize(bool explain) const {
+    massert(40349,
+            "$merge shouldn't have different db than input",
+            _outputNs.db() == pExpCtx->ns.db());
+
+    vector<Value> onFields;
+    for (auto&& field : _onFields) {
+        onFields.emplace_back(field.fullPath());
+    }
+
+    return Value(DOC(getSourceName() << DOC("into" << _outputNs.coll() << "on" << onFields
+                                                   << "whenMatched"
+                                                   << serializeWhenMatched(_whenMatched)
+                                                   << "whenNotMatched"
+                                                   << serializeWhenNotMatched(_whenNotMatched))));
+}
+
+DocumentSource::GetDepsReturn DocumentSourceMerge::getDependencies(DepsTracker* deps) const {
+    deps->needWholeDocument = true;
+    return EXHAUSTIVE_ALL;
+}
+}
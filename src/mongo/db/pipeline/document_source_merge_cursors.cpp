@@ -131,6 +131,10 @@ void DocumentSourceMergeCursors::start() {
         uassert(
             17028, "error reading response from " + _cursors.back()->connection->toString(), ok);
         verify(!retry);
+
+        // Ask for the next batch right away, so that every shard keeps producing results while
+        // the ones already received are being merged.
+        cursor->cursor.enablePrefetch();
     }
 
     _currentCursor = _cursors.begin();
@@ -174,10 +178,15 @@ boost::optional<Document> DocumentSourceMergeCursors::getNext() {
 void DocumentSourceMergeCursors::dispose() {
     // Note it is an error to call done() on a connection before consuming the response from a
     // request. Therefore it is an error to call dispose() if there are any outstanding connections
-    // which have not received a reply.
+    // which have not received a reply to initLazy(). Connections still waiting for the reply to a
+    // prefetched getMore are closed instead, rather than waiting for the shard to produce it.
     for (auto&& cursorAndConn : _cursors) {
         cursorAndConn->cursor.kill();
-        cursorAndConn->connection.done();
+        if (cursorAndConn->cursor.hasPendingReply()) {
+            cursorAndConn->connection.kill();
+        } else {
+            cursorAndConn->connection.done();
+        }
     }
     _cursors.clear();
     _currentCursor = _cursors.end();
@@ -0,0 +1,314 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <deque>
+#include <vector>
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/json.h"
+#include "mongo/db/pipeline/aggregation_context_fixture.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+// Crutch.
+bool isMongos() {
+    return false;
+}
+
+namespace {
+
+using boost::intrusive_ptr;
+using std::deque;
+using std::vector;
+
+// This provides access to getExpCtx(), but we'll use a different name for this test suite.
+using DocumentSourceMergeTest = AggregationContextFixture;
+
+/**
+ * A MongodInterface which records the batches of writes it is asked to perform.
+ */
+class MockMongodImplementation final : public DocumentSourceNeedsMongod::MongodInterface {
+public:
+    void setOperationContext(OperationContext* opCtx) final {
+        MONGO_UNREACHABLE;
+    }
+
+    DBClientBase* directClient() final {
+        MONGO_UNREACHABLE;
+    }
+
+    bool isSharded(const NamespaceString& ns) final {
+        return false;
+    }
+
+    BSONObj insert(const NamespaceString& ns, const vector<BSONObj>& objs) final {
+        insertBatches.push_back(objs);
+        return BSONObj();
+    }
+
+    Status update(const NamespaceString& ns, const vector<BSONObj>& updates) final {
+        updateBatches.push_back(updates);
+        return updateStatus;
+    }
+
+    CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
+                                          const NamespaceString& ns) final {
+        MONGO_UNREACHABLE;
+    }
+
+    void appendLatencyStats(const NamespaceString& nss,
+                            bool includeHistograms,
+                            BSONObjBuilder* builder) const final {
+        MONGO_UNREACHABLE;
+    }
+
+    Status appendStorageStats(const NamespaceString& nss,
+                              const BSONObj& param,
+                              BSONObjBuilder* builder) const final {
+        MONGO_UNREACHABLE;
+    }
+
+    BSONObj getCollectionOptions(const NamespaceString& nss) final {
+        MONGO_UNREACHABLE;
+    }
+
+    Status renameIfOptionsAndIndexesHaveNotChanged(
+        const BSONObj& renameCommandObj,
+        const NamespaceString& targetNs,
+        const BSONObj& originalCollectionOptions,
+        const std::list<BSONObj>& originalIndexes) final {
+        MONGO_UNREACHABLE;
+    }
+
+    StatusWith<intrusive_ptr<Pipeline>> makePipeline(
+        const vector<BSONObj>& rawPipeline,
+        const intrusive_ptr<ExpressionContext>& expCtx) final {
+        MONGO_UNREACHABLE;
+    }
+
+    vector<vector<BSONObj>> insertBatches;
+    vector<vector<BSONObj>> updateBatches;
+    Status updateStatus = Status::OK();
+};
+
+intrusive_ptr<DocumentSource> createMerge(const intrusive_ptr<ExpressionContext>& expCtx,
+                                          const BSONObj& spec) {
+    return DocumentSourceMerge::createFromBson(spec.firstElement(), expCtx);
+}
+
+/**
+ * Runs a $merge stage with the given spec over 'inputs', and returns the interface it wrote to.
+ */
+std::shared_ptr<MockMongodImplementation> runMerge(const intrusive_ptr<ExpressionContext>& expCtx,
+                                                   const BSONObj& spec,
+                                                   deque<Document> inputs) {
+    auto merge = createMerge(expCtx, spec);
+    auto mongod = std::make_shared<MockMongodImplementation>();
+    dynamic_cast<DocumentSourceNeedsMongod*>(merge.get())->injectMongodInterface(mongod);
+    auto source = DocumentSourceMock::create(std::move(inputs));
+    merge->setSource(source.get());
+
+    ASSERT_FALSE(merge->getNext());
+    ASSERT_FALSE(merge->getNext());
+    return mongod;
+}
+
+//
+// Parsing and serialization.
+//
+
+TEST_F(DocumentSourceMergeTest, ShouldRejectNonObjectSpec) {
+    auto spec = BSON("$merge"
+                     << "target");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40336);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldRejectMissingOrInvalidInto) {
+    auto spec = BSON("$merge" << BSONObj());
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40353);
+
+    spec = BSON("$merge" << BSON("into" << 1));
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40337);
+
+    spec = BSON("$merge" << BSON("into"
+                                 << "pipeline_test"));
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40348);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldRejectInvalidOnFields) {
+    auto spec = fromjson("{$merge: {into: 'target', on: 1}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40338);
+
+    spec = fromjson("{$merge: {into: 'target', on: []}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40338);
+
+    spec = fromjson("{$merge: {into: 'target', on: ['a', 1]}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40351);
+
+    spec = fromjson("{$merge: {into: 'target', on: ['a', 'b', 'a']}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40352);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldRejectInvalidModes) {
+    auto spec = fromjson("{$merge: {into: 'target', whenMatched: 'upsert'}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40339);
+
+    spec = fromjson("{$merge: {into: 'target', whenNotMatched: 'fail'}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40340);
+
+    spec = fromjson("{$merge: {into: 'target', whenMatched: 'keepExisting', whenNotMatched: "
+                    "'discard'}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40342);
+
+    spec = fromjson("{$merge: {into: 'target', whenMatched: 'fail', whenNotMatched: 'discard'}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40342);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldRejectUnknownOptions) {
+    auto spec = fromjson("{$merge: {into: 'target', upsert: true}}");
+    ASSERT_THROWS_CODE(createMerge(getExpCtx(), spec), UserException, 40341);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldSerializeDefaultOptions) {
+    auto spec = fromjson("{$merge: {into: 'target'}}");
+    auto merge = createMerge(getExpCtx(), spec);
+
+    vector<Value> serialization;
+    merge->serializeToArray(serialization);
+    ASSERT_EQ(serialization.size(), 1UL);
+    ASSERT_VALUE_EQ(serialization[0],
+                    Value(fromjson("{$merge: {into: 'target', on: ['_id'], whenMatched: 'merge', "
+                                   "whenNotMatched: 'insert'}}")));
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldRoundTripExplicitOptions) {
+    auto spec = fromjson("{$merge: {into: 'target', on: ['_id', 'a.b'], whenMatched: "
+                         "'replace', whenNotMatched: 'discard'}}");
+    auto merge = createMerge(getExpCtx(), spec);
+
+    vector<Value> serialization;
+    merge->serializeToArray(serialization);
+    ASSERT_EQ(serialization.size(), 1UL);
+    ASSERT_VALUE_EQ(serialization[0], Value(spec));
+}
+
+//
+// Execution.
+//
+
+TEST_F(DocumentSourceMergeTest, ShouldUpsertWithSetWhenMerging) {
+    auto spec = fromjson("{$merge: {into: 'target'}}");
+    auto mongod = runMerge(getExpCtx(), spec, {Document{{"_id", 1}, {"a", 1}}});
+
+    ASSERT_TRUE(mongod->insertBatches.empty());
+    ASSERT_EQ(mongod->updateBatches.size(), 1UL);
+    ASSERT_EQ(mongod->updateBatches[0].size(), 1UL);
+    ASSERT_BSONOBJ_EQ(mongod->updateBatches[0][0],
+                      fromjson("{q: {_id: 1}, u: {$set: {_id: 1, a: 1}}, upsert: true, "
+                               "multi: false}"));
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldUseEachModeToBuildTheUpdate) {
+    auto spec = fromjson("{$merge: {into: 'target', on: ['_id', 'a.b'], whenMatched: "
+                         "'replace', whenNotMatched: 'discard'}}");
+    auto mongod =
+        runMerge(getExpCtx(), spec, {Document{{"_id", 1}, {"a", Document{{"b", 2}}}, {"c", 3}}});
+    ASSERT_EQ(mongod->updateBatches.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(mongod->updateBatches[0][0],
+                      fromjson("{q: {_id: 1, 'a.b': 2}, u: {_id: 1, a: {b: 2}, c: 3}, "
+                               "upsert: false, multi: false}"));
+
+    spec = fromjson("{$merge: {into: 'target', whenMatched: 'keepExisting'}}");
+    mongod = runMerge(getExpCtx(), spec, {Document{{"_id", 1}, {"a", 1}}});
+    ASSERT_EQ(mongod->updateBatches.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(mongod->updateBatches[0][0],
+                      fromjson("{q: {_id: 1}, u: {$setOnInsert: {_id: 1, a: 1}}, upsert: true, "
+                               "multi: false}"));
+
+    spec = fromjson("{$merge: {into: 'target', whenMatched: 'fail'}}");
+    mongod = runMerge(getExpCtx(), spec, {Document{{"_id", 1}, {"a", 1}}});
+    ASSERT_TRUE(mongod->updateBatches.empty());
+    ASSERT_EQ(mongod->insertBatches.size(), 1UL);
+    ASSERT_BSONOBJ_EQ(mongod->insertBatches[0][0], fromjson("{_id: 1, a: 1}"));
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldWriteInBatches) {
+    deque<Document> inputs;
+    const size_t nDocs = 2 * DocumentSourceMerge::kMaxBatchSize + 10;
+    for (size_t i = 0; i < nDocs; ++i) {
+        inputs.push_back(Document{{"_id", static_cast<long long>(i)}});
+    }
+
+    auto spec = fromjson("{$merge: {into: 'target'}}");
+    auto mongod = runMerge(getExpCtx(), spec, std::move(inputs));
+
+    ASSERT_EQ(mongod->updateBatches.size(), 3UL);
+    ASSERT_EQ(mongod->updateBatches[0].size(), DocumentSourceMerge::kMaxBatchSize);
+    ASSERT_EQ(mongod->updateBatches[1].size(), DocumentSourceMerge::kMaxBatchSize);
+    ASSERT_EQ(mongod->updateBatches[2].size(), 10UL);
+    ASSERT_BSONOBJ_EQ(mongod->updateBatches[2][9]["q"].Obj(), BSON("_id" << 2009LL));
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldFailIfDocumentIsMissingAnOnField) {
+    auto spec = fromjson("{$merge: {into: 'target', on: ['_id', 'a']}}");
+    auto merge = createMerge(getExpCtx(), spec);
+    auto mongod = std::make_shared<MockMongodImplementation>();
+    dynamic_cast<DocumentSourceNeedsMongod*>(merge.get())->injectMongodInterface(mongod);
+    auto source = DocumentSourceMock::create(Document{{"_id", 1}});
+    merge->setSource(source.get());
+    ASSERT_THROWS_CODE(merge->getNext(), UserException, 40346);
+
+    merge = createMerge(getExpCtx(), spec);
+    dynamic_cast<DocumentSourceNeedsMongod*>(merge.get())->injectMongodInterface(mongod);
+    source = DocumentSourceMock::create(Document{{"_id", 1}, {"a", vector<Value>{Value(1)}}});
+    merge->setSource(source.get());
+    ASSERT_THROWS_CODE(merge->getNext(), UserException, 40346);
+}
+
+TEST_F(DocumentSourceMergeTest, ShouldFailIfWriteFails) {
+    auto spec = fromjson("{$merge: {into: 'target'}}");
+    auto merge = createMerge(getExpCtx(), spec);
+    auto mongod = std::make_shared<MockMongodImplementation>();
+    mongod->updateStatus = {ErrorCodes::DuplicateKey, "duplicate key"};
+    dynamic_cast<DocumentSourceNeedsMongod*>(merge.get())->injectMongodInterface(mongod);
+    auto source = DocumentSourceMock::create(Document{{"_id", 1}});
+    merge->setSource(source.get());
+    ASSERT_THROWS_CODE(merge->getNext(), UserException, 40354);
+}
+
+}  // namespace
+}  // namespace mongo
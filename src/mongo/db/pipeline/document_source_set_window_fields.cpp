@@ -0,0 +1,506 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source.h"
+
+#include <cmath>
+
+#include "mongo/db/pipeline/dependencies.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+REGISTER_MULTI_STAGE_ALIAS(setWindowFields, DocumentSourceSetWindowFields::createFromBson);
+REGISTER_DOCUMENT_SOURCE(_internalSetWindowFields,
+                         DocumentSourceSetWindowFields::createFromBsonInternal);
+
+namespace {
+const char kUnbounded[] = "unbounded";
+const char kCurrent[] = "current";
+
+/**
+ * Parses one bound of a window. Returns boost::none for an unbounded bound.
+ */
+boost::optional<double> parseWindowBound(const BSONElement& elem, bool isRange) {
+    if (elem.type() == String) {
+        if (elem.valueStringData() == kUnbounded) {
+            return boost::none;
+        }
+        if (elem.valueStringData() == kCurrent) {
+            return 0.0;
+        }
+    } else if (elem.isNumber()) {
+        const double bound = elem.numberDouble();
+        uassert(40313,
+                str::stream() << "$setWindowFields bounds must be finite, but found " << elem,
+                std::isfinite(bound));
+        uassert(40314,
+                str::stream() << "$setWindowFields 'documents' bounds must be integers, but found "
+                              << elem,
+                isRange || bound == std::floor(bound));
+        return bound;
+    }
+    uasserted(40315,
+              str::stream() << "$setWindowFields bounds must be a number, '" << kUnbounded
+                            << "' or '"
+                            << kCurrent
+                            << "', but found "
+                            << elem);
+}
+
+Value serializeWindowBound(const boost::optional<double>& bound, bool isRange) {
+    if (!bound) {
+        return Value(StringData(kUnbounded));
+    }
+    return isRange ? Value(*bound) : Value(static_cast<long long>(*bound));
+}
+}  // namespace
+
+const char* DocumentSourceSetWindowFields::getSourceName() const {
+    return "$_internalSetWindowFields";
+}
+
+DocumentSourceSetWindowFields::DocumentSourceSetWindowFields(
+    const intrusive_ptr<ExpressionContext>& pExpCtx, uint64_t maxMemoryUsageBytes)
+    : DocumentSource(pExpCtx), _maxMemoryUsageBytes(maxMemoryUsageBytes) {}
+
+boost::optional<Document> DocumentSourceSetWindowFields::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    while (true) {
+        if (_nextToOutput < _partitionSize &&
+            (_partitionLoaded || windowsAreComplete(_nextToOutput))) {
+            return outputNextDocument();
+        }
+
+        if (!_partitionLoaded) {
+            loadNextDocument();
+            continue;
+        }
+
+        // Every document of the current partition has been returned.
+        if (!_firstDocOfNextPartition) {
+            return boost::none;
+        }
+        startNextPartition();
+    }
+}
+
+Value DocumentSourceSetWindowFields::computePartitionKey(const Document& doc) {
+    if (!_partitionBy) {
+        return Value(BSONNULL);
+    }
+
+    _variables->setRoot(doc);
+    Value key = _partitionBy->evaluate(_variables.get());
+
+    // To be consistent with the $group stage, we consider "missing" to be equivalent to null when
+    // partitioning documents.
+    return key.missing() ? Value(BSONNULL) : std::move(key);
+}
+
+void DocumentSourceSetWindowFields::loadNextDocument() {
+    boost::optional<Document> next = pSource->getNext();
+    if (!next) {
+        _partitionLoaded = true;
+        return;
+    }
+
+    Value key = computePartitionKey(*next);
+    if (_partitionSize > 0 && pExpCtx->getValueComparator().evaluate(key != _partitionKey)) {
+        _firstDocOfNextPartition = std::move(next);
+        _partitionLoaded = true;
+        return;
+    }
+
+    _partitionKey = std::move(key);
+    appendToBuffer(std::move(*next));
+}
+
+void DocumentSourceSetWindowFields::appendToBuffer(Document doc) {
+    BufferedDocument buffered;
+    buffered.memUsageBytes = doc.getApproximateSize();
+
+    _variables->setRoot(doc);
+    buffered.inputs.reserve(_outputFields.size());
+    for (auto&& field : _outputFields) {
+        buffered.inputs.push_back(field.expression->evaluate(_variables.get()));
+        buffered.memUsageBytes += buffered.inputs.back().getApproximateSize();
+    }
+
+    if (_rangeSortPath) {
+        Value sortKey = doc.getNestedField(*_rangeSortPath);
+        uassert(40316,
+                str::stream() << "$setWindowFields 'range' windows require the sortBy field to be "
+                                 "numeric, but found "
+                              << sortKey.toString(),
+                sortKey.numeric());
+        buffered.sortKey = sortKey.coerceToDouble() * _rangeSortDirection;
+    }
+
+    buffered.doc = std::move(doc);
+    _memUsageBytes += buffered.memUsageBytes;
+    uassert(40317,
+            str::stream() << "$setWindowFields exceeded its memory limit of "
+                          << _maxMemoryUsageBytes
+                          << " bytes. Use narrower windows or a more selective partitionBy.",
+            _memUsageBytes <= _maxMemoryUsageBytes);
+
+    _buffer.push_back(std::move(buffered));
+    ++_partitionSize;
+}
+
+void DocumentSourceSetWindowFields::startNextPartition() {
+    invariant(_firstDocOfNextPartition);
+
+    _buffer.clear();
+    _bufferStart = 0;
+    _memUsageBytes = 0;
+    _partitionSize = 0;
+    _nextToOutput = 0;
+    _partitionLoaded = false;
+    for (auto&& field : _outputFields) {
+        field.accumulator->reset();
+        field.nextToAdd = 0;
+        field.nextToRemove = 0;
+    }
+
+    Document doc = std::move(*_firstDocOfNextPartition);
+    _firstDocOfNextPartition = boost::none;
+    _partitionKey = computePartitionKey(doc);
+    appendToBuffer(std::move(doc));
+}
+
+bool DocumentSourceSetWindowFields::windowsAreComplete(long long index) const {
+    const long long lastLoaded = _partitionSize - 1;
+    for (auto&& field : _outputFields) {
+        if (!field.upper) {
+            return false;
+        }
+
+        // A range window is only complete once a document beyond its upper bound has been read,
+        // since any number of documents may share the same sort key.
+        if (field.isRange ? position(field, lastLoaded) <= position(field, index) + *field.upper
+                          : lastLoaded < index + *field.upper) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Document DocumentSourceSetWindowFields::outputNextDocument() {
+    const long long index = _nextToOutput;
+    MutableDocument out(bufferedDocument(index).doc);
+
+    for (size_t i = 0; i < _outputFields.size(); ++i) {
+        OutputField& field = _outputFields[i];
+        const double current = position(field, index);
+
+        while (field.nextToAdd < _partitionSize &&
+               (!field.upper || position(field, field.nextToAdd) <= current + *field.upper)) {
+            field.accumulator->process(bufferedDocument(field.nextToAdd).inputs[i], false);
+            ++field.nextToAdd;
+        }
+
+        if (field.lower) {
+            while (field.nextToRemove < field.nextToAdd &&
+                   position(field, field.nextToRemove) < current + *field.lower) {
+                field.accumulator->remove(bufferedDocument(field.nextToRemove).inputs[i]);
+                ++field.nextToRemove;
+            }
+        }
+
+        // To be consistent with the $group stage, we consider "missing" to be equivalent to null
+        // when evaluating accumulators.
+        Value result = field.accumulator->getValue(false);
+        out.setNestedField(field.path, result.missing() ? Value(BSONNULL) : std::move(result));
+    }
+
+    ++_nextToOutput;
+    releaseBuffer();
+    return out.freeze();
+}
+
+void DocumentSourceSetWindowFields::releaseBuffer() {
+    // Windows without a lower bound never remove anything, so they only need the documents which
+    // have not been added yet.
+    long long retainFrom = _nextToOutput;
+    for (auto&& field : _outputFields) {
+        retainFrom = std::min(retainFrom, field.lower ? field.nextToRemove : field.nextToAdd);
+    }
+
+    while (_bufferStart < retainFrom) {
+        _memUsageBytes -= _buffer.front().memUsageBytes;
+        _buffer.pop_front();
+        ++_bufferStart;
+    }
+}
+
+intrusive_ptr<DocumentSource> DocumentSourceSetWindowFields::optimize() {
+    if (_partitionBy) {
+        _partitionBy = _partitionBy->optimize();
+    }
+    for (auto&& field : _outputFields) {
+        field.expression = field.expression->optimize();
+    }
+    return this;
+}
+
+void DocumentSourceSetWindowFields::doInjectExpressionContext() {
+    if (_partitionBy) {
+        _partitionBy->injectExpressionContext(pExpCtx);
+    }
+    for (auto&& field : _outputFields) {
+        field.expression->injectExpressionContext(pExpCtx);
+        field.accumulator->injectExpressionContext(pExpCtx);
+    }
+}
+
+void DocumentSourceSetWindowFields::dispose() {
+    _buffer.clear();
+    _memUsageBytes = 0;
+    _firstDocOfNextPartition = boost::none;
+    pSource->dispose();
+}
+
+DocumentSource::GetDepsReturn DocumentSourceSetWindowFields::getDependencies(
+    DepsTracker* deps) const {
+    if (_partitionBy) {
+        _partitionBy->addDependencies(deps);
+    }
+    for (auto&& sortField : _sortBy) {
+        deps->fields.insert(sortField.fieldName());
+    }
+    for (auto&& field : _outputFields) {
+        field.expression->addDependencies(deps);
+    }
+
+    // This stage passes every input document through, so later stages may need any field.
+    return SEE_NEXT;
+}
+
+BSONObjSet DocumentSourceSetWindowFields::getOutputSorts() {
+    if (!pSource) {
+        return SimpleBSONObjComparator::kInstance.makeBSONObjSet();
+    }
+
+    std::set<std::string> modifiedFields;
+    for (auto&& field : _outputFields) {
+        modifiedFields.insert(field.path.fullPath());
+    }
+    return truncateSortSet(pSource->getOutputSorts(), modifiedFields);
+}
+
+Value DocumentSourceSetWindowFields::serialize(bool explain) const {
+    MutableDocument spec;
+    if (_partitionBy) {
+        spec["partitionBy"] = _partitionBy->serialize(explain);
+    }
+    if (!_sortBy.isEmpty()) {
+        spec["sortBy"] = Value(_sortBy);
+    }
+
+    MutableDocument outputSpec(_outputFields.size());
+    for (auto&& field : _outputFields) {
+        const Value bounds(vector<Value>{serializeWindowBound(field.lower, field.isRange),
+                                         serializeWindowBound(field.upper, field.isRange)});
+        outputSpec[field.path.fullPath()] = Value(
+            Document{{field.accumulator->getOpName(), field.expression->serialize(explain)},
+                     {"window", Document{{field.isRange ? "range" : "documents", bounds}}}});
+    }
+    spec["output"] = outputSpec.freezeToValue();
+
+    return Value(Document{{getSourceName(), spec.freezeToValue()}});
+}
+
+void DocumentSourceSetWindowFields::parseOutputField(const BSONElement& elem,
+                                                     const VariablesParseState& vps) {
+    const auto fieldName = elem.fieldNameStringData();
+    uassert(40318,
+            str::stream() << "The $setWindowFields output field '" << fieldName
+                          << "' must be an object",
+            elem.type() == Object);
+
+    OutputField field(fieldName.toString());
+    boost::optional<BSONObj> windowSpec;
+    for (auto&& arg : elem.embeddedObject()) {
+        const auto argName = arg.fieldNameStringData();
+        if (argName == "window") {
+            uassert(40319,
+                    str::stream() << "The $setWindowFields 'window' of '" << fieldName
+                                  << "' must be an object",
+                    arg.type() == Object);
+            windowSpec = arg.embeddedObject();
+        } else {
+            uassert(40320,
+                    str::stream() << "The $setWindowFields output field '" << fieldName
+                                  << "' must specify exactly one accumulator",
+                    argName[0] == '$' && !field.expression);
+            uassert(40321,
+                    str::stream() << "The " << argName << " accumulator is a unary operator",
+                    arg.type() != Array);
+            field.factory = Accumulator::getFactory(argName);
+            field.expression = Expression::parseOperand(arg, vps);
+        }
+    }
+    uassert(40334,
+            str::stream() << "The $setWindowFields output field '" << fieldName
+                          << "' must specify exactly one accumulator",
+            field.expression);
+
+    // Without a window, the accumulator is evaluated over the whole partition.
+    if (windowSpec) {
+        const BSONElement bounds = windowSpec->firstElement();
+        const auto boundsType = bounds.fieldNameStringData();
+        uassert(40322,
+                str::stream() << "The $setWindowFields 'window' of '" << fieldName
+                              << "' must have exactly one of 'documents' or 'range'",
+                windowSpec->nFields() == 1 && (boundsType == "documents" || boundsType == "range"));
+        uassert(40323,
+                str::stream() << "The $setWindowFields window bounds must be an array of two "
+                                 "elements, but found "
+                              << bounds,
+                bounds.type() == Array && bounds.embeddedObject().nFields() == 2);
+
+        field.isRange = (boundsType == "range");
+        BSONObjIterator it(bounds.embeddedObject());
+        field.lower = parseWindowBound(it.next(), field.isRange);
+        field.upper = parseWindowBound(it.next(), field.isRange);
+        uassert(40324,
+                str::stream() << "The $setWindowFields lower bound must not be greater than the "
+                                 "upper bound, but found "
+                              << bounds,
+                !field.lower || !field.upper || *field.lower <= *field.upper);
+    }
+
+    field.accumulator = field.factory();
+    const bool removable = field.accumulator->enableRemoval();
+    uassert(40325,
+            str::stream() << "The " << field.accumulator->getOpName()
+                          << " accumulator cannot be used in a window with a lower bound",
+            !field.lower || removable);
+
+    _outputFields.push_back(std::move(field));
+}
+
+intrusive_ptr<DocumentSourceSetWindowFields> DocumentSourceSetWindowFields::createFromBsonInternal(
+    BSONElement elem,
+    const intrusive_ptr<ExpressionContext>& pExpCtx,
+    uint64_t maxMemoryUsageBytes) {
+    uassert(40326,
+            str::stream() << "The argument to $setWindowFields must be an object, but found type: "
+                          << typeName(elem.type()),
+            elem.type() == Object);
+
+    intrusive_ptr<DocumentSourceSetWindowFields> windowFields(
+        new DocumentSourceSetWindowFields(pExpCtx, maxMemoryUsageBytes));
+
+    VariablesIdGenerator idGenerator;
+    VariablesParseState vps(&idGenerator);
+    for (auto&& argument : elem.embeddedObject()) {
+        const auto argName = argument.fieldNameStringData();
+        if (argName == "partitionBy") {
+            windowFields->_partitionBy = Expression::parseOperand(argument, vps);
+        } else if (argName == "sortBy") {
+            uassert(40327,
+                    "The $setWindowFields 'sortBy' field must be an object",
+                    argument.type() == Object);
+            for (auto&& sortField : argument.embeddedObject()) {
+                uassert(40328,
+                        str::stream() << "The $setWindowFields sort order of '"
+                                      << sortField.fieldNameStringData()
+                                      << "' must be 1 or -1",
+                        sortField.isNumber() &&
+                            (sortField.numberInt() == 1 || sortField.numberInt() == -1));
+            }
+            windowFields->_sortBy = argument.embeddedObject().getOwned();
+        } else if (argName == "output") {
+            uassert(40329,
+                    "The $setWindowFields 'output' field must be an object",
+                    argument.type() == Object);
+            for (auto&& outputField : argument.embeddedObject()) {
+                windowFields->parseOutputField(outputField, vps);
+            }
+        } else {
+            uasserted(40330,
+                      str::stream() << "Unrecognized option to $setWindowFields: " << argName);
+        }
+    }
+
+    uassert(40331,
+            "$setWindowFields requires at least one 'output' field",
+            !windowFields->_outputFields.empty());
+
+    for (auto&& field : windowFields->_outputFields) {
+        if (field.isRange) {
+            uassert(40332,
+                    "$setWindowFields 'range' windows require 'sortBy' to have exactly one field",
+                    windowFields->_sortBy.nFields() == 1);
+            const BSONElement sortField = windowFields->_sortBy.firstElement();
+            windowFields->_rangeSortPath.emplace(sortField.fieldName());
+            windowFields->_rangeSortDirection = sortField.numberInt();
+            break;
+        }
+    }
+
+    windowFields->_variables.reset(new Variables(idGenerator.getIdCount()));
+    windowFields->injectExpressionContext(pExpCtx);
+    return windowFields;
+}
+
+vector<intrusive_ptr<DocumentSource>> DocumentSourceSetWindowFields::createFromBson(
+    BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    auto windowFields = createFromBsonInternal(elem, pExpCtx);
+
+    // Documents must arrive grouped by partition, and sorted by 'sortBy' within each partition.
+    BSONObjBuilder sortPattern;
+    if (windowFields->_partitionBy) {
+        DepsTracker deps;
+        windowFields->_partitionBy->addDependencies(&deps);
+        uassert(40333,
+                "$setWindowFields 'partitionBy' must be a field path such as \"$a\"",
+                dynamic_cast<ExpressionFieldPath*>(windowFields->_partitionBy.get()) &&
+                    !deps.needWholeDocument && deps.fields.size() == 1);
+        sortPattern.append(*deps.fields.begin(), 1);
+    }
+    sortPattern.appendElements(windowFields->_sortBy);
+
+    const BSONObj sortObj = sortPattern.obj();
+    if (sortObj.isEmpty()) {
+        return {windowFields};
+    }
+    return {DocumentSourceSort::create(pExpCtx, sortObj), windowFields};
+}
+}  // namespace mongo
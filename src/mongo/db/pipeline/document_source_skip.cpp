@@ -40,7 +40,7 @@ namespace mongo {
 using boost::intrusive_ptr;
 
 DocumentSourceSkip::DocumentSourceSkip(const intrusive_ptr<ExpressionContext>& pExpCtx)
-    : DocumentSource(pExpCtx), _skip(0), _needToSkip(true) {}
+    : DocumentSource(pExpCtx), _skip(0) {}
 
 REGISTER_DOCUMENT_SOURCE(skip, DocumentSourceSkip::createFromBson);
 
@@ -51,12 +51,11 @@ const char* DocumentSourceSkip::getSourceName() const {
 boost::optional<Document> DocumentSourceSkip::getNext() {
     pExpCtx->checkForInterrupt();
 
-    if (_needToSkip) {
-        _needToSkip = false;
-        for (long long i = 0; i < _skip; i++) {
-            if (!pSource->getNext())
-                return boost::none;
-        }
+    // Count the documents skipped so far, rather than skipping them all at once, so that this stage
+    // can carry on skipping if it is asked for more input after reaching EOF.
+    for (; _nSkipped < _skip; _nSkipped++) {
+        if (!pSource->getNext())
+            return boost::none;
     }
 
     return pSource->getNext();
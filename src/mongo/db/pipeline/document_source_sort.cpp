@@ -36,6 +36,7 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/query/collation/collation_index_key.h"
 
 namespace mongo {
 
@@ -50,6 +51,36 @@ DocumentSourceSort::DocumentSourceSort(const intrusive_ptr<ExpressionContext>& p
 
 REGISTER_DOCUMENT_SOURCE(sort, DocumentSourceSort::createFromBson);
 
+namespace {
+
+// The most fields a single Ordering can describe.
+const size_t kMaxFieldsPerKeyString = 32;
+
+/**
+ * Appends one component of a sort key with an empty field name, in a form whose KeyString
+ * encoding orders the same way the ValueComparator for 'collator' orders the component.
+ */
+void appendSortKeyComponent(const Value& component,
+                            const CollatorInterface* collator,
+                            BSONObjBuilder* out) {
+    if (component.missing()) {
+        // Missing values cannot be stored in BSON, but they compare equal to undefined.
+        out->appendUndefined("");
+        return;
+    }
+
+    if (!collator) {
+        component.addToBsonObj(out, "");
+        return;
+    }
+
+    BSONObjBuilder raw;
+    component.addToBsonObj(&raw, "");
+    CollationIndexKey::collationAwareIndexKeyAppend(raw.done().firstElement(), collator, out);
+}
+
+}  // namespace
+
 const char* DocumentSourceSort::getSourceName() const {
     return "$sort";
 }
@@ -257,17 +288,76 @@ void DocumentSourceSort::populate() {
 
 void DocumentSourceSort::loadDocument(const Document& doc) {
     invariant(!populated);
+    if (!_keyStringSorter) {
+        makeKeyOrderings();
+        _keyStringSorter.reset(KeyStringSorter::make(makeSortOptions(), KeyStringComparator()));
+    }
+
+    Value key = extractKey(doc);
     if (!_sorter) {
-        _sorter.reset(MySorter::make(makeSortOptions(), Comparator(*this)));
+        if (boost::optional<SortableKeyString> encoded = encodeKey(key)) {
+            _keyStringSorter->add(*encoded, doc);
+            return;
+        }
+        switchToValueSorter();
     }
-    _sorter->add(extractKey(doc), doc);
+    _sorter->add(key, doc);
+}
+
+void DocumentSourceSort::switchToValueSorter() {
+    // The documents already in '_keyStringSorter' keep their memory only if none were spilled,
+    // since done() spills the rest of them otherwise.
+    const size_t held = _keyStringSorter->numFiles() ? 0 : _keyStringSorter->memUsed();
+    _keyStringSorted.reset(_keyStringSorter->done());
+    _keyStringSorter.reset();
+
+    SortOptions opts = makeSortOptions();
+    opts.maxMemoryUsageBytes -= std::min(held, opts.maxMemoryUsageBytes);
+    _sorter.reset(MySorter::make(opts, Comparator(*this)));
 }
 
+class DocumentSourceSort::IteratorFromKeyStringSorter : public MySorter::Iterator {
+public:
+    /**
+     * The Value keys are only recomputed if 'needKeys' is true, which is when this output has to be
+     * merged with the output of a MySorter.
+     */
+    IteratorFromKeyStringSorter(const DocumentSourceSort* sorter,
+                                KeyStringSorter::Iterator* input,
+                                bool needKeys)
+        : _sorter(sorter), _input(input), _needKeys(needKeys) {}
+
+    bool more() {
+        return _input->more();
+    }
+    Data next() {
+        Document doc = _input->next().second;
+        Value key = _needKeys ? _sorter->extractKey(doc) : Value();
+        return make_pair(std::move(key), std::move(doc));
+    }
+
+private:
+    const DocumentSourceSort* _sorter;
+    std::unique_ptr<KeyStringSorter::Iterator> _input;
+    const bool _needKeys;
+};
+
 void DocumentSourceSort::loadingDone() {
+    if (!_keyStringSorter && !_sorter) {
+        makeKeyOrderings();
+        _keyStringSorter.reset(KeyStringSorter::make(makeSortOptions(), KeyStringComparator()));
+    }
+
     if (!_sorter) {
-        _sorter.reset(MySorter::make(makeSortOptions(), Comparator(*this)));
+        _output.reset(new IteratorFromKeyStringSorter(this, _keyStringSorter->done(), false));
+    } else {
+        vector<std::shared_ptr<MySorter::Iterator>> iterators;
+        iterators.push_back(
+            std::make_shared<IteratorFromKeyStringSorter>(this, _keyStringSorted.release(), true));
+        iterators.push_back(std::shared_ptr<MySorter::Iterator>(_sorter->done()));
+        _output.reset(MySorter::Iterator::merge(iterators, makeSortOptions(), Comparator(*this)));
     }
-    _output.reset(_sorter->done());
+    _keyStringSorter.reset();
     _sorter.reset();
     populated = true;
 }
@@ -314,6 +404,50 @@ Value DocumentSourceSort::extractKey(const Document& d) const {
     return Value(std::move(keys));
 }
 
+void DocumentSourceSort::makeKeyOrderings() {
+    _keyOrderings.clear();
+    for (size_t start = 0; start < vAscending.size(); start += kMaxFieldsPerKeyString) {
+        BSONObjBuilder pattern;
+        const size_t end = std::min(vAscending.size(), start + kMaxFieldsPerKeyString);
+        for (size_t i = start; i < end; ++i) {
+            pattern.append("", vAscending[i] ? 1 : -1);
+        }
+        _keyOrderings.push_back(Ordering::make(pattern.done()));
+    }
+}
+
+boost::optional<SortableKeyString> DocumentSourceSort::encodeKey(const Value& key) const {
+    const CollatorInterface* collator = pExpCtx->getCollator();
+    const size_t n = vSortKey.size();
+
+    KeyString ks(SortableKeyString::kVersion);
+    BufBuilder concatenated;
+    for (size_t chunk = 0; chunk < _keyOrderings.size(); ++chunk) {
+        BSONObjBuilder components;
+        const size_t start = chunk * kMaxFieldsPerKeyString;
+        const size_t end = std::min(n, start + kMaxFieldsPerKeyString);
+        for (size_t i = start; i < end; ++i) {
+            appendSortKeyComponent(n == 1 ? key : key[i], collator, &components);
+        }
+
+        // KeyString's TypeBits only have room for keys that fit in an index entry, even though the
+        // TypeBits are thrown away here.
+        BSONObj obj = components.done();
+        if (obj.objsize() >= static_cast<int>(KeyString::TypeBits::kMaxKeyBytes)) {
+            return boost::none;
+        }
+
+        // Each KeyString ends with a terminator byte, so KeyStrings of equal prefixes stay aligned
+        // and their concatenation still compares field by field.
+        ks.resetToKey(obj, _keyOrderings[chunk]);
+        if (_keyOrderings.size() == 1) {
+            return SortableKeyString(ks.getBuffer(), ks.getSize());
+        }
+        concatenated.appendBuf(ks.getBuffer(), ks.getSize());
+    }
+    return SortableKeyString(concatenated.buf(), concatenated.len());
+}
+
 int DocumentSourceSort::compare(const Value& lhs, const Value& rhs) const {
     /*
       populate() already checked that there is a non-empty sort key,
@@ -54,6 +54,12 @@ boost::intrusive_ptr<DocumentSourceTeeConsumer> DocumentSourceTeeConsumer::creat
 boost::optional<Document> DocumentSourceTeeConsumer::getNext() {
     pExpCtx->checkForInterrupt();
 
+    if (_pushed) {
+        boost::optional<Document> next;
+        std::swap(next, _pushedDocument);
+        return next;
+    }
+
     if (!_initialized) {
         _bufferSource->populate();
         _initialized = true;
@@ -67,6 +73,11 @@ boost::optional<Document> DocumentSourceTeeConsumer::getNext() {
     return {*_iterator++};
 }
 
+void DocumentSourceTeeConsumer::push(const Document& input) {
+    _pushed = true;
+    _pushedDocument = input;
+}
+
 void DocumentSourceTeeConsumer::dispose() {
     // Release our reference to the buffer. We shouldn't call dispose() on the buffer, since there
     // might be other consumers that need to use it.
@@ -55,6 +55,14 @@ public:
     void dispose() final;
     boost::optional<Document> getNext() final;
 
+    /**
+     * Feeds 'input' directly to this consumer, bypassing the buffer. Once this has been called,
+     * getNext() returns the most recently pushed document if it has not yet been returned, and
+     * boost::none otherwise, so that the stages after this one can be driven one input document
+     * at a time.
+     */
+    void push(const Document& input);
+
     /**
      * Returns SEE_NEXT, since it requires no fields, and changes nothing about the documents.
      */
@@ -71,5 +79,9 @@ private:
     bool _initialized = false;
     boost::intrusive_ptr<TeeBuffer> _bufferSource;
     TeeBuffer::const_iterator _iterator;
+
+    // Set once push() has been called, after which '_pushedDocument' is the only input.
+    bool _pushed = false;
+    boost::optional<Document> _pushedDocument;
 };
 }  // namespace mongo
@@ -37,6 +37,7 @@
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/pipeline/value_comparator.h"
+#include "mongo/db/query/collation/collator_interface_mock.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_noop.h"
 #include "mongo/db/storage/storage_options.h"
@@ -1353,6 +1354,8 @@ public:
         // Run standard base tests.
         CheckResultsBase::run();
     }
+
+private:
     std::deque<Document> inputData() {
         return {Document()};
     }
@@ -2567,6 +2570,81 @@ public:
     }
 };
 
+/** Keys too large to encode as KeyStrings are still ordered among the encoded keys. */
+class LargeKeyValue : public CheckResultsBase {
+    std::deque<Document> inputData() {
+        return {DOC("_id" << 0 << "a"
+                          << "c"),
+                DOC("_id" << 1 << "a" << largeString()),
+                DOC("_id" << 2 << "a"
+                          << "a")};
+    }
+    BSONObj expectedResultSet() {
+        return BSON_ARRAY(BSON("_id" << 2 << "a"
+                                     << "a")
+                          << BSON("_id" << 1 << "a" << largeString())
+                          << BSON("_id" << 0 << "a"
+                                        << "c"));
+    }
+    string largeString() {
+        return string(2000, 'b');
+    }
+};
+
+/** Sort patterns with more fields than a single Ordering can describe. */
+class ManySortFields : public CheckResultsBase {
+    static const int kNumFields = 40;
+
+    string fieldName(int i) {
+        return str::stream() << "f" << i;
+    }
+    Document makeDoc(int id, int field, int value) {
+        MutableDocument doc;
+        doc["_id"] = Value(id);
+        for (int i = 0; i < kNumFields; ++i) {
+            doc[fieldName(i)] = Value(i == field ? value : 0);
+        }
+        return doc.freeze();
+    }
+    std::deque<Document> inputData() {
+        return {makeDoc(0, 35, 1), makeDoc(1, 39, 1), makeDoc(2, 39, 2), makeDoc(3, 35, -1)};
+    }
+    BSONObj expectedResultSet() {
+        return BSON_ARRAY(makeDoc(3, 35, -1) << makeDoc(2, 39, 2) << makeDoc(1, 39, 1)
+                                             << makeDoc(0, 35, 1));
+    }
+    BSONObj sortSpec() {
+        BSONObjBuilder spec;
+        for (int i = 0; i < kNumFields; ++i) {
+            spec.append(fieldName(i), i == kNumFields - 1 ? -1 : 1);
+        }
+        return spec.obj();
+    }
+};
+
+/** The collation applies to strings inside encoded keys, including nested ones. */
+class CollationIsApplied : public CheckResultsBase {
+public:
+    void run() {
+        ctx()->setCollator(stdx::make_unique<CollatorInterfaceMock>(
+            CollatorInterfaceMock::MockType::kReverseString));
+        CheckResultsBase::run();
+    }
+
+private:
+    std::deque<Document> inputData() {
+        return {DOC("_id" << 0 << "a" << DOC("b"
+                                             << "ab")),
+                DOC("_id" << 1 << "a" << DOC("b"
+                                             << "ba")),
+                DOC("_id" << 2 << "a" << DOC("b"
+                                             << "ca"))};
+    }
+    string expectedResultSetString() {
+        return "[{_id:1,a:{b:'ba'}},{_id:2,a:{b:'ca'}},{_id:0,a:{b:'ab'}}]";
+    }
+};
+
 class OutputSort : public Base {
 public:
     void run() {
@@ -4751,8 +4829,353 @@ TEST_F(BucketAutoTests, ShouldFailOnNegativeNumbersWhenGranularitySpecified) {
     auto docs = {Document{{"x", 0}}, Document{{"x", -1}}, Document{{"x", 1}}, Document{{"x", 2}}};
     ASSERT_THROWS_CODE(getResults(bucketAutoSpec, docs), UserException, 40260);
 }
+
+//
+// Approximate mode.
+//
+
+TEST_F(BucketAutoTests, SerializesApproximateFieldIfSpecified) {
+    auto spec = fromjson("{$bucketAuto : {groupBy : '$x', buckets : 2, approximate : true}}");
+    auto expected = fromjson(
+        "{groupBy : '$x', buckets : 2, approximate : true, output : {count : {$sum : {$const : "
+        "1}}}}");
+    testSerialize(spec, expected);
+}
+
+TEST_F(BucketAutoTests, FailsWithNonBoolApproximate) {
+    auto spec = fromjson("{$bucketAuto : {groupBy : '$x', buckets : 2, approximate : 1}}");
+    ASSERT_THROWS_CODE(createBucketAuto(spec), UserException, 40356);
+}
+
+TEST_F(BucketAutoTests, ApproximateMatchesExactWhenEveryValueIsSampled) {
+    auto exactSpec = fromjson("{$bucketAuto : {groupBy : '$x', buckets : 3}}");
+    auto approximateSpec =
+        fromjson("{$bucketAuto : {groupBy : '$x', buckets : 3, approximate : true}}");
+    auto exactGranularitySpec =
+        fromjson("{$bucketAuto : {groupBy : '$x', buckets : 3, granularity : 'R5'}}");
+    auto approximateGranularitySpec = fromjson(
+        "{$bucketAuto : {groupBy : '$x', buckets : 3, granularity : 'R5', approximate : true}}");
+
+    // Values are 1 through 'numValues' in a scrambled order, with 7 repeated for odd sizes. The
+    // sizes cover buckets rounded both up and down from the number of values per bucket.
+    for (int numValues : {7, 8, 10, 11, 20, 21}) {
+        deque<Document> docs;
+        for (int i = 0; i < numValues; i++) {
+            docs.push_back(Document{{"x", (i * 13) % numValues + 1}});
+        }
+        if (numValues % 2) {
+            docs.back() = Document{{"x", 7}};
+        }
+
+        auto exactResults = getResults(exactSpec, docs);
+        auto approximateResults = getResults(approximateSpec, docs);
+        ASSERT_EQUALS(approximateResults.size(), exactResults.size());
+        for (size_t i = 0; i < exactResults.size(); i++) {
+            ASSERT_DOCUMENT_EQ(approximateResults[i], exactResults[i]);
+        }
+
+        exactResults = getResults(exactGranularitySpec, docs);
+        approximateResults = getResults(approximateGranularitySpec, docs);
+        ASSERT_EQUALS(approximateResults.size(), exactResults.size());
+        for (size_t i = 0; i < exactResults.size(); i++) {
+            ASSERT_DOCUMENT_EQ(approximateResults[i], exactResults[i]);
+        }
+    }
+}
+
+TEST_F(BucketAutoTests, ApproximateRoundsBoundariesWithGranularitySpecified) {
+    auto bucketAutoSpec = fromjson(
+        "{$bucketAuto : {groupBy : '$x', buckets : 2, granularity : 'R5', approximate : true}}");
+
+    // Values are 1, 15, 24, 30, 50
+    auto docs = {Document{{"x", 24}},
+                 Document{{"x", 15}},
+                 Document{{"x", 30}},
+                 Document{{"x", 50}},
+                 Document{{"x", 1}}};
+    auto results = getResults(bucketAutoSpec, docs);
+
+    ASSERT_EQUALS(results.size(), 2UL);
+    ASSERT_DOCUMENT_EQ(results[0], Document(fromjson("{_id : {min : 0.63, max : 25}, count : 3}")));
+    ASSERT_DOCUMENT_EQ(results[1], Document(fromjson("{_id : {min : 25, max : 63}, count : 2}")));
+}
+
+TEST_F(BucketAutoTests, ApproximateKeepsEqualValuesInOneBucket) {
+    auto bucketAutoSpec =
+        fromjson("{$bucketAuto : {groupBy : '$x', buckets : 4, approximate : true}}");
+
+    // Values are 1, 2, 2, 2, 2, 2, 2, 3
+    deque<Document> docs = {Document{{"x", 3}}, Document{{"x", 1}}};
+    for (int i = 0; i < 6; i++) {
+        docs.push_back(Document{{"x", 2}});
+    }
+    auto results = getResults(bucketAutoSpec, docs);
+
+    // As in the exact mode, the first bucket absorbs every 2 after its second value.
+    ASSERT_EQUALS(results.size(), 2UL);
+    ASSERT_DOCUMENT_EQ(results[0], Document(fromjson("{_id : {min : 1, max : 3}, count : 7}")));
+    ASSERT_DOCUMENT_EQ(results[1], Document(fromjson("{_id : {min : 3, max : 3}, count : 1}")));
+}
+
+TEST_F(BucketAutoTests, ApproximateBucketsAreBalancedWhenInputIsLargerThanSample) {
+    const int numBuckets = 4;
+    const int numDocs = 100 * 1000;
+    auto bucketAutoSpec =
+        BSON("$bucketAuto" << BSON("groupBy"
+                                   << "$x"
+                                   << "buckets"
+                                   << numBuckets
+                                   << "approximate"
+                                   << true));
+
+    deque<Document> docs;
+    for (int i = 0; i < numDocs; i++) {
+        docs.push_back(Document{{"x", (i * 7919) % numDocs}});
+    }
+    auto results = getResults(bucketAutoSpec, docs);
+
+    ASSERT_EQUALS(results.size(), size_t(numBuckets));
+    ASSERT_VALUE_EQ(results.front()["_id"]["min"], Value(0));
+    ASSERT_VALUE_EQ(results.back()["_id"]["max"], Value(numDocs - 1));
+    long long total = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (i > 0) {
+            ASSERT_VALUE_EQ(results[i]["_id"]["min"], results[i - 1]["_id"]["max"]);
+        }
+        const long long count = results[i]["count"].coerceToLong();
+        ASSERT_GT(count, numDocs / numBuckets * 8 / 10);
+        ASSERT_LT(count, numDocs / numBuckets * 12 / 10);
+        total += count;
+    }
+    ASSERT_EQUALS(total, numDocs);
+}
+
+TEST_F(BucketAutoTests, ApproximateFailsWhenBufferingTooManyDocumentsWithoutDiskUse) {
+    auto largeStr = std::string(1000, 'b');
+    auto mock =
+        DocumentSourceMock::create({Document{{"a", largeStr}}, Document{{"a", largeStr}}});
+
+    const uint64_t maxMemoryUsageBytes = 1000;
+    auto spec = fromjson("{$bucketAuto : {groupBy : '$a', buckets : 1, approximate : true}}");
+    auto bucketAuto = DocumentSourceBucketAuto::createFromBsonWithMaxMemoryUsage(
+        spec.firstElement(), ctx(), maxMemoryUsageBytes);
+    bucketAuto->setSource(mock.get());
+    ASSERT_THROWS_CODE(bucketAuto->getNext(), UserException, 40355);
+}
+
+TEST_F(BucketAutoTests, ApproximateSpillsBufferedDocumentsWhenDiskUseIsAllowed) {
+    TempDir tempDir("BucketAutoTestsApproximateSpill");
+    ctx()->extSortAllowed = true;
+    ctx()->tempDir = tempDir.path();
+
+    const int numDocs = 1000;
+    deque<Document> docs;
+    for (int i = 0; i < numDocs; i++) {
+        docs.push_back(Document{{"x", numDocs - 1 - i}, {"pad", std::string(100, 'a')}});
+    }
+    auto mock = DocumentSourceMock::create(docs);
+
+    // The buffer holds a few dozen documents, so the input is spilled many times over.
+    const uint64_t maxMemoryUsageBytes = 10 * 1000;
+    auto spec = fromjson(
+        "{$bucketAuto : {groupBy : '$x', buckets : 1, approximate : true, output : {count : {$sum "
+        ": 1}, total : {$sum : '$x'}}}}");
+    auto bucketAuto = DocumentSourceBucketAuto::createFromBsonWithMaxMemoryUsage(
+        spec.firstElement(), ctx(), maxMemoryUsageBytes);
+    bucketAuto->setSource(mock.get());
+
+    auto next = bucketAuto->getNext();
+    ASSERT_TRUE(next);
+    ASSERT_DOCUMENT_EQ(*next,
+                       Document(fromjson(
+                           "{_id : {min : 0, max : 999}, count : 1000, total : 499500}")));
+    ASSERT_FALSE(bucketAuto->getNext());
+}
 }  // namespace DocumentSourceBucketAuto
 
+namespace DocumentSourceSetWindowFields {
+using mongo::DocumentSourceSetWindowFields;
+using mongo::DocumentSourceMock;
+using std::vector;
+using std::deque;
+using boost::intrusive_ptr;
+
+class SetWindowFieldsTests : public Mock::Base, public unittest::Test {
+public:
+    intrusive_ptr<DocumentSourceSetWindowFields> createSetWindowFields(
+        BSONObj spec,
+        uint64_t maxMemoryUsageBytes = DocumentSourceSetWindowFields::kMaxMemoryUsageBytes) {
+        return DocumentSourceSetWindowFields::createFromBsonInternal(
+            spec.firstElement(), ctx(), maxMemoryUsageBytes);
+    }
+
+    vector<Document> getResults(BSONObj spec, deque<Document> docs) {
+        auto windowFields = createSetWindowFields(spec);
+        auto source = DocumentSourceMock::create(docs);
+        windowFields->setSource(source.get());
+
+        vector<Document> results;
+        while (boost::optional<Document> next = windowFields->getNext()) {
+            results.push_back(*next);
+        }
+        return results;
+    }
+};
+
+TEST_F(SetWindowFieldsTests, ReturnsNothingWhenSourceIsEmpty) {
+    auto spec = fromjson("{$_internalSetWindowFields: {output: {total: {$sum: '$x'}}}}");
+    ASSERT_EQUALS(getResults(spec, {}).size(), 0UL);
+}
+
+TEST_F(SetWindowFieldsTests, DefaultWindowCoversWholePartition) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {partitionBy: '$p', output: {total: {$sum: '$x'}}}}");
+    auto results = getResults(spec,
+                              {Document{{"p", 1}, {"x", 1}},
+                               Document{{"p", 1}, {"x", 2}},
+                               Document{{"p", 2}, {"x", 5}}});
+    ASSERT_EQUALS(results.size(), 3UL);
+    ASSERT_DOCUMENT_EQ(results[0], (Document{{"p", 1}, {"x", 1}, {"total", 3}}));
+    ASSERT_DOCUMENT_EQ(results[1], (Document{{"p", 1}, {"x", 2}, {"total", 3}}));
+    ASSERT_DOCUMENT_EQ(results[2], (Document{{"p", 2}, {"x", 5}, {"total", 5}}));
+}
+
+TEST_F(SetWindowFieldsTests, ComputesRunningTotalWithDocumentsWindow) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {sortBy: {x: 1}, output: {total: {$sum: '$x', window: "
+        "{documents: ['unbounded', 'current']}}}}}");
+    auto results = getResults(spec, {Document{{"x", 1}}, Document{{"x", 2}}, Document{{"x", 3}}});
+    ASSERT_EQUALS(results.size(), 3UL);
+    ASSERT_VALUE_EQ(results[0]["total"], Value(1));
+    ASSERT_VALUE_EQ(results[1]["total"], Value(3));
+    ASSERT_VALUE_EQ(results[2]["total"], Value(6));
+}
+
+TEST_F(SetWindowFieldsTests, ComputesSlidingAverageAndMaxWithDocumentsWindow) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {sortBy: {t: 1}, output: {"
+        "avg: {$avg: '$x', window: {documents: [-1, 1]}}, "
+        "max: {$max: '$x', window: {documents: [-1, 0]}}}}}");
+    auto results = getResults(spec,
+                              {Document{{"t", 1}, {"x", 4}},
+                               Document{{"t", 2}, {"x", 2}},
+                               Document{{"t", 3}, {"x", 6}},
+                               Document{{"t", 4}, {"x", 1}}});
+    ASSERT_EQUALS(results.size(), 4UL);
+    ASSERT_VALUE_EQ(results[0]["avg"], Value(3.0));
+    ASSERT_VALUE_EQ(results[1]["avg"], Value(4.0));
+    ASSERT_VALUE_EQ(results[2]["avg"], Value(3.0));
+    ASSERT_VALUE_EQ(results[3]["avg"], Value(3.5));
+    ASSERT_VALUE_EQ(results[0]["max"], Value(4));
+    ASSERT_VALUE_EQ(results[1]["max"], Value(4));
+    ASSERT_VALUE_EQ(results[2]["max"], Value(6));
+    ASSERT_VALUE_EQ(results[3]["max"], Value(6));
+}
+
+TEST_F(SetWindowFieldsTests, ComputesRangeWindowOverSortKey) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {sortBy: {t: 1}, output: {"
+        "total: {$sum: '$x', window: {range: [-10, 0]}}}}}");
+    auto results = getResults(spec,
+                              {Document{{"t", 0}, {"x", 1}},
+                               Document{{"t", 5}, {"x", 2}},
+                               Document{{"t", 5}, {"x", 4}},
+                               Document{{"t", 20}, {"x", 8}}});
+    ASSERT_EQUALS(results.size(), 4UL);
+    ASSERT_VALUE_EQ(results[0]["total"], Value(1));
+    ASSERT_VALUE_EQ(results[1]["total"], Value(7));
+    ASSERT_VALUE_EQ(results[2]["total"], Value(7));
+    ASSERT_VALUE_EQ(results[3]["total"], Value(8));
+}
+
+TEST_F(SetWindowFieldsTests, ResetsWindowsAtPartitionBoundaries) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {partitionBy: '$p', sortBy: {x: 1}, output: {"
+        "min: {$min: '$x', window: {documents: [-1, 'current']}}}}}");
+    auto results = getResults(spec,
+                              {Document{{"p", 1}, {"x", 3}},
+                               Document{{"p", 1}, {"x", 7}},
+                               Document{{"p", 2}, {"x", 9}}});
+    ASSERT_EQUALS(results.size(), 3UL);
+    ASSERT_VALUE_EQ(results[0]["min"], Value(3));
+    ASSERT_VALUE_EQ(results[1]["min"], Value(3));
+    ASSERT_VALUE_EQ(results[2]["min"], Value(9));
+}
+
+TEST_F(SetWindowFieldsTests, ShouldBeAbleToReParseSerializedStage) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {partitionBy: '$p', sortBy: {t: -1}, output: {"
+        "avg: {$avg: '$x', window: {range: [-1.5, 2]}}, "
+        "total: {$sum: '$x', window: {documents: ['unbounded', 0]}}}}}");
+    auto windowFields = createSetWindowFields(spec);
+
+    vector<Value> serialization;
+    windowFields->serializeToArray(serialization);
+    ASSERT_EQUALS(serialization.size(), 1UL);
+    ASSERT_EQUALS(serialization[0].getType(), BSONType::Object);
+
+    auto serializedBson = serialization[0].getDocument().toBson();
+    auto roundTripped = createSetWindowFields(serializedBson);
+
+    vector<Value> newSerialization;
+    roundTripped->serializeToArray(newSerialization);
+    ASSERT_EQUALS(newSerialization.size(), 1UL);
+    ASSERT_VALUE_EQ(newSerialization[0], serialization[0]);
+}
+
+TEST_F(SetWindowFieldsTests, AliasPrependsSortOnPartitionAndSortKeys) {
+    auto spec = fromjson(
+        "{$setWindowFields: {partitionBy: '$p', sortBy: {t: 1}, output: {total: {$sum: '$x'}}}}");
+    auto stages = DocumentSourceSetWindowFields::createFromBson(spec.firstElement(), ctx());
+    ASSERT_EQUALS(stages.size(), 2UL);
+    ASSERT_EQUALS(std::string(stages[0]->getSourceName()), "$sort");
+    ASSERT_EQUALS(std::string(stages[1]->getSourceName()), "$_internalSetWindowFields");
+}
+
+TEST_F(SetWindowFieldsTests, FailsWithNonFieldPathPartitionBy) {
+    auto spec = fromjson(
+        "{$setWindowFields: {partitionBy: {$add: ['$a', 1]}, output: {total: {$sum: '$x'}}}}");
+    ASSERT_THROWS_CODE(DocumentSourceSetWindowFields::createFromBson(spec.firstElement(), ctx()),
+                       UserException,
+                       40333);
+}
+
+TEST_F(SetWindowFieldsTests, FailsWithLowerBoundOnNonRemovableAccumulator) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {output: {all: {$push: '$x', window: {documents: [-1, "
+        "0]}}}}}");
+    ASSERT_THROWS_CODE(createSetWindowFields(spec), UserException, 40325);
+}
+
+TEST_F(SetWindowFieldsTests, FailsWithInvalidBounds) {
+    auto spec = fromjson(
+        "{$_internalSetWindowFields: {output: {s: {$sum: '$x', window: {documents: [1, -1]}}}}}");
+    ASSERT_THROWS_CODE(createSetWindowFields(spec), UserException, 40324);
+
+    spec = fromjson(
+        "{$_internalSetWindowFields: {output: {s: {$sum: '$x', window: {documents: [-0.5, 0]}}}}}");
+    ASSERT_THROWS_CODE(createSetWindowFields(spec), UserException, 40314);
+
+    spec = fromjson(
+        "{$_internalSetWindowFields: {output: {s: {$sum: '$x', window: {documents: ['x', 0]}}}}}");
+    ASSERT_THROWS_CODE(createSetWindowFields(spec), UserException, 40315);
+
+    spec = fromjson(
+        "{$_internalSetWindowFields: {output: {s: {$sum: '$x', window: {range: [-1, 0]}}}}}");
+    ASSERT_THROWS_CODE(createSetWindowFields(spec), UserException, 40332);
+}
+
+TEST_F(SetWindowFieldsTests, FailsWhenBufferingTooManyDocuments) {
+    auto spec = fromjson("{$_internalSetWindowFields: {output: {n: {$sum: 1}}}}");
+    auto windowFields = createSetWindowFields(spec, 1000);
+
+    auto largeStr = std::string(1000, 'b');
+    auto mock = DocumentSourceMock::create({Document{{"a", largeStr}}, Document{{"a", largeStr}}});
+    windowFields->setSource(mock.get());
+    ASSERT_THROWS_CODE(windowFields->getNext(), UserException, 40317);
+}
+}  // namespace DocumentSourceSetWindowFields
+
 namespace DocumentSourceAddFields {
 
 using mongo::DocumentSourceMock;
@@ -4963,6 +5386,9 @@ public:
         add<DocumentSourceSort::RandMeta>();
         add<DocumentSourceSort::MissingObjectWithinArray>();
         add<DocumentSourceSort::ExtractArrayValues>();
+        add<DocumentSourceSort::LargeKeyValue>();
+        add<DocumentSourceSort::ManySortFields>();
+        add<DocumentSourceSort::CollationIsApplied>();
         add<DocumentSourceSort::Dependencies>();
         add<DocumentSourceSort::OutputSort>();
 
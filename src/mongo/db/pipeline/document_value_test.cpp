@@ -104,6 +104,134 @@ TEST(DocumentConstruction, FromInitializerList) {
     ASSERT_EQUALS("q", getNthField(document, 1).second.getString());
 }
 
+TEST(DocumentConstruction, LazyFromBsonShouldMatchEagerConversion) {
+    BSONObj bson = BSON("a" << 1 << "b"
+                            << "q"
+                            << "c"
+                            << BSON("d" << 1)
+                            << "e"
+                            << BSON_ARRAY(1 << 2)
+                            << "f"
+                            << 2.5
+                            << "g"
+                            << BSONNULL);
+    Document lazy = Document::lazyFromBsonWithMetaData(bson);
+
+    // Look fields up out of order, so that some are found by decoding further into the BSON and
+    // others are found among the fields decoded already.
+    ASSERT_VALUE_EQ(lazy["e"], Value(BSON_ARRAY(1 << 2)));
+    ASSERT_VALUE_EQ(lazy["a"], Value(1));
+    ASSERT_TRUE(lazy["missing"].missing());
+    ASSERT_VALUE_EQ(lazy["c"], Value(mongo::Document{{"d", 1}}));
+    ASSERT_TRUE(lazy.positionOf("f").found());
+
+    ASSERT_EQUALS(6U, lazy.size());
+    ASSERT_DOCUMENT_EQ(lazy, fromBson(bson));
+    ASSERT_EQUALS("g", getNthField(lazy, 5).first.toString());
+
+    // An unmodified Document converts back to the BSON it was created from, without copying it.
+    ASSERT_EQUALS(lazy.toBson().objdata(), bson.objdata());
+}
+
+TEST(DocumentConstruction, LazyFromBsonShouldBeFullyDecodedWhenModified) {
+    BSONObj bson = BSON("a" << 1 << "b" << 2 << "c" << 3 << "d" << 4 << "e" << 5);
+    Document lazy = Document::lazyFromBsonWithMetaData(bson);
+    ASSERT_VALUE_EQ(lazy["b"], Value(2));
+
+    // Modifying a copy should not affect the original.
+    MutableDocument shared(lazy);
+    shared["b"] = Value(20);
+    shared.addField("f", Value(6));
+    ASSERT_BSONOBJ_EQ(shared.freeze().toBson(),
+                      BSON("a" << 1 << "b" << 20 << "c" << 3 << "d" << 4 << "e" << 5 << "f" << 6));
+    ASSERT_BSONOBJ_EQ(lazy.toBson(), bson);
+
+    // Modifying the only reference to the storage should decode the remaining fields in place.
+    MutableDocument unshared(std::move(lazy));
+    unshared.addField("f", Value(6));
+    unshared.remove("c");
+    ASSERT_BSONOBJ_EQ(unshared.freeze().toBson(),
+                      BSON("a" << 1 << "b" << 2 << "d" << 4 << "e" << 5 << "f" << 6));
+}
+
+TEST(DocumentConstruction, LazyFromBsonShouldParseMetadata) {
+    BSONObj bson = BSON("a" << 1 << Document::metaFieldTextScore << 2.0 << "b" << 3);
+    Document lazy = Document::lazyFromBsonWithMetaData(bson);
+
+    ASSERT_TRUE(lazy.hasTextScore());
+    ASSERT_EQUALS(2.0, lazy.getTextScore());
+    ASSERT_FALSE(lazy.hasRandMetaField());
+    ASSERT_TRUE(lazy[Document::metaFieldTextScore].missing());
+    ASSERT_BSONOBJ_EQ(lazy.toBson(), BSON("a" << 1 << "b" << 3));
+    ASSERT_DOCUMENT_EQ(Document::fromBsonWithMetaData(lazy.toBsonWithMetaData()), lazy);
+}
+
+Document makeTransientDocument(int i) {
+    MutableDocument md;
+    md.addField("_id", mongo::Value(i));
+    md.addField("sub", mongo::Value(Document{{"x", i}, {"y", "str"_sd}}));
+    md.addField("arr", mongo::Value(vector<mongo::Value>{mongo::Value(i), mongo::Value(i + 1)}));
+    return md.freeze();
+}
+
+TEST(DocumentArena, ShouldReuseMemoryOfTransientDocuments) {
+    // Count the blocks requested for one document; without an arena each is a heap allocation.
+    long long allocationsPerDocument;
+    {
+        DocumentArena arena;
+        makeTransientDocument(0);
+        allocationsPerDocument = arena.heapAllocations() + arena.reusedAllocations();
+    }
+    ASSERT_GT(allocationsPerDocument, 0);
+
+    // With an arena in scope, documents which are freed before the next one is built only need
+    // to allocate from the heap for the first one.
+    const int kNumDocuments = 1000;
+    DocumentArena arena;
+    for (int i = 0; i < kNumDocuments; ++i) {
+        ASSERT_EQ(i, makeTransientDocument(i)["_id"].getInt());
+    }
+    ASSERT_EQ(kNumDocuments * allocationsPerDocument,
+              arena.heapAllocations() + arena.reusedAllocations());
+    ASSERT_LTE(arena.heapAllocations(), allocationsPerDocument);
+}
+
+TEST(DocumentArena, DocumentsShouldOutliveTheArena) {
+    Document escaped;
+    {
+        DocumentArena arena;
+        makeTransientDocument(0);
+        escaped = makeTransientDocument(1);
+    }
+    ASSERT_DOCUMENT_EQ(escaped, makeTransientDocument(1));
+
+    // Freeing the escaped document inside another arena hands its memory to that arena.
+    DocumentArena arena;
+    escaped = Document();
+    makeTransientDocument(2);
+    ASSERT_GT(arena.reusedAllocations(), 0);
+}
+
+TEST(DocumentArena, NestedArenaShouldBeUsedUntilItGoesOutOfScope) {
+    DocumentArena outer;
+    makeTransientDocument(0);
+    const long long outerHeapAllocations = outer.heapAllocations();
+    const long long outerReusedAllocations = outer.reusedAllocations();
+    {
+        // The inner arena starts out empty, even though the outer one has memory to reuse.
+        DocumentArena inner;
+        makeTransientDocument(1);
+        ASSERT_EQ(outerHeapAllocations, inner.heapAllocations());
+        ASSERT_EQ(outerHeapAllocations, outer.heapAllocations());
+        ASSERT_EQ(outerReusedAllocations, outer.reusedAllocations());
+    }
+
+    // Once the inner arena is gone, the outer one serves the same allocations from its cache.
+    makeTransientDocument(2);
+    ASSERT_EQ(outerHeapAllocations, outer.heapAllocations());
+    ASSERT_GT(outer.reusedAllocations(), outerReusedAllocations);
+}
+
 /** Add Document fields. */
 class AddField {
 public:
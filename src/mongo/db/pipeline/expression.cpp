@@ -39,9 +39,11 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/platform/bits.h"
 #include "mongo/platform/decimal128.h"
+#include "mongo/platform/overflow_arithmetic.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/string_map.h"
 #include "mongo/util/summation.h"
@@ -260,6 +262,10 @@ intrusive_ptr<Expression> Expression::parseOperand(BSONElement exprElement,
     }
 }
 
+size_t Expression::compile(ExpressionCompiler* compiler) const {
+    return compiler->fallback(this);
+}
+
 namespace {
 /**
  * UTF-8 multi-byte code points consist of one leading byte of the form 11xxxxxx, and potentially
@@ -324,7 +330,13 @@ const char* ExpressionAbs::getOpName() const {
 
 /* ------------------------- ExpressionAdd ----------------------------- */
 
-Value ExpressionAdd::evaluateInternal(Variables* vars) const {
+namespace {
+
+/**
+ * Returns the sum of 'n' operands, where 'operand(i)' returns the i-th one.
+ */
+template <typename GetOperand>
+Value addOperands(size_t n, const GetOperand& operand) {
     // We'll try to return the narrowest possible result value while avoiding overflow, loss
     // of precision due to intermediate rounding or implicit use of decimal types. To do that,
     // compute a compensated sum for non-decimal values and a separate decimal sum for decimal
@@ -334,9 +346,8 @@ Value ExpressionAdd::evaluateInternal(Variables* vars) const {
     BSONType totalType = NumberInt;
     bool haveDate = false;
 
-    const size_t n = vpOperand.size();
     for (size_t i = 0; i < n; ++i) {
-        Value val = vpOperand[i]->evaluateInternal(vars);
+        Value val = operand(i);
 
         switch (val.getType()) {
             case NumberDecimal:
@@ -399,6 +410,49 @@ Value ExpressionAdd::evaluateInternal(Variables* vars) const {
     }
 }
 
+}  // namespace
+
+Value ExpressionAdd::evaluateInternal(Variables* vars) const {
+    return addOperands(vpOperand.size(),
+                       [&](size_t i) { return vpOperand[i]->evaluateInternal(vars); });
+}
+
+Value ExpressionAdd::apply(const Value& lhs, const Value& rhs) {
+    return addOperands(2, [&](size_t i) { return i == 0 ? lhs : rhs; });
+}
+
+size_t ExpressionAdd::compile(ExpressionCompiler* compiler) const {
+    if (vpOperand.size() != 2) {
+        return compiler->fallback(this);
+    }
+    const auto lhs = compiler->compile(*vpOperand[0]);
+    const auto rhs = compiler->compile(*vpOperand[1]);
+    return compiler->binary(&ExpressionAdd::evaluateCompiled, this, lhs, rhs);
+}
+
+Value ExpressionAdd::evaluateCompiled(const Expression* node,
+                                      const Value& lhs,
+                                      const Value& rhs,
+                                      Variables* vars) {
+    const BSONType lhsType = lhs.getType();
+    const BSONType rhsType = rhs.getType();
+    if (lhsType == NumberInt && rhsType == NumberInt) {
+        return Value::createIntOrLong(static_cast<long long>(lhs.getInt()) + rhs.getInt());
+    }
+    if ((lhsType == NumberInt || lhsType == NumberLong) &&
+        (rhsType == NumberInt || rhsType == NumberLong)) {
+        long long sum;
+        if (!mongoSignedAddOverflow64(lhs.coerceToLong(), rhs.coerceToLong(), &sum)) {
+            return Value(sum);
+        }
+    } else if ((lhsType == NumberDouble || lhsType == NumberInt) &&
+               (rhsType == NumberDouble || rhsType == NumberInt)) {
+        // The compensated sum never produces a negative zero, since it starts from positive zero.
+        return Value(lhs.coerceToDouble() + rhs.coerceToDouble() + 0.0);
+    }
+    return apply(lhs, rhs);
+}
+
 REGISTER_EXPRESSION(add, ExpressionAdd::parse);
 const char* ExpressionAdd::getOpName() const {
     return "$add";
@@ -495,6 +549,21 @@ Value ExpressionAnd::evaluateInternal(Variables* vars) const {
     return Value(true);
 }
 
+size_t ExpressionAnd::compile(ExpressionCompiler* compiler) const {
+    const auto result = compiler->newRegister();
+    const auto isFalse = compiler->newLabel();
+    const auto end = compiler->newLabel();
+    for (auto&& operand : vpOperand) {
+        compiler->jumpIfFalse(compiler->compile(*operand), isFalse);
+    }
+    compiler->move(result, compiler->constant(Value(true)));
+    compiler->jump(end);
+    compiler->bind(isFalse);
+    compiler->move(result, compiler->constant(Value(false)));
+    compiler->bind(end);
+    return result;
+}
+
 REGISTER_EXPRESSION(and, ExpressionAnd::parse);
 const char* ExpressionAnd::getOpName() const {
     return "$and";
@@ -649,6 +718,10 @@ Value ExpressionCoerceToBool::evaluateInternal(Variables* vars) const {
     return Value(false);
 }
 
+size_t ExpressionCoerceToBool::compile(ExpressionCompiler* compiler) const {
+    return compiler->coerceToBool(compiler->compile(*pExpression));
+}
+
 Value ExpressionCoerceToBool::serialize(bool explain) const {
     // When not explaining, serialize to an $and expression. When parsed, the $and expression
     // will be optimized back into a ExpressionCoerceToBool.
@@ -735,8 +808,10 @@ Value ExpressionCompare::evaluateInternal(Variables* vars) const {
     Value pLeft(vpOperand[0]->evaluateInternal(vars));
     Value pRight(vpOperand[1]->evaluateInternal(vars));
 
-    int cmp = getExpressionContext()->getValueComparator().compare(pLeft, pRight);
+    return resultOfComparison(getExpressionContext()->getValueComparator().compare(pLeft, pRight));
+}
 
+Value ExpressionCompare::resultOfComparison(int cmp) const {
     // Make cmp one of 1, 0, or -1.
     if (cmp == 0) {
         // leave as 0
@@ -753,6 +828,40 @@ Value ExpressionCompare::evaluateInternal(Variables* vars) const {
     return Value(returnValue);
 }
 
+size_t ExpressionCompare::compile(ExpressionCompiler* compiler) const {
+    const auto lhs = compiler->compile(*vpOperand[0]);
+    const auto rhs = compiler->compile(*vpOperand[1]);
+    return compiler->binary(&ExpressionCompare::evaluateCompiled, this, lhs, rhs);
+}
+
+Value ExpressionCompare::evaluateCompiled(const Expression* node,
+                                          const Value& lhs,
+                                          const Value& rhs,
+                                          Variables* vars) {
+    const auto* compare = static_cast<const ExpressionCompare*>(node);
+    const BSONType lhsType = lhs.getType();
+    const BSONType rhsType = rhs.getType();
+
+    // Integers compare exactly as longs, and as doubles against doubles. NaN has a special place in
+    // the sort order, so it is left to the ValueComparator.
+    if ((lhsType == NumberInt || lhsType == NumberLong) &&
+        (rhsType == NumberInt || rhsType == NumberLong)) {
+        const long long left = lhs.coerceToLong();
+        const long long right = rhs.coerceToLong();
+        return compare->resultOfComparison(left < right ? -1 : left > right ? 1 : 0);
+    }
+    if ((lhsType == NumberDouble || lhsType == NumberInt) &&
+        (rhsType == NumberDouble || rhsType == NumberInt)) {
+        const double left = lhs.coerceToDouble();
+        const double right = rhs.coerceToDouble();
+        if (!std::isnan(left) && !std::isnan(right)) {
+            return compare->resultOfComparison(left < right ? -1 : left > right ? 1 : 0);
+        }
+    }
+    return compare->resultOfComparison(
+        compare->getExpressionContext()->getValueComparator().compare(lhs, rhs));
+}
+
 const char* ExpressionCompare::getOpName() const {
     return cmpLookup[cmpOp].name;
 }
@@ -819,6 +928,19 @@ Value ExpressionCond::evaluateInternal(Variables* vars) const {
     return vpOperand[idx]->evaluateInternal(vars);
 }
 
+size_t ExpressionCond::compile(ExpressionCompiler* compiler) const {
+    const auto result = compiler->newRegister();
+    const auto otherwise = compiler->newLabel();
+    const auto end = compiler->newLabel();
+    compiler->jumpIfFalse(compiler->compile(*vpOperand[0]), otherwise);
+    compiler->move(result, compiler->compile(*vpOperand[1]));
+    compiler->jump(end);
+    compiler->bind(otherwise);
+    compiler->move(result, compiler->compile(*vpOperand[2]));
+    compiler->bind(end);
+    return result;
+}
+
 intrusive_ptr<Expression> ExpressionCond::parse(BSONElement expr, const VariablesParseState& vps) {
     if (expr.type() != Object) {
         return Base::parse(expr, vps);
@@ -885,6 +1007,10 @@ Value ExpressionConstant::evaluateInternal(Variables* vars) const {
     return pValue;
 }
 
+size_t ExpressionConstant::compile(ExpressionCompiler* compiler) const {
+    return compiler->constant(pValue);
+}
+
 Value ExpressionConstant::serialize(bool explain) const {
     return serializeConstant(pValue);
 }
@@ -1137,9 +1263,26 @@ const char* ExpressionDayOfYear::getOpName() const {
 /* ----------------------- ExpressionDivide ---------------------------- */
 
 Value ExpressionDivide::evaluateInternal(Variables* vars) const {
-    Value lhs = vpOperand[0]->evaluateInternal(vars);
-    Value rhs = vpOperand[1]->evaluateInternal(vars);
+    return apply(vpOperand[0]->evaluateInternal(vars), vpOperand[1]->evaluateInternal(vars));
+}
+
+size_t ExpressionDivide::compile(ExpressionCompiler* compiler) const {
+    const auto lhs = compiler->compile(*vpOperand[0]);
+    const auto rhs = compiler->compile(*vpOperand[1]);
+    return compiler->binary(&ExpressionDivide::evaluateCompiled, this, lhs, rhs);
+}
+
+Value ExpressionDivide::evaluateCompiled(const Expression* node,
+                                         const Value& lhs,
+                                         const Value& rhs,
+                                         Variables* vars) {
+    if (lhs.getType() == NumberDouble && rhs.getType() == NumberDouble && rhs.getDouble() != 0.0) {
+        return Value(lhs.getDouble() / rhs.getDouble());
+    }
+    return apply(lhs, rhs);
+}
 
+Value ExpressionDivide::apply(const Value& lhs, const Value& rhs) {
     auto assertNonZero = [](bool nonZero) { uassert(16608, "can't $divide by zero", nonZero); };
 
     if (lhs.numeric() && rhs.numeric()) {
@@ -1363,6 +1506,16 @@ Value ExpressionFieldPath::evaluateInternal(Variables* vars) const {
     }
 }
 
+size_t ExpressionFieldPath::compile(ExpressionCompiler* compiler) const {
+    if (_fieldPath.getPathLength() == 1) {
+        return compiler->loadVariable(_variable);
+    }
+    if (_variable == Variables::ROOT_ID) {
+        return compiler->loadRootPath(this, _fieldPath.tail());
+    }
+    return compiler->fallback(this);
+}
+
 Value ExpressionFieldPath::serialize(bool explain) const {
     if (_fieldPath.getFieldName(0) == "CURRENT" && _fieldPath.getPathLength() > 1) {
         // use short form for "$$CURRENT.foo" but not just "$$CURRENT"
@@ -1854,7 +2007,13 @@ const char* ExpressionMonth::getOpName() const {
 
 /* ------------------------- ExpressionMultiply ----------------------------- */
 
-Value ExpressionMultiply::evaluateInternal(Variables* vars) const {
+namespace {
+
+/**
+ * Returns the product of 'n' operands, where 'operand(i)' returns the i-th one.
+ */
+template <typename GetOperand>
+Value multiplyOperands(size_t n, const GetOperand& operand) {
     /*
       We'll try to return the narrowest possible result value.  To do that
       without creating intermediate Values, do the arithmetic for double
@@ -1867,9 +2026,8 @@ Value ExpressionMultiply::evaluateInternal(Variables* vars) const {
 
     BSONType productType = NumberInt;
 
-    const size_t n = vpOperand.size();
     for (size_t i = 0; i < n; ++i) {
-        Value val = vpOperand[i]->evaluateInternal(vars);
+        Value val = operand(i);
 
         if (val.numeric()) {
             BSONType oldProductType = productType;
@@ -1910,6 +2068,42 @@ Value ExpressionMultiply::evaluateInternal(Variables* vars) const {
         massert(16418, "$multiply resulted in a non-numeric type", false);
 }
 
+}  // namespace
+
+Value ExpressionMultiply::evaluateInternal(Variables* vars) const {
+    return multiplyOperands(vpOperand.size(),
+                            [&](size_t i) { return vpOperand[i]->evaluateInternal(vars); });
+}
+
+Value ExpressionMultiply::apply(const Value& lhs, const Value& rhs) {
+    return multiplyOperands(2, [&](size_t i) { return i == 0 ? lhs : rhs; });
+}
+
+size_t ExpressionMultiply::compile(ExpressionCompiler* compiler) const {
+    if (vpOperand.size() != 2) {
+        return compiler->fallback(this);
+    }
+    const auto lhs = compiler->compile(*vpOperand[0]);
+    const auto rhs = compiler->compile(*vpOperand[1]);
+    return compiler->binary(&ExpressionMultiply::evaluateCompiled, this, lhs, rhs);
+}
+
+Value ExpressionMultiply::evaluateCompiled(const Expression* node,
+                                           const Value& lhs,
+                                           const Value& rhs,
+                                           Variables* vars) {
+    const BSONType lhsType = lhs.getType();
+    const BSONType rhsType = rhs.getType();
+    if (lhsType == NumberInt && rhsType == NumberInt) {
+        return Value::createIntOrLong(static_cast<long long>(lhs.getInt()) * rhs.getInt());
+    }
+    if ((lhsType == NumberDouble || lhsType == NumberInt) &&
+        (rhsType == NumberDouble || rhsType == NumberInt)) {
+        return Value(lhs.coerceToDouble() * rhs.coerceToDouble());
+    }
+    return apply(lhs, rhs);
+}
+
 REGISTER_EXPRESSION(multiply, ExpressionMultiply::parse);
 const char* ExpressionMultiply::getOpName() const {
     return "$multiply";
@@ -1938,6 +2132,16 @@ Value ExpressionIfNull::evaluateInternal(Variables* vars) const {
     return pRight;
 }
 
+size_t ExpressionIfNull::compile(ExpressionCompiler* compiler) const {
+    const auto result = compiler->newRegister();
+    const auto end = compiler->newLabel();
+    compiler->move(result, compiler->compile(*vpOperand[0]));
+    compiler->jumpIfNotNullish(result, end);
+    compiler->move(result, compiler->compile(*vpOperand[1]));
+    compiler->bind(end);
+    return result;
+}
+
 REGISTER_EXPRESSION(ifNull, ExpressionIfNull::parse);
 const char* ExpressionIfNull::getOpName() const {
     return "$ifNull";
@@ -2405,6 +2609,10 @@ Value ExpressionNot::evaluateInternal(Variables* vars) const {
     return Value(!b);
 }
 
+size_t ExpressionNot::compile(ExpressionCompiler* compiler) const {
+    return compiler->logicalNot(compiler->compile(*vpOperand[0]));
+}
+
 REGISTER_EXPRESSION(not, ExpressionNot::parse);
 const char* ExpressionNot::getOpName() const {
     return "$not";
@@ -2423,6 +2631,21 @@ Value ExpressionOr::evaluateInternal(Variables* vars) const {
     return Value(false);
 }
 
+size_t ExpressionOr::compile(ExpressionCompiler* compiler) const {
+    const auto result = compiler->newRegister();
+    const auto isTrue = compiler->newLabel();
+    const auto end = compiler->newLabel();
+    for (auto&& operand : vpOperand) {
+        compiler->jumpIfTrue(compiler->compile(*operand), isTrue);
+    }
+    compiler->move(result, compiler->constant(Value(false)));
+    compiler->jump(end);
+    compiler->bind(isTrue);
+    compiler->move(result, compiler->constant(Value(true)));
+    compiler->bind(end);
+    return result;
+}
+
 intrusive_ptr<Expression> ExpressionOr::optimize() {
     /* optimize the disjunction as much as possible */
     intrusive_ptr<Expression> pE(ExpressionNary::optimize());
@@ -3503,9 +3726,29 @@ const char* ExpressionStrLenCP::getOpName() const {
 /* ----------------------- ExpressionSubtract ---------------------------- */
 
 Value ExpressionSubtract::evaluateInternal(Variables* vars) const {
-    Value lhs = vpOperand[0]->evaluateInternal(vars);
-    Value rhs = vpOperand[1]->evaluateInternal(vars);
+    return apply(vpOperand[0]->evaluateInternal(vars), vpOperand[1]->evaluateInternal(vars));
+}
+
+size_t ExpressionSubtract::compile(ExpressionCompiler* compiler) const {
+    const auto lhs = compiler->compile(*vpOperand[0]);
+    const auto rhs = compiler->compile(*vpOperand[1]);
+    return compiler->binary(&ExpressionSubtract::evaluateCompiled, this, lhs, rhs);
+}
+
+Value ExpressionSubtract::evaluateCompiled(const Expression* node,
+                                           const Value& lhs,
+                                           const Value& rhs,
+                                           Variables* vars) {
+    if (lhs.getType() == NumberInt && rhs.getType() == NumberInt) {
+        return Value::createIntOrLong(static_cast<long long>(lhs.getInt()) - rhs.getInt());
+    }
+    if (lhs.getType() == NumberDouble && rhs.getType() == NumberDouble) {
+        return Value(lhs.getDouble() - rhs.getDouble());
+    }
+    return apply(lhs, rhs);
+}
 
+Value ExpressionSubtract::apply(const Value& lhs, const Value& rhs) {
     BSONType diffType = Value::getWidestNumeric(rhs.getType(), lhs.getType());
 
     if (diffType == NumberDecimal) {
@@ -52,6 +52,7 @@ class BSONArrayBuilder;
 class BSONElement;
 class BSONObjBuilder;
 class DocumentSource;
+class ExpressionCompiler;
 
 /**
  * Registers an Parser so it can be called from parseExpression and friends.
@@ -274,6 +275,15 @@ public:
      */
     virtual Value evaluateInternal(Variables* vars) const = 0;
 
+    /**
+     * Emits the instructions which evaluate this Expression into 'compiler', and returns the
+     * register which will hold the result. See ExpressionProgram.
+     *
+     * Expressions without a compiled form use this default, which evaluates them with the tree
+     * interpreter from within the program.
+     */
+    virtual size_t compile(ExpressionCompiler* compiler) const;
+
     /**
      * Registers an Parser so it can be called from parseExpression.
      *
@@ -492,6 +502,7 @@ class ExpressionAbs final : public ExpressionSingleNumericArg<ExpressionAbs> {
 class ExpressionAdd final : public ExpressionVariadic<ExpressionAdd> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     bool isAssociative() const final {
@@ -501,6 +512,16 @@ public:
     bool isCommutative() const final {
         return true;
     }
+
+private:
+    static Value apply(const Value& lhs, const Value& rhs);
+
+    // Used by compiled programs for two operands, falling back to apply() for any types without
+    // a specialized implementation.
+    static Value evaluateCompiled(const Expression* node,
+                                  const Value& lhs,
+                                  const Value& rhs,
+                                  Variables* vars);
 };
 
 
@@ -515,6 +536,7 @@ class ExpressionAnd final : public ExpressionVariadic<ExpressionAnd> {
 public:
     boost::intrusive_ptr<Expression> optimize() final;
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     bool isAssociative() const final {
@@ -562,6 +584,7 @@ public:
     boost::intrusive_ptr<Expression> optimize() final;
     void addDependencies(DepsTracker* deps) const final;
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     Value serialize(bool explain) const final;
 
     static boost::intrusive_ptr<ExpressionCoerceToBool> create(
@@ -594,6 +617,7 @@ public:
     };
 
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     static boost::intrusive_ptr<Expression> parse(BSONElement bsonExpr,
@@ -603,6 +627,15 @@ public:
     explicit ExpressionCompare(CmpOp cmpOp);
 
 private:
+    // Turns the result of comparing the operands into the result of this Expression.
+    Value resultOfComparison(int cmp) const;
+
+    // Used by compiled programs.
+    static Value evaluateCompiled(const Expression* node,
+                                  const Value& lhs,
+                                  const Value& rhs,
+                                  Variables* vars);
+
     CmpOp cmpOp;
 };
 
@@ -634,6 +667,7 @@ class ExpressionCond final : public ExpressionFixedArity<ExpressionCond, 3> {
 
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     static boost::intrusive_ptr<Expression> parse(BSONElement expr, const VariablesParseState& vps);
@@ -645,6 +679,7 @@ public:
     boost::intrusive_ptr<Expression> optimize() final;
     void addDependencies(DepsTracker* deps) const final;
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     Value serialize(bool explain) const final;
 
     const char* getOpName() const;
@@ -736,7 +771,17 @@ public:
 class ExpressionDivide final : public ExpressionFixedArity<ExpressionDivide, 2> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
+
+private:
+    static Value apply(const Value& lhs, const Value& rhs);
+
+    // Used by compiled programs.
+    static Value evaluateCompiled(const Expression* node,
+                                  const Value& lhs,
+                                  const Value& rhs,
+                                  Variables* vars);
 };
 
 
@@ -751,6 +796,7 @@ public:
     boost::intrusive_ptr<Expression> optimize() final;
     void addDependencies(DepsTracker* deps) const final;
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     Value serialize(bool explain) const final;
 
     /*
@@ -851,6 +897,7 @@ public:
 class ExpressionIfNull final : public ExpressionFixedArity<ExpressionIfNull, 2> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 };
 
@@ -1003,6 +1050,7 @@ public:
 class ExpressionMultiply final : public ExpressionVariadic<ExpressionMultiply> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     bool isAssociative() const final {
@@ -1012,6 +1060,16 @@ public:
     bool isCommutative() const final {
         return true;
     }
+
+private:
+    static Value apply(const Value& lhs, const Value& rhs);
+
+    // Used by compiled programs for two operands, falling back to apply() for any types without
+    // a specialized implementation.
+    static Value evaluateCompiled(const Expression* node,
+                                  const Value& lhs,
+                                  const Value& rhs,
+                                  Variables* vars);
 };
 
 
@@ -1030,6 +1088,7 @@ public:
 class ExpressionNot final : public ExpressionFixedArity<ExpressionNot, 1> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 };
 
@@ -1082,6 +1141,7 @@ class ExpressionOr final : public ExpressionVariadic<ExpressionOr> {
 public:
     boost::intrusive_ptr<Expression> optimize() final;
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
 
     bool isAssociative() const final {
@@ -1276,7 +1336,17 @@ class ExpressionStrLenCP final : public ExpressionFixedArity<ExpressionStrLenCP,
 class ExpressionSubtract final : public ExpressionFixedArity<ExpressionSubtract, 2> {
 public:
     Value evaluateInternal(Variables* vars) const final;
+    size_t compile(ExpressionCompiler* compiler) const final;
     const char* getOpName() const final;
+
+private:
+    static Value apply(const Value& lhs, const Value& rhs);
+
+    // Used by compiled programs.
+    static Value evaluateCompiled(const Expression* node,
+                                  const Value& lhs,
+                                  const Value& rhs,
+                                  Variables* vars);
 };
 
 
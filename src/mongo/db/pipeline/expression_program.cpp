@@ -0,0 +1,275 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/expression_program.h"
+
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/field_path.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+
+MONGO_EXPORT_SERVER_PARAMETER(internalAggregationCompileExpressions, bool, true);
+
+std::unique_ptr<ExpressionProgram> ExpressionProgram::compile(
+    const intrusive_ptr<Expression>& expression) {
+    ExpressionCompiler compiler;
+    const auto result = compiler.compile(*expression);
+    return compiler.finish(expression, result);
+}
+
+Value ExpressionProgram::loadRootPath(const Instruction& instruction, Variables* vars) const {
+    const RootPath& path = _paths[instruction.operand];
+    const size_t last = path.fieldNames.size() - 1;
+
+    // Holds the sub-document being traversed, if the path has gone below the root.
+    Document subDoc;
+    const Document* doc = &vars->getRoot();
+    for (size_t i = 0; i < last; ++i) {
+        Value val = doc->getField(path.fieldNames[i], path.fieldHashes[i]);
+        switch (val.getType()) {
+            case Object:
+                subDoc = val.getDocument();
+                doc = &subDoc;
+                break;
+            case Array:
+                // Paths through arrays collect the path from every element, which is left to
+                // ExpressionFieldPath.
+                return instruction.node->evaluateInternal(vars);
+            default:
+                return Value();
+        }
+    }
+    return doc->getField(path.fieldNames[last], path.fieldHashes[last]);
+}
+
+Value ExpressionProgram::evaluate(Variables* vars) const {
+    const size_t numInstructions = _instructions.size();
+    size_t pc = 0;
+    while (pc < numInstructions) {
+        const Instruction& instruction = _instructions[pc++];
+        switch (instruction.op) {
+            case OpCode::kLoadRootPath:
+                _registers[instruction.dst] = loadRootPath(instruction, vars);
+                break;
+            case OpCode::kLoadVariable:
+                _registers[instruction.dst] = vars->getValue(instruction.operand);
+                break;
+            case OpCode::kFallback:
+                _registers[instruction.dst] = instruction.node->evaluateInternal(vars);
+                break;
+            case OpCode::kBinary:
+                _registers[instruction.dst] = instruction.fn(instruction.node,
+                                                             _registers[instruction.lhs],
+                                                             _registers[instruction.rhs],
+                                                             vars);
+                break;
+            case OpCode::kCoerceToBool:
+                _registers[instruction.dst] = Value(_registers[instruction.lhs].coerceToBool());
+                break;
+            case OpCode::kNot:
+                _registers[instruction.dst] = Value(!_registers[instruction.lhs].coerceToBool());
+                break;
+            case OpCode::kMove:
+                _registers[instruction.dst] = _registers[instruction.lhs];
+                break;
+            case OpCode::kJump:
+                pc = instruction.operand;
+                break;
+            case OpCode::kJumpIfFalse:
+                if (!_registers[instruction.lhs].coerceToBool()) {
+                    pc = instruction.operand;
+                }
+                break;
+            case OpCode::kJumpIfTrue:
+                if (_registers[instruction.lhs].coerceToBool()) {
+                    pc = instruction.operand;
+                }
+                break;
+            case OpCode::kJumpIfNotNullish:
+                if (!_registers[instruction.lhs].nullish()) {
+                    pc = instruction.operand;
+                }
+                break;
+        }
+    }
+
+    Value result = _registers[_result];
+
+    // Don't hold on to parts of the input until the next evaluation.
+    for (size_t i = _numConstants; i < _registers.size(); ++i) {
+        _registers[i] = Value();
+    }
+    return result;
+}
+
+//
+// ExpressionCompiler
+//
+
+const ExpressionCompiler::Register ExpressionCompiler::kConstantRegister;
+const size_t ExpressionCompiler::kUnboundLabel;
+
+ExpressionCompiler::Register ExpressionCompiler::constant(const Value& value) {
+    _constants.push_back(value);
+    return kConstantRegister | (_constants.size() - 1);
+}
+
+ExpressionCompiler::Register ExpressionCompiler::loadRootPath(const Expression* node,
+                                                              const FieldPath& path) {
+    ExpressionProgram::RootPath rootPath;
+    for (size_t i = 0; i < path.getPathLength(); ++i) {
+        rootPath.fieldNames.push_back(path.getFieldName(i));
+        rootPath.fieldHashes.push_back(Document::hashFieldName(path.getFieldName(i)));
+    }
+
+    const Register dst = emit(OpCode::kLoadRootPath, 0, 0);
+    _program->_instructions.back().operand = _program->_paths.size();
+    _program->_instructions.back().node = node;
+    _program->_paths.push_back(std::move(rootPath));
+    return dst;
+}
+
+ExpressionCompiler::Register ExpressionCompiler::loadVariable(Variables::Id id) {
+    const Register dst = emit(OpCode::kLoadVariable, 0, 0);
+    _program->_instructions.back().operand = id;
+    return dst;
+}
+
+ExpressionCompiler::Register ExpressionCompiler::fallback(const Expression* node) {
+    const Register dst = emit(OpCode::kFallback, 0, 0);
+    _program->_instructions.back().node = node;
+    ++_program->_fallbacks;
+    return dst;
+}
+
+ExpressionCompiler::Register ExpressionCompiler::binary(ExpressionProgram::BinaryFn fn,
+                                                        const Expression* node,
+                                                        Register lhs,
+                                                        Register rhs) {
+    const Register dst = emit(OpCode::kBinary, lhs, rhs);
+    _program->_instructions.back().fn = fn;
+    _program->_instructions.back().node = node;
+    return dst;
+}
+
+ExpressionCompiler::Register ExpressionCompiler::coerceToBool(Register src) {
+    return emit(OpCode::kCoerceToBool, src, 0);
+}
+
+ExpressionCompiler::Register ExpressionCompiler::logicalNot(Register src) {
+    return emit(OpCode::kNot, src, 0);
+}
+
+ExpressionCompiler::Register ExpressionCompiler::newRegister() {
+    return _numRegisters++;
+}
+
+void ExpressionCompiler::move(Register dst, Register src) {
+    invariant(!(dst & kConstantRegister));
+    _program->_instructions.push_back({OpCode::kMove, dst, src, 0, 0, nullptr, nullptr});
+}
+
+ExpressionCompiler::Label ExpressionCompiler::newLabel() {
+    _labels.push_back(kUnboundLabel);
+    return _labels.size() - 1;
+}
+
+void ExpressionCompiler::bind(Label label) {
+    invariant(_labels[label] == kUnboundLabel);
+    _labels[label] = _program->_instructions.size();
+}
+
+void ExpressionCompiler::jump(Label label) {
+    emitJump(OpCode::kJump, 0, label);
+}
+
+void ExpressionCompiler::jumpIfFalse(Register condition, Label label) {
+    emitJump(OpCode::kJumpIfFalse, condition, label);
+}
+
+void ExpressionCompiler::jumpIfTrue(Register condition, Label label) {
+    emitJump(OpCode::kJumpIfTrue, condition, label);
+}
+
+void ExpressionCompiler::jumpIfNotNullish(Register value, Label label) {
+    emitJump(OpCode::kJumpIfNotNullish, value, label);
+}
+
+ExpressionCompiler::Register ExpressionCompiler::emit(OpCode op, Register lhs, Register rhs) {
+    const Register dst = newRegister();
+    _program->_instructions.push_back({op, dst, lhs, rhs, 0, nullptr, nullptr});
+    return dst;
+}
+
+void ExpressionCompiler::emitJump(OpCode op, Register condition, Label label) {
+    // The label is replaced by its instruction index in finish(), once every label is bound.
+    _program->_instructions.push_back({op, 0, condition, 0, label, nullptr, nullptr});
+}
+
+std::unique_ptr<ExpressionProgram> ExpressionCompiler::finish(
+    const intrusive_ptr<Expression>& expression, Register result) {
+    auto program = std::move(_program);
+    const size_t numConstants = _constants.size();
+
+    // Constants take the first registers, followed by every other register.
+    auto renumber = [numConstants](Register reg) {
+        return (reg & kConstantRegister) ? reg & ~kConstantRegister : reg + numConstants;
+    };
+
+    for (auto&& instruction : program->_instructions) {
+        switch (instruction.op) {
+            case OpCode::kJump:
+            case OpCode::kJumpIfFalse:
+            case OpCode::kJumpIfTrue:
+            case OpCode::kJumpIfNotNullish:
+                invariant(_labels[instruction.operand] != kUnboundLabel);
+                instruction.operand = _labels[instruction.operand];
+                break;
+            default:
+                break;
+        }
+        instruction.dst = renumber(instruction.dst);
+        instruction.lhs = renumber(instruction.lhs);
+        instruction.rhs = renumber(instruction.rhs);
+    }
+
+    program->_expression = expression;
+    program->_registers = std::move(_constants);
+    program->_registers.resize(numConstants + _numRegisters);
+    program->_numConstants = numConstants;
+    program->_result = renumber(result);
+    return program;
+}
+
+}  // namespace mongo
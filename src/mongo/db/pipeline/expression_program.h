@@ -0,0 +1,237 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <boost/intrusive_ptr.hpp>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+class Document;
+
+/**
+ * Whether optimized Expressions of $project and $addFields stages should be compiled into an
+ * ExpressionProgram.
+ */
+extern std::atomic<bool> internalAggregationCompileExpressions;  // NOLINT
+
+/**
+ * An ExpressionProgram is a flattened form of an optimized Expression tree. Rather than walking
+ * the tree with a virtual call per node, it runs a linear sequence of instructions over a file of
+ * registers, with conditional jumps for the short-circuiting operators. Field paths rooted at
+ * $$CURRENT are resolved with field name hashes computed at compile time, and constants are loaded
+ * into their registers once rather than on every evaluation.
+ *
+ * Only the operators which commonly dominate $project and $addFields stages have a compiled form.
+ * Any other subexpression is evaluated by the tree interpreter from within the program, so every
+ * Expression can be compiled and gives the same result either way.
+ *
+ * A program holds pointers into the Expression tree it was compiled from, so the tree must
+ * outlive it. Evaluation is not reentrant, since the registers belong to the program.
+ */
+class ExpressionProgram {
+    MONGO_DISALLOW_COPYING(ExpressionProgram);
+
+public:
+    using Register = size_t;
+
+    /**
+     * Evaluates two operands already held in registers. 'node' is the Expression which emitted
+     * the instruction; it may be used to fall back to evaluating that subtree with 'vars'.
+     */
+    using BinaryFn = Value (*)(const Expression* node,
+                               const Value& lhs,
+                               const Value& rhs,
+                               Variables* vars);
+
+    /**
+     * Compiles 'expression', which should already be optimized.
+     */
+    static std::unique_ptr<ExpressionProgram> compile(
+        const boost::intrusive_ptr<Expression>& expression);
+
+    /**
+     * Computes the same Value as evaluating the compiled Expression with 'vars'.
+     */
+    Value evaluate(Variables* vars) const;
+
+    size_t numInstructions() const {
+        return _instructions.size();
+    }
+
+    /**
+     * Returns how many subexpressions are evaluated by the tree interpreter.
+     */
+    size_t numFallbacks() const {
+        return _fallbacks;
+    }
+
+private:
+    friend class ExpressionCompiler;
+
+    enum class OpCode {
+        kLoadRootPath,       // dst = the field path _paths[operand] of $$ROOT.
+        kLoadVariable,       // dst = vars->getValue(operand).
+        kFallback,           // dst = node->evaluateInternal(vars).
+        kBinary,             // dst = fn(node, lhs, rhs, vars).
+        kCoerceToBool,       // dst = lhs.coerceToBool().
+        kNot,                // dst = !lhs.coerceToBool().
+        kMove,               // dst = lhs.
+        kJump,               // Continue at instruction 'operand'.
+        kJumpIfFalse,        // Continue at instruction 'operand' if !lhs.coerceToBool().
+        kJumpIfTrue,         // Continue at instruction 'operand' if lhs.coerceToBool().
+        kJumpIfNotNullish,   // Continue at instruction 'operand' if !lhs.nullish().
+    };
+
+    struct Instruction {
+        OpCode op;
+        Register dst;
+        Register lhs;
+        Register rhs;
+        size_t operand;
+        BinaryFn fn;
+        const Expression* node;
+    };
+
+    /**
+     * A field path below $$ROOT, with the hash of each field name computed ahead of time.
+     */
+    struct RootPath {
+        std::vector<std::string> fieldNames;
+        std::vector<unsigned> fieldHashes;
+    };
+
+    ExpressionProgram() = default;
+
+    Value loadRootPath(const Instruction& instruction, Variables* vars) const;
+
+    // The Expression the program was compiled from, which keeps alive the nodes referred to by
+    // the instructions.
+    boost::intrusive_ptr<Expression> _expression;
+
+    std::vector<Instruction> _instructions;
+    std::vector<RootPath> _paths;
+    size_t _fallbacks = 0;
+
+    // Registers below '_numConstants' hold constants, which are loaded at compile time and never
+    // written by an instruction.
+    mutable std::vector<Value> _registers;
+    size_t _numConstants = 0;
+    Register _result = 0;
+};
+
+/**
+ * Builds an ExpressionProgram. Expressions with a compiled form override Expression::compile()
+ * to emit their instructions through this interface, compiling their operands first.
+ */
+class ExpressionCompiler {
+    MONGO_DISALLOW_COPYING(ExpressionCompiler);
+
+public:
+    using Register = ExpressionProgram::Register;
+    using Label = size_t;
+
+    ExpressionCompiler() = default;
+
+    /**
+     * Compiles 'expression' and returns the register which will hold its result.
+     */
+    Register compile(const Expression& expression) {
+        return expression.compile(this);
+    }
+
+    Register constant(const Value& value);
+
+    /**
+     * Loads 'path', which is relative to $$ROOT. 'node' is evaluated instead if the path
+     * traverses an array.
+     */
+    Register loadRootPath(const Expression* node, const FieldPath& path);
+    Register loadVariable(Variables::Id id);
+
+    /**
+     * Evaluates 'node' with the tree interpreter.
+     */
+    Register fallback(const Expression* node);
+
+    Register binary(ExpressionProgram::BinaryFn fn,
+                    const Expression* node,
+                    Register lhs,
+                    Register rhs);
+    Register coerceToBool(Register src);
+    Register logicalNot(Register src);
+
+    /**
+     * Returns a new register, for results which are written by more than one instruction.
+     */
+    Register newRegister();
+    void move(Register dst, Register src);
+
+    Label newLabel();
+    void bind(Label label);
+    void jump(Label label);
+    void jumpIfFalse(Register condition, Label label);
+    void jumpIfTrue(Register condition, Label label);
+    void jumpIfNotNullish(Register value, Label label);
+
+    /**
+     * Returns the program which computes 'result'. The compiler may not be used afterwards.
+     */
+    std::unique_ptr<ExpressionProgram> finish(const boost::intrusive_ptr<Expression>& expression,
+                                              Register result);
+
+private:
+    using OpCode = ExpressionProgram::OpCode;
+    using Instruction = ExpressionProgram::Instruction;
+
+    Register emit(OpCode op, Register lhs, Register rhs);
+    void emitJump(OpCode op, Register condition, Label label);
+
+    std::unique_ptr<ExpressionProgram> _program{new ExpressionProgram()};
+
+    // Constants and other registers are numbered separately while compiling, since the number of
+    // constants is not known until the end. Constant registers are tagged with
+    // 'kConstantRegister' until finish() renumbers every register.
+    static const Register kConstantRegister = Register(1) << (sizeof(Register) * 8 - 1);
+    std::vector<Value> _constants;
+    size_t _numRegisters = 0;
+
+    // The instruction index of each bound label, or kUnboundLabel.
+    static const size_t kUnboundLabel = size_t(-1);
+    std::vector<size_t> _labels;
+};
+
+}  // namespace mongo
@@ -0,0 +1,177 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/expression_program.h"
+
+#include <limits>
+
+#include "mongo/bson/json.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using boost::intrusive_ptr;
+
+/**
+ * Parses and optimizes the expression 'spec', given as the value of the field "expr".
+ */
+intrusive_ptr<Expression> parseOptimized(const BSONObj& spec) {
+    VariablesIdGenerator idGenerator;
+    VariablesParseState vps(&idGenerator);
+    auto expression = Expression::parseOperand(spec["expr"], vps);
+    expression->injectExpressionContext(intrusive_ptr<ExpressionContext>(new ExpressionContext()));
+    return expression->optimize();
+}
+
+/**
+ * Asserts that compiling 'spec' gives the same Value, including its type, as the tree
+ * interpreter for each of 'docs', or fails with the same error.
+ */
+void assertCompiledMatchesInterpreted(const std::string& spec, const std::vector<Document>& docs) {
+    auto expression = parseOptimized(fromjson(spec));
+    auto program = ExpressionProgram::compile(expression);
+    for (auto&& doc : docs) {
+        Variables treeVars(0, doc);
+        Variables programVars(0, doc);
+
+        Value expected;
+        try {
+            expected = expression->evaluate(&treeVars);
+        } catch (const UserException& ex) {
+            ASSERT_THROWS_CODE(program->evaluate(&programVars), UserException, ex.getCode());
+            continue;
+        }
+
+        const Value actual = program->evaluate(&programVars);
+        ASSERT_VALUE_EQ(actual, expected);
+        ASSERT_EQUALS(actual.getType(), expected.getType());
+    }
+}
+
+const long long kLongMax = std::numeric_limits<long long>::max();
+const int kIntMax = std::numeric_limits<int>::max();
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+std::vector<Document> numericDocs() {
+    return {Document{{"a", 1}, {"b", 2}},
+            Document{{"a", kIntMax}, {"b", kIntMax}},
+            Document{{"a", kLongMax}, {"b", 1}},
+            Document{{"a", 1LL}, {"b", 2}},
+            Document{{"a", 1.5}, {"b", 2}},
+            Document{{"a", -0.0}, {"b", -0.0}},
+            Document{{"a", kNaN}, {"b", 1.0}},
+            Document{{"a", Decimal128("1.1")}, {"b", 2}},
+            Document{{"a", BSONNULL}, {"b", 1}},
+            Document{{"b", 3}},
+            Document{{"a", Date_t::fromMillisSinceEpoch(1000)}, {"b", 1}}};
+}
+
+TEST(ExpressionProgramTest, ConstantNeedsNoInstructions) {
+    auto program = ExpressionProgram::compile(parseOptimized(fromjson("{expr: {$add: [1, 2]}}")));
+    ASSERT_EQUALS(program->numInstructions(), 0UL);
+
+    Variables vars(0, Document());
+    ASSERT_VALUE_EQ(program->evaluate(&vars), Value(3));
+}
+
+TEST(ExpressionProgramTest, ArithmeticMatchesInterpreter) {
+    assertCompiledMatchesInterpreted("{expr: {$add: ['$a', '$b']}}", numericDocs());
+    assertCompiledMatchesInterpreted("{expr: {$subtract: ['$a', '$b']}}", numericDocs());
+    assertCompiledMatchesInterpreted("{expr: {$multiply: ['$a', '$b']}}", numericDocs());
+    assertCompiledMatchesInterpreted("{expr: {$add: ['$a', '$b', 1]}}", numericDocs());
+    assertCompiledMatchesInterpreted("{expr: {$divide: ['$b', 4]}}", numericDocs());
+}
+
+TEST(ExpressionProgramTest, ComparisonsMatchInterpreter) {
+    for (auto op : {"$eq", "$ne", "$gt", "$gte", "$lt", "$lte", "$cmp"}) {
+        assertCompiledMatchesInterpreted(std::string("{expr: {") + op + ": ['$a', '$b']}}",
+                                         numericDocs());
+    }
+}
+
+TEST(ExpressionProgramTest, ShortCircuitingOperatorsMatchInterpreter) {
+    const std::vector<Document> docs = {Document{{"a", 0}, {"b", 1}},
+                                        Document{{"a", 1}, {"b", 0}},
+                                        Document{{"a", 1}, {"b", 1}},
+                                        Document{{"b", BSONNULL}}};
+    assertCompiledMatchesInterpreted("{expr: {$and: ['$a', '$b']}}", docs);
+    assertCompiledMatchesInterpreted("{expr: {$or: ['$a', '$b']}}", docs);
+    assertCompiledMatchesInterpreted("{expr: {$not: ['$a']}}", docs);
+    assertCompiledMatchesInterpreted("{expr: {$cond: ['$a', '$b', 'no']}}", docs);
+    assertCompiledMatchesInterpreted("{expr: {$ifNull: ['$a', '$b']}}", docs);
+
+    // The branch not taken must not be evaluated, since it would fail here.
+    assertCompiledMatchesInterpreted(
+        "{expr: {$cond: [{$eq: ['$a', 1]}, 'one', {$divide: [1, {$subtract: ['$a', 1]}]}]}}",
+        {Document{{"a", 1}}, Document{{"a", 3}}});
+}
+
+TEST(ExpressionProgramTest, FieldPathsMatchInterpreter) {
+    const std::vector<Document> docs = {
+        Document{{"a", Document{{"b", Document{{"c", 1}}}}}},
+        Document{{"a", Document{{"b", 2}}}},
+        Document{{"a", std::vector<Value>{Value(Document{{"b", Document{{"c", 3}}}}),
+                                          Value(Document{{"b", Document{{"c", 4}}}})}}},
+        Document{{"a", 5}},
+        Document{{"x", 1}, {"y", 2}, {"z", 3}, {"a", Document{{"b", Document{{"c", 6}}}}}},
+        Document()};
+    assertCompiledMatchesInterpreted("{expr: '$a.b.c'}", docs);
+    assertCompiledMatchesInterpreted("{expr: '$$ROOT.a'}", docs);
+    assertCompiledMatchesInterpreted("{expr: '$$CURRENT'}", docs);
+}
+
+TEST(ExpressionProgramTest, UnsupportedOperatorsFallBackToInterpreter) {
+    auto expression = parseOptimized(
+        fromjson("{expr: {$add: [{$size: '$arr'}, {$strLenBytes: '$str'}]}}"));
+    auto program = ExpressionProgram::compile(expression);
+    ASSERT_EQUALS(program->numFallbacks(), 2UL);
+
+    Variables vars(0, Document{{"arr", std::vector<Value>{Value(1), Value(2)}}, {"str", "abc"}});
+    ASSERT_VALUE_EQ(program->evaluate(&vars), Value(5));
+}
+
+TEST(ExpressionProgramTest, ProgramCanBeEvaluatedRepeatedly) {
+    auto program = ExpressionProgram::compile(
+        parseOptimized(fromjson("{expr: {$cond: [{$gt: ['$a', 0]}, '$a', {$literal: 0}]}}")));
+    for (int i = -3; i < 3; ++i) {
+        Variables vars(0, Document{{"a", i}});
+        ASSERT_VALUE_EQ(program->evaluate(&vars), Value(std::max(i, 0)));
+    }
+}
+
+}  // namespace
+}  // namespace mongo
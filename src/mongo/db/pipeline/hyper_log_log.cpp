@@ -0,0 +1,248 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/hyper_log_log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/platform/bits.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+namespace {
+const uint8_t kFormatVersion = 1;
+const uint8_t kSparseFormat = 0;
+const uint8_t kDenseFormat = 1;
+
+// Version, precision and format bytes.
+const size_t kHeaderSize = 3;
+
+double alpha(size_t numRegisters) {
+    switch (numRegisters) {
+        case 16:
+            return 0.673;
+        case 32:
+            return 0.697;
+        case 64:
+            return 0.709;
+        default:
+            return 0.7213 / (1.0 + 1.079 / numRegisters);
+    }
+}
+}  // namespace
+
+constexpr int HyperLogLog::kMinPrecision;
+constexpr int HyperLogLog::kMaxPrecision;
+constexpr int HyperLogLog::kDefaultPrecision;
+constexpr int HyperLogLog::kRankBits;
+constexpr uint32_t HyperLogLog::kRankMask;
+
+HyperLogLog::HyperLogLog(int precision) : _precision(precision) {
+    invariant(precision >= kMinPrecision && precision <= kMaxPrecision);
+}
+
+void HyperLogLog::add(uint64_t hash) {
+    const uint32_t index = hash >> (64 - _precision);
+
+    // Setting a guard bit caps the rank at (64 - precision + 1), the largest value a register can
+    // legitimately hold.
+    const uint64_t remaining = (hash << _precision) | (1ULL << (_precision - 1));
+    const uint8_t rank = countLeadingZeros64(remaining) + 1;
+
+    _updateRegister(index, rank);
+}
+
+void HyperLogLog::_updateRegister(uint32_t index, uint8_t rank) {
+    if (!isSparse()) {
+        _registers[index] = std::max(_registers[index], rank);
+        return;
+    }
+
+    const uint32_t key = index << kRankBits;
+    auto it = std::lower_bound(_sparse.begin(), _sparse.end(), key);
+    if (it != _sparse.end() && (*it >> kRankBits) == index) {
+        if ((*it & kRankMask) < rank) {
+            *it = key | rank;
+        }
+        return;
+    }
+
+    _sparse.insert(it, key | rank);
+    if (_sparse.size() * sizeof(uint32_t) > numRegisters()) {
+        _convertToDense();
+    }
+}
+
+void HyperLogLog::_convertToDense() {
+    invariant(isSparse());
+    _registers.assign(numRegisters(), 0);
+    for (auto entry : _sparse) {
+        _registers[entry >> kRankBits] = entry & kRankMask;
+    }
+    std::vector<uint32_t>().swap(_sparse);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    invariant(_precision == other._precision);
+
+    if (other.isSparse()) {
+        for (auto entry : other._sparse) {
+            _updateRegister(entry >> kRankBits, entry & kRankMask);
+        }
+        return;
+    }
+
+    if (isSparse()) {
+        _convertToDense();
+    }
+    for (size_t i = 0; i < _registers.size(); ++i) {
+        _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+}
+
+long long HyperLogLog::estimate() const {
+    const size_t m = numRegisters();
+
+    double sum = 0;
+    size_t zeros = 0;
+    if (isSparse()) {
+        zeros = m - _sparse.size();
+        sum = zeros;
+        for (auto entry : _sparse) {
+            sum += std::ldexp(1.0, -static_cast<int>(entry & kRankMask));
+        }
+    } else {
+        for (auto reg : _registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(reg));
+            if (reg == 0) {
+                ++zeros;
+            }
+        }
+    }
+
+    double estimate = alpha(m) * m * m / sum;
+
+    // The raw estimate is heavily biased for small cardinalities, so use linear counting instead
+    // while there are still empty registers.
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(static_cast<double>(m) / zeros);
+    }
+
+    return std::llround(estimate);
+}
+
+size_t HyperLogLog::memUsageBytes() const {
+    return sizeof(*this) + _sparse.capacity() * sizeof(uint32_t) + _registers.capacity();
+}
+
+void HyperLogLog::reset() {
+    std::vector<uint32_t>().swap(_sparse);
+    std::vector<uint8_t>().swap(_registers);
+}
+
+std::string HyperLogLog::serialize() const {
+    const size_t bodySize =
+        isSparse() ? sizeof(uint32_t) + _sparse.size() * sizeof(uint32_t) : _registers.size();
+
+    std::string out(kHeaderSize + bodySize, '\0');
+    DataView view(&out[0]);
+    view.write<uint8_t>(kFormatVersion, 0);
+    view.write<uint8_t>(_precision, 1);
+    view.write<uint8_t>(isSparse() ? kSparseFormat : kDenseFormat, 2);
+
+    if (isSparse()) {
+        size_t offset = kHeaderSize;
+        view.write<LittleEndian<uint32_t>>(_sparse.size(), offset);
+        offset += sizeof(uint32_t);
+        for (auto entry : _sparse) {
+            view.write<LittleEndian<uint32_t>>(entry, offset);
+            offset += sizeof(uint32_t);
+        }
+    } else {
+        std::copy(_registers.begin(), _registers.end(), out.begin() + kHeaderSize);
+    }
+    return out;
+}
+
+StatusWith<HyperLogLog> HyperLogLog::deserialize(StringData data) {
+    const Status badSketch(ErrorCodes::BadValue, "invalid serialized HyperLogLog sketch");
+    if (data.size() < kHeaderSize) {
+        return badSketch;
+    }
+
+    ConstDataView view(data.rawData());
+    const uint8_t version = view.read<uint8_t>();
+    const int precision = view.read<uint8_t>(1);
+    const uint8_t format = view.read<uint8_t>(2);
+    if (version != kFormatVersion || precision < kMinPrecision || precision > kMaxPrecision) {
+        return badSketch;
+    }
+
+    HyperLogLog hll(precision);
+    const size_t bodySize = data.size() - kHeaderSize;
+    if (format == kDenseFormat) {
+        if (bodySize != hll.numRegisters()) {
+            return badSketch;
+        }
+        hll._registers.assign(data.begin() + kHeaderSize, data.end());
+        return std::move(hll);
+    }
+
+    if (format != kSparseFormat || bodySize < sizeof(uint32_t)) {
+        return badSketch;
+    }
+
+    size_t offset = kHeaderSize;
+    const uint32_t count = view.read<LittleEndian<uint32_t>>(offset);
+    offset += sizeof(uint32_t);
+    if (bodySize != sizeof(uint32_t) * (count + 1)) {
+        return badSketch;
+    }
+
+    hll._sparse.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t entry = view.read<LittleEndian<uint32_t>>(offset);
+        offset += sizeof(uint32_t);
+        const uint32_t index = entry >> kRankBits;
+        if (index >= hll.numRegisters() ||
+            (!hll._sparse.empty() && index <= (hll._sparse.back() >> kRankBits))) {
+            return badSketch;
+        }
+        hll._sparse.push_back(entry);
+    }
+    return std::move(hll);
+}
+
+}  // namespace mongo
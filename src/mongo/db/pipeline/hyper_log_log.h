@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+/**
+ * A HyperLogLog sketch for estimating the number of distinct elements in a multiset using a fixed
+ * amount of memory. Callers are responsible for hashing their elements; the sketch expects the
+ * input hashes to be uniformly distributed over all 64 bits.
+ *
+ * Small sketches are kept in a sparse representation which only stores the non-zero registers, so
+ * that many groups with few distinct values stay cheap. Once the sparse representation would use
+ * as much memory as the dense register array, the sketch converts itself to the dense form.
+ *
+ * Two sketches with the same precision can be merged, and the result is the same as if a single
+ * sketch had seen all of the input. This makes the sketch suitable for computing partial results
+ * on shards which are then combined on the merging node.
+ */
+class HyperLogLog {
+public:
+    static constexpr int kMinPrecision = 4;
+    static constexpr int kMaxPrecision = 16;
+
+    /**
+     * With a precision of 12 there are 4096 registers, giving a standard error of about 1.6%.
+     */
+    static constexpr int kDefaultPrecision = 12;
+
+    explicit HyperLogLog(int precision = kDefaultPrecision);
+
+    /**
+     * Adds a hashed element to the sketch.
+     */
+    void add(uint64_t hash);
+
+    /**
+     * Folds 'other' into this sketch. Both sketches must have the same precision.
+     */
+    void merge(const HyperLogLog& other);
+
+    /**
+     * Returns the estimated number of distinct hashes which have been added to this sketch.
+     */
+    long long estimate() const;
+
+    /**
+     * Returns the approximate number of bytes used by this sketch, including 'sizeof(*this)'.
+     */
+    size_t memUsageBytes() const;
+
+    /**
+     * Clears all state, leaving an empty sparse sketch of the same precision.
+     */
+    void reset();
+
+    int getPrecision() const {
+        return _precision;
+    }
+
+    bool isSparse() const {
+        return _registers.empty();
+    }
+
+    /**
+     * Serializes the sketch into an opaque binary string which can be parsed back using
+     * deserialize().
+     */
+    std::string serialize() const;
+
+    /**
+     * Reconstructs a sketch from the output of serialize(). Returns a non-OK status if 'data' is
+     * not a valid serialized sketch.
+     */
+    static StatusWith<HyperLogLog> deserialize(StringData data);
+
+private:
+    // Each sparse entry packs the register index in the upper bits and the register value in the
+    // lowest 'kRankBits' bits.
+    static constexpr int kRankBits = 8;
+    static constexpr uint32_t kRankMask = (1u << kRankBits) - 1;
+
+    size_t numRegisters() const {
+        return size_t(1) << _precision;
+    }
+
+    void _updateRegister(uint32_t index, uint8_t rank);
+    void _convertToDense();
+
+    int _precision;
+
+    // Sorted by register index. Only used while '_registers' is empty.
+    std::vector<uint32_t> _sparse;
+
+    // The dense register array. Empty while the sketch is sparse.
+    std::vector<uint8_t> _registers;
+};
+
+}  // namespace mongo
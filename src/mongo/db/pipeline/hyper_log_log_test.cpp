@@ -0,0 +1,150 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/hyper_log_log.h"
+
+#include <cmath>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * SplitMix64, used to generate well distributed 64-bit hashes of consecutive integers.
+ */
+uint64_t hashOf(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void assertWithinRelativeError(long long actual, long long expected, double relativeError) {
+    ASSERT_LTE(std::abs(actual - expected), std::ceil(expected * relativeError));
+}
+
+TEST(HyperLogLogTest, EmptySketchEstimatesZero) {
+    HyperLogLog hll;
+    ASSERT_EQ(hll.estimate(), 0);
+    ASSERT_TRUE(hll.isSparse());
+}
+
+TEST(HyperLogLogTest, DuplicatesAreNotCounted) {
+    HyperLogLog hll;
+    for (int i = 0; i < 1000; ++i) {
+        hll.add(hashOf(i % 10));
+    }
+    ASSERT_EQ(hll.estimate(), 10);
+    ASSERT_TRUE(hll.isSparse());
+}
+
+TEST(HyperLogLogTest, SmallCardinalitiesAreNearlyExact) {
+    HyperLogLog hll;
+    for (int i = 0; i < 500; ++i) {
+        hll.add(hashOf(i));
+    }
+    assertWithinRelativeError(hll.estimate(), 500, 0.02);
+}
+
+TEST(HyperLogLogTest, ConvertsToDenseAndStaysAccurate) {
+    HyperLogLog hll;
+    const long long n = 200000;
+    for (long long i = 0; i < n; ++i) {
+        hll.add(hashOf(i));
+    }
+    ASSERT_FALSE(hll.isSparse());
+    // The standard error for the default precision is about 1.6%; allow for three of them.
+    assertWithinRelativeError(hll.estimate(), n, 0.05);
+    ASSERT_LTE(hll.memUsageBytes(), sizeof(hll) + (size_t(1) << HyperLogLog::kDefaultPrecision));
+}
+
+TEST(HyperLogLogTest, MergeIsEquivalentToUnion) {
+    HyperLogLog left, right, combined;
+    for (int i = 0; i < 30000; ++i) {
+        left.add(hashOf(i));
+        combined.add(hashOf(i));
+    }
+    for (int i = 20000; i < 50000; ++i) {
+        right.add(hashOf(i));
+        combined.add(hashOf(i));
+    }
+    left.merge(right);
+    ASSERT_EQ(left.estimate(), combined.estimate());
+    assertWithinRelativeError(left.estimate(), 50000, 0.05);
+}
+
+TEST(HyperLogLogTest, MergeSparseIntoSparse) {
+    HyperLogLog left, right;
+    for (int i = 0; i < 100; ++i) {
+        left.add(hashOf(i));
+        right.add(hashOf(i + 50));
+    }
+    left.merge(right);
+    assertWithinRelativeError(left.estimate(), 150, 0.02);
+}
+
+TEST(HyperLogLogTest, SerializationRoundTripsSparseAndDense) {
+    for (int n : {0, 10, 100000}) {
+        HyperLogLog hll;
+        for (int i = 0; i < n; ++i) {
+            hll.add(hashOf(i));
+        }
+        auto swParsed = HyperLogLog::deserialize(hll.serialize());
+        ASSERT_OK(swParsed.getStatus());
+        ASSERT_EQ(swParsed.getValue().isSparse(), hll.isSparse());
+        ASSERT_EQ(swParsed.getValue().estimate(), hll.estimate());
+    }
+}
+
+TEST(HyperLogLogTest, DeserializeRejectsGarbage) {
+    ASSERT_NOT_OK(HyperLogLog::deserialize("").getStatus());
+    ASSERT_NOT_OK(HyperLogLog::deserialize("not a sketch").getStatus());
+
+    HyperLogLog hll;
+    hll.add(hashOf(1));
+    std::string truncated = hll.serialize();
+    truncated.pop_back();
+    ASSERT_NOT_OK(HyperLogLog::deserialize(truncated).getStatus());
+}
+
+TEST(HyperLogLogTest, ResetClearsSketch) {
+    HyperLogLog hll;
+    for (int i = 0; i < 100000; ++i) {
+        hll.add(hashOf(i));
+    }
+    hll.reset();
+    ASSERT_TRUE(hll.isSparse());
+    ASSERT_EQ(hll.estimate(), 0);
+}
+
+}  // namespace
+}  // namespace mongo
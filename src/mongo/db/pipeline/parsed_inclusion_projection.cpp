@@ -46,8 +46,12 @@ using std::unique_ptr;
 InclusionNode::InclusionNode(std::string pathToNode) : _pathToNode(std::move(pathToNode)) {}
 
 void InclusionNode::optimize() {
+    _programs.clear();
     for (auto&& expressionIt : _expressions) {
         _expressions[expressionIt.first] = expressionIt.second->optimize();
+        if (internalAggregationCompileExpressions.load()) {
+            _programs[expressionIt.first] = ExpressionProgram::compile(expressionIt.second);
+        }
     }
     for (auto&& childPair : _children) {
         childPair.second->optimize();
@@ -157,6 +161,12 @@ void InclusionNode::addComputedFields(MutableDocument* outputDoc, Variables* var
             outputDoc->setField(field,
                                 childIt->second->addComputedFields(outputDoc->peek()[field], vars));
         } else {
+            auto programIt = _programs.find(field);
+            if (programIt != _programs.end()) {
+                outputDoc->setField(field, programIt->second->evaluate(vars));
+                continue;
+            }
+
             auto expressionIt = _expressions.find(field);
             invariant(expressionIt != _expressions.end());
             outputDoc->setField(field, expressionIt->second->evaluate(vars));
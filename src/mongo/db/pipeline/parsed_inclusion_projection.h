@@ -34,6 +34,7 @@
 
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/parsed_aggregation_projection.h"
 #include "mongo/stdx/memory.h"
 
@@ -55,7 +56,8 @@ public:
     InclusionNode(std::string pathToNode = "");
 
     /**
-     * Optimize any computed expressions.
+     * Optimize any computed expressions, and compile them into ExpressionPrograms if
+     * 'internalAggregationCompileExpressions' is enabled.
      */
     void optimize();
 
@@ -155,6 +157,10 @@ private:
     std::vector<std::string> _orderToProcessAdditionsAndChildren;
 
     StringMap<boost::intrusive_ptr<Expression>> _expressions;
+
+    // Compiled forms of '_expressions', populated by optimize(). Fields without a program are
+    // evaluated with the Expression tree.
+    std::unordered_map<std::string, std::unique_ptr<ExpressionProgram>> _programs;
     std::unordered_set<std::string> _inclusions;
 
     // TODO use StringMap once SERVER-23700 is resolved.
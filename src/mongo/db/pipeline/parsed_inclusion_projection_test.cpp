@@ -38,8 +38,11 @@
 #include "mongo/db/pipeline/dependencies.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/expression_program.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 namespace parsed_aggregation_projection {
@@ -425,6 +428,39 @@ TEST(InclusionProjectionExecutionTest, ShouldAddComputedDottedFieldToEachElement
     ASSERT_DOCUMENT_EQ(result, expectedResult);
 }
 
+TEST(InclusionProjectionExecutionTest, ShouldComputeSameFieldsWhetherOrNotExpressionsAreCompiled) {
+    auto spec = fromjson(
+        "{a: {$add: ['$x', 1]}, 'b.c': {$cond: [{$gt: ['$x', 1]}, '$y.z', {$size: '$arr'}]}}");
+    vector<Document> inputs = {
+        Document{{"x", 2}, {"y", Document{{"z", "zed"}}}},
+        Document{{"x", 1},
+                 {"b", vector<Value>{Value(1), Value(Document{})}},
+                 {"arr", vector<Value>{Value(1), Value(2)}}},
+        Document{{"x", 1.5}, {"y", vector<Value>{Value(Document{{"z", 1}})}}}};
+
+    boost::intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    const bool compileExpressions = internalAggregationCompileExpressions.load();
+    ON_BLOCK_EXIT([compileExpressions] {
+        internalAggregationCompileExpressions.store(compileExpressions);
+    });
+
+    internalAggregationCompileExpressions.store(false);
+    ParsedInclusionProjection interpreted;
+    interpreted.parse(spec);
+    interpreted.injectExpressionContext(expCtx);
+    interpreted.optimize();
+
+    internalAggregationCompileExpressions.store(true);
+    ParsedInclusionProjection compiled;
+    compiled.parse(spec);
+    compiled.injectExpressionContext(expCtx);
+    compiled.optimize();
+
+    for (auto&& input : inputs) {
+        ASSERT_DOCUMENT_EQ(compiled.applyProjection(input), interpreted.applyProjection(input));
+    }
+}
+
 TEST(InclusionProjectionExecutionTest, ShouldApplyInclusionsAndAdditionsToEachElementInArray) {
     ParsedInclusionProjection inclusion;
     inclusion.parse(BSON("a.inc" << true << "a.comp" << wrapInLiteral("COMPUTED")));
@@ -100,6 +100,10 @@ Status Pipeline::ensureAllStagesAreInLegalPositions() const {
         if (dynamic_cast<DocumentSourceOut*>(stage.get()) && i != _sources.size() - 1) {
             return {ErrorCodes::BadValue, "$out can only be the final stage in the pipeline"};
         }
+
+        if (dynamic_cast<DocumentSourceMerge*>(stage.get()) && i != _sources.size() - 1) {
+            return {ErrorCodes::BadValue, "$merge can only be the final stage in the pipeline"};
+        }
         ++i;
     }
     return Status::OK();
@@ -132,7 +136,7 @@ bool Pipeline::aggSupportsWriteConcern(const BSONObj& cmd) {
 
     auto stages = cmd["pipeline"].Array();
     for (auto stage : stages) {
-        if (stage.Obj().hasField("$out")) {
+        if (stage.Obj().hasField("$out") || stage.Obj().hasField("$merge")) {
             return true;
         }
     }
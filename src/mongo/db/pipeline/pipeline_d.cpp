@@ -62,6 +62,7 @@
 #include "mongo/db/stats/top.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/rpc/get_status_from_command_result.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
@@ -103,6 +104,32 @@ public:
         return _client.getLastErrorDetailed();
     }
 
+    Status update(const NamespaceString& ns, const std::vector<BSONObj>& updates) final {
+        boost::optional<DisableDocumentValidation> maybeDisableValidation;
+        if (_ctx->bypassDocumentValidation)
+            maybeDisableValidation.emplace(_ctx->opCtx);
+
+        BSONObjBuilder cmd;
+        cmd.append("update", ns.coll());
+        cmd.append("updates", updates);
+        cmd.append("ordered", true);
+
+        BSONObj res;
+        _client.runCommand(ns.db().toString(), cmd.done(), res);
+        auto status = getStatusFromCommandResult(res);
+        if (!status.isOK()) {
+            return status;
+        }
+
+        // A write error does not fail the command, so report the first one ourselves.
+        if (auto writeErrors = res["writeErrors"]) {
+            auto firstError = writeErrors.Obj().firstElement().Obj();
+            return {ErrorCodes::fromInt(firstError["code"].numberInt()),
+                    firstError["errmsg"].str()};
+        }
+        return Status::OK();
+    }
+
     CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
                                           const NamespaceString& ns) final {
         AutoGetCollectionForRead autoColl(opCtx, ns);
@@ -0,0 +1,254 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/t_digest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+namespace {
+const uint8_t kFormatVersion = 1;
+
+// Version byte, followed by the compression, min, max and the number of centroids.
+const size_t kHeaderSize = 1 + 3 * sizeof(double) + sizeof(uint32_t);
+
+// The buffer of unmerged values holds this many times 'compression' values before it is folded
+// into the centroids.
+const size_t kBufferSizeFactor = 5;
+
+/**
+ * The k1 scale function from Dunning's "Computing Extremely Accurate Quantiles Using t-Digests".
+ * Two adjacent centroids may only be merged if the result spans at most one unit of 'k'.
+ */
+double scaleK(double q, double compression) {
+    return compression / (2 * M_PI) * std::asin(2 * q - 1);
+}
+
+bool centroidLessThan(const TDigest::Centroid& lhs, const TDigest::Centroid& rhs) {
+    return lhs.mean < rhs.mean;
+}
+}  // namespace
+
+constexpr double TDigest::kDefaultCompression;
+
+TDigest::TDigest(double compression) : _compression(compression) {
+    invariant(compression >= 1);
+    reset();
+}
+
+void TDigest::reset() {
+    _totalWeight = 0;
+    _min = std::numeric_limits<double>::infinity();
+    _max = -std::numeric_limits<double>::infinity();
+    std::vector<Centroid>().swap(_centroids);
+    std::vector<Centroid>().swap(_buffer);
+}
+
+void TDigest::add(double value, double weight) {
+    if (std::isnan(value) || weight <= 0) {
+        return;
+    }
+
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+    _totalWeight += weight;
+    _buffer.push_back({value, weight});
+    if (_buffer.size() >= kBufferSizeFactor * static_cast<size_t>(_compression)) {
+        _compress();
+    }
+}
+
+void TDigest::merge(const TDigest& other) {
+    if (other.empty()) {
+        return;
+    }
+
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+    _totalWeight += other._totalWeight;
+    _buffer.insert(_buffer.end(), other._centroids.begin(), other._centroids.end());
+    _buffer.insert(_buffer.end(), other._buffer.begin(), other._buffer.end());
+    _compress();
+}
+
+void TDigest::_compress() const {
+    if (_buffer.empty()) {
+        return;
+    }
+
+    _buffer.insert(_buffer.end(), _centroids.begin(), _centroids.end());
+    std::sort(_buffer.begin(), _buffer.end(), centroidLessThan);
+
+    std::vector<Centroid> merged;
+    merged.reserve(_centroids.size() + 1);
+
+    Centroid current = _buffer.front();
+    double weightSoFar = 0;
+    double kLow = scaleK(0, _compression);
+    for (auto it = _buffer.begin() + 1; it != _buffer.end(); ++it) {
+        const double proposedWeight = current.weight + it->weight;
+        const double kHigh = scaleK((weightSoFar + proposedWeight) / _totalWeight, _compression);
+        if (kHigh - kLow <= 1) {
+            current.mean += (it->mean - current.mean) * it->weight / proposedWeight;
+            current.weight = proposedWeight;
+        } else {
+            weightSoFar += current.weight;
+            kLow = scaleK(weightSoFar / _totalWeight, _compression);
+            merged.push_back(current);
+            current = *it;
+        }
+    }
+    merged.push_back(current);
+
+    _centroids = std::move(merged);
+    _buffer.clear();
+}
+
+double TDigest::quantile(double q) const {
+    invariant(!empty());
+    _compress();
+
+    q = std::max(0.0, std::min(1.0, q));
+    if (q == 0) {
+        return _min;
+    }
+    if (q == 1) {
+        return _max;
+    }
+
+    // Each centroid is treated as having half of its weight on either side of its mean. Values
+    // between the centers of two adjacent centroids are interpolated linearly, and the tails are
+    // interpolated towards the exact minimum and maximum.
+    const double index = q * _totalWeight;
+    const Centroid& first = _centroids.front();
+    if (index < first.weight / 2) {
+        return _min + (first.mean - _min) * index / (first.weight / 2);
+    }
+
+    double weightSoFar = first.weight / 2;
+    for (size_t i = 1; i < _centroids.size(); ++i) {
+        const Centroid& left = _centroids[i - 1];
+        const Centroid& right = _centroids[i];
+        const double gap = (left.weight + right.weight) / 2;
+        if (index < weightSoFar + gap) {
+            return left.mean + (right.mean - left.mean) * (index - weightSoFar) / gap;
+        }
+        weightSoFar += gap;
+    }
+
+    const Centroid& last = _centroids.back();
+    const double tailWeight = last.weight / 2;
+    return last.mean + (_max - last.mean) * std::min(1.0, (index - weightSoFar) / tailWeight);
+}
+
+size_t TDigest::memUsageBytes() const {
+    return sizeof(*this) + (_centroids.capacity() + _buffer.capacity()) * sizeof(Centroid);
+}
+
+std::string TDigest::serialize() const {
+    _compress();
+
+    std::string out(kHeaderSize + _centroids.size() * 2 * sizeof(double), '\0');
+    DataView view(&out[0]);
+    size_t offset = 0;
+    view.write<uint8_t>(kFormatVersion, offset);
+    offset += 1;
+    for (double field : {_compression, _min, _max}) {
+        view.write<LittleEndian<double>>(field, offset);
+        offset += sizeof(double);
+    }
+    view.write<LittleEndian<uint32_t>>(_centroids.size(), offset);
+    offset += sizeof(uint32_t);
+    for (auto&& centroid : _centroids) {
+        view.write<LittleEndian<double>>(centroid.mean, offset);
+        offset += sizeof(double);
+        view.write<LittleEndian<double>>(centroid.weight, offset);
+        offset += sizeof(double);
+    }
+    return out;
+}
+
+StatusWith<TDigest> TDigest::deserialize(StringData data) {
+    const Status badDigest(ErrorCodes::BadValue, "invalid serialized t-digest");
+    if (data.size() < kHeaderSize) {
+        return badDigest;
+    }
+
+    ConstDataView view(data.rawData());
+    size_t offset = 0;
+    if (view.read<uint8_t>(offset) != kFormatVersion) {
+        return badDigest;
+    }
+    offset += 1;
+
+    const double compression = view.read<LittleEndian<double>>(offset);
+    offset += sizeof(double);
+    if (!(compression >= 1)) {
+        return badDigest;
+    }
+
+    TDigest digest(compression);
+    digest._min = view.read<LittleEndian<double>>(offset);
+    offset += sizeof(double);
+    digest._max = view.read<LittleEndian<double>>(offset);
+    offset += sizeof(double);
+
+    const uint32_t count = view.read<LittleEndian<uint32_t>>(offset);
+    offset += sizeof(uint32_t);
+    if (data.size() != kHeaderSize + count * 2 * sizeof(double)) {
+        return badDigest;
+    }
+
+    digest._centroids.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Centroid centroid;
+        centroid.mean = view.read<LittleEndian<double>>(offset);
+        offset += sizeof(double);
+        centroid.weight = view.read<LittleEndian<double>>(offset);
+        offset += sizeof(double);
+        if (!(centroid.weight > 0) || std::isnan(centroid.mean) ||
+            (!digest._centroids.empty() && centroid.mean < digest._centroids.back().mean)) {
+            return badDigest;
+        }
+        digest._totalWeight += centroid.weight;
+        digest._centroids.push_back(centroid);
+    }
+    return std::move(digest);
+}
+
+}  // namespace mongo
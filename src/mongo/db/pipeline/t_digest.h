@@ -0,0 +1,136 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+/**
+ * A merging t-digest for estimating quantiles of a stream of doubles in bounded memory.
+ *
+ * Incoming values are appended to a buffer which is periodically folded into a sorted list of
+ * centroids. Centroids near the tails of the distribution are kept small while those near the
+ * median are allowed to grow, so extreme quantiles are estimated much more accurately than a
+ * uniform histogram of the same size would allow. The number of centroids is bounded by a small
+ * multiple of the compression parameter, independently of the number of values added.
+ *
+ * Digests with the same compression can be merged, which allows partial digests computed on the
+ * shards to be combined on the merging node.
+ */
+class TDigest {
+public:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    static constexpr double kDefaultCompression = 100;
+
+    explicit TDigest(double compression = kDefaultCompression);
+
+    /**
+     * Adds 'value' to the digest with the given weight. NaN values are ignored.
+     */
+    void add(double value, double weight = 1);
+
+    /**
+     * Folds all of the values summarized by 'other' into this digest.
+     */
+    void merge(const TDigest& other);
+
+    /**
+     * Returns the estimated value at quantile 'q', which is clamped to the range [0, 1]. Must not
+     * be called on an empty digest.
+     */
+    double quantile(double q) const;
+
+    /**
+     * Returns the sum of the weights of all the values which have been added.
+     */
+    double totalWeight() const {
+        return _totalWeight;
+    }
+
+    bool empty() const {
+        return _totalWeight == 0;
+    }
+
+    double min() const {
+        return _min;
+    }
+
+    double max() const {
+        return _max;
+    }
+
+    /**
+     * Returns the approximate number of bytes used by this digest, including 'sizeof(*this)'.
+     */
+    size_t memUsageBytes() const;
+
+    /**
+     * Clears all state so that the digest can be reused.
+     */
+    void reset();
+
+    /**
+     * Serializes the digest into an opaque binary string which can be parsed back using
+     * deserialize().
+     */
+    std::string serialize() const;
+
+    /**
+     * Reconstructs a digest from the output of serialize(). Returns a non-OK status if 'data' is
+     * not a valid serialized digest.
+     */
+    static StatusWith<TDigest> deserialize(StringData data);
+
+private:
+    /**
+     * Merges the buffered values into '_centroids'. Logically const since it does not change the
+     * distribution summarized by the digest.
+     */
+    void _compress() const;
+
+    double _compression;
+    double _totalWeight = 0;
+    double _min;
+    double _max;
+
+    mutable std::vector<Centroid> _centroids;
+    mutable std::vector<Centroid> _buffer;
+};
+
+}  // namespace mongo
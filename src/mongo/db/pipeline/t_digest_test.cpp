@@ -0,0 +1,144 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/t_digest.h"
+
+#include <algorithm>
+#include <random>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+std::vector<double> shuffledRange(int n) {
+    std::vector<double> values;
+    for (int i = 0; i < n; ++i) {
+        values.push_back(i);
+    }
+    std::shuffle(values.begin(), values.end(), std::mt19937(12345));
+    return values;
+}
+
+TEST(TDigestTest, SingleValue) {
+    TDigest digest;
+    digest.add(42);
+    ASSERT_EQ(digest.quantile(0), 42);
+    ASSERT_EQ(digest.quantile(0.5), 42);
+    ASSERT_EQ(digest.quantile(1), 42);
+}
+
+TEST(TDigestTest, NaNIsIgnored) {
+    TDigest digest;
+    digest.add(std::nan(""));
+    ASSERT_TRUE(digest.empty());
+}
+
+TEST(TDigestTest, ExtremesAreExact) {
+    TDigest digest;
+    for (double v : shuffledRange(100000)) {
+        digest.add(v);
+    }
+    ASSERT_EQ(digest.quantile(0), 0);
+    ASSERT_EQ(digest.quantile(1), 99999);
+    ASSERT_EQ(digest.min(), 0);
+    ASSERT_EQ(digest.max(), 99999);
+    ASSERT_EQ(digest.totalWeight(), 100000);
+}
+
+TEST(TDigestTest, QuantilesOfUniformDistribution) {
+    const int n = 100000;
+    TDigest digest;
+    for (double v : shuffledRange(n)) {
+        digest.add(v);
+    }
+    for (double q : {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999}) {
+        ASSERT_APPROX_EQUAL(digest.quantile(q), q * n, n * 0.005);
+    }
+}
+
+TEST(TDigestTest, MemoryIsBoundedByCompression) {
+    TDigest digest;
+    for (double v : shuffledRange(200000)) {
+        digest.add(v);
+    }
+    digest.quantile(0.5);
+    ASSERT_LT(digest.memUsageBytes(), 64 * 1024U);
+}
+
+TEST(TDigestTest, MergeMatchesSingleDigest) {
+    const int n = 100000;
+    std::vector<TDigest> parts(4);
+    int i = 0;
+    for (double v : shuffledRange(n)) {
+        parts[i++ % parts.size()].add(v);
+    }
+
+    TDigest merged;
+    for (auto&& part : parts) {
+        merged.merge(part);
+    }
+    ASSERT_EQ(merged.totalWeight(), n);
+    for (double q : {0.01, 0.5, 0.99}) {
+        ASSERT_APPROX_EQUAL(merged.quantile(q), q * n, n * 0.005);
+    }
+}
+
+TEST(TDigestTest, SerializationRoundTrips) {
+    TDigest digest;
+    for (double v : shuffledRange(10000)) {
+        digest.add(v);
+    }
+
+    auto swParsed = TDigest::deserialize(digest.serialize());
+    ASSERT_OK(swParsed.getStatus());
+    const TDigest& parsed = swParsed.getValue();
+    ASSERT_EQ(parsed.totalWeight(), digest.totalWeight());
+    ASSERT_EQ(parsed.min(), digest.min());
+    ASSERT_EQ(parsed.max(), digest.max());
+    for (double q : {0.0, 0.1, 0.5, 0.9, 1.0}) {
+        ASSERT_EQ(parsed.quantile(q), digest.quantile(q));
+    }
+}
+
+TEST(TDigestTest, EmptyDigestRoundTrips) {
+    auto swParsed = TDigest::deserialize(TDigest().serialize());
+    ASSERT_OK(swParsed.getStatus());
+    ASSERT_TRUE(swParsed.getValue().empty());
+}
+
+TEST(TDigestTest, DeserializeRejectsGarbage) {
+    ASSERT_NOT_OK(TDigest::deserialize("").getStatus());
+    ASSERT_NOT_OK(TDigest::deserialize("definitely not a t-digest").getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
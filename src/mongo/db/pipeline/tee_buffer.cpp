@@ -44,12 +44,12 @@ boost::intrusive_ptr<TeeBuffer> TeeBuffer::create(uint64_t maxMemoryUsageBytes)
 }
 
 TeeBuffer::const_iterator TeeBuffer::begin() const {
-    invariant(_populated);
+    invariant(_populated && _retainInput);
     return _buffer.begin();
 }
 
 TeeBuffer::const_iterator TeeBuffer::end() const {
-    invariant(_populated);
+    invariant(_populated && _retainInput);
     return _buffer.end();
 }
 
@@ -58,15 +58,24 @@ void TeeBuffer::dispose() {
     _populated = false;  // Set this to ensure no one is calling begin() or end().
 }
 
-void TeeBuffer::populate() {
+void TeeBuffer::populate(const std::vector<PushConsumer>& pushConsumers, bool retainInput) {
     invariant(_source);
     if (_populated) {
         return;
     }
     _populated = true;
+    _retainInput = retainInput;
 
     size_t estimatedMemoryUsageBytes = 0;
     while (auto next = _source->getNext()) {
+        for (auto&& consumer : pushConsumers) {
+            consumer(*next);
+        }
+
+        if (!_retainInput) {
+            continue;
+        }
+
         estimatedMemoryUsageBytes += next->getApproximateSize();
         uassert(40174,
                 "Exceeded memory limit for $facet",
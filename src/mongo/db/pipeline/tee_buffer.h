@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "mongo/db/pipeline/document_source.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/assert_util.h"
 
 namespace mongo {
@@ -44,7 +45,8 @@ class Value;
 /**
  * This stage takes a stream of input documents and makes them available to multiple consumers. To
  * do so, it will buffer all incoming documents up to the configured memory limit, then provide
- * access to that buffer via an iterator.
+ * access to that buffer via an iterator. Consumers which can process their input incrementally may
+ * instead be handed each document as it is read, in which case the input need not be buffered.
  *
  * TODO SERVER-24153: This stage should be able to spill to disk if allowed to and the memory limit
  * has been exceeded.
@@ -52,6 +54,7 @@ class Value;
 class TeeBuffer : public RefCountable {
 public:
     using const_iterator = std::vector<Document>::const_iterator;
+    using PushConsumer = stdx::function<void(const Document&)>;
 
     static const uint64_t kMaxMemoryUsageBytes = 100 * 1024 * 1024;
 
@@ -71,8 +74,12 @@ public:
     /**
      * Populates the buffer by consuming all input from 'pSource'. This must be called before
      * calling begin() or end().
+     *
+     * Each document is also passed to every function in 'pushConsumers' as soon as it is read. If
+     * 'retainInput' is false, the documents are not kept in the buffer once they have been pushed,
+     * and it is illegal to call begin() or end().
      */
-    void populate();
+    void populate(const std::vector<PushConsumer>& pushConsumers = {}, bool retainInput = true);
 
     const_iterator begin() const;
     const_iterator end() const;
@@ -81,6 +88,7 @@ private:
     TeeBuffer(uint64_t maxMemoryUsageBytes);
 
     bool _populated = false;
+    bool _retainInput = true;
     uint64_t _maxMemoryUsageBytes;
     std::vector<Document> _buffer;
     boost::intrusive_ptr<DocumentSource> _source;
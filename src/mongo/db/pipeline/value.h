@@ -53,7 +53,9 @@ class BSONElement;
  *  accessing the object. Any number of threads can read from a Value
  *  concurrently. There are no restrictions on how threads access Value
  *  instances exclusively owned by them, even if they reference the same
- *  storage as Value in other threads.
+ *  storage as Value in other threads. The exception is a Value holding a
+ *  Document created by Document::lazyFromBsonWithMetaData(), which reading
+ *  may modify; see Document.
  */
 class Value {
 public:
@@ -177,6 +179,7 @@ public:
     bool getBool() const;
     long long getDate() const;  // in milliseconds
     Timestamp getTimestamp() const;
+    BSONBinData getBinData() const;
     const char* getRegex() const;
     const char* getRegexFlags() const;
     std::string getSymbol() const;
@@ -369,6 +372,12 @@ inline std::string Value::getString() const {
     return _storage.getString().toString();
 }
 
+inline BSONBinData Value::getBinData() const {
+    verify(getType() == BinData);
+    StringData data = _storage.getString();
+    return BSONBinData(data.rawData(), data.size(), _storage.binDataType());
+}
+
 inline OID Value::getOid() const {
     verify(getType() == jstOID);
     return OID(_storage.oid);
@@ -37,6 +37,7 @@
 #include "mongo/bson/bsontypes.h"
 #include "mongo/bson/oid.h"
 #include "mongo/bson/timestamp.h"
+#include "mongo/db/pipeline/document_arena.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/intrusive_counter.h"
 
@@ -52,6 +53,15 @@ class RCVector : public RefCountable {
 public:
     RCVector() {}
     RCVector(std::vector<Value> v) : vec(std::move(v)) {}
+
+    // Allocated from the DocumentArena in scope, if there is one, like DocumentStorage.
+    static void* operator new(size_t bytes) {
+        return DocumentArena::allocate(bytes);
+    }
+    static void operator delete(void* ptr, size_t bytes) {
+        DocumentArena::deallocate(ptr, bytes);
+    }
+
     std::vector<Value> vec;
 };
 
@@ -52,6 +52,7 @@
 #include "mongo/db/exec/sort_key_generator.h"
 #include "mongo/db/exec/subplan.h"
 #include "mongo/db/exec/update.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/matcher/extensions_callback_disallow_extensions.h"
@@ -140,6 +141,7 @@ void fillOutPlannerParams(OperationContext* txn,
                                                     ice->getFilterExpression(),
                                                     desc->infoObj(),
                                                     ice->getCollator()));
+        plannerParams->indices.back().includedFields = ice->accessMethod()->getIncludedFields();
     }
 
     // If query supports index filters, filter params.indices by indices in query settings.
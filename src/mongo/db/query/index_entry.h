@@ -135,6 +135,10 @@ struct IndexEntry {
     // by the keyPattern?)
     IndexType type;
 
+    // The non-key fields whose values the index stores with each key, as {b: 1, c: 1}. A query
+    // which needs only these and the key fields can be covered by the index.
+    BSONObj includedFields;
+
     // Null if this index orders strings according to the simple binary compare. If non-null,
     // represents the collator used to generate index keys for indexed strings.
     const CollatorInterface* collator = nullptr;
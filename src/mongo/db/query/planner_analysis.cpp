@@ -770,7 +770,14 @@ QuerySolution* QueryPlannerAnalysis::analyzeDataAccess(const CanonicalQuery& que
                         if (STAGE_IXSCAN == leafNodes[0]->getType()) {
                             projType = ProjectionNode::COVERED_ONE_INDEX;
                             IndexScanNode* ixn = static_cast<IndexScanNode*>(leafNodes[0]);
-                            coveredKeyObj = ixn->index.keyPattern;
+                            // The values of any included fields follow the key in the index
+                            // entry.
+                            coveredKeyObj = ixn->index.includedFields.isEmpty()
+                                ? ixn->index.keyPattern
+                                : BSONObjBuilder()
+                                      .appendElements(ixn->index.keyPattern)
+                                      .appendElements(ixn->index.includedFields)
+                                      .obj();
                             LOG(5) << "PROJECTION: covered via IXSCAN, using COVERED fast path";
                         } else if (STAGE_DISTINCT_SCAN == leafNodes[0]->getType()) {
                             projType = ProjectionNode::COVERED_ONE_INDEX;
@@ -1362,6 +1362,34 @@ TEST_F(QueryPlannerTest, IdCovering) {
         "{filter: null, pattern: {_id: 1}}}}}");
 }
 
+TEST_F(QueryPlannerTest, IncludedFieldsCovering) {
+    addIndex(BSON("x" << 1));
+    params.indices.back().includedFields = BSON("y" << 1 << "z" << 1);
+    runQuerySortProj(fromjson("{x: {$gt: 1}}"), BSONObj(), fromjson("{_id: 0, x: 1, z: 1}"));
+
+    ASSERT_EQUALS(getNumSolutions(), 2U);
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, x: 1, z: 1}, type: 'coveredIndex', node: {ixscan: "
+        "{filter: null, pattern: {x: 1}}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, x: 1, z: 1}, node: "
+        "{cscan: {dir: 1, filter: {x: {$gt: 1}}}}}}");
+}
+
+TEST_F(QueryPlannerTest, IncludedFieldsDoNotCoverOtherFields) {
+    addIndex(BSON("x" << 1));
+    params.indices.back().includedFields = BSON("y" << 1);
+    runQuerySortProj(fromjson("{x: {$gt: 1}}"), BSONObj(), fromjson("{_id: 0, y: 1, z: 1}"));
+
+    ASSERT_EQUALS(getNumSolutions(), 2U);
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, y: 1, z: 1}, node: {fetch: {filter: null, node: "
+        "{ixscan: {filter: null, pattern: {x: 1}}}}}}}");
+    assertSolutionExists(
+        "{proj: {spec: {_id: 0, y: 1, z: 1}, node: "
+        "{cscan: {dir: 1, filter: {x: {$gt: 1}}}}}}");
+}
+
 TEST_F(QueryPlannerTest, ProjNonCovering) {
     addIndex(BSON("x" << 1));
     runQuerySortProj(fromjson("{ x : {$gt: 1}}"), BSONObj(), fromjson("{x: 1}"));
@@ -547,6 +547,12 @@ bool IndexScanNode::hasField(const string& field) const {
         return false;
     }
 
+    // Included fields are stored with each key exactly as they appear in the document, so they
+    // are provided even if the index has a collation.
+    if (index.includedFields.hasField(field)) {
+        return true;
+    }
+
     // If the index has a non-simple collation and we have collation keys inside 'field', then this
     // index scan does not provide that field (and the query cannot be covered).
     if (index.collator) {
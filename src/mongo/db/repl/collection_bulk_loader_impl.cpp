@@ -105,6 +105,13 @@ Status CollectionBulkLoaderImpl::init(OperationContext* txn,
         }
     }
 
+    // The collection was just created and is held exclusively until commit, so its records can be
+    // appended without going through the regular, transactional insert path.
+    _recordLoader = coll->getRecordStore()->makeBulkLoader(txn);
+    if (_recordLoader) {
+        LOG(2) << "Bulk loading records for ns: " << _nss.ns();
+    }
+
     return Status::OK();
 }
 
@@ -122,16 +129,37 @@ Status CollectionBulkLoaderImpl::insertDocuments(const std::vector<BSONObj>::con
             if (_hasSecondaryIndexes) {
                 indexers.push_back(&_secondaryIndexesBlock);
             }
-            MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+            auto insertDocument = [&]() -> Status {
                 WriteUnitOfWork wunit(txn);
-                const auto status = _coll->insertDocument(txn, *iter, indexers, false);
-                if (!status.isOK()) {
-                    return status;
+                const auto status =
+                    _coll->insertDocument(txn, *iter, indexers, false, _recordLoader.get());
+                if (status.isOK()) {
+                    wunit.commit();
+                }
+                return status;
+            };
+
+            Status status = Status::OK();
+            if (_recordLoader) {
+                // A record appended through the loader is kept even if the rest of the insert
+                // fails and rolls back, so retrying would append the document twice. Failing the
+                // clone makes initial sync drop the collection instead.
+                try {
+                    status = insertDocument();
+                } catch (const WriteConflictException&) {
+                    status = {ErrorCodes::WriteConflict,
+                              str::stream() << "Write conflict while bulk loading " << _nss.ns()};
+                }
+            } else {
+                MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                    status = insertDocument();
                 }
-                wunit.commit();
+                MONGO_WRITE_CONFLICT_RETRY_LOOP_END(
+                    _txn, "CollectionBulkLoaderImpl::insertDocuments", _nss.ns());
+            }
+            if (!status.isOK()) {
+                return status;
             }
-            MONGO_WRITE_CONFLICT_RETRY_LOOP_END(
-                _txn, "CollectionBulkLoaderImpl::insertDocuments", _nss.ns());
 
             ++count;
         }
@@ -147,6 +175,15 @@ Status CollectionBulkLoaderImpl::commit() {
             invariant(txn->getClient() == &cc());
             invariant(txn == _txn);
 
+            // Finish loading the records first, so that they are visible to the dup deletes below.
+            if (_recordLoader) {
+                auto status = _recordLoader->finish();
+                _recordLoader.reset();
+                if (!status.isOK()) {
+                    return status;
+                }
+            }
+
             // Commit before deleting dups, so the dups will be removed from secondary indexes when
             // deleted.
             if (_hasSecondaryIndexes) {
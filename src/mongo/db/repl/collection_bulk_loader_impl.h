@@ -96,6 +96,9 @@ private:
     bool _hasSecondaryIndexes = false;
     BSONObj _idIndexSpec;
     Stats _stats;
+    // Appends records directly to the empty record store, if it supports it. Declared last so
+    // that it is finished before the collection locks are released.
+    std::unique_ptr<RecordStoreBulkLoader> _recordLoader;
 };
 
 }  // namespace repl
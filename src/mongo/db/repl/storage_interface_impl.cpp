@@ -64,6 +64,7 @@
 #include "mongo/db/repl/rs_initialsync.h"
 #include "mongo/db/repl/task_runner.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/storage/storage_engine.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/concurrency/old_thread_pool.h"
 #include "mongo/util/destructor_guard.h"
@@ -146,6 +147,13 @@ void StorageInterfaceImpl::setInitialSyncFlag(OperationContext* txn) {
 void StorageInterfaceImpl::clearInitialSyncFlag(OperationContext* txn) {
     LOG(3) << "clearing initial sync flag";
 
+    // Collections cloned with a RecordStoreBulkLoader are not journaled, so they are checkpointed
+    // before initial sync is recorded as complete.
+    StorageEngine* storageEngine = getGlobalServiceContext()->getGlobalStorageEngine();
+    if (storageEngine->isDurable()) {
+        storageEngine->flushAllFiles(true);
+    }
+
     auto replCoord = repl::ReplicationCoordinator::get(txn);
     OpTime time = replCoord->getMyLastAppliedOpTime();
     updateMinValidDocument(
@@ -274,7 +282,9 @@ StorageInterfaceImpl::createCollectionForBulkLoading(
             collection = db->getDb()->createCollection(txn, nss.ns(), options, false);
             invariant(collection);
             wunit.commit();
-            coll = stdx::make_unique<AutoGetCollection>(txn, nss, MODE_IX);
+
+            // Keep the collection locked exclusively, which allows the loader to bypass the regular
+            // insert path for its records.
 
             // Move locks into loader, so it now controls their lifetime.
             auto loader = stdx::make_unique<CollectionBulkLoaderImpl>(txn,
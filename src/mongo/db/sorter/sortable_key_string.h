@@ -0,0 +1,151 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/bson/util/builder.h"
+#include "mongo/db/storage/key_string.h"
+#include "mongo/util/bufreader.h"
+#include "mongo/util/shared_buffer.h"
+
+namespace mongo {
+
+/**
+ * An immutable KeyString encoding usable as the Key type of a Sorter. Sort keys are encoded once
+ * when they are added to the Sorter, after which every comparison during the in-memory sort and
+ * the external merge is a memcmp rather than a walk over the BSON or Value being sorted.
+ *
+ * The TypeBits are kept next to the encoding when the original key has to be recovered with
+ * toBson(). Keys that are only used for ordering can be built from raw bytes and carry none.
+ * Copies share the same buffer, so getOwned() is cheap.
+ */
+class SortableKeyString {
+public:
+    static const KeyString::Version kVersion = KeyString::Version::V1;
+
+    struct SorterDeserializeSettings {};
+
+    SortableKeyString() = default;
+
+    /**
+     * Copies the encoding and TypeBits of 'ks'. It must have been built with 'kVersion'.
+     */
+    explicit SortableKeyString(const KeyString& ks) {
+        dassert(ks.version == kVersion);
+        const auto& typeBits = ks.getTypeBits();
+        _init(ks.getBuffer(),
+              ks.getSize(),
+              typeBits.getBuffer(),
+              typeBits.isAllZeros() ? 0 : typeBits.getSize());
+    }
+
+    /**
+     * Copies an encoding without TypeBits, such as a concatenation of KeyStrings.
+     */
+    SortableKeyString(const char* data, size_t size) {
+        _init(data, size, nullptr, 0);
+    }
+
+    const char* getBuffer() const {
+        return _buf.get();
+    }
+
+    size_t getSize() const {
+        return _keySize;
+    }
+
+    KeyString::TypeBits getTypeBits() const {
+        BufReader reader(_buf.get() + _keySize, _typeBitsSize);
+        return KeyString::TypeBits::fromBuffer(kVersion, &reader);
+    }
+
+    /**
+     * Decodes the key back into BSON with empty field names. Only valid for keys constructed from
+     * a KeyString, since the TypeBits are needed to restore the exact types.
+     */
+    BSONObj toBson(Ordering ord) const {
+        return KeyString::toBson(getBuffer(), getSize(), ord, getTypeBits());
+    }
+
+    int compare(const SortableKeyString& other) const {
+        const size_t minSize = std::min(_keySize, other._keySize);
+        if (minSize) {
+            if (int cmp = memcmp(_buf.get(), other._buf.get(), minSize)) {
+                return cmp;
+            }
+        }
+        return _keySize < other._keySize ? -1 : (_keySize > other._keySize ? 1 : 0);
+    }
+
+    void serializeForSorter(BufBuilder& buf) const {
+        buf.appendNum(static_cast<int>(_keySize));
+        buf.appendNum(static_cast<int>(_typeBitsSize));
+        buf.appendBuf(_buf.get(), _keySize + _typeBitsSize);
+    }
+
+    static SortableKeyString deserializeForSorter(BufReader& buf,
+                                                  const SorterDeserializeSettings&) {
+        const size_t keySize = buf.read<LittleEndian<int>>();
+        const size_t typeBitsSize = buf.read<LittleEndian<int>>();
+        const char* data = static_cast<const char*>(buf.skip(keySize + typeBitsSize));
+
+        SortableKeyString out;
+        out._init(data, keySize, data + keySize, typeBitsSize);
+        return out;
+    }
+
+    int memUsageForSorter() const {
+        return sizeof(SortableKeyString) + _keySize + _typeBitsSize;
+    }
+
+    SortableKeyString getOwned() const {
+        return *this;
+    }
+
+private:
+    void _init(const void* key, size_t keySize, const void* typeBits, size_t typeBitsSize) {
+        _buf = SharedBuffer::allocate(keySize + typeBitsSize);
+        memcpy(_buf.get(), key, keySize);
+        if (typeBitsSize) {
+            memcpy(_buf.get() + keySize, typeBits, typeBitsSize);
+        }
+        _keySize = keySize;
+        _typeBitsSize = typeBitsSize;
+    }
+
+    // Holds the encoded key immediately followed by its TypeBits.
+    SharedBuffer _buf;
+    uint32_t _keySize = 0;
+    uint32_t _typeBitsSize = 0;
+};
+
+}  // namespace mongo
@@ -47,7 +47,9 @@
 
 #include "mongo/db/sorter/sorter.h"
 
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
+#include <exception>
 #include <snappy.h>
 #include <vector>
 
@@ -59,6 +61,11 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_customization_hooks.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/s/mongos_options.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/bufreader.h"
 #include "mongo/util/destructor_guard.h"
@@ -132,6 +139,140 @@ private:
     const std::string _fileName;
 };
 
+/**
+ * Runs tasks in order on a background thread. Used to read the next block of each spilled run
+ * ahead of the merge which consumes it, so that the merge does not wait for each read in turn.
+ *
+ * Tasks must not throw. The destructor waits for all scheduled tasks to finish.
+ */
+class ReadAheadThread {
+    MONGO_DISALLOW_COPYING(ReadAheadThread);
+
+public:
+    ReadAheadThread() : _thread([this] { run(); }) {}
+
+    ~ReadAheadThread() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _shutdown = true;
+        }
+        _condition.notify_one();
+        _thread.join();
+    }
+
+    void schedule(stdx::function<void()> task) {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+        _condition.notify_one();
+    }
+
+private:
+    void run() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        while (true) {
+            _condition.wait(lk, [this] { return _shutdown || !_tasks.empty(); });
+            if (_tasks.empty())
+                return;
+
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            lk.unlock();
+            task();
+            lk.lock();
+        }
+    }
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _condition;
+    std::deque<stdx::function<void()>> _tasks;
+    bool _shutdown = false;
+
+    stdx::thread _thread;  // Must be initialized last, since it uses the members above.
+};
+
+/**
+ * Calls task(i) for every i in [0, n), each on its own thread except for task(0), which runs on the
+ * calling thread. Returns once all of them have finished, rethrowing the first exception thrown.
+ */
+template <typename Task>
+void runInParallel(size_t n, const Task& task) {
+    std::vector<std::exception_ptr> errors(n);
+    auto runOne = [&](size_t i) {
+        try {
+            task(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<stdx::thread> threads;
+    try {
+        for (size_t i = 1; i < n; i++) {
+            threads.emplace_back([&runOne, i] { runOne(i); });
+        }
+    } catch (...) {
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+        throw;
+    }
+
+    runOne(0);
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    for (auto&& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+/** Slices smaller than this are not worth handing to another thread. */
+const size_t kMinItemsPerSortThread = 16 * 1024;
+
+/**
+ * Stable-sorts 'data' on up to 'numThreads' threads. The range is cut into one slice per thread and
+ * each slice is sorted on its own thread. Neighbouring slices are then merged pairwise, also in
+ * parallel, until a single sorted range remains.
+ */
+template <typename Container, typename Less>
+void parallelStableSort(Container& data, const Less& less, size_t numThreads) {
+    typedef typename Container::iterator Iterator;
+
+    const size_t numSlices = std::min(numThreads, data.size() / kMinItemsPerSortThread);
+    if (numSlices <= 1) {
+        std::stable_sort(data.begin(), data.end(), less);
+        return;
+    }
+
+    std::vector<Iterator> bounds;
+    for (size_t i = 0; i <= numSlices; i++) {
+        bounds.push_back(data.begin() + (data.size() * i) / numSlices);
+    }
+
+    runInParallel(numSlices,
+                  [&](size_t i) { std::stable_sort(bounds[i], bounds[i + 1], less); });
+
+    while (bounds.size() > 2) {
+        runInParallel((bounds.size() - 1) / 2, [&](size_t i) {
+            std::inplace_merge(bounds[2 * i], bounds[2 * i + 1], bounds[2 * i + 2], less);
+        });
+
+        // Slice 2i now spans slices 2i and 2i + 1. An odd slice out at the end is left for the
+        // next pass.
+        std::vector<Iterator> merged;
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+        }
+        if (merged.back() != bounds.back()) {
+            merged.push_back(bounds.back());
+        }
+        bounds.swap(merged);
+    }
+}
+
 /** Returns results from sorted in-memory storage */
 template <typename Key, typename Value>
 class InMemIterator : public SortIteratorInterface<Key, Value> {
@@ -188,6 +329,14 @@ public:
                 boost::filesystem::file_size(_fileName) != 0);
     }
 
+    ~FileIterator() {
+        // A read in progress on the read-ahead thread still uses this object.
+        if (_readAhead) {
+            stdx::unique_lock<stdx::mutex> lk(_readAheadMutex);
+            _readAheadCondition.wait(lk, [this] { return !_readAheadInProgress; });
+        }
+    }
+
     bool more() {
         if (!_done)
             fillIfNeeded();  // may change _done
@@ -204,7 +353,24 @@ public:
         return Data(std::move(first), std::move(second));
     }
 
+    /**
+     * From now on, reads each block on 'readAheadThread' while the previous one is consumed.
+     */
+    void startReadAhead(std::shared_ptr<ReadAheadThread> readAheadThread) {
+        invariant(!_readAhead);
+        _readAhead = std::move(readAheadThread);
+        if (!_done) {
+            scheduleReadAhead();
+        }
+    }
+
 private:
+    // A decompressed block of the file.
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
     void fillIfNeeded() {
         verify(!_done);
 
@@ -213,64 +379,117 @@ private:
     }
 
     void fill() {
+        if (!_readAhead) {
+            _done = !readBlock(&_block);
+        } else {
+            stdx::unique_lock<stdx::mutex> lk(_readAheadMutex);
+            _readAheadCondition.wait(lk, [this] { return !_readAheadInProgress; });
+            if (_readAheadError) {
+                std::rethrow_exception(_readAheadError);
+            }
+
+            _done = _readAheadDone;
+            _block = std::move(_readAheadBlock);
+            lk.unlock();
+
+            if (!_done) {
+                scheduleReadAhead();
+            }
+        }
+
+        if (!_done) {
+            _reader.reset(new BufReader(_block.data.get(), _block.size));
+        }
+    }
+
+    void scheduleReadAhead() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_readAheadMutex);
+            invariant(!_readAheadInProgress);
+            _readAheadInProgress = true;
+        }
+
+        _readAhead->schedule([this] {
+            Block block;
+            bool done = false;
+            std::exception_ptr error;
+            try {
+                done = !readBlock(&block);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            stdx::lock_guard<stdx::mutex> lk(_readAheadMutex);
+            _readAheadBlock = std::move(block);
+            _readAheadDone = done;
+            _readAheadError = error;
+            _readAheadInProgress = false;
+            _readAheadCondition.notify_all();
+        });
+    }
+
+    /**
+     * Reads and decompresses the next block of the file into 'out'. Returns false at the end of
+     * the file. Only touches _file, so it can run on the read-ahead thread.
+     */
+    bool readBlock(Block* out) {
         int32_t rawSize;
-        read(&rawSize, sizeof(rawSize));
-        if (_done)
-            return;
+        if (!read(&rawSize, sizeof(rawSize)))
+            return false;
 
         // negative size means compressed
         const bool compressed = rawSize < 0;
         int32_t blockSize = std::abs(rawSize);
 
-        _buffer.reset(new char[blockSize]);
-        read(_buffer.get(), blockSize);
-        massert(16816, "file too short?", !_done);
+        std::unique_ptr<char[]> buffer(new char[blockSize]);
+        massert(16816, "file too short?", read(buffer.get(), blockSize));
 
         auto hooks = WiredTigerCustomizationHooks::get(getGlobalServiceContext());
         if (hooks->enabled()) {
-            std::unique_ptr<char[]> out(new char[blockSize]);
+            std::unique_ptr<char[]> unprotected(new char[blockSize]);
             size_t outLen;
-            Status status = hooks->unprotectTmpData(reinterpret_cast<uint8_t*>(_buffer.get()),
+            Status status = hooks->unprotectTmpData(reinterpret_cast<uint8_t*>(buffer.get()),
                                                     blockSize,
-                                                    reinterpret_cast<uint8_t*>(out.get()),
+                                                    reinterpret_cast<uint8_t*>(unprotected.get()),
                                                     blockSize,
                                                     &outLen);
             massert(28841,
                     str::stream() << "Failed to unprotect data: " << status.toString(),
                     status.isOK());
             blockSize = outLen;
-            _buffer.swap(out);
+            buffer.swap(unprotected);
         }
 
         if (!compressed) {
-            _reader.reset(new BufReader(_buffer.get(), blockSize));
-            return;
+            out->data = std::move(buffer);
+            out->size = blockSize;
+            return true;
         }
 
-        dassert(snappy::IsValidCompressedBuffer(_buffer.get(), blockSize));
+        dassert(snappy::IsValidCompressedBuffer(buffer.get(), blockSize));
 
         size_t uncompressedSize;
         massert(17061,
                 "couldn't get uncompressed length",
-                snappy::GetUncompressedLength(_buffer.get(), blockSize, &uncompressedSize));
+                snappy::GetUncompressedLength(buffer.get(), blockSize, &uncompressedSize));
 
         std::unique_ptr<char[]> decompressionBuffer(new char[uncompressedSize]);
         massert(17062,
                 "decompression failed",
-                snappy::RawUncompress(_buffer.get(), blockSize, decompressionBuffer.get()));
+                snappy::RawUncompress(buffer.get(), blockSize, decompressionBuffer.get()));
 
         // hold on to decompressed data and throw out compressed data at block exit
-        _buffer.swap(decompressionBuffer);
-        _reader.reset(new BufReader(_buffer.get(), uncompressedSize));
+        out->data = std::move(decompressionBuffer);
+        out->size = uncompressedSize;
+        return true;
     }
 
-    // sets _done to true on EOF - asserts on any other error
-    void read(void* out, size_t size) {
+    // returns false on EOF - asserts on any other error
+    bool read(void* out, size_t size) {
         _file.read(reinterpret_cast<char*>(out), size);
         if (!_file.good()) {
             if (_file.eof()) {
-                _done = true;
-                return;
+                return false;
             }
 
             msgasserted(16817,
@@ -278,24 +497,50 @@ private:
                                       << myErrnoWithDescription());
         }
         verify(_file.gcount() == static_cast<std::streamsize>(size));
+        return true;
     }
 
     const Settings _settings;
     bool _done;
-    std::unique_ptr<char[]> _buffer;
+    Block _block;
     std::unique_ptr<BufReader> _reader;
     std::string _fileName;
     std::shared_ptr<FileDeleter> _fileDeleter;  // Must outlive _file
     std::ifstream _file;
+
+    // Set once read-ahead has started. The other _readAhead members are protected by
+    // _readAheadMutex, and describe the read of the block after _block.
+    std::shared_ptr<ReadAheadThread> _readAhead;
+    stdx::mutex _readAheadMutex;
+    stdx::condition_variable _readAheadCondition;
+    bool _readAheadInProgress = false;
+    Block _readAheadBlock;
+    bool _readAheadDone = false;
+    std::exception_ptr _readAheadError;
 };
 
-/** Merge-sorts results from 0 or more FileIterators */
+template <typename Key, typename Value, typename Comparator>
+class BackgroundMergeIterator;
+
+/**
+ * Merge-sorts results from 0 or more FileIterators.
+ *
+ * The inputs are merged with a tournament tree of losers: each internal node remembers the input
+ * which lost the comparison there, and the overall winner is kept at the root. After a result is
+ * returned, only the path from the winner's leaf to the root is replayed, which takes one
+ * comparison per level rather than the two per level needed to sift a binary heap.
+ *
+ * If SortOptions::mergeThreads allows it and there are enough inputs, groups of inputs are first
+ * merged concurrently on background threads, and this iterator merges the results of the groups.
+ */
 template <typename Key, typename Value, typename Comparator>
 class MergeIterator : public SortIteratorInterface<Key, Value> {
 public:
     typedef SortIteratorInterface<Key, Value> Input;
     typedef std::pair<Key, Value> Data;
 
+    // Inputs are only merged with several threads if each thread can merge at least this many.
+    static const size_t kMinInputsPerMergeThread = 8;
 
     MergeIterator(const std::vector<std::shared_ptr<Input>>& iters,
                   const SortOptions& opts,
@@ -303,32 +548,22 @@ public:
         : _opts(opts),
           _remaining(opts.limit ? opts.limit : std::numeric_limits<unsigned long long>::max()),
           _first(true),
-          _greater(comp) {
-        for (size_t i = 0; i < iters.size(); i++) {
-            if (iters[i]->more()) {
-                _heap.push_back(std::make_shared<Stream>(i, iters[i]->next(), iters[i]));
-            }
-        }
-
-        if (_heap.empty()) {
-            _remaining = 0;
-            return;
+          _comp(comp) {
+        if (opts.mergeThreads > 1 && iters.size() >= opts.mergeThreads * kMinInputsPerMergeThread) {
+            init(mergeInBackground(iters));
+        } else {
+            init(iters);
         }
-
-        std::make_heap(_heap.begin(), _heap.end(), _greater);
-        std::pop_heap(_heap.begin(), _heap.end(), _greater);
-        _current = _heap.back();
-        _heap.pop_back();
     }
 
     bool more() {
-        if (_remaining > 0 && (_first || !_heap.empty() || _current->more()))
+        if (_remaining > 0 && (_first || _numActive > 1 || _streams[_tree[0]]->more()))
             return true;
 
         // We are done so clean up resources.
         // Can't do this in next() due to lifetime guarantees of unowned Data.
-        _heap.clear();
-        _current.reset();
+        _streams.clear();
+        _tree.clear();
         _remaining = 0;
 
         return false;
@@ -341,30 +576,24 @@ public:
 
         if (_first) {
             _first = false;
-            return _current->current();
+            return _streams[_tree[0]]->current();
         }
 
-        if (!_current->advance()) {
-            verify(!_heap.empty());
-
-            std::pop_heap(_heap.begin(), _heap.end(), _greater);
-            _current = _heap.back();
-            _heap.pop_back();
-        } else if (!_heap.empty() && _greater(_current, _heap.front())) {
-            std::pop_heap(_heap.begin(), _heap.end(), _greater);
-            std::swap(_current, _heap.back());
-            std::push_heap(_heap.begin(), _heap.end(), _greater);
+        const size_t winner = _tree[0];
+        if (!_streams[winner]->advance()) {
+            _numActive--;
+            verify(_numActive > 0);
         }
+        replay(winner);
 
-        return _current->current();
+        return _streams[_tree[0]]->current();
     }
 
 
 private:
     class Stream {  // Data + Iterator
     public:
-        Stream(size_t fileNum, const Data& first, std::shared_ptr<Input> rest)
-            : fileNum(fileNum), _current(first), _rest(rest) {}
+        Stream(const Data& first, std::shared_ptr<Input> rest) : _current(first), _rest(rest) {}
 
         const Data& current() const {
             return _current;
@@ -373,46 +602,245 @@ private:
             return _rest->more();
         }
         bool advance() {
-            if (!_rest->more())
+            if (!_rest->more()) {
+                _exhausted = true;
                 return false;
+            }
 
             _current = _rest->next();
             return true;
         }
 
-        const size_t fileNum;
+        // An exhausted stream's current() has already been returned, so it loses to every other
+        // stream.
+        bool exhausted() const {
+            return _exhausted;
+        }
 
     private:
         Data _current;
         std::shared_ptr<Input> _rest;
+        bool _exhausted = false;
     };
 
-    class STLComparator {  // uses greater rather than less-than to maintain a MinHeap
-    public:
-        explicit STLComparator(const Comparator& comp) : _comp(comp) {}
-        bool operator()(unowned_ptr<const Stream> lhs, unowned_ptr<const Stream> rhs) const {
-            // first compare data
-            dassertCompIsSane(_comp, lhs->current(), rhs->current());
-            int ret = _comp(lhs->current(), rhs->current());
-            if (ret)
-                return ret > 0;
+    void init(const std::vector<std::shared_ptr<Input>>& iters) {
+        // Read the spilled runs ahead of the merge on a background thread.
+        std::shared_ptr<ReadAheadThread> readAheadThread;
+        for (auto&& iter : iters) {
+            if (auto fileIter = dynamic_cast<FileIterator<Key, Value>*>(iter.get())) {
+                if (!readAheadThread) {
+                    readAheadThread = std::make_shared<ReadAheadThread>();
+                }
+                fileIter->startReadAhead(readAheadThread);
+            }
+        }
+
+        // Streams are kept in the order of their inputs, which is used to break ties so that
+        // the merge is stable.
+        for (auto&& iter : iters) {
+            if (iter->more()) {
+                _streams.push_back(std::make_shared<Stream>(iter->next(), iter));
+            }
+        }
 
-            // then compare fileNums to ensure stability
-            return lhs->fileNum > rhs->fileNum;
+        if (_streams.empty()) {
+            _remaining = 0;
+            return;
         }
 
-    private:
-        const Comparator _comp;
-    };
+        _numActive = _streams.size();
+        _tree.resize(_streams.size());
+        _tree[0] = buildTree(1);
+    }
+
+    /**
+     * Splits 'iters' into one group per merge thread, and returns an iterator over the merged
+     * results of each group. Groups are contiguous so that the merge stays stable.
+     */
+    std::vector<std::shared_ptr<Input>> mergeInBackground(
+        const std::vector<std::shared_ptr<Input>>& iters) {
+        const size_t groupSize = (iters.size() + _opts.mergeThreads - 1) / _opts.mergeThreads;
+        const SortOptions groupOpts = SortOptions(_opts).MergeThreads(1);
+
+        std::vector<std::shared_ptr<Input>> groups;
+        for (size_t begin = 0; begin < iters.size(); begin += groupSize) {
+            const size_t end = std::min(begin + groupSize, iters.size());
+            std::vector<std::shared_ptr<Input>> group(iters.begin() + begin, iters.begin() + end);
+            groups.push_back(std::make_shared<BackgroundMergeIterator<Key, Value, Comparator>>(
+                group, groupOpts, _comp));
+        }
+        return groups;
+    }
+
+    /**
+     * Fills in the losers of the subtree rooted at 'node', and returns its winner. Node n has
+     * children 2n and 2n+1, and nodes k through 2k-1 are the leaves for the k streams.
+     */
+    size_t buildTree(size_t node) {
+        if (node >= _streams.size())
+            return node - _streams.size();
+
+        const size_t left = buildTree(2 * node);
+        const size_t right = buildTree(2 * node + 1);
+        if (beats(left, right)) {
+            _tree[node] = right;
+            return left;
+        }
+        _tree[node] = left;
+        return right;
+    }
+
+    /**
+     * Replays the matches on the path from the leaf of 'stream' to the root, after the current
+     * value of 'stream' changed.
+     */
+    void replay(size_t stream) {
+        size_t winner = stream;
+        for (size_t node = (stream + _streams.size()) / 2; node > 0; node /= 2) {
+            if (beats(_tree[node], winner))
+                std::swap(_tree[node], winner);
+        }
+        _tree[0] = winner;
+    }
+
+    /**
+     * Returns whether the current value of stream 'lhs' should be returned before that of 'rhs'.
+     */
+    bool beats(size_t lhs, size_t rhs) const {
+        const Stream& left = *_streams[lhs];
+        const Stream& right = *_streams[rhs];
+        if (left.exhausted() || right.exhausted()) {
+            if (left.exhausted() != right.exhausted())
+                return right.exhausted();
+            return lhs < rhs;
+        }
+
+        // first compare data
+        dassertCompIsSane(_comp, left.current(), right.current());
+        int ret = _comp(left.current(), right.current());
+        if (ret)
+            return ret < 0;
+
+        // then compare input positions to ensure stability
+        return lhs < rhs;
+    }
 
     SortOptions _opts;
     unsigned long long _remaining;
     bool _first;
-    std::shared_ptr<Stream> _current;
-    std::vector<std::shared_ptr<Stream>> _heap;  // MinHeap
-    STLComparator _greater;                      // named so calls make sense
+    const Comparator _comp;
+    std::vector<std::shared_ptr<Stream>> _streams;
+    std::vector<size_t> _tree;  // _tree[0] is the winner, the other nodes hold losers.
+    size_t _numActive = 0;      // Number of streams which are not exhausted.
 };
 
+/**
+ * Merges a group of inputs on a background thread, and hands the results to the consumer in
+ * batches. Used by MergeIterator to merge very large numbers of inputs with several threads.
+ */
+template <typename Key, typename Value, typename Comparator>
+class BackgroundMergeIterator : public SortIteratorInterface<Key, Value> {
+public:
+    typedef SortIteratorInterface<Key, Value> Input;
+    typedef std::pair<Key, Value> Data;
+
+    static const size_t kBatchSize = 1024;
+    static const size_t kMaxQueuedBatches = 4;
+
+    BackgroundMergeIterator(const std::vector<std::shared_ptr<Input>>& iters,
+                            const SortOptions& opts,
+                            const Comparator& comp)
+        : _merged(stdx::make_unique<MergeIterator<Key, Value, Comparator>>(iters, opts, comp)),
+          _thread([this] { run(); }) {}
+
+    ~BackgroundMergeIterator() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _shutdown = true;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    bool more() {
+        if (!_batch.empty())
+            return true;
+
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _condition.wait(lk, [this] { return !_queue.empty() || _producerDone; });
+        if (_queue.empty()) {
+            if (_error)
+                std::rethrow_exception(_error);
+            return false;
+        }
+
+        _batch = std::move(_queue.front());
+        _queue.pop_front();
+        _condition.notify_all();
+        return true;
+    }
+
+    Data next() {
+        verify(more());
+        Data out = std::move(_batch.front());
+        _batch.pop_front();
+        return out;
+    }
+
+private:
+    void run() {
+        try {
+            bool more = true;
+            while (more) {
+                // Results are handed to another thread, so they must not refer to buffers owned
+                // by the inputs.
+                std::deque<Data> batch;
+                while (batch.size() < kBatchSize && (more = _merged->more())) {
+                    Data next = _merged->next();
+                    batch.emplace_back(next.first.getOwned(), next.second.getOwned());
+                }
+
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                _condition.wait(
+                    lk, [this] { return _shutdown || _queue.size() < kMaxQueuedBatches; });
+                if (_shutdown)
+                    return;
+                if (!batch.empty())
+                    _queue.push_back(std::move(batch));
+                _producerDone = !more;
+                _condition.notify_all();
+            }
+        } catch (...) {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _error = std::current_exception();
+            _producerDone = true;
+            _condition.notify_all();
+        }
+    }
+
+    const std::unique_ptr<MergeIterator<Key, Value, Comparator>> _merged;
+    std::deque<Data> _batch;  // Only used by the consumer.
+
+    // Protects the members below, and is used to signal changes to them in both directions.
+    stdx::mutex _mutex;
+    stdx::condition_variable _condition;
+    std::deque<std::deque<Data>> _queue;
+    bool _producerDone = false;
+    bool _shutdown = false;
+    std::exception_ptr _error;
+
+    stdx::thread _thread;  // Must be initialized last, since it uses the members above.
+};
+
+template <typename Key, typename Value, typename Comparator>
+const size_t MergeIterator<Key, Value, Comparator>::kMinInputsPerMergeThread;
+
+template <typename Key, typename Value, typename Comparator>
+const size_t BackgroundMergeIterator<Key, Value, Comparator>::kBatchSize;
+
+template <typename Key, typename Value, typename Comparator>
+const size_t BackgroundMergeIterator<Key, Value, Comparator>::kMaxQueuedBatches;
+
 template <typename Key, typename Value, typename Comparator>
 class NoLimitSorter : public Sorter<Key, Value> {
 public:
@@ -429,23 +857,31 @@ public:
         verify(_opts.limit == 0);
     }
 
+    ~NoLimitSorter() {
+        if (_spillThread.joinable())
+            _spillThread.join();
+    }
+
     void add(const Key& key, const Value& val) {
         _data.push_back(std::make_pair(key, val));
 
         _memUsed += key.memUsageForSorter();
         _memUsed += val.memUsageForSorter();
 
-        if (_memUsed > _opts.maxMemoryUsageBytes)
+        if (_memUsed > runMemoryLimit())
             spill();
     }
 
     Iterator* done() {
-        if (_iters.empty()) {
-            sort();
+        if (_iters.empty() && !_spillThread.joinable()) {
+            sort(_data);
             return new InMemIterator<Key, Value>(_data);
         }
 
-        spill();
+        waitForSpill();
+        if (!_data.empty())
+            _iters.push_back(writeRun(_data));
+        _memUsed = 0;
         return Iterator::merge(_iters, _opts, _comp);
     }
 
@@ -470,15 +906,33 @@ private:
         const Comparator& _comp;
     };
 
-    void sort() {
+    // When runs are spilled in the background, the run being written and the run being filled each
+    // get half of the memory budget.
+    size_t runMemoryLimit() const {
+        return _opts.spillInBackground ? _opts.maxMemoryUsageBytes / 2 : _opts.maxMemoryUsageBytes;
+    }
+
+    void sort(std::deque<Data>& data) const {
         STLComparator less(_comp);
-        std::stable_sort(_data.begin(), _data.end(), less);
+        parallelStableSort(data, less, _opts.sortThreads);
 
         // Does 2x more compares than stable_sort
         // TODO test on windows
         // std::sort(_data.begin(), _data.end(), comp);
     }
 
+    /** Sorts 'run' and writes it to a new file, leaving 'run' empty. */
+    std::shared_ptr<Iterator> writeRun(std::deque<Data>& run) const {
+        sort(run);
+
+        SortedFileWriter<Key, Value> writer(_opts, _settings);
+        for (; !run.empty(); run.pop_front()) {
+            writer.addAlreadySorted(run.front().first, run.front().second);
+        }
+
+        return std::shared_ptr<Iterator>(writer.done());
+    }
+
     void spill() {
         if (_data.empty())
             return;
@@ -496,16 +950,37 @@ private:
                           << " Pass allowDiskUse:true to opt in.");
         }
 
-        sort();
-
-        SortedFileWriter<Key, Value> writer(_opts, _settings);
-        for (; !_data.empty(); _data.pop_front()) {
-            writer.addAlreadySorted(_data.front().first, _data.front().second);
+        if (!_opts.spillInBackground) {
+            _iters.push_back(writeRun(_data));
+            _memUsed = 0;
+            return;
         }
 
-        _iters.push_back(std::shared_ptr<Iterator>(writer.done()));
-
+        // Only one run is written at a time, which bounds memory use and keeps the files in the
+        // order their data was added.
+        waitForSpill();
+        _spilling.swap(_data);
         _memUsed = 0;
+        _spillThread = stdx::thread([this] {
+            try {
+                _spilled = writeRun(_spilling);
+            } catch (...) {
+                _spillError = std::current_exception();
+            }
+        });
+    }
+
+    /** Waits for the run being written in the background, if any, and adds it to '_iters'. */
+    void waitForSpill() {
+        if (!_spillThread.joinable())
+            return;
+
+        _spillThread.join();
+        if (_spillError)
+            std::rethrow_exception(_spillError);
+
+        _iters.push_back(std::move(_spilled));
+        _spilled.reset();
     }
 
     const Comparator _comp;
@@ -514,6 +989,12 @@ private:
     size_t _memUsed;
     std::deque<Data> _data;                         // the "current" data
     std::vector<std::shared_ptr<Iterator>> _iters;  // data that has already been spilled
+
+    // The run being written by '_spillThread'. Only touched by that thread while it is running.
+    std::deque<Data> _spilling;
+    std::shared_ptr<Iterator> _spilled;
+    std::exception_ptr _spillError;
+    stdx::thread _spillThread;
 };
 
 template <typename Key, typename Value, typename Comparator>
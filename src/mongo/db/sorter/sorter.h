@@ -98,8 +98,22 @@ struct SortOptions {
     bool extSortAllowed;         /// If false, uassert if more mem needed than allowed.
     std::string tempDir;         /// Directory to directly place files in.
                                  /// Must be explicitly set if extSortAllowed is true.
-
-    SortOptions() : limit(0), maxMemoryUsageBytes(64 * 1024 * 1024), extSortAllowed(false) {}
+    size_t mergeThreads;         /// Max threads used to merge very large numbers of spills.
+    size_t sortThreads;          /// Max threads used to sort each run of in-memory data.
+    bool spillInBackground;      /// If true, a full run is sorted and written to disk on
+                                 /// another thread while the next one is filled. Each run
+                                 /// then gets half of maxMemoryUsageBytes.
+                                 /// With several sort threads or spilling in background, the
+                                 /// data is read on other threads, so it must not be lazily
+                                 /// decoded Documents shared with the caller.
+
+    SortOptions()
+        : limit(0),
+          maxMemoryUsageBytes(64 * 1024 * 1024),
+          extSortAllowed(false),
+          mergeThreads(1),
+          sortThreads(1),
+          spillInBackground(false) {}
 
     /// Fluent API to support expressions like SortOptions().Limit(1000).ExtSortAllowed(true)
 
@@ -122,6 +136,21 @@ struct SortOptions {
         tempDir = newTempDir;
         return *this;
     }
+
+    SortOptions& MergeThreads(size_t newMergeThreads) {
+        mergeThreads = newMergeThreads;
+        return *this;
+    }
+
+    SortOptions& SortThreads(size_t newSortThreads) {
+        sortThreads = newSortThreads;
+        return *this;
+    }
+
+    SortOptions& SpillInBackground(bool newSpillInBackground = true) {
+        spillInBackground = newSpillInBackground;
+        return *this;
+    }
 };
 
 /// This is the output from the sorting framework
@@ -221,6 +250,7 @@ private:
     template class ::mongo::sorter::LimitOneSorter<Key, Value, Comparator>;              \
     template class ::mongo::sorter::TopKSorter<Key, Value, Comparator>;                  \
     template class ::mongo::sorter::MergeIterator<Key, Value, Comparator>;               \
+    template class ::mongo::sorter::BackgroundMergeIterator<Key, Value, Comparator>;     \
     template class ::mongo::sorter::InMemIterator<Key, Value>;                           \
     template class ::mongo::sorter::FileIterator<Key, Value>;                            \
     /* factory functions */                                                              \
@@ -35,8 +35,10 @@
 #include "mongo/base/data_type_endian.h"
 #include "mongo/base/init.h"
 #include "mongo/config.h"
+#include "mongo/db/jsobj.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_noop.h"
+#include "mongo/db/sorter/sortable_key_string.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/unittest/temp_dir.h"
@@ -332,6 +334,52 @@ public:
                 mergeIterators(iterators, ASC, SortOptions().Limit(10)),
                 make_shared<LimitIterator>(10, make_shared<IntIterator>(0, 20, 1)));
         }
+        {  // test a number of inputs which is not a power of two
+            std::shared_ptr<IWIterator> iterators[37];
+            for (int i = 0; i < 37; i++)
+                iterators[i] = make_shared<IntIterator>(i, 37 * 100, 37);
+
+            ASSERT_ITERATORS_EQUIVALENT(mergeIterators(iterators, ASC),
+                                        make_shared<IntIterator>(0, 37 * 100, 1));
+        }
+        {  // test that equal keys are returned in the order of their inputs
+            std::shared_ptr<IWIterator> iterators[5];
+            for (int i = 0; i < 5; i++) {
+                std::vector<IWPair> vec;
+                for (int key = 0; key < 10; key++)
+                    vec.push_back(IWPair(key, i));
+                iterators[i] = make_shared<sorter::InMemIterator<IntWrapper, IntWrapper>>(vec);
+            }
+
+            std::shared_ptr<IWIterator> merged = mergeIterators(iterators, ASC);
+            for (int key = 0; key < 10; key++) {
+                for (int i = 0; i < 5; i++) {
+                    ASSERT(merged->more());
+                    IWPair pair = merged->next();
+                    ASSERT_EQUALS(pair.first, key);
+                    ASSERT_EQUALS(pair.second, i);
+                }
+            }
+            ASSERT_FALSE(merged->more());
+        }
+        {  // test merging groups of inputs on background threads
+            std::shared_ptr<IWIterator> iterators[100];
+            for (int i = 0; i < 100; i++)
+                iterators[i] = make_shared<IntIterator>(i, 100 * 100, 100);
+
+            ASSERT_ITERATORS_EQUIVALENT(
+                mergeIterators(iterators, ASC, SortOptions().MergeThreads(3)),
+                make_shared<IntIterator>(0, 100 * 100, 1));
+        }
+        {  // test Limit when merging on background threads
+            std::shared_ptr<IWIterator> iterators[100];
+            for (int i = 0; i < 100; i++)
+                iterators[i] = make_shared<IntIterator>(i, 100 * 100, 100);
+
+            ASSERT_ITERATORS_EQUIVALENT(
+                mergeIterators(iterators, ASC, SortOptions().MergeThreads(4).Limit(5000)),
+                make_shared<LimitIterator>(5000, make_shared<IntIterator>(0, 100 * 100, 1)));
+        }
     }
 };
 
@@ -522,6 +570,46 @@ public:
 };
 
 
+class LotsOfDataParallelMerge : public LotsOfDataLittleMemory</*random=*/true> {
+    SortOptions adjustSortOptions(SortOptions opts) {
+        // Make sure there are enough files to merge them on several threads
+        typedef MergeIterator<IntWrapper, IntWrapper, IWComparator> IWMergeIterator;
+        static_assert((NUM_ITEMS * sizeof(IWPair)) / MEM_LIMIT >
+                          4 * IWMergeIterator::kMinInputsPerMergeThread,
+                      "(NUM_ITEMS * sizeof(IWPair)) / MEM_LIMIT > 4 * kMinInputsPerMergeThread");
+
+        return LotsOfDataLittleMemory::adjustSortOptions(opts).MergeThreads(4);
+    }
+};
+
+template <bool Spill>
+class LotsOfDataParallelSort : public LotsOfDataLittleMemory</*random=*/true> {
+    SortOptions adjustSortOptions(SortOptions opts) {
+        // Make sure each run is large enough to be sorted on all four threads
+        static_assert(RUN_MEM_LIMIT / 2 / sizeof(IWPair) >= 4 * kMinItemsPerSortThread,
+                      "RUN_MEM_LIMIT / 2 / sizeof(IWPair) >= 4 * kMinItemsPerSortThread");
+        static_assert(NUM_ITEMS * sizeof(IWPair) > 2 * RUN_MEM_LIMIT,
+                      "NUM_ITEMS * sizeof(IWPair) > 2 * RUN_MEM_LIMIT");
+
+        opts.SortThreads(4).SpillInBackground();
+        if (Spill) {
+            return opts.MaxMemoryUsageBytes(RUN_MEM_LIMIT).ExtSortAllowed();
+        }
+        return opts.MaxMemoryUsageBytes(NUM_ITEMS * sizeof(IWPair) * 4);
+    }
+
+    void addData(unowned_ptr<IWSorter> sorter) {
+        LotsOfDataLittleMemory::addData(sorter);
+        if (Spill) {
+            ASSERT_GREATER_THAN(sorter->numFiles(), 0);
+        } else {
+            ASSERT_EQUALS(sorter->numFiles(), 0);
+        }
+    }
+
+    enum { RUN_MEM_LIMIT = 1024 * 1024 };
+};
+
 template <long long Limit, bool Random = true>
 class LotsOfDataWithLimit : public LotsOfDataLittleMemory<Random> {
     typedef LotsOfDataLittleMemory<Random> Parent;
@@ -549,6 +637,76 @@ class LotsOfDataWithLimit : public LotsOfDataLittleMemory<Random> {
     }
     enum { MEM_LIMIT = 32 * 1024 };
 };
+
+class KeyStringKeys {
+public:
+    typedef Sorter<SortableKeyString, IntWrapper> KSSorter;
+
+    class KSComparator {
+    public:
+        int operator()(const KSSorter::Data& lhs, const KSSorter::Data& rhs) const {
+            return lhs.first.compare(rhs.first);
+        }
+    };
+
+    void run() {
+        unittest::TempDir tempDir("sorterTests");
+        const BSONObj pattern = BSON("a" << 1 << "b" << -1);
+        const Ordering ordering = Ordering::make(pattern);
+
+        // Mix numeric types and strings so that the TypeBits are needed to decode the keys.
+        std::vector<BSONObj> keys;
+        for (int i = 0; i < NUM_ITEMS; i++) {
+            BSONObjBuilder key;
+            switch (i % 4) {
+                case 0:
+                    key.append("", i % 97);
+                    break;
+                case 1:
+                    key.append("", static_cast<long long>(i % 89));
+                    break;
+                case 2:
+                    key.append("", (i % 83) + 0.5);
+                    break;
+                case 3:
+                    key.append("", str::stream() << "s" << (i % 79));
+                    break;
+            }
+            key.append("", i);
+            keys.push_back(key.obj());
+        }
+
+        std::unique_ptr<KSSorter> sorter(KSSorter::make(SortOptions()
+                                                            .TempDir(tempDir.path())
+                                                            .MaxMemoryUsageBytes(MEM_LIMIT)
+                                                            .ExtSortAllowed(),
+                                                        KSComparator()));
+        for (int i = 0; i < NUM_ITEMS; i++) {
+            KeyString ks(SortableKeyString::kVersion, keys[i], ordering);
+            sorter->add(SortableKeyString(ks), i);
+        }
+        ASSERT_GREATER_THAN(sorter->numFiles(), 1);
+
+        std::unique_ptr<KSSorter::Iterator> it(sorter->done());
+        BSONObj last;
+        int count = 0;
+        while (it->more()) {
+            const KSSorter::Data data = it->next();
+            const BSONObj key = data.first.toBson(ordering);
+            ASSERT(key.binaryEqual(keys[data.second]));
+            if (count++) {
+                ASSERT_LTE(last.woCompare(key, pattern, false), 0);
+            }
+            last = key;
+        }
+        ASSERT_EQUALS(count, NUM_ITEMS);
+    }
+
+    enum Constants {
+        NUM_ITEMS = 20 * 1000,
+        MEM_LIMIT = 64 * 1024,
+    };
+};
 }
 
 class SorterSuite : public mongo::unittest::Suite {
@@ -564,12 +722,16 @@ public:
         add<SorterTests::Dupes>();
         add<SorterTests::LotsOfDataLittleMemory</*random=*/false>>();
         add<SorterTests::LotsOfDataLittleMemory</*random=*/true>>();
+        add<SorterTests::LotsOfDataParallelMerge>();
+        add<SorterTests::LotsOfDataParallelSort</*spill=*/false>>();
+        add<SorterTests::LotsOfDataParallelSort</*spill=*/true>>();
         add<SorterTests::LotsOfDataWithLimit<1, /*random=*/false>>();     // limit=1 is special case
         add<SorterTests::LotsOfDataWithLimit<1, /*random=*/true>>();      // limit=1 is special case
         add<SorterTests::LotsOfDataWithLimit<100, /*random=*/false>>();   // fits in mem
         add<SorterTests::LotsOfDataWithLimit<100, /*random=*/true>>();    // fits in mem
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/false>>();  // spills
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/true>>();   // spills
+        add<SorterTests::KeyStringKeys>();
     }
 };
 
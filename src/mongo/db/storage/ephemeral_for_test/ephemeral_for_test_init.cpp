@@ -30,8 +30,10 @@
  */
 
 #include "mongo/base/init.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/ephemeral_for_test/ephemeral_for_test_engine.h"
+#include "mongo/db/storage/ephemeral_for_test/ephemeral_for_test_record_store.h"
 #include "mongo/db/storage/kv/kv_storage_engine.h"
 #include "mongo/db/storage/storage_options.h"
 
@@ -39,6 +41,24 @@ namespace mongo {
 
 namespace {
 
+/**
+ * Adds "ephemeralForTest" to the results of db.serverStatus().
+ */
+class EphemeralForTestServerStatusSection : public ServerStatusSection {
+public:
+    EphemeralForTestServerStatusSection() : ServerStatusSection("ephemeralForTest") {}
+
+    bool includeByDefault() const final {
+        return true;
+    }
+
+    BSONObj generateSection(OperationContext* txn, const BSONElement& configElement) const final {
+        BSONObjBuilder bob;
+        EphemeralForTestRecordStore::appendMemoryStats(&bob);
+        return bob.obj();
+    }
+};
+
 class EphemeralForTestFactory : public StorageEngine::Factory {
 public:
     virtual ~EphemeralForTestFactory() {}
@@ -47,6 +67,9 @@ public:
         KVStorageEngineOptions options;
         options.directoryPerDB = params.directoryperdb;
         options.forRepair = params.repair;
+
+        // Intentionally leaked.
+        new EphemeralForTestServerStatusSection();
         return new KVStorageEngine(new EphemeralForTestEngine(), options);
     }
 
@@ -37,8 +37,10 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/oplog_hack.h"
 #include "mongo/db/storage/recovery_unit.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -48,6 +50,26 @@ namespace mongo {
 
 using std::shared_ptr;
 
+// The most record data all record stores may hold together, in bytes. 0 means no limit. Index
+// keys are not counted.
+MONGO_EXPORT_SERVER_PARAMETER(ephemeralForTestMaxRecordDataBytes, long long, 0);
+
+namespace {
+
+AtomicInt64 totalRecordDataSize;
+AtomicInt64 writesRejectedForMemory;
+
+}  // namespace
+
+EphemeralForTestRecordStore::Data::~Data() {
+    totalRecordDataSize.subtractAndFetch(dataSize);
+}
+
+void EphemeralForTestRecordStore::Data::adjustDataSize(int64_t delta) {
+    dataSize += delta;
+    totalRecordDataSize.addAndFetch(delta);
+}
+
 class EphemeralForTestRecordStore::InsertChange : public RecoveryUnit::Change {
 public:
     InsertChange(Data* data, RecordId loc) : _data(data), _loc(loc) {}
@@ -55,7 +77,7 @@ public:
     virtual void rollback() {
         Records::iterator it = _data->records.find(_loc);
         if (it != _data->records.end()) {
-            _data->dataSize -= it->second.size;
+            _data->adjustDataSize(-it->second.size);
             _data->records.erase(it);
         }
     }
@@ -75,10 +97,10 @@ public:
     virtual void rollback() {
         Records::iterator it = _data->records.find(_loc);
         if (it != _data->records.end()) {
-            _data->dataSize -= it->second.size;
+            _data->adjustDataSize(-it->second.size);
         }
 
-        _data->dataSize += _rec.size;
+        _data->adjustDataSize(_rec.size);
         _data->records[_loc] = _rec;
     }
 
@@ -90,16 +112,16 @@ private:
 
 class EphemeralForTestRecordStore::TruncateChange : public RecoveryUnit::Change {
 public:
-    TruncateChange(Data* data) : _data(data), _dataSize(0) {
+    TruncateChange(Data* data) : _data(data), _dataSize(_data->dataSize) {
         using std::swap;
-        swap(_dataSize, _data->dataSize);
+        _data->adjustDataSize(-_dataSize);
         swap(_records, _data->records);
     }
 
     virtual void commit() {}
     virtual void rollback() {
         using std::swap;
-        swap(_dataSize, _data->dataSize);
+        _data->adjustDataSize(_dataSize - _data->dataSize);
         swap(_records, _data->records);
     }
 
@@ -322,7 +344,7 @@ bool EphemeralForTestRecordStore::findRecord(OperationContext* txn,
 void EphemeralForTestRecordStore::deleteRecord(OperationContext* txn, const RecordId& loc) {
     EphemeralForTestRecord* rec = recordFor(loc);
     txn->recoveryUnit()->registerChange(new RemoveChange(_data, loc, *rec));
-    _data->dataSize -= rec->size;
+    _data->adjustDataSize(-rec->size);
     invariant(_data->records.erase(loc) == 1);
 }
 
@@ -376,6 +398,10 @@ StatusWith<RecordId> EphemeralForTestRecordStore::insertRecord(OperationContext*
         return StatusWith<RecordId>(ErrorCodes::BadValue, "object to insert exceeds cappedMaxSize");
     }
 
+    Status memoryStatus = checkMemoryLimit(len);
+    if (!memoryStatus.isOK())
+        return memoryStatus;
+
     EphemeralForTestRecord rec(len);
     memcpy(rec.data.get(), data, len);
 
@@ -390,7 +416,7 @@ StatusWith<RecordId> EphemeralForTestRecordStore::insertRecord(OperationContext*
     }
 
     txn->recoveryUnit()->registerChange(new InsertChange(_data, loc));
-    _data->dataSize += len;
+    _data->adjustDataSize(len);
     _data->records[loc] = rec;
 
     cappedDeleteAsNeeded(txn);
@@ -410,6 +436,10 @@ Status EphemeralForTestRecordStore::insertRecordsWithDocWriter(OperationContext*
             return Status(ErrorCodes::BadValue, "object to insert exceeds cappedMaxSize");
         }
 
+        Status memoryStatus = checkMemoryLimit(len);
+        if (!memoryStatus.isOK())
+            return memoryStatus;
+
         EphemeralForTestRecord rec(len);
         docs[i]->writeDocument(rec.data.get());
 
@@ -424,7 +454,7 @@ Status EphemeralForTestRecordStore::insertRecordsWithDocWriter(OperationContext*
         }
 
         txn->recoveryUnit()->registerChange(new InsertChange(_data, loc));
-        _data->dataSize += len;
+        _data->adjustDataSize(len);
         _data->records[loc] = rec;
 
         cappedDeleteAsNeeded(txn);
@@ -448,6 +478,10 @@ Status EphemeralForTestRecordStore::updateRecord(OperationContext* txn,
     // Documents in capped collections cannot change size. We check that above the storage layer.
     invariant(!_isCapped || len == oldLen);
 
+    Status memoryStatus = checkMemoryLimit(len - oldLen);
+    if (!memoryStatus.isOK())
+        return memoryStatus;
+
     if (notifier) {
         // The in-memory KV engine uses the invalidation framework (does not support
         // doc-locking), and therefore must notify that it is updating a document.
@@ -461,7 +495,7 @@ Status EphemeralForTestRecordStore::updateRecord(OperationContext* txn,
     memcpy(newRecord.data.get(), data, len);
 
     txn->recoveryUnit()->registerChange(new RemoveChange(_data, loc, *oldRecord));
-    _data->dataSize += len - oldLen;
+    _data->adjustDataSize(len - oldLen);
     *oldRecord = newRecord;
 
     cappedDeleteAsNeeded(txn);
@@ -525,7 +559,7 @@ void EphemeralForTestRecordStore::temp_cappedTruncateAfter(OperationContext* txn
         inclusive ? _data->records.lower_bound(end) : _data->records.upper_bound(end);
     while (it != _data->records.end()) {
         txn->recoveryUnit()->registerChange(new RemoveChange(_data, it->first, it->second));
-        _data->dataSize -= it->second.size;
+        _data->adjustDataSize(-it->second.size);
         _data->records.erase(it++);
     }
 }
@@ -591,6 +625,33 @@ int64_t EphemeralForTestRecordStore::storageSize(OperationContext* txn,
     return _data->dataSize + recordOverhead;
 }
 
+Status EphemeralForTestRecordStore::checkMemoryLimit(int64_t growth) const {
+    const long long limit = ephemeralForTestMaxRecordDataBytes.load();
+    if (limit <= 0 || growth <= 0 || _isCapped) {
+        return Status::OK();
+    }
+
+    const int64_t total = totalRecordDataSize.load();
+    if (total + growth <= limit) {
+        return Status::OK();
+    }
+
+    writesRejectedForMemory.addAndFetch(1);
+    return Status(ErrorCodes::ExceededMemoryLimit,
+                  str::stream() << "cannot add " << growth << " bytes to " << ns()
+                                << ": record stores already hold "
+                                << total
+                                << " bytes, and ephemeralForTestMaxRecordDataBytes is "
+                                << limit);
+}
+
+// static
+void EphemeralForTestRecordStore::appendMemoryStats(BSONObjBuilder* builder) {
+    builder->append("recordDataBytes", static_cast<long long>(totalRecordDataSize.load()));
+    builder->append("maxRecordDataBytes", ephemeralForTestMaxRecordDataBytes.load());
+    builder->append("writesRejected", static_cast<long long>(writesRejectedForMemory.load()));
+}
+
 RecordId EphemeralForTestRecordStore::allocateLoc() {
     RecordId out = RecordId(_data->nextId++);
     invariant(out < RecordId::max());
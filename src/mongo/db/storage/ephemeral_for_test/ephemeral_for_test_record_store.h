@@ -125,7 +125,7 @@ public:
                                         long long numRecords,
                                         long long dataSize) {
         invariant(_data->records.size() == size_t(numRecords));
-        _data->dataSize = dataSize;
+        _data->adjustDataSize(dataSize - _data->dataSize);
     }
 
 protected:
@@ -166,6 +166,13 @@ public:
         return _cappedMaxSize;
     }
 
+    /**
+     * Appends the bytes of record data held by all record stores in this process, the limit on
+     * them set by the ephemeralForTestMaxRecordDataBytes server parameter, and the number of
+     * writes rejected for exceeding it. Index keys are not counted.
+     */
+    static void appendMemoryStats(BSONObjBuilder* builder);
+
 private:
     class InsertChange;
     class RemoveChange;
@@ -178,6 +185,13 @@ private:
 
     RecordId allocateLoc();
     bool cappedAndNeedDelete(OperationContext* txn) const;
+
+    /**
+     * Returns ExceededMemoryLimit if growing this record store's data by 'growth' bytes would take
+     * the total past ephemeralForTestMaxRecordDataBytes. Capped collections are bounded already,
+     * and are never refused.
+     */
+    Status checkMemoryLimit(int64_t growth) const;
     void cappedDeleteAsNeeded(OperationContext* txn);
 
     // TODO figure out a proper solution to metadata
@@ -189,6 +203,12 @@ private:
     // This is the "persistent" data.
     struct Data {
         Data(bool isOplog) : dataSize(0), nextId(1), isOplog(isOplog) {}
+        ~Data();
+
+        /**
+         * Adds 'delta' to 'dataSize' and to the total across all record stores.
+         */
+        void adjustDataSize(int64_t delta);
 
         int64_t dataSize;
         Records records;
@@ -32,9 +32,11 @@
 
 #include "mongo/db/storage/ephemeral_for_test/ephemeral_for_test_record_store.h"
 
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/ephemeral_for_test/ephemeral_for_test_recovery_unit.h"
 #include "mongo/db/storage/record_store_test_harness.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
@@ -65,4 +67,37 @@ public:
 std::unique_ptr<HarnessHelper> newHarnessHelper() {
     return stdx::make_unique<EphemeralForTestHarnessHelper>();
 }
+
+TEST(EphemeralForTestRecordStoreTest, RejectsWritesOverMemoryLimit) {
+    const auto harnessHelper = newHarnessHelper();
+    const std::unique_ptr<RecordStore> rs(harnessHelper->newNonCappedRecordStore());
+
+    ServerParameter* maxRecordData =
+        ServerParameterSet::getGlobal()->getMap().at("ephemeralForTestMaxRecordDataBytes");
+    ASSERT_OK(maxRecordData->setFromString("100"));
+    // Asserting here could throw from a destructor while another assertion unwinds the test.
+    ON_BLOCK_EXIT([&] { maxRecordData->setFromString("0"); });
+
+    const std::string data(60, 'x');
+    auto opCtx = harnessHelper->newOperationContext();
+    {
+        WriteUnitOfWork uow(opCtx.get());
+        ASSERT_OK(rs->insertRecord(opCtx.get(), data.c_str(), data.size(), false).getStatus());
+        ASSERT_EQ(ErrorCodes::ExceededMemoryLimit,
+                  rs->insertRecord(opCtx.get(), data.c_str(), data.size(), false).getStatus());
+        uow.commit();
+    }
+    {
+        // Rolled back writes give their memory back.
+        WriteUnitOfWork uow(opCtx.get());
+        ASSERT_OK(rs->insertRecord(opCtx.get(), data.c_str(), 30, false).getStatus());
+    }
+
+    BSONObjBuilder stats;
+    EphemeralForTestRecordStore::appendMemoryStats(&stats);
+    ASSERT_BSONOBJ_EQ(BSON("recordDataBytes" << 60LL << "maxRecordDataBytes" << 100LL
+                                           << "writesRejected"
+                                           << 1LL),
+                      stats.obj());
+}
 }
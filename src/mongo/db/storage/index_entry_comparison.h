@@ -40,13 +40,18 @@ namespace mongo {
 
 /**
  * Represents a single item in an index. An index item simply consists of a key
- * and a disk location.
+ * and a disk location, plus the values of any non-key fields the index includes.
  */
 struct IndexKeyEntry {
-    IndexKeyEntry(BSONObj key, RecordId loc) : key(std::move(key)), loc(std::move(loc)) {}
+    IndexKeyEntry(BSONObj key, RecordId loc, BSONObj included = BSONObj())
+        : key(std::move(key)), loc(std::move(loc)), included(std::move(included)) {}
 
     BSONObj key;
     RecordId loc;
+
+    // Values of the index's included fields, in the same format as 'key'. Not part of the
+    // entry's identity, so ignored when comparing entries.
+    BSONObj included;
 };
 
 std::ostream& operator<<(std::ostream& stream, const IndexKeyEntry& entry);
@@ -270,6 +270,31 @@ public:
     }
 };
 
+/**
+ * Appends records to a RecordStore which was empty when the loader was made, more cheaply than
+ * RecordStore::insertRecord() can. Obtained from RecordStore::makeBulkLoader().
+ *
+ * Records appended through a loader are not part of any WriteUnitOfWork: they are kept even if
+ * the unit of work they were appended in rolls back. They are guaranteed to be visible to other
+ * users of the RecordStore once finish() succeeds, but may not be durable until the storage
+ * engine's next checkpoint, which StorageEngine::flushAllFiles() forces.
+ */
+class RecordStoreBulkLoader {
+public:
+    virtual ~RecordStoreBulkLoader() {}
+
+    /**
+     * Appends a record and returns its RecordId. RecordIds are assigned in increasing order.
+     */
+    virtual StatusWith<RecordId> insertRecord(const char* data, int len) = 0;
+
+    /**
+     * Finishes loading. Must be called once, after the last insertRecord(). A loader destroyed
+     * without a successful finish() leaves the RecordStore in an unspecified state.
+     */
+    virtual Status finish() = 0;
+};
+
 /**
  * A RecordStore provides an abstraction used for storing documents in a collection,
  * or entries in an index. In storage engines implementing the KVEngine, record stores
@@ -386,6 +411,19 @@ public:
         return Status::OK();
     }
 
+    /**
+     * Returns a loader which appends records to this RecordStore more cheaply than
+     * insertRecord(), or nullptr if this RecordStore is not empty or does not support bulk
+     * loading.
+     *
+     * The caller must hold the collection lock in MODE_X for as long as the loader exists, must
+     * not otherwise use this RecordStore until the loader is destroyed, and must be prepared to
+     * drop the collection if loading fails, since appended records are never rolled back.
+     */
+    virtual std::unique_ptr<RecordStoreBulkLoader> makeBulkLoader(OperationContext* txn) {
+        return nullptr;
+    }
+
     /**
      * Inserts nDocs documents into this RecordStore using the DocWriter interface.
      *
@@ -29,6 +29,7 @@
 #include <boost/optional/optional.hpp>
 #include <boost/optional/optional_io.hpp>
 #include <memory>
+#include <vector>
 
 #include "mongo/db/jsobj.h"
 #include "mongo/db/operation_context.h"
@@ -100,6 +101,26 @@ public:
                           const RecordId& loc,
                           bool dupsAllowed) = 0;
 
+    /**
+     * Return true if 'this' index can store the values of non-key included fields alongside each
+     * key, and return them from cursors positioned on that key.
+     */
+    virtual bool supportsIncludedFields() const {
+        return false;
+    }
+
+    /**
+     * Like insert(), but also stores 'included', the values of the index's included fields, with
+     * the entry. Only called when supportsIncludedFields() returns true.
+     */
+    virtual Status insertWithIncludedFields(OperationContext* txn,
+                                            const BSONObj& key,
+                                            const RecordId& loc,
+                                            bool dupsAllowed,
+                                            const BSONObj& included) {
+        return insert(txn, key, loc, dupsAllowed);
+    }
+
     /**
      * Remove the entry from the index with the specified key and RecordId.
      *
@@ -259,6 +280,28 @@ public:
          */
         virtual boost::optional<IndexKeyEntry> next(RequestedInfo parts = kKeyAndLoc) = 0;
 
+        /**
+         * Moves forward up to 'n' times, appending each entry to 'out', and returns the number of
+         * entries appended. Returning fewer than 'n' means the cursor hit the end, exactly as if
+         * next() had returned boost::none.
+         *
+         * Unlike next(), the returned BSON is owned, so the entries stay valid after the cursor
+         * moves again. They are not kept up to date with changes made after they were read.
+         */
+        virtual size_t nextBatch(size_t n,
+                                 std::vector<IndexKeyEntry>* out,
+                                 RequestedInfo parts = kKeyAndLoc) {
+            size_t count = 0;
+            while (count < n) {
+                auto kv = next(parts);
+                if (!kv)
+                    break;
+                out->emplace_back(kv->key.getOwned(), kv->loc, kv->included.getOwned());
+                ++count;
+            }
+            return count;
+        }
+
         //
         // Seeking
         //
@@ -400,6 +443,16 @@ public:
      */
     virtual Status addKey(const BSONObj& key, const RecordId& loc) = 0;
 
+    /**
+     * Like addKey(), but also stores 'included', the values of the index's included fields, with
+     * the entry. Only called when the index's supportsIncludedFields() returns true.
+     */
+    virtual Status addKeyWithIncludedFields(const BSONObj& key,
+                                            const RecordId& loc,
+                                            const BSONObj& included) {
+        return addKey(key, loc);
+    }
+
     /**
      * Do any necessary work to finish building the tree.
      *
@@ -31,6 +31,7 @@
 #include "mongo/db/storage/sorted_data_interface_test_harness.h"
 
 #include <memory>
+#include <vector>
 
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/unittest/unittest.h"
@@ -122,6 +123,45 @@ TEST(SortedDataInterface, ExhaustCursor) {
     }
 }
 
+// Read a forward cursor in batches until it is exhausted. A batch stops short at the end
+// position, and the entries returned stay valid after the cursor moves on.
+TEST(SortedDataInterface, ExhaustCursorInBatches) {
+    const std::unique_ptr<HarnessHelper> harnessHelper(newHarnessHelper());
+    const std::unique_ptr<SortedDataInterface> sorted(harnessHelper->newSortedDataInterface(false));
+
+    int nToInsert = 10;
+    for (int i = 0; i < nToInsert; i++) {
+        const ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+        {
+            WriteUnitOfWork uow(opCtx.get());
+            BSONObj key = BSON("" << i);
+            RecordId loc(42, i * 2);
+            ASSERT_OK(sorted->insert(opCtx.get(), key, loc, true));
+            uow.commit();
+        }
+    }
+
+    {
+        const ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+        const std::unique_ptr<SortedDataInterface::Cursor> cursor(sorted->newCursor(opCtx.get()));
+        cursor->setEndPosition(BSON("" << 7), true);
+        ASSERT_EQ(cursor->seek(kMinBSONKey, true), IndexKeyEntry(BSON("" << 0), RecordId(42, 0)));
+
+        std::vector<IndexKeyEntry> entries;
+        ASSERT_EQ(cursor->nextBatch(4, &entries), 4U);
+        ASSERT_EQ(cursor->nextBatch(4, &entries), 3U);
+        ASSERT_EQ(cursor->nextBatch(4, &entries), 0U);
+
+        ASSERT_EQ(entries.size(), 7U);
+        for (int i = 1; i <= 7; i++) {
+            ASSERT_EQ(entries[i - 1], IndexKeyEntry(BSON("" << i), RecordId(42, i * 2)));
+        }
+
+        // Cursor at EOF should remain at EOF when advanced
+        ASSERT(!cursor->next());
+    }
+}
+
 // Call advance() on a reverse cursor until it is exhausted.
 // When a cursor positioned at EOF is advanced, it stays at EOF.
 TEST(SortedDataInterface, ExhaustCursorReversed) {
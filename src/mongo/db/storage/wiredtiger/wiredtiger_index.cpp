@@ -85,8 +85,10 @@ static const WiredTigerItem emptyItem(NULL, 0);
 // Keystring format 7 was used in 3.3.6 - 3.3.8 development releases.
 static const int kKeyStringV0Version = 6;
 static const int kKeyStringV1Version = 8;
+// V1 keystrings, with the values of the index's included fields appended to the TypeBits.
+static const int kIncludedFieldsVersion = 9;
 static const int kMinimumIndexVersion = kKeyStringV0Version;
-static const int kMaximumIndexVersion = kKeyStringV1Version;
+static const int kMaximumIndexVersion = kIncludedFieldsVersion;
 
 bool hasFieldNames(const BSONObj& obj) {
     BSONForEach(e, obj) {
@@ -117,6 +119,25 @@ Status checkKeySize(const BSONObj& key) {
     return Status::OK();
 }
 
+/**
+ * Returns the value of the standard index entry for 'key'. The value holds the key's TypeBits,
+ * followed by the 'included' field values if there are any, in which case 'buffer' holds the
+ * value. The TypeBits are then always written out since cursors need to find where they end.
+ */
+WiredTigerItem makeStandardIndexValue(const KeyString& key,
+                                      const BSONObj& included,
+                                      BufBuilder* buffer) {
+    if (!included.isEmpty()) {
+        buffer->appendBuf(key.getTypeBits().getBuffer(), key.getTypeBits().getSize());
+        buffer->appendBuf(included.objdata(), included.objsize());
+        return WiredTigerItem(buffer->buf(), buffer->len());
+    }
+
+    return key.getTypeBits().isAllZeros()
+        ? emptyItem
+        : WiredTigerItem(key.getTypeBits().getBuffer(), key.getTypeBits().getSize());
+}
+
 }  // namespace
 
 Status WiredTigerIndex::dupKeyError(const BSONObj& key) {
@@ -194,9 +215,16 @@ StatusWith<std::string> WiredTigerIndex::generateCreateString(const std::string&
     // Indexes need to store the metadata for collation to work as expected.
     ss << ",key_format=u,value_format=u";
 
+    // Indexes with included fields get a format version of their own, which older versions of
+    // mongod refuse to open instead of misreading the entries' values.
+    int formatVersion = enableBSON1_1 ? kKeyStringV1Version : kKeyStringV0Version;
+    if (!desc.includedFields().isEmpty()) {
+        formatVersion = kIncludedFieldsVersion;
+    }
+
     // Index metadata
     ss << ",app_metadata=("
-       << "formatVersion=" << (enableBSON1_1 ? kKeyStringV1Version : kKeyStringV0Version) << ','
+       << "formatVersion=" << formatVersion << ','
        << "infoObj=" << desc.infoObj().jsonString() << "),";
 
     LOG(3) << "index create string: " << ss.ss.str();
@@ -235,7 +263,8 @@ WiredTigerIndex::WiredTigerIndex(OperationContext* ctx,
         fassertFailedWithStatusNoTrace(28579, indexVersionStatus);
     }
     _keyStringVersion =
-        version.getValue() == kKeyStringV1Version ? KeyString::Version::V1 : KeyString::Version::V0;
+        version.getValue() >= kKeyStringV1Version ? KeyString::Version::V1 : KeyString::Version::V0;
+    _storesIncludedFields = version.getValue() == kIncludedFieldsVersion;
 }
 
 Status WiredTigerIndex::insert(OperationContext* txn,
@@ -453,8 +482,10 @@ Status WiredTigerIndex::compact(OperationContext* txn) {
     if (!cache->isEphemeral()) {
         UniqueWiredTigerSession session = cache->getSession();
         WT_SESSION* s = session->getSession();
+        // Compaction can run alongside other operations on the table, which may leave it busy.
         int ret = s->compact(s, uri().c_str(), "timeout=0");
-        invariantWTOK(ret);
+        if (ret)
+            return wtRCToStatus(ret, "WiredTigerIndex::compact");
     }
     return Status::OK();
 }
@@ -513,6 +544,12 @@ public:
         : BulkBuilder(idx, txn), _idx(idx) {}
 
     Status addKey(const BSONObj& key, const RecordId& id) {
+        return addKeyWithIncludedFields(key, id, BSONObj());
+    }
+
+    Status addKeyWithIncludedFields(const BSONObj& key,
+                                    const RecordId& id,
+                                    const BSONObj& included) {
         {
             const Status s = checkKeySize(key);
             if (!s.isOK())
@@ -525,9 +562,8 @@ public:
         WiredTigerItem item(data.getBuffer(), data.getSize());
         _cursor->set_key(_cursor, item.Get());
 
-        WiredTigerItem valueItem = data.getTypeBits().isAllZeros()
-            ? emptyItem
-            : WiredTigerItem(data.getTypeBits().getBuffer(), data.getTypeBits().getSize());
+        BufBuilder value;
+        WiredTigerItem valueItem = makeStandardIndexValue(data, included, &value);
 
         _cursor->set_value(_cursor, valueItem.Get());
 
@@ -664,6 +700,21 @@ public:
         return curr(parts);
     }
 
+    size_t nextBatch(size_t n, std::vector<IndexKeyEntry>* out, RequestedInfo parts) override {
+        // Keys and included values built by curr() are already owned, so entries can be handed
+        // out as-is without the copy the default implementation makes.
+        out->reserve(out->size() + n);
+        size_t count = 0;
+        while (count < n) {
+            auto kv = WiredTigerIndexCursorBase::next(parts);
+            if (!kv)
+                break;
+            out->push_back(std::move(*kv));
+            ++count;
+        }
+        return count;
+    }
+
     void setEndPosition(const BSONObj& key, bool inclusive) override {
         TRACE_CURSOR << "setEndPosition inclusive: " << inclusive << ' ' << key;
         if (key.isEmpty()) {
@@ -777,6 +828,10 @@ protected:
             TRACE_CURSOR << " returning " << bson << ' ' << _id;
         }
 
+        if (parts & kWantKey) {
+            return {{std::move(bson), _id, _included}};
+        }
+
         return {{std::move(bson), _id}};
     }
 
@@ -912,6 +967,9 @@ protected:
     RecordId _id;
     bool _eof = true;
 
+    // The values of the index's included fields at the current position, if it stores any.
+    BSONObj _included;
+
     // This differs from _eof in that it always reflects the result of the most recent call to
     // reposition _cursor.
     bool _cursorAtEof = false;
@@ -938,6 +996,9 @@ public:
         invariantWTOK(c->get_value(c, &item));
         BufReader br(item.data, item.size);
         _typeBits.resetFromBuffer(&br);
+
+        // Any included field values follow the type bits.
+        _included = br.atEof() ? BSONObj() : BSONObj(static_cast<const char*>(br.pos())).getOwned();
     }
 };
 
@@ -1165,20 +1226,44 @@ SortedDataBuilderInterface* WiredTigerIndexStandard::getBulkBuilder(OperationCon
     return new StandardBulkBuilder(this, txn);
 }
 
+Status WiredTigerIndexStandard::insertWithIncludedFields(OperationContext* txn,
+                                                         const BSONObj& key,
+                                                         const RecordId& id,
+                                                         bool dupsAllowed,
+                                                         const BSONObj& included) {
+    invariant(id.isNormal());
+    dassert(!hasFieldNames(key));
+
+    Status s = checkKeySize(key);
+    if (!s.isOK())
+        return s;
+
+    WiredTigerCursor curwrap(_uri, _tableId, false, txn);
+    curwrap.assertInActiveTxn();
+
+    invariant(dupsAllowed);
+    return _insertEntry(curwrap.get(), key, id, included);
+}
+
 Status WiredTigerIndexStandard::_insert(WT_CURSOR* c,
                                         const BSONObj& keyBson,
                                         const RecordId& id,
                                         bool dupsAllowed) {
     invariant(dupsAllowed);
+    return _insertEntry(c, keyBson, id, BSONObj());
+}
 
-    TRACE_INDEX << " key: " << keyBson << " id: " << id;
+Status WiredTigerIndexStandard::_insertEntry(WT_CURSOR* c,
+                                             const BSONObj& keyBson,
+                                             const RecordId& id,
+                                             const BSONObj& included) {
+    TRACE_INDEX << " key: " << keyBson << " id: " << id << " included: " << included;
 
     KeyString key(keyStringVersion(), keyBson, _ordering, id);
     WiredTigerItem keyItem(key.getBuffer(), key.getSize());
 
-    WiredTigerItem valueItem = key.getTypeBits().isAllZeros()
-        ? emptyItem
-        : WiredTigerItem(key.getTypeBits().getBuffer(), key.getTypeBits().getSize());
+    BufBuilder value;
+    WiredTigerItem valueItem = makeStandardIndexValue(key, included, &value);
 
     c->set_key(c, keyItem.Get());
     c->set_value(c, valueItem.Get());
@@ -147,6 +147,8 @@ protected:
     const Ordering _ordering;
     // The keystring version is effectively const after the WiredTigerIndex instance is constructed.
     KeyString::Version _keyStringVersion;
+    // Whether the index's data format allows storing included field values after the TypeBits.
+    bool _storesIncludedFields;
     std::string _uri;
     uint64_t _tableId;
     std::string _collectionNamespace;
@@ -189,9 +191,29 @@ public:
         return false;
     }
 
+    bool supportsIncludedFields() const override {
+        return _storesIncludedFields;
+    }
+
+    Status insertWithIncludedFields(OperationContext* txn,
+                                    const BSONObj& key,
+                                    const RecordId& id,
+                                    bool dupsAllowed,
+                                    const BSONObj& included) override;
+
     Status _insert(WT_CURSOR* c, const BSONObj& key, const RecordId& id, bool dupsAllowed) override;
 
     void _unindex(WT_CURSOR* c, const BSONObj& key, const RecordId& id, bool dupsAllowed) override;
+
+private:
+    /**
+     * Inserts the entry for 'key' and 'id', storing the 'included' field values with it if
+     * there are any.
+     */
+    Status _insertEntry(WT_CURSOR* c,
+                        const BSONObj& key,
+                        const RecordId& id,
+                        const BSONObj& included);
 };
 
 }  // namespace
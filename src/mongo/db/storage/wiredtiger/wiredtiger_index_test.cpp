@@ -66,13 +66,24 @@ public:
     }
 
     std::unique_ptr<SortedDataInterface> newSortedDataInterface(bool unique) final {
+        return newSortedDataInterface(unique, BSONObj());
+    }
+
+    /**
+     * Creates an index whose spec holds the fields of 'extraSpec' in addition to the usual ones.
+     */
+    std::unique_ptr<SortedDataInterface> newSortedDataInterface(bool unique,
+                                                                const BSONObj& extraSpec) {
         std::string ns = "test.wt";
         OperationContextNoop txn(newRecoveryUnit().release());
 
-        BSONObj spec = BSON("key" << BSON("a" << 1) << "name"
-                                  << "testIndex"
-                                  << "ns"
-                                  << ns);
+        BSONObjBuilder specBuilder;
+        specBuilder.appendElements(extraSpec);
+        specBuilder << "key" << BSON("a" << 1) << "name"
+                    << "testIndex"
+                    << "ns"
+                    << ns;
+        BSONObj spec = specBuilder.obj();
 
         IndexDescriptor desc(NULL, "", spec);
 
@@ -142,4 +153,87 @@ TEST(WiredTigerIndexTest, GenerateCreateStringValidConfigStringOption) {
     ASSERT_EQ(WiredTigerIndex::parseIndexOptions(spec), std::string("prefix_compression=true,"));
 }
 
+TEST(WiredTigerIndexTest, OnlyIndexesCreatedWithIncludedFieldsStoreThem) {
+    {
+        MyHarnessHelper harnessHelper;
+        ASSERT_FALSE(
+            harnessHelper.newSortedDataInterface(/*unique*/ false)->supportsIncludedFields());
+    }
+    {
+        MyHarnessHelper harnessHelper;
+        ASSERT(harnessHelper
+                   .newSortedDataInterface(/*unique*/ false, BSON("include" << BSON_ARRAY("b")))
+                   ->supportsIncludedFields());
+    }
+}
+
+TEST(WiredTigerIndexTest, CursorReturnsIncludedFields) {
+    const auto harnessHelper = stdx::make_unique<MyHarnessHelper>();
+    const std::unique_ptr<SortedDataInterface> sorted(harnessHelper->newSortedDataInterface(
+        /*unique*/ false, BSON("include" << BSON_ARRAY("b" << "c"))));
+    ASSERT(sorted->supportsIncludedFields());
+
+    // The second key has non-zero type bits, which are stored ahead of the included values.
+    const BSONObj intKey = BSON("" << 1);
+    const BSONObj doubleKey = BSON("" << 2.0);
+    const BSONObj included = BSON("" << "b" << "" << BSONNULL);
+    {
+        auto opCtx = harnessHelper->newOperationContext();
+        WriteUnitOfWork uow(opCtx.get());
+        ASSERT_OK(sorted->insertWithIncludedFields(opCtx.get(), intKey, loc1, true, included));
+        ASSERT_OK(sorted->insertWithIncludedFields(opCtx.get(), doubleKey, loc2, true, included));
+        ASSERT_OK(sorted->insert(opCtx.get(), key3, loc3, true));
+        uow.commit();
+    }
+
+    auto opCtx = harnessHelper->newOperationContext();
+    const auto cursor = sorted->newCursor(opCtx.get());
+
+    auto entry = cursor->seek(intKey, true);
+    ASSERT(entry);
+    ASSERT_EQ(*entry, IndexKeyEntry(intKey, loc1));
+    ASSERT_BSONOBJ_EQ(entry->included, included);
+
+    entry = cursor->next();
+    ASSERT(entry);
+    ASSERT_EQ(*entry, IndexKeyEntry(doubleKey, loc2));
+    ASSERT_EQ(NumberDouble, entry->key.firstElement().type());
+    ASSERT_BSONOBJ_EQ(entry->included, included);
+
+    entry = cursor->next();
+    ASSERT(entry);
+    ASSERT_EQ(*entry, IndexKeyEntry(key3, loc3));
+    ASSERT(entry->included.isEmpty());
+}
+
+TEST(WiredTigerIndexTest, BulkBuilderStoresIncludedFields) {
+    const auto harnessHelper = stdx::make_unique<MyHarnessHelper>();
+    const std::unique_ptr<SortedDataInterface> sorted(harnessHelper->newSortedDataInterface(
+        /*unique*/ false, BSON("include" << BSON_ARRAY("b"))));
+
+    const BSONObj included = BSON("" << 2.0);
+    {
+        auto opCtx = harnessHelper->newOperationContext();
+        const std::unique_ptr<SortedDataBuilderInterface> builder(
+            sorted->getBulkBuilder(opCtx.get(), true));
+        ASSERT_OK(builder->addKeyWithIncludedFields(key1, loc1, included));
+        ASSERT_OK(builder->addKey(key2, loc2));
+        builder->commit(false);
+    }
+
+    auto opCtx = harnessHelper->newOperationContext();
+    const auto cursor = sorted->newCursor(opCtx.get());
+
+    auto entry = cursor->seek(key1, true);
+    ASSERT(entry);
+    ASSERT_EQ(*entry, IndexKeyEntry(key1, loc1));
+    ASSERT_BSONOBJ_EQ(entry->included, included);
+    ASSERT_EQ(NumberDouble, entry->included.firstElement().type());
+
+    entry = cursor->next();
+    ASSERT(entry);
+    ASSERT_EQ(*entry, IndexKeyEntry(key2, loc2));
+    ASSERT(entry->included.isEmpty());
+}
+
 }  // namespace mongo
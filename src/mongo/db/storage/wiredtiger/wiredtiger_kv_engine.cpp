@@ -62,6 +62,8 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
 #include "mongo/util/background.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/exit.h"
@@ -122,6 +124,60 @@ private:
     std::atomic<bool> _shuttingDown{false};  // NOLINT
 };
 
+/**
+ * Periodically writes the record and data size counters of dirty collections to the size storer
+ * table, so that operation threads never pay for it.
+ */
+class WiredTigerKVEngine::WiredTigerSizeStorerFlusher : public BackgroundJob {
+public:
+    explicit WiredTigerSizeStorerFlusher(WiredTigerKVEngine* engine)
+        : BackgroundJob(false /* deleteSelf */), _engine(engine) {}
+
+    virtual string name() const {
+        return "WTSizeStorerFlusher";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+
+        LOG(1) << "starting " << name() << " thread";
+
+        while (true) {
+            {
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                _cv.wait_for(lk, kSyncInterval.toSystemDuration(), [&] { return _shuttingDown; });
+
+                if (_shuttingDown)
+                    break;
+            }
+
+            _engine->syncSizeInfo(false);
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    void shutdown() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _shuttingDown = true;
+        }
+        _cv.notify_one();
+        wait();
+    }
+
+private:
+    static const Seconds kSyncInterval;
+
+    WiredTigerKVEngine* const _engine;
+
+    // Guards _shuttingDown.
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+    bool _shuttingDown = false;
+};
+
+const Seconds WiredTigerKVEngine::WiredTigerSizeStorerFlusher::kSyncInterval(60);
+
 namespace {
 
 class TicketServerParameter : public ServerParameter {
@@ -183,7 +239,6 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
     : _eventHandler(WiredTigerUtil::defaultEventHandlers()),
       _canonicalName(canonicalName),
       _path(path),
-      _sizeStorerSyncTracker(cs, 100000, Seconds(60)),
       _durable(durable),
       _ephemeral(ephemeral),
       _readOnly(readOnly) {
@@ -275,6 +330,11 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
     _sizeStorer.reset(new WiredTigerSizeStorer(_conn, _sizeStorerUri));
     _sizeStorer->fillCache();
 
+    if (!_readOnly) {
+        _sizeStorerFlusher = stdx::make_unique<WiredTigerSizeStorerFlusher>(this);
+        _sizeStorerFlusher->go();
+    }
+
     Locker::setGlobalThrottling(&openReadTransaction, &openWriteTransaction);
 }
 
@@ -308,6 +368,10 @@ void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
 
 void WiredTigerKVEngine::cleanShutdown() {
     log() << "WiredTigerKVEngine shutting down";
+    if (_sizeStorerFlusher) {
+        _sizeStorerFlusher->shutdown();
+        _sizeStorerFlusher.reset();
+    }
     if (!_readOnly)
         syncSizeInfo(true);
     if (_conn) {
@@ -575,11 +639,6 @@ bool WiredTigerKVEngine::haveDropsQueued() const {
     Date_t now = Date_t::now();
     Milliseconds delta = now - _previousCheckedDropsQueued;
 
-    if (!_readOnly && _sizeStorerSyncTracker.intervalHasElapsed()) {
-        _sizeStorerSyncTracker.resetLastTime();
-        syncSizeInfo(false);
-    }
-
     // We only want to check the queue max once per second or we'll thrash
     // This is done in haveDropsQueued, not dropSomeQueuedIdents so we skip the mutex
     if (delta < Milliseconds(1000))
@@ -40,7 +40,6 @@
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/stdx/mutex.h"
-#include "mongo/util/elapsed_tracker.h"
 
 namespace mongo {
 
@@ -153,6 +152,7 @@ public:
 
 private:
     class WiredTigerJournalFlusher;
+    class WiredTigerSizeStorerFlusher;
 
     Status _salvageIfNeeded(const char* uri);
     void _checkIdentPath(StringData ident);
@@ -170,7 +170,7 @@ private:
 
     std::unique_ptr<WiredTigerSizeStorer> _sizeStorer;
     std::string _sizeStorerUri;
-    mutable ElapsedTracker _sizeStorerSyncTracker;
+    std::unique_ptr<WiredTigerSizeStorerFlusher> _sizeStorerFlusher;  // Depends on _sizeStorer
 
     bool _durable;
     bool _ephemeral;
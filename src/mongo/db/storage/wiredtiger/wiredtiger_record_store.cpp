@@ -657,6 +657,54 @@ StatusWith<std::string> WiredTigerRecordStore::parseOptionsField(const BSONObj o
     return StatusWith<std::string>(ss.str());
 }
 
+/**
+ * Appends records through a WiredTiger bulk cursor, which writes pages directly rather than going
+ * through the transactional insert path. Bulk loads are not logged, so the loaded records are only
+ * durable after the next checkpoint.
+ */
+class WiredTigerRecordStore::BulkLoader final : public RecordStoreBulkLoader {
+public:
+    BulkLoader(WiredTigerRecordStore* rs, UniqueWiredTigerSession session, WT_CURSOR* cursor)
+        : _rs(rs), _session(std::move(session)), _cursor(cursor) {}
+
+    ~BulkLoader() {
+        if (!_cursor)
+            return;
+        int ret = _cursor->close(_cursor);
+        if (ret)
+            warning() << "Failed to close bulk cursor on " << _rs->_uri << ": "
+                      << wiredtiger_strerror(ret);
+    }
+
+    Status finish() final {
+        invariant(_cursor);
+        WT_CURSOR* cursor = _cursor;
+        _cursor = nullptr;
+        return wtRCToStatus(cursor->close(cursor), "WiredTigerRecordStore::BulkLoader::finish");
+    }
+
+    StatusWith<RecordId> insertRecord(const char* data, int len) final {
+        // Records are appended in RecordId order, as bulk cursors require.
+        const RecordId id = _rs->_nextId();
+        _cursor->set_key(_cursor, _makeKey(id));
+        WiredTigerItem value(data, len);
+        _cursor->set_value(_cursor, value.Get());
+        int ret = _cursor->insert(_cursor);
+        if (ret)
+            return wtRCToStatus(ret, "WiredTigerRecordStore::BulkLoader::insertRecord");
+
+        // Bulk inserts are never rolled back, so neither are the size adjustments.
+        _rs->_numRecords.fetchAndAdd(1);
+        _rs->_increaseDataSize(nullptr, len);
+        return id;
+    }
+
+private:
+    WiredTigerRecordStore* const _rs;
+    const UniqueWiredTigerSession _session;
+    WT_CURSOR* _cursor;  // null once finished
+};
+
 class WiredTigerRecordStore::RandomCursor final : public RecordCursor {
 public:
     RandomCursor(OperationContext* txn, const WiredTigerRecordStore& rs, StringData config)
@@ -811,7 +859,6 @@ WiredTigerRecordStore::WiredTigerRecordStore(OperationContext* ctx,
       _cappedDeleteCheckCount(0),
       _useOplogHack(shouldUseOplogHack(ctx, _uri)),
       _sizeStorer(sizeStorer),
-      _sizeStorerCounter(0),
       _shuttingDown(false) {
     Status versionStatus = WiredTigerUtil::checkApplicationMetadataFormatVersion(
                                ctx, uri, kMinimumRecordStoreVersion, kMaximumRecordStoreVersion)
@@ -837,6 +884,7 @@ WiredTigerRecordStore::WiredTigerRecordStore(OperationContext* ctx,
     if (auto record = cursor.next()) {
         int64_t max = _makeKey(record->id);
         _oplog_highestSeen = record->id;
+        _oplogReadTill.store(_oplog_highestSeen.repr());
         _nextIdNum.store(1 + max);
 
         if (_sizeStorer) {
@@ -1308,8 +1356,10 @@ Status WiredTigerRecordStore::_insertRecords(OperationContext* txn,
 
     if (_useOplogHack && (highestId > _oplog_highestSeen)) {
         stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-        if (highestId > _oplog_highestSeen)
+        if (highestId > _oplog_highestSeen) {
             _oplog_highestSeen = highestId;
+            _publishVisibility_inlock();
+        }
     }
 
     for (size_t i = 0; i < nRecords; i++) {
@@ -1334,6 +1384,29 @@ Status WiredTigerRecordStore::_insertRecords(OperationContext* txn,
     return Status::OK();
 }
 
+std::unique_ptr<RecordStoreBulkLoader> WiredTigerRecordStore::makeBulkLoader(
+    OperationContext* txn) {
+    if (_isCapped || numRecords(txn) != 0)
+        return nullptr;
+
+    // Open cursors on the table, including cached ones, make opening a bulk cursor fail.
+    WiredTigerRecoveryUnit::get(txn)->getSession(txn)->closeAllCursors();
+
+    // Bulk cursors must be opened outside of a transaction, so use a session of our own.
+    UniqueWiredTigerSession session =
+        WiredTigerRecoveryUnit::get(txn)->getSessionCache()->getSession();
+    WT_SESSION* s = session->getSession();
+    WT_CURSOR* cursor;
+    int ret = s->open_cursor(s, _uri.c_str(), NULL, "bulk", &cursor);
+    if (ret) {
+        // WiredTiger refuses bulk cursors on tables which have ever held data or are in use.
+        LOG(1) << "Not bulk loading " << _uri << ": " << wiredtiger_strerror(ret);
+        return nullptr;
+    }
+
+    return stdx::make_unique<BulkLoader>(this, std::move(session), cursor);
+}
+
 StatusWith<RecordId> WiredTigerRecordStore::insertRecord(OperationContext* txn,
                                                          const char* data,
                                                          int len,
@@ -1349,19 +1422,27 @@ void WiredTigerRecordStore::_dealtWithCappedId(SortedRecordIds::iterator it) {
     invariant(&(*it) != NULL);
     stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
     _uncommittedRecordIds.erase(it);
+    _publishVisibility_inlock();
+}
+
+void WiredTigerRecordStore::_publishVisibility_inlock() {
+    const RecordId lowestHidden =
+        _uncommittedRecordIds.empty() ? RecordId() : _uncommittedRecordIds.front();
+    _lowestHiddenRecord.store(lowestHidden.repr());
+    _oplogReadTill.store(lowestHidden.isNull() ? _oplog_highestSeen.repr()
+                                               : lowestHidden.repr());
 }
 
 bool WiredTigerRecordStore::isCappedHidden(const RecordId& id) const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    if (_uncommittedRecordIds.empty()) {
+    const RecordId lowestHidden = lowestCappedHiddenRecord();
+    if (lowestHidden.isNull()) {
         return false;
     }
-    return _uncommittedRecordIds.front() <= id;
+    return lowestHidden <= id;
 }
 
 RecordId WiredTigerRecordStore::lowestCappedHiddenRecord() const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    return _uncommittedRecordIds.empty() ? RecordId() : _uncommittedRecordIds.front();
+    return RecordId(_lowestHiddenRecord.load());
 }
 
 Status WiredTigerRecordStore::insertRecordsWithDocWriter(OperationContext* txn,
@@ -1455,12 +1536,7 @@ StatusWith<RecordData> WiredTigerRecordStore::updateWithDamages(
 }
 
 void WiredTigerRecordStore::_oplogSetStartHack(WiredTigerRecoveryUnit* wru) const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    if (_uncommittedRecordIds.empty()) {
-        wru->setOplogReadTill(_oplog_highestSeen);
-    } else {
-        wru->setOplogReadTill(_uncommittedRecordIds.front());
-    }
+    wru->setOplogReadTill(RecordId(_oplogReadTill.load()));
 }
 
 std::unique_ptr<SeekableRecordCursor> WiredTigerRecordStore::getCursor(OperationContext* txn,
@@ -1523,8 +1599,10 @@ Status WiredTigerRecordStore::compact(OperationContext* txn,
     if (!cache->isEphemeral()) {
         UniqueWiredTigerSession session = cache->getSession();
         WT_SESSION* s = session->getSession();
+        // Compaction can run alongside other operations on the table, which may leave it busy.
         int ret = s->compact(s, getURI().c_str(), "timeout=0");
-        invariantWTOK(ret);
+        if (ret)
+            return wtRCToStatus(ret, "WiredTigerRecordStore::compact");
     }
     return Status::OK();
 }
@@ -1650,6 +1728,23 @@ void WiredTigerRecordStore::appendCustomStats(OperationContext* txn,
         bob.append("code", static_cast<int>(status.code()));
         bob.append("reason", status.reason());
     }
+
+    // The size of the records relative to the file space in use, which is how well the collection
+    // compresses on disk. The record size is current, but the file space is only updated by
+    // checkpoints, so the ratio is skewed by the writes made since the last one: it reads high
+    // after inserts and low after removes until the next checkpoint.
+    if (!_isEphemeral) {
+        StatusWith<int64_t> fileSize = WiredTigerUtil::getStatisticsValueAs<int64_t>(
+            s, "statistics:" + getURI(), "statistics=(fast)", WT_STAT_DSRC_BLOCK_SIZE);
+        StatusWith<int64_t> reusableSize = WiredTigerUtil::getStatisticsValueAs<int64_t>(
+            s, "statistics:" + getURI(), "statistics=(fast)", WT_STAT_DSRC_BLOCK_REUSE_BYTES);
+        if (fileSize.isOK() && reusableSize.isOK() &&
+            fileSize.getValue() > reusableSize.getValue()) {
+            bob.append("compressionRatio",
+                       static_cast<double>(dataSize(txn)) /
+                           (fileSize.getValue() - reusableSize.getValue()));
+        }
+    }
 }
 
 Status WiredTigerRecordStore::touch(OperationContext* txn, BSONObjBuilder* output) const {
@@ -1699,6 +1794,7 @@ void WiredTigerRecordStore::_addUncommitedRecordId_inlock(OperationContext* txn,
     SortedRecordIds::iterator it = _uncommittedRecordIds.insert(_uncommittedRecordIds.end(), id);
     txn->recoveryUnit()->registerChange(new CappedInsertChange(this, it));
     _oplog_highestSeen = id;
+    _publishVisibility_inlock();
 }
 
 boost::optional<RecordId> WiredTigerRecordStore::oplogStartHack(
@@ -1789,10 +1885,6 @@ void WiredTigerRecordStore::_increaseDataSize(OperationContext* txn, int64_t amo
 
     if (_dataSize.fetchAndAdd(amount) < 0)
         _dataSize.store(std::max(amount, int64_t(0)));
-
-    if (_sizeStorer && _sizeStorerCounter++ % 1000 == 0) {
-        _sizeStorer->storeToCache(_uri, _numRecords.load(), _dataSize.load());
-    }
 }
 
 int64_t WiredTigerRecordStore::_makeKey(const RecordId& id) {
@@ -1859,7 +1951,9 @@ void WiredTigerRecordStore::temp_cappedTruncateAfter(OperationContext* txn,
 
     if (_useOplogHack) {
         // Forget that we've ever seen a higher timestamp than we now have.
+        stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
         _oplog_highestSeen = lastKeptId;
+        _publishVisibility_inlock();
     }
 
     if (_oplogStones) {
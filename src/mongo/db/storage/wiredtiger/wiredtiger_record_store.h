@@ -146,6 +146,12 @@ public:
                                                      const char* damageSource,
                                                      const mutablebson::DamageVector& damages);
 
+    /**
+     * Bulk loading uses a WiredTiger bulk cursor, so it is only supported on tables which have
+     * never had any data and have no open cursors. Not supported for capped collections.
+     */
+    std::unique_ptr<RecordStoreBulkLoader> makeBulkLoader(OperationContext* txn) final;
+
     std::unique_ptr<SeekableRecordCursor> getCursor(OperationContext* txn,
                                                     bool forward) const final;
     std::unique_ptr<RecordCursor> getRandomCursor(OperationContext* txn) const final;
@@ -242,6 +248,7 @@ public:
     };
 
 private:
+    class BulkLoader;
     class Cursor;
     class RandomCursor;
 
@@ -257,6 +264,12 @@ private:
     void _dealtWithCappedId(SortedRecordIds::iterator it);
     void _addUncommitedRecordId_inlock(OperationContext* txn, const RecordId& id);
 
+    /**
+     * Publishes the visibility state derived from _uncommittedRecordIds and _oplog_highestSeen
+     * for readers. Must be called with _uncommittedRecordIdsMutex held after changing either.
+     */
+    void _publishVisibility_inlock();
+
     Status _insertRecords(OperationContext* txn, Record* records, size_t nRecords);
 
     RecordId _nextId();
@@ -297,12 +310,21 @@ private:
     RecordId _oplog_highestSeen;
     mutable stdx::mutex _uncommittedRecordIdsMutex;
 
+    // Copies of the visibility state above, published by _publishVisibility_inlock() so that
+    // readers never need to take _uncommittedRecordIdsMutex, which inserts and commits hold.
+    // _lowestHiddenRecord is the lowest uncommitted RecordId, or null if there is none, and
+    // _oplogReadTill is the point oplog readers may read up to: the lowest uncommitted RecordId,
+    // or _oplog_highestSeen if there is none. Both are stored as RecordId::repr().
+    AtomicInt64 _lowestHiddenRecord;
+    AtomicInt64 _oplogReadTill;
+
     AtomicInt64 _nextIdNum;
+    // The source of truth for this collection's size. The size storer reads these when it
+    // flushes, so writers never touch it.
     AtomicInt64 _dataSize;
     AtomicInt64 _numRecords;
 
     WiredTigerSizeStorer* _sizeStorer;  // not owned, can be NULL
-    int _sizeStorerCounter;
 
     bool _shuttingDown;
 
@@ -48,6 +48,7 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -384,6 +385,50 @@ TEST(WiredTigerRecordStoreTest, SizeStorer1) {
     rs.reset(NULL);  // this has to be deleted before ss
 }
 
+// Syncing the size storer writes the current counters of the record stores registered with it,
+// even though inserting never updates the size storer itself.
+TEST(WiredTigerRecordStoreTest, SizeStorerSyncReadsRecordStoreCounters) {
+    unique_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+    string sizeStorerUri = "table:sizeStorer";
+    WiredTigerSizeStorer ss(harnessHelper->conn(), sizeStorerUri);
+
+    string uri;
+    unique_ptr<RecordStore> rs;
+    {
+        unique_ptr<RecordStore> temp(harnessHelper->newNonCappedRecordStore());
+        uri = checked_cast<WiredTigerRecordStore*>(temp.get())->getURI();
+        temp.reset(NULL);
+
+        ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+        rs.reset(new WiredTigerRecordStore(
+            opCtx.get(), "a.b", uri, kWiredTigerEngineName, false, false, -1, -1, NULL, &ss));
+    }
+
+    int N = 2500;
+    {
+        ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+        WriteUnitOfWork uow(opCtx.get());
+        for (int i = 0; i < N; i++) {
+            ASSERT_OK(rs->insertRecord(opCtx.get(), "a", 2, false).getStatus());
+        }
+        uow.commit();
+    }
+
+    ss.syncCache(true);
+
+    {
+        WiredTigerSizeStorer ss2(harnessHelper->conn(), sizeStorerUri);
+        ss2.fillCache();
+        long long numRecords;
+        long long dataSize;
+        ss2.loadFromCache(uri, &numRecords, &dataSize);
+        ASSERT_EQUALS(N, numRecords);
+        ASSERT_EQUALS(N * 2, dataSize);
+    }
+
+    rs.reset(NULL);  // this has to be deleted before ss
+}
+
 namespace {
 
 class GoodValidateAdaptor : public ValidateAdaptor {
@@ -923,6 +968,90 @@ TEST(WiredTigerRecordStoreTest, OplogOrder) {
     }
 }
 
+TEST(WiredTigerRecordStoreTest, OplogVisibilityFollowsUncommittedInserts) {
+    unique_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+    unique_ptr<RecordStore> rs(harnessHelper->newCappedRecordStore("local.oplog.foo", 100000, -1));
+    const WiredTigerRecordStore* wrs = checked_cast<WiredTigerRecordStore*>(rs.get());
+
+    ASSERT(wrs->lowestCappedHiddenRecord().isNull());
+
+    auto client1 = harnessHelper->serviceContext()->makeClient("c1");
+    auto t1 = harnessHelper->newOperationContext(client1.get());
+    auto w1 = stdx::make_unique<WriteUnitOfWork>(t1.get());
+    const RecordId id1 = _oplogOrderInsertOplog(t1.get(), rs, 1);
+
+    RecordId id2;
+    auto client2 = harnessHelper->serviceContext()->makeClient("c2");
+    auto t2 = harnessHelper->newOperationContext(client2.get());
+    {
+        WriteUnitOfWork w2(t2.get());
+        id2 = _oplogOrderInsertOplog(t2.get(), rs, 2);
+
+        // Everything from the oldest uncommitted insert on is hidden.
+        ASSERT_EQ(id1, wrs->lowestCappedHiddenRecord());
+        ASSERT(wrs->isCappedHidden(id1));
+        ASSERT(wrs->isCappedHidden(id2));
+        w2.commit();
+    }
+
+    // Committing a later insert does not reveal it while an earlier one is outstanding.
+    ASSERT_EQ(id1, wrs->lowestCappedHiddenRecord());
+    ASSERT(wrs->isCappedHidden(id2));
+
+    // Rolling back the earlier insert makes the later one visible.
+    w1.reset();
+    ASSERT(wrs->lowestCappedHiddenRecord().isNull());
+    ASSERT_FALSE(wrs->isCappedHidden(id2));
+
+    auto client3 = harnessHelper->serviceContext()->makeClient("c3");
+    auto opCtx = harnessHelper->newOperationContext(client3.get());
+    auto cursor = rs->getCursor(opCtx.get());
+    auto record = cursor->next();
+    ASSERT(record);
+    ASSERT_EQ(id2, record->id);
+    ASSERT(!cursor->next());
+}
+
+TEST(WiredTigerRecordStoreTest, BulkLoadIntoEmptyRecordStore) {
+    unique_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+    unique_ptr<RecordStore> rs(harnessHelper->newNonCappedRecordStore());
+
+    std::vector<RecordId> ids;
+    {
+        ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+        auto loader = rs->makeBulkLoader(opCtx.get());
+        ASSERT(loader);
+        for (int i = 0; i < 100; i++) {
+            std::string data = str::stream() << "record " << i;
+            auto id = loader->insertRecord(data.c_str(), data.size() + 1);
+            ASSERT_OK(id.getStatus());
+            if (!ids.empty()) {
+                ASSERT_GT(id.getValue(), ids.back());
+            }
+            ids.push_back(id.getValue());
+        }
+        ASSERT_OK(loader->finish());
+    }
+
+    ServiceContext::UniqueOperationContext opCtx(harnessHelper->newOperationContext());
+    ASSERT_EQUALS(100, rs->numRecords(opCtx.get()));
+    auto cursor = rs->getCursor(opCtx.get());
+    for (int i = 0; i < 100; i++) {
+        auto record = cursor->next();
+        ASSERT(record);
+        ASSERT_EQ(ids[i], record->id);
+        ASSERT_EQUALS(std::string(str::stream() << "record " << i), record->data.data());
+    }
+    ASSERT(!cursor->next());
+    cursor.reset();
+
+    // Only empty record stores can be bulk loaded.
+    ASSERT(!rs->makeBulkLoader(opCtx.get()));
+
+    unique_ptr<RecordStore> capped(harnessHelper->newCappedRecordStore("a.c", 100000, -1));
+    ASSERT(!capped->makeBulkLoader(opCtx.get()));
+}
+
 TEST(WiredTigerRecordStoreTest, StorageSizeStatisticsDisabled) {
     WiredTigerHarnessHelper harnessHelper("statistics=(none)");
     unique_ptr<RecordStore> rs(harnessHelper.newNonCappedRecordStore("a.b"));
@@ -35,17 +35,34 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include <algorithm>
+
 #include "mongo/base/error_codes.h"
 #include "mongo/db/storage/journal_listener.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
+namespace {
+
+// Threads are assigned session cache partitions round robin, the first time they need one.
+AtomicUInt32 nextThreadPartition;
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL uint32_t threadPartition;  // 0 until assigned
+
+size_t numSessionCachePartitions() {
+    ProcessInfo p;
+    return std::max(p.getNumCores(), 1u);
+}
+
+}  // namespace
+
 WiredTigerSession::WiredTigerSession(WT_CONNECTION* conn, uint64_t epoch, uint64_t cursorEpoch)
     : _epoch(epoch),
       _cursorEpoch(cursorEpoch),
@@ -145,10 +162,18 @@ uint64_t WiredTigerSession::genTableId() {
 // -----------------------
 
 WiredTigerSessionCache::WiredTigerSessionCache(WiredTigerKVEngine* engine)
-    : _engine(engine), _conn(engine->getConnection()), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(engine),
+      _conn(engine->getConnection()),
+      _snapshotManager(_conn),
+      _shuttingDown(0),
+      _partitions(numSessionCachePartitions()) {}
 
 WiredTigerSessionCache::WiredTigerSessionCache(WT_CONNECTION* conn)
-    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(NULL),
+      _conn(conn),
+      _snapshotManager(_conn),
+      _shuttingDown(0),
+      _partitions(numSessionCachePartitions()) {}
 
 WiredTigerSessionCache::~WiredTigerSessionCache() {
     shuttingDown();
@@ -233,20 +258,49 @@ void WiredTigerSessionCache::closeAllCursors() {
     // Increment the cursor epoch so that all cursors from this epoch are closed.
     _cursorEpoch.fetchAndAdd(1);
 
-    stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-    for (SessionCache::iterator i = _sessions.begin(); i != _sessions.end(); i++) {
-        (*i)->closeAllCursors();
+    // Each partition's sessions are taken out of it while their cursors are closed, so the
+    // partition stays usable meanwhile.
+    for (auto&& partition : _partitions) {
+        SessionCache sessions;
+        {
+            scoped_spinlock lock(partition.lock);
+            sessions.swap(partition.sessions);
+        }
+
+        for (auto&& session : sessions) {
+            session->closeAllCursors();
+        }
+
+        // Sessions are only put back while their epoch is current, as in releaseSession().
+        SessionCache stale;
+        {
+            scoped_spinlock lock(partition.lock);
+            const uint64_t currentEpoch = _epoch.load();
+            for (auto&& session : sessions) {
+                if (session->_getEpoch() == currentEpoch) {
+                    partition.sessions.push_back(session);
+                } else {
+                    stale.push_back(session);
+                }
+            }
+        }
+
+        for (auto&& session : stale) {
+            delete session;
+        }
     }
 }
 
 void WiredTigerSessionCache::closeAll() {
-    // Increment the epoch as we are now closing all sessions with this epoch.
-    SessionCache swap;
+    // Increment the epoch as we are now closing all sessions with this epoch. This must happen
+    // before any partition is emptied, see releaseSession().
+    _epoch.fetchAndAdd(1);
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        _epoch.fetchAndAdd(1);
-        _sessions.swap(swap);
+    SessionCache swap;
+    for (auto&& partition : _partitions) {
+        scoped_spinlock lock(partition.lock);
+        swap.insert(swap.end(), partition.sessions.begin(), partition.sessions.end());
+        partition.sessions.clear();
     }
 
     for (SessionCache::iterator i = swap.begin(); i != swap.end(); i++) {
@@ -254,6 +308,21 @@ void WiredTigerSessionCache::closeAll() {
     }
 }
 
+size_t WiredTigerSessionCache::getIdleSessionsCount() {
+    size_t count = 0;
+    for (auto&& partition : _partitions) {
+        scoped_spinlock lock(partition.lock);
+        count += partition.sessions.size();
+    }
+    return count;
+}
+
+WiredTigerSessionCache::Partition& WiredTigerSessionCache::_partitionForThisThread() {
+    if (!threadPartition)
+        threadPartition = nextThreadPartition.addAndFetch(1);
+    return _partitions[threadPartition % _partitions.size()];
+}
+
 bool WiredTigerSessionCache::isEphemeral() {
     return _engine && _engine->isEphemeral();
 }
@@ -263,13 +332,16 @@ UniqueWiredTigerSession WiredTigerSessionCache::getSession() {
     // operations should be allowed to start.
     invariant(!(_shuttingDown.loadRelaxed() & kShuttingDownMask));
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        if (!_sessions.empty()) {
+    // Look in this thread's partition first, then in the others before creating a new session.
+    const size_t first = &_partitionForThisThread() - &_partitions.front();
+    for (size_t i = 0; i < _partitions.size(); ++i) {
+        Partition& partition = _partitions[(first + i) % _partitions.size()];
+        scoped_spinlock lock(partition.lock);
+        if (!partition.sessions.empty()) {
             // Get the most recently used session so that if we discard sessions, we're
             // discarding older ones
-            WiredTigerSession* cachedSession = _sessions.back();
-            _sessions.pop_back();
+            WiredTigerSession* cachedSession = partition.sessions.back();
+            partition.sessions.pop_back();
             return UniqueWiredTigerSession(cachedSession);
         }
     }
@@ -315,10 +387,11 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
     uint64_t currentEpoch = _epoch.load();
 
     if (session->_getEpoch() == currentEpoch) {  // check outside of lock to reduce contention
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
+        Partition& partition = _partitionForThisThread();
+        scoped_spinlock lock(partition.lock);
         if (session->_getEpoch() == _epoch.load()) {  // recheck inside the lock for correctness
             returnedToCache = true;
-            _sessions.push_back(session);
+            partition.sessions.push_back(session);
         }
     } else
         invariant(session->_getEpoch() < currentEpoch);
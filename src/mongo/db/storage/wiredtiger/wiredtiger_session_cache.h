@@ -33,6 +33,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <wiredtiger.h>
@@ -138,6 +139,11 @@ private:
 /**
  *  This cache implements a shared pool of WiredTiger sessions with the goal to amortize the
  *  cost of session creation and destruction over multiple uses.
+ *
+ *  Idle sessions are spread over several partitions, each with its own lock. A thread returns
+ *  sessions to, and first looks for them in, the partition it is assigned to, so that threads
+ *  rarely contend for the same lock. When its own partition is empty a thread takes a session
+ *  from another partition before creating a new one.
  */
 class WiredTigerSessionCache {
 public:
@@ -204,6 +210,11 @@ public:
         return _cursorEpoch.load();
     }
 
+    /**
+     * Returns the number of sessions currently cached for reuse.
+     */
+    size_t getIdleSessionsCount();
+
 private:
     WiredTigerKVEngine* _engine;  // not owned, might be NULL
     WT_CONNECTION* _conn;         // not owned
@@ -215,12 +226,23 @@ private:
     AtomicUInt32 _shuttingDown;
     static const uint32_t kShuttingDownMask = 1 << 31;
 
-    stdx::mutex _cacheLock;
     typedef std::vector<WiredTigerSession*> SessionCache;
-    SessionCache _sessions;
 
-    // Bumped when all open sessions need to be closed
-    AtomicUInt64 _epoch;  // atomic so we can check it outside of the lock
+    // The padding keeps the lock and session list of neighbouring partitions on separate cache
+    // lines. A std::vector doesn't honor over-aligned element types, so they can't be aligned.
+    struct Partition {
+        SpinLock lock;
+        SessionCache sessions;
+        char padding[64];
+    };
+
+    // One partition per core. Never resized, so partitions can be used without further locking.
+    std::vector<Partition> _partitions;
+
+    // Bumped when all open sessions need to be closed. A session is only added to a partition if
+    // its epoch is current while that partition's lock is held, and closeAll() bumps the epoch
+    // before emptying each partition under its lock, so no session from an old epoch is cached.
+    AtomicUInt64 _epoch;
 
     // Bumped when all open cursors need to be closed
     AtomicUInt64 _cursorEpoch;  // atomic so we can check it outside of the lock
@@ -239,6 +261,11 @@ private:
      * session and releasing it, the session is directly released. This method is thread safe.
      */
     void releaseSession(WiredTigerSession* session);
+
+    /**
+     * Returns the partition the calling thread prefers to take sessions from and return them to.
+     */
+    Partition& _partitionForThisThread();
 };
 
 /**
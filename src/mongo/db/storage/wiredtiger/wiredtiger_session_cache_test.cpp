@@ -0,0 +1,135 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace {
+
+class WiredTigerSessionCacheTest : public unittest::Test {
+public:
+    WiredTigerSessionCacheTest() : _dbpath("wt_test") {
+        int ret = wiredtiger_open(_dbpath.path().c_str(), NULL, "create,", &_conn);
+        ASSERT_OK(wtRCToStatus(ret));
+        _sessionCache.reset(new WiredTigerSessionCache(_conn));
+    }
+
+    ~WiredTigerSessionCacheTest() {
+        _sessionCache.reset();
+        _conn->close(_conn, NULL);
+    }
+
+    WiredTigerSessionCache* sessionCache() {
+        return _sessionCache.get();
+    }
+
+private:
+    unittest::TempDir _dbpath;
+    WT_CONNECTION* _conn;
+    std::unique_ptr<WiredTigerSessionCache> _sessionCache;
+};
+
+TEST_F(WiredTigerSessionCacheTest, ReleasedSessionIsReused) {
+    WiredTigerSession* first;
+    {
+        UniqueWiredTigerSession session = sessionCache()->getSession();
+        first = session.get();
+        ASSERT_EQ(0U, sessionCache()->getIdleSessionsCount());
+    }
+    ASSERT_EQ(1U, sessionCache()->getIdleSessionsCount());
+
+    UniqueWiredTigerSession session = sessionCache()->getSession();
+    ASSERT_EQ(first, session.get());
+    ASSERT_EQ(0U, sessionCache()->getIdleSessionsCount());
+}
+
+TEST_F(WiredTigerSessionCacheTest, SessionReleasedByAnotherThreadIsReused) {
+    stdx::thread([this] { sessionCache()->getSession(); }).join();
+    ASSERT_EQ(1U, sessionCache()->getIdleSessionsCount());
+
+    UniqueWiredTigerSession session = sessionCache()->getSession();
+    ASSERT_EQ(0U, sessionCache()->getIdleSessionsCount());
+}
+
+TEST_F(WiredTigerSessionCacheTest, CloseAllDiscardsIdleAndOutstandingSessions) {
+    UniqueWiredTigerSession outstanding = sessionCache()->getSession();
+    stdx::thread([this] { sessionCache()->getSession(); }).join();
+    ASSERT_EQ(1U, sessionCache()->getIdleSessionsCount());
+
+    sessionCache()->closeAll();
+    ASSERT_EQ(0U, sessionCache()->getIdleSessionsCount());
+
+    // A session obtained before closeAll() is closed rather than cached when released.
+    outstanding.reset();
+    ASSERT_EQ(0U, sessionCache()->getIdleSessionsCount());
+
+    // Sessions created afterwards are cached as usual.
+    sessionCache()->getSession();
+    ASSERT_EQ(1U, sessionCache()->getIdleSessionsCount());
+}
+
+TEST_F(WiredTigerSessionCacheTest, ConcurrentGetAndRelease) {
+    const int kNumThreads = 16;
+    const int kIterations = 20000;
+
+    Timer timer;
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+        threads.emplace_back([this] {
+            for (int j = 0; j < kIterations; ++j) {
+                UniqueWiredTigerSession session = sessionCache()->getSession();
+                invariant(session->getSession());
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    const long long micros = timer.micros();
+
+    // All sessions were returned to the cache rather than closed.
+    ASSERT_GTE(sessionCache()->getIdleSessionsCount(), 1U);
+
+    unittest::log() << "session cache get/release with " << kNumThreads << " threads: "
+                    << (kNumThreads * kIterations * 1000LL * 1000) / std::max(micros, 1LL)
+                    << " ops/sec";
+}
+
+}  // namespace
+}  // namespace mongo
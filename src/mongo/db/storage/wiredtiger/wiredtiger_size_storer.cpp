@@ -229,9 +229,16 @@ void WiredTigerSizeStorer::syncCache(bool syncToDisk) {
     invariantWTOK(session->commit_transaction(session, NULL));
 
     {
+        // Only clear entries which haven't changed again since they were snapshotted, otherwise
+        // the newer counts would never be written.
         stdx::lock_guard<stdx::mutex> lk(_entriesMutex);
-        for (Map::iterator it = _entries.begin(); it != _entries.end(); ++it) {
-            it->second.dirty = false;
+        for (Map::iterator it = myMap.begin(); it != myMap.end(); ++it) {
+            Map::iterator current = _entries.find(it->first);
+            if (current != _entries.end() &&
+                current->second.numRecords == it->second.numRecords &&
+                current->second.dataSize == it->second.dataSize) {
+                current->second.dirty = false;
+            }
         }
     }
 }
@@ -44,6 +44,13 @@ namespace mongo {
 class WiredTigerRecordStore;
 class WiredTigerSession;
 
+/**
+ * Persists the record and data size counters of every collection to a WiredTiger table.
+ *
+ * The counters of open collections live in their WiredTigerRecordStore, which registers itself
+ * with onCreate(). Writers only update those counters; syncCache() reads them, and writes out
+ * the entries which changed since the last sync.
+ */
 class WiredTigerSizeStorer {
 public:
     WiredTigerSizeStorer(WT_CONNECTION* conn, const std::string& storageUri);
@@ -62,7 +69,8 @@ public:
     void fillCache();
 
     /**
-     * Writes all changes to the underlying table.
+     * Writes all changes to the underlying table. Only entries whose counts changed since the
+     * last sync are written.
      */
     void syncCache(bool syncToDisk);
 
@@ -52,11 +52,14 @@
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/sorter/sortable_key_string.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/db/storage/mmap_v1/dur_stats.h"
 #include "mongo/db/storage/mmap_v1/mmap.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/dbtests/framework_options.h"
+#include "mongo/platform/random.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/util/log.h"
@@ -450,6 +453,176 @@ public:
     }
 };
 
+/** Value type for the sorter benchmarks. */
+class SorterBenchValue {
+public:
+    SorterBenchValue(long long n = 0) : _n(n) {}
+
+    struct SorterDeserializeSettings {};
+    void serializeForSorter(BufBuilder& buf) const {
+        buf.appendNum(_n);
+    }
+    static SorterBenchValue deserializeForSorter(BufReader& buf,
+                                                 const SorterDeserializeSettings&) {
+        return buf.read<LittleEndian<long long>>().value;
+    }
+    int memUsageForSorter() const {
+        return sizeof(SorterBenchValue);
+    }
+    SorterBenchValue getOwned() const {
+        return *this;
+    }
+
+private:
+    long long _n;
+};
+
+typedef std::pair<BSONObj, SorterBenchValue> SorterBenchData;
+
+class SorterBenchComparator {
+public:
+    explicit SorterBenchComparator(Ordering ordering = Ordering::make(BSONObj()))
+        : _ordering(ordering) {}
+
+    int operator()(const SorterBenchData& lhs, const SorterBenchData& rhs) const {
+        return lhs.first.woCompare(rhs.first, _ordering, false);
+    }
+
+private:
+    Ordering _ordering;
+};
+
+typedef std::pair<SortableKeyString, SorterBenchValue> SorterBenchKeyStringData;
+
+class SorterBenchKeyStringComparator {
+public:
+    int operator()(const SorterBenchKeyStringData& lhs,
+                   const SorterBenchKeyStringData& rhs) const {
+        return lhs.first.compare(rhs.first);
+    }
+};
+
+/**
+ * Sorts about 1GB of random string keys with 16MB of memory, so that the data is spilled to
+ * around a hundred files. Only merging the files is timed.
+ */
+template <size_t MergeThreads>
+class SorterMerge : public B {
+public:
+    string name() {
+        return str::stream() << "sorter-merge-1GB-" << MergeThreads << "-threads";
+    }
+    virtual int howLongMillis() {
+        return 0;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+
+    void prep() {
+        const SortOptions opts = SortOptions()
+                                     .TempDir(storageGlobalParams.dbpath + "/_tmp")
+                                     .ExtSortAllowed()
+                                     .MaxMemoryUsageBytes(16 * 1024 * 1024)
+                                     .MergeThreads(MergeThreads);
+        _sorter.reset(Sorter<BSONObj, SorterBenchValue>::make(opts, SorterBenchComparator()));
+
+        PseudoRandom random(1);
+        long long bytes = 0;
+        for (long long i = 0; bytes < 1024 * 1024 * 1024; ++i) {
+            char key[32];
+            for (auto&& c : key) {
+                c = 'a' + random.nextInt32(26);
+            }
+            BSONObj obj = BSON("" << StringData(key, sizeof(key)));
+            bytes += obj.objsize() + sizeof(long long);
+            _sorter->add(obj, i);
+        }
+    }
+
+    void timed() {
+        std::unique_ptr<Sorter<BSONObj, SorterBenchValue>::Iterator> it(_sorter->done());
+        while (it->more()) {
+            it->next();
+        }
+    }
+
+    void post() {
+        _sorter.reset();
+    }
+
+private:
+    std::unique_ptr<Sorter<BSONObj, SorterBenchValue>> _sorter;
+};
+
+/**
+ * Sorts a million compound keys in memory the way an index build on {a: 1, b: -1} does, either by
+ * comparing the BSON keys or by comparing their KeyString encodings. Encoding the keys and decoding
+ * them again on the way out is part of the timed work.
+ */
+template <bool UseKeyStrings>
+class SorterKeyComparison : public B {
+public:
+    string name() {
+        return str::stream() << "sorter-1M-keys-" << (UseKeyStrings ? "keystring" : "bson");
+    }
+    virtual int howLongMillis() {
+        return 0;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+
+    void prep() {
+        PseudoRandom random(1);
+        for (int i = 0; i < 1000 * 1000; ++i) {
+            char str[16];
+            for (auto&& c : str) {
+                c = 'a' + random.nextInt32(26);
+            }
+            _keys.push_back(
+                BSON("" << random.nextInt32(1000) << "" << StringData(str, sizeof(str))));
+        }
+    }
+
+    void timed() {
+        const BSONObj pattern = BSON("a" << 1 << "b" << -1);
+        const Ordering ordering = Ordering::make(pattern);
+        const SortOptions opts = SortOptions().MaxMemoryUsageBytes(1024 * 1024 * 1024);
+
+        if (UseKeyStrings) {
+            std::unique_ptr<Sorter<SortableKeyString, SorterBenchValue>> sorter(
+                Sorter<SortableKeyString, SorterBenchValue>::make(
+                    opts, SorterBenchKeyStringComparator()));
+            for (size_t i = 0; i < _keys.size(); ++i) {
+                KeyString ks(SortableKeyString::kVersion, _keys[i], ordering);
+                sorter->add(SortableKeyString(ks), i);
+            }
+            std::unique_ptr<Sorter<SortableKeyString, SorterBenchValue>::Iterator> it(
+                sorter->done());
+            while (it->more()) {
+                it->next().first.toBson(ordering);
+            }
+        } else {
+            std::unique_ptr<Sorter<BSONObj, SorterBenchValue>> sorter(
+                Sorter<BSONObj, SorterBenchValue>::make(opts, SorterBenchComparator(ordering)));
+            for (size_t i = 0; i < _keys.size(); ++i) {
+                sorter->add(_keys[i], i);
+            }
+            std::unique_ptr<Sorter<BSONObj, SorterBenchValue>::Iterator> it(sorter->done());
+            while (it->more()) {
+                it->next();
+            }
+        }
+    }
+
+    void post() {
+        _keys.clear();
+    }
+
+private:
+    std::vector<BSONObj> _keys;
+};
 
 class All : public Suite {
 public:
@@ -463,6 +636,18 @@ public:
         add<boosttimed_mutexspeed>();
         add<stdmutexspeed>();
         add<stdtimed_mutexspeed>();
+        add<SorterMerge<1>>();
+        add<SorterMerge<4>>();
+        add<SorterKeyComparison<false>>();
+        add<SorterKeyComparison<true>>();
     }
 } myall;
 }
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::BSONObj,
+                    PerfTests::SorterBenchValue,
+                    PerfTests::SorterBenchComparator);
+MONGO_CREATE_SORTER(mongo::SortableKeyString,
+                    PerfTests::SorterBenchValue,
+                    PerfTests::SorterBenchKeyStringComparator);
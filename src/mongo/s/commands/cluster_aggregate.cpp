@@ -249,6 +249,9 @@ Status ClusterAggregate::runAggregate(OperationContext* txn,
     std::string outputNsOrEmpty;
     if (DocumentSourceOut* out = dynamic_cast<DocumentSourceOut*>(pipeline.getValue()->output())) {
         outputNsOrEmpty = out->getOutputNs().ns();
+    } else if (DocumentSourceMerge* merge =
+                   dynamic_cast<DocumentSourceMerge*>(pipeline.getValue()->output())) {
+        outputNsOrEmpty = merge->getOutputNs().ns();
     }
 
     // Run merging command on random shard, unless a stage needs the primary shard. Need to use